@@ -0,0 +1,209 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "Heap.h"
+#include "MSTKruskal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Compare the union-find Kruskal of QHullMSTClusteringProcess with the heap
+// and relabeling version it replaced, on a synthetic point cloud.  Require the
+// same number of edges and total length, and the same spanning tree when no
+// two edge lengths tie.
+
+// Jittered lattice of 3 feature vectors (like pure plug T1, T2, PD samples)
+// with the edges to the 13 forward lattice neighbors, a connected candidate
+// graph with about the density of a 3D Delaunay triangulation.  Every edge
+// is listed twice, in both directions, as shared facets do.
+static void
+MakeSyntheticPointCloud(const unsigned int               numberOfVertices,
+                        std::vector<vnl_vector<float>> & vertices,
+                        std::vector<MSTEdge> &           edges)
+{
+  const auto side = static_cast<unsigned int>(std::ceil(std::cbrt(static_cast<double>(numberOfVertices))));
+
+  std::mt19937                          generator(numberOfVertices);
+  std::uniform_real_distribution<float> jitter(-0.3f, 0.3f);
+
+  vertices.clear();
+  for (unsigned int k = 0; k < numberOfVertices; k++)
+  {
+    const unsigned int x = k % side;
+    const unsigned int y = (k / side) % side;
+    const unsigned int z = k / (side * side);
+    vnl_vector<float>  v(3);
+    v[0] = 100.0f + 10.0f * (x + jitter(generator));
+    v[1] = 200.0f + 10.0f * (y + jitter(generator));
+    v[2] = 300.0f + 10.0f * (z + jitter(generator));
+    vertices.push_back(v);
+  }
+
+  edges.clear();
+  for (unsigned int k = 0; k < numberOfVertices; k++)
+  {
+    const int x = k % side;
+    const int y = (k / side) % side;
+    const int z = k / (side * side);
+    for (int dz = 0; dz <= 1; dz++)
+    {
+      for (int dy = (dz == 0) ? 0 : -1; dy <= 1; dy++)
+      {
+        for (int dx = (dz == 0 && dy == 0) ? 1 : -1; dx <= 1; dx++)
+        {
+          const int nx = x + dx;
+          const int ny = y + dy;
+          const int nz = z + dz;
+          if (nx < 0 || ny < 0 || nx >= static_cast<int>(side) || ny >= static_cast<int>(side) ||
+              nz >= static_cast<int>(side))
+          {
+            continue;
+          }
+          const unsigned int n = (nz * side + ny) * side + nx;
+          if (n >= numberOfVertices)
+          {
+            continue;
+          }
+          MSTEdge e;
+          e.i = k;
+          e.j = n;
+          edges.push_back(e);
+          std::swap(e.i, e.j);
+          edges.push_back(e);
+        }
+      }
+    }
+  }
+  std::shuffle(edges.begin(), edges.end(), generator);
+}
+
+// Kruskal as QHullMSTClusteringProcess used to run it
+static unsigned int
+ReferenceKruskal(const std::vector<vnl_vector<float>> & vertices,
+                 const std::vector<MSTEdge> &           edges,
+                 std::vector<MSTEdge> &                 mstEdges)
+{
+  const unsigned int numberOfVertices = vertices.size();
+  Heap<MSTEdge>      delaunayHeap;
+  for (const auto & candidate : edges)
+  {
+    MSTEdge                 e = candidate;
+    const vnl_vector<float> dij = vertices[e.i] - vertices[e.j];
+    e.dist = dij.squared_magnitude();
+    delaunayHeap.Insert(e);
+  }
+
+  std::vector<unsigned int> treeMap(numberOfVertices);
+  for (unsigned int i = 0; i < numberOfVertices; i++)
+  {
+    treeMap[i] = i;
+  }
+  mstEdges.clear();
+  while (!delaunayHeap.IsEmpty())
+  {
+    const MSTEdge      minEdge = delaunayHeap.ExtractMinimum();
+    const unsigned int map1 = treeMap[minEdge.i];
+    const unsigned int map2 = treeMap[minEdge.j];
+    if (map1 == map2)
+    {
+      continue;
+    }
+    for (unsigned int k = 0; k < numberOfVertices; k++)
+    {
+      if (treeMap[k] == map2)
+      {
+        treeMap[k] = map1;
+      }
+    }
+    mstEdges.push_back(minEdge);
+    if (mstEdges.size() == numberOfVertices - 1)
+    {
+      break;
+    }
+  }
+  return mstEdges.size();
+}
+
+// Edges as sorted (min, max) vertex pairs, for comparing trees
+static std::vector<std::pair<unsigned int, unsigned int>>
+SortedEdgePairs(const MSTEdge * edges, const unsigned int numberOfEdges)
+{
+  std::vector<std::pair<unsigned int, unsigned int>> pairs;
+  for (unsigned int k = 0; k < numberOfEdges; k++)
+  {
+    pairs.emplace_back(std::min(edges[k].i, edges[k].j), std::max(edges[k].i, edges[k].j));
+  }
+  std::sort(pairs.begin(), pairs.end());
+  return pairs;
+}
+
+static bool
+HasTiedLengths(std::vector<MSTEdge> edges)
+{
+  std::sort(edges.begin(), edges.end());
+  return std::adjacent_find(edges.begin(), edges.end(), [](const MSTEdge & a, const MSTEdge & b) {
+           return a.dist == b.dist;
+         }) != edges.end();
+}
+
+int
+main(int, char *[])
+{
+  constexpr unsigned int         numberOfVertices = 2000;
+  std::vector<vnl_vector<float>> vertices;
+  std::vector<MSTEdge>           candidates;
+  MakeSyntheticPointCloud(numberOfVertices, vertices, candidates);
+
+  std::vector<MSTEdge> edges = candidates;
+  MSTRemoveDuplicateEdges(edges);
+  MSTComputeEdgeLengths(vertices, edges);
+  std::vector<MSTEdge> mstEdges(numberOfVertices - 1);
+  const unsigned int   edgeCount = MSTKruskal(numberOfVertices, edges, mstEdges.data());
+
+  std::vector<MSTEdge> referenceEdges;
+  const unsigned int   referenceCount = ReferenceKruskal(vertices, candidates, referenceEdges);
+  bool                 identical = edgeCount == numberOfVertices - 1 && referenceCount == edgeCount;
+
+  // Every minimum spanning tree has the same sorted edge lengths, and so the
+  // same total length, the tree itself is unique when no two lengths tie.
+  // The reference sums through vnl, allow for the last bit.
+  double totalLength = 0.0;
+  double referenceTotalLength = 0.0;
+  for (unsigned int k = 0; k < edgeCount && k < referenceCount; k++)
+  {
+    identical &= std::abs(mstEdges[k].dist - referenceEdges[k].dist) <= 1e-6f * referenceEdges[k].dist;
+    totalLength += mstEdges[k].dist;
+    referenceTotalLength += referenceEdges[k].dist;
+  }
+  identical &= std::abs(totalLength - referenceTotalLength) <= 1e-6 * referenceTotalLength;
+  if (!HasTiedLengths(edges))
+  {
+    identical &= SortedEdgePairs(mstEdges.data(), edgeCount) == SortedEdgePairs(referenceEdges.data(), referenceCount);
+  }
+  if (!identical)
+  {
+    std::cerr << "Union-find Kruskal differs from the heap based reference" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -49,7 +49,7 @@
 
 #include "BRAINSFitHelper.h"
 #include "BRAINSABCUtilities.h"
-#include "itkAverageImageFilter.h"
+#include "itkRunningImageAccumulator.h"
 #include "itkBinaryThresholdImageFilter.h"
 #include <string>
 
@@ -115,21 +115,21 @@ AverageImageList(const std::vector<typename TImage::Pointer> & inputImageList)
     averageMask = multIF->GetOutput();
   }
 
-  using AvgFilterType = itk::AverageImageFilter<TImage, TImage>;
-  typename AvgFilterType::Pointer filter = AvgFilterType::New();
-  typename TImage::Pointer        referenceScaleImg = inputImageList[0];
-  filter->SetInput(0, referenceScaleImg);
+  // Fold each intensity matched image into a running mean as soon as it is
+  // computed, instead of keeping all of them for an AverageImageFilter.
+  using AccumulatorType = itk::RunningImageAccumulator<TImage, TImage>;
+  typename AccumulatorType::Pointer accumulator = AccumulatorType::New();
+  typename TImage::Pointer          referenceScaleImg = inputImageList[0];
+  accumulator->AddImage(referenceScaleImg);
   for (unsigned int i = 1; i < inputImageList.size(); ++i)
   {
-    // Modify inputImageList in place.
     typename TImage::Pointer temp = LinearRegressionIntensityMatching<TImage, TImage>(
       referenceScaleImg.GetPointer(), averageMask.GetPointer(), inputImageList[i].GetPointer());
-    filter->SetInput(i, temp);
+    accumulator->AddImage(temp);
   }
-  filter->Update();
   typename MultiplyFilterType::Pointer multIF = MultiplyFilterType::New();
   multIF->SetInput1(averageMask);
-  multIF->SetInput2(filter->GetOutput());
+  multIF->SetInput2(accumulator->GetMean());
   multIF->Update();
 
   return multIF->GetOutput();
@@ -39,6 +39,12 @@ NormalizeProbListInPlace<FloatImageType>(std::vector<FloatImageType::Pointer> &)
 template void
 ZeroNegativeValuesInPlace<FloatImageType>(std::vector<FloatImageType::Pointer> &);
 
+template std::vector<FloatImageType::Pointer>
+WarpImageListSinglePass<FloatImageType>(const std::vector<FloatImageType::Pointer> &,
+                                        const itk::ImageBase<3> *,
+                                        const std::vector<FloatImageType::PixelType> &,
+                                        const GenericTransformType *);
+
 MapOfFloatImageVectors
 ResampleImageListToFirstKeyImage(const std::string &            resamplerInterpolatorType,
                                  const MapOfFloatImageVectors & inputImageMap)
@@ -219,6 +219,12 @@ NormalizeProbListInPlace<FloatImageType>(std::vector<FloatImageType::Pointer> &)
 extern template void
 ZeroNegativeValuesInPlace<FloatImageType>(std::vector<FloatImageType::Pointer> &);
 
+extern template std::vector<FloatImageType::Pointer>
+WarpImageListSinglePass<FloatImageType>(const std::vector<FloatImageType::Pointer> &,
+                                        const itk::ImageBase<3> *,
+                                        const std::vector<FloatImageType::PixelType> &,
+                                        const GenericTransformType *);
+
 template <typename ImageType>
 typename ImageType::Pointer
 NormalizeInputIntensityImage(const typename ImageType::Pointer inputImage)
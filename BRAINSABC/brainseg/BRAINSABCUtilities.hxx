@@ -20,6 +20,9 @@
 #define __BRAINSABCUtilities__hxx__
 
 #include "ExtractSingleLargestRegion.h"
+#include "TransformToDisplacementField.h"
+
+#include "itkLinearInterpolateImageFunction.h"
 
 #include "tbb/blocked_range.h"
 #include "tbb/blocked_range2d.h"
@@ -136,6 +139,116 @@ DuplicateImageList(const std::vector<typename TInputImage::Pointer> & inputList)
   return outputList;
 }
 
+/*
+ * Resample all images of inputList onto the lattice of referenceOutput through
+ * warpTransform with linear interpolation, using defaultValues[i] outside of
+ * image i.  Gives the same result as one ResampleImageFilter per image, but
+ * each output voxel is mapped through the transform only once and all images
+ * are interpolated from that point in a single threaded pass.
+ */
+template <typename TImage>
+std::vector<typename TImage::Pointer>
+WarpImageListSinglePass(const std::vector<typename TImage::Pointer> &   inputList,
+                        const itk::ImageBase<TImage::ImageDimension> *  referenceOutput,
+                        const std::vector<typename TImage::PixelType> & defaultValues,
+                        const GenericTransformType *                    warpTransform)
+{
+  using InterpolatorType = itk::LinearInterpolateImageFunction<TImage, double>;
+  using PointType = typename TImage::PointType;
+  using ContinuousIndexType = itk::ContinuousIndex<double, TImage::ImageDimension>;
+
+  const unsigned int numImages = inputList.size();
+  if (defaultValues.size() != numImages)
+  {
+    itkGenericExceptionMacro(<< "ERROR:  inputList and defaultValues arrays sizes do not match" << std::endl);
+  }
+
+  // Images that share a physical lattice share the mapped continuous index,
+  // so group them by the first image with the same origin, spacing and direction.
+  std::vector<unsigned int>                       latticeOf(numImages);
+  std::vector<unsigned int>                       latticeRepresentative;
+  std::vector<typename InterpolatorType::Pointer> interpolators(numImages);
+  std::vector<typename TImage::Pointer>           outputList(numImages);
+  const typename TImage::RegionType               outputRegion = referenceOutput->GetLargestPossibleRegion();
+  for (unsigned int i = 0; i < numImages; ++i)
+  {
+    const TImage * current = inputList[i].GetPointer();
+    latticeOf[i] = latticeRepresentative.size();
+    for (unsigned int l = 0; l < latticeRepresentative.size(); ++l)
+    {
+      const TImage * representative = inputList[latticeRepresentative[l]].GetPointer();
+      if (current->GetOrigin() == representative->GetOrigin() &&
+          current->GetSpacing() == representative->GetSpacing() &&
+          current->GetDirection() == representative->GetDirection())
+      {
+        latticeOf[i] = l;
+        break;
+      }
+    }
+    if (latticeOf[i] == latticeRepresentative.size())
+    {
+      latticeRepresentative.push_back(i);
+    }
+
+    interpolators[i] = InterpolatorType::New();
+    interpolators[i]->SetInputImage(current);
+
+    outputList[i] = TImage::New();
+    outputList[i]->CopyInformation(referenceOutput);
+    outputList[i]->SetRegions(outputRegion);
+    outputList[i]->Allocate();
+  }
+  const unsigned int numLattices = latticeRepresentative.size();
+
+  const typename GenericTransformType::ConstPointer flatTransform =
+    FlattenLinearTransformChain<double, TImage::ImageDimension>(warpTransform);
+  const GenericTransformType * const transform = flatTransform.GetPointer();
+
+  const typename TImage::IndexType start = outputRegion.GetIndex();
+  const typename TImage::SizeType  size = outputRegion.GetSize();
+  {
+    tbb::parallel_for(
+      tbb::blocked_range3d<LOOPITERTYPE>(0, size[2], 1, 0, size[1], size[1] / 2, 0, size[0], 512),
+      [=, &inputList, &outputList, &interpolators, &latticeOf, &latticeRepresentative, &defaultValues](
+        const tbb::blocked_range3d<LOOPITERTYPE> & r) {
+        std::vector<ContinuousIndexType> latticeIndex(numLattices);
+        for (LOOPITERTYPE kk = r.pages().begin(); kk < r.pages().end(); ++kk)
+        {
+          for (LOOPITERTYPE jj = r.rows().begin(); jj < r.rows().end(); ++jj)
+          {
+            for (LOOPITERTYPE ii = r.cols().begin(); ii < r.cols().end(); ++ii)
+            {
+              const typename TImage::IndexType currIndex = { { start[0] + ii, start[1] + jj, start[2] + kk } };
+              PointType                        outputPoint;
+              referenceOutput->TransformIndexToPhysicalPoint(currIndex, outputPoint);
+              // The only transform evaluation for this voxel, shared by all images.
+              const PointType mappedPoint = transform->TransformPoint(outputPoint);
+              for (unsigned int l = 0; l < numLattices; ++l)
+              {
+                inputList[latticeRepresentative[l]]->TransformPhysicalPointToContinuousIndex(mappedPoint,
+                                                                                             latticeIndex[l]);
+              }
+              for (unsigned int i = 0; i < numImages; ++i)
+              {
+                const ContinuousIndexType & cindex = latticeIndex[latticeOf[i]];
+                if (interpolators[i]->IsInsideBuffer(cindex))
+                {
+                  outputList[i]->SetPixel(
+                    currIndex,
+                    static_cast<typename TImage::PixelType>(interpolators[i]->EvaluateAtContinuousIndex(cindex)));
+                }
+                else
+                {
+                  outputList[i]->SetPixel(currIndex, defaultValues[i]);
+                }
+              }
+            }
+          }
+        }
+      });
+  }
+  return outputList;
+}
 
 template <typename TProbabilityImage>
 typename ByteImageType::Pointer
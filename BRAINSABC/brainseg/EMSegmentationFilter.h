@@ -34,6 +34,7 @@
 #define __EMSegmentationFilter_h
 
 #include "GeneratePurePlugMask.h"
+#include "itkBackgroundImageFileWriter.h"
 #include <map>
 #include <list>
 class AtlasDefinition;
@@ -340,6 +341,10 @@ private:
   WriteDebugCorrectedImages(const MapOfInputImageVectors & correctImageList,
                             const unsigned int             CurrentEMIteration) const;
 
+  /** Wait for the queued debug images and log the ones that failed. */
+  void
+  FlushDebugImages() const;
+
   unsigned int
   ComputePriorLookupTable();
 
@@ -495,6 +500,9 @@ private:
 
   std::string m_OutputDebugDir;
 
+  /** Compresses and writes the WriteDebug* images off the EM loop. */
+  itk::BackgroundImageFileWriter::Pointer m_DebugImageWriter;
+
   std::vector<RegionStats> m_ListOfClassStatistics;
 
   bool m_UseKNN;
@@ -597,6 +597,8 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::EMSegmentationFilter()
   m_ThresholdedLabels = nullptr;
   m_DirtyThresholdedLabels = nullptr;
 
+  m_DebugImageWriter = itk::BackgroundImageFileWriter::New();
+
   m_SampleSpacing = 2.0;
 
   // Bias
@@ -674,7 +676,25 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::EMSegmentationFilter()
 }
 
 template <typename TInputImage, typename TProbabilityImage>
-EMSegmentationFilter<TInputImage, TProbabilityImage>::~EMSegmentationFilter() = default;
+EMSegmentationFilter<TInputImage, TProbabilityImage>::~EMSegmentationFilter()
+{
+  this->FlushDebugImages();
+}
+
+template <typename TInputImage, typename TProbabilityImage>
+void
+EMSegmentationFilter<TInputImage, TProbabilityImage>::FlushDebugImages() const
+{
+  // Debug images are compressed and written in the background, let them finish.
+  try
+  {
+    this->m_DebugImageWriter->Flush();
+  }
+  catch (itk::ExceptionObject & e)
+  {
+    muLogMacro(<< "WARNING: " << e.GetDescription() << std::endl);
+  }
+}
 
 template <typename TInputImage, typename TProbabilityImage>
 void
@@ -868,9 +888,6 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugPosteriors(
     write_posteriors_level_stream << write_posteriors_level;
     for (unsigned int iprob = 0; iprob < numPosteriors; iprob++)
     {
-      using ProbabilityImageWriterType = itk::ImageFileWriter<TProbabilityImage>;
-      typename ProbabilityImageWriterType::Pointer writer = ProbabilityImageWriterType::New();
-
       std::stringstream template_index_stream("");
       template_index_stream << iprob;
       const std::string fn = this->m_OutputDebugDir + "/POSTERIOR_" + ClassifierID + "_INDEX_" +
@@ -878,10 +895,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugPosteriors(
                              write_posteriors_level_stream.str() + ".nii.gz";
 
       muLogMacro(<< "Writing posterior images... " << fn << std::endl);
-      writer->SetInput(Posteriors[iprob]);
-      writer->SetFileName(fn);
-      writer->UseCompressionOn();
-      writer->Update();
+      this->m_DebugImageWriter->Write(Posteriors[iprob].GetPointer(), fn);
     }
   }
 }
@@ -1357,11 +1371,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::ComputePosteriors(
       write_label_image_level_stream << IterationID;
       const std::string fn =
         this->m_OutputDebugDir + "/KNNLabelsImage_Level_" + write_label_image_level_stream.str() + ".nii.gz";
-      using LabelImageWriterType = itk::ImageFileWriter<ByteImageType>;
-      typename LabelImageWriterType::Pointer cleanLabelWriter = LabelImageWriterType::New();
-      cleanLabelWriter->SetInput(dirtyThresholdedLabels);
-      cleanLabelWriter->SetFileName(fn);
-      cleanLabelWriter->Update();
+      this->m_DebugImageWriter->Write(dirtyThresholdedLabels.GetPointer(), fn, false);
     }
 
     itk::TimeProbe ComputeKNNPosteriorsTimer;
@@ -1412,16 +1422,10 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugLabels(const uns
     std::stringstream CurrentEMIteration_stream("");
     CurrentEMIteration_stream << CurrentEMIteration;
     {
-      using LabelImageWriterType = itk::ImageFileWriter<ByteImageType>;
-      typename LabelImageWriterType::Pointer writer = LabelImageWriterType::New();
-
       const std::string fn = this->m_OutputDebugDir + "/LABELS_LEVEL_" + CurrentEMIteration_stream.str() + ".nii.gz";
 
       muLogMacro(<< "Writing label images... " << fn << std::endl);
-      writer->SetInput(m_CleanedLabels);
-      writer->SetFileName(fn);
-      writer->UseCompressionOn();
-      writer->Update();
+      this->m_DebugImageWriter->Write(m_CleanedLabels.GetPointer(), fn);
     }
   }
   if (this->m_DebugLevel > 6)
@@ -1430,17 +1434,11 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugLabels(const uns
     std::stringstream CurrentEMIteration_stream("");
     CurrentEMIteration_stream << CurrentEMIteration;
     {
-      using LabelImageWriterType = itk::ImageFileWriter<ByteImageType>;
-      typename LabelImageWriterType::Pointer writer = LabelImageWriterType::New();
-
       const std::string fn =
         this->m_OutputDebugDir + "/LABELSDIRTY_LEVEL_" + CurrentEMIteration_stream.str() + ".nii.gz";
 
       muLogMacro(<< "Writing label images... " << fn << std::endl);
-      writer->SetInput(m_DirtyLabels);
-      writer->SetFileName(fn);
-      writer->UseCompressionOn();
-      writer->Update();
+      this->m_DebugImageWriter->Write(m_DirtyLabels.GetPointer(), fn);
     }
   }
 }
@@ -1461,17 +1459,12 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugCorrectedImages(
   {
     for (auto imIt = mapIt->second.begin(); imIt != mapIt->second.end(); ++imIt)
     {
-      using WriterType = itk::ImageFileWriter<InputImageType>;
-      typename WriterType::Pointer writer = WriterType::New();
-      writer->UseCompressionOn();
       std::stringstream template_index_stream("");
       template_index_stream << std::distance(mapIt->second.begin(), imIt);
       const std::string fn = this->m_OutputDebugDir + "/CORRECTED_INDEX_" + mapIt->first + template_index_stream.str() +
                              "_LEVEL_" + CurrentEMIteration_stream.str() + ".nii.gz";
-      writer->SetInput((*imIt));
-      writer->SetFileName(fn.c_str());
-      writer->Update();
-      muLogMacro(<< "DEBUG:  Wrote image " << fn << std::endl);
+      this->m_DebugImageWriter->Write(imIt->GetPointer(), fn);
+      muLogMacro(<< "DEBUG:  Queued image " << fn << std::endl);
     }
   }
 }
@@ -1546,15 +1539,9 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugHeadRegion(const
   std::stringstream CurrentEMIteration_stream("");
   CurrentEMIteration_stream << CurrentEMIteration;
   { // DEBUG:  This code is for debugging purposes only;
-    using WriterType = itk::ImageFileWriter<ByteImageType>;
-    typename WriterType::Pointer writer = WriterType::New();
-    writer->UseCompressionOn();
-
     const std::string fn = this->m_OutputDebugDir + "/HEAD_REGION_LEVEL_" + CurrentEMIteration_stream.str() + ".nii.gz";
-    writer->SetInput(this->m_NonAirRegion);
-    writer->SetFileName(fn.c_str());
-    writer->Update();
-    muLogMacro(<< "DEBUG:  Wrote image " << fn << std::endl);
+    this->m_DebugImageWriter->Write(this->m_NonAirRegion.GetPointer(), fn);
+    muLogMacro(<< "DEBUG:  Queued image " << fn << std::endl);
   }
 }
 
@@ -1569,22 +1556,9 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WarpImageList(ProbabilityI
   {
     itkGenericExceptionMacro(<< "ERROR:  originalList and backgroundValues arrays sizes do not match" << std::endl);
   }
-  std::vector<typename TInputImage::Pointer> warpedList(originalList.size());
-
-  using ResamplerType = itk::ResampleImageFilter<TInputImage, TInputImage>;
-  for (unsigned int vIndex = 0; vIndex < originalList.size(); vIndex++)
-  {
-    typename ResamplerType::Pointer warper = ResamplerType::New();
-    warper->SetInput(originalList[vIndex]);
-    warper->SetTransform(warpTransform);
-
-    // warper->SetInterpolator(linearInt); // Default is linear
-    warper->SetOutputParametersFromImage(referenceOutput);
-    warper->SetDefaultPixelValue(backgroundValues[vIndex]);
-    warper->Update();
-    warpedList[vIndex] = warper->GetOutput();
-  }
-  return warpedList;
+  // Map each voxel through warpTransform once for all of the priors.
+  return WarpImageListSinglePass<TInputImage>(
+    originalList, referenceOutput.GetPointer(), backgroundValues, warpTransform.GetPointer());
 }
 
 template <typename TInputImage, typename TProbabilityImage>
@@ -1593,24 +1567,24 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WarpImageList(MapOfInputIm
                                                                     const InputImagePointer             referenceOutput,
                                                                     const GenericTransformType::Pointer warpTransform)
 {
-  using ResamplerType = itk::ResampleImageFilter<TInputImage, TInputImage>;
+  // Warp the images of all modalities together so that each voxel is mapped
+  // through warpTransform only once.
+  InputImageVector flatList;
+  for (auto mapIt = originalList.begin(); mapIt != originalList.end(); ++mapIt)
+  {
+    flatList.insert(flatList.end(), mapIt->second.begin(), mapIt->second.end());
+  }
+  const BackgroundValueVector zeroBackground(flatList.size(), 0);
+  const InputImageVector      warpedFlatList = WarpImageListSinglePass<TInputImage>(
+    flatList, referenceOutput.GetPointer(), zeroBackground, warpTransform.GetPointer());
 
   MapOfInputImageVectors warpedList;
-
+  auto                   warpedIt = warpedFlatList.begin();
   for (auto mapIt = originalList.begin(); mapIt != originalList.end(); ++mapIt)
   {
-    for (auto imIt = mapIt->second.begin(); imIt != mapIt->second.end(); ++imIt)
-    {
-      typename ResamplerType::Pointer warper = ResamplerType::New();
-      warper->SetInput(*imIt);
-      warper->SetTransform(warpTransform);
-
-      // warper->SetInterpolator(linearInt); // Default is linear
-      warper->SetOutputParametersFromImage(referenceOutput);
-      warper->SetDefaultPixelValue(0);
-      warper->Update();
-      warpedList[mapIt->first].push_back(warper->GetOutput());
-    }
+    InputImageVector & warpedModality = warpedList[mapIt->first];
+    warpedModality.assign(warpedIt, warpedIt + mapIt->second.size());
+    warpedIt += mapIt->second.size();
   }
   return warpedList;
 }
@@ -1636,18 +1610,12 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugWarpedAtlasImage
       {
         for (auto imIt = mapIt->second.begin(); imIt != mapIt->second.end(); ++imIt)
         {
-          using WriterType = itk::ImageFileWriter<InputImageType>;
-          typename WriterType::Pointer writer = WriterType::New();
-          writer->UseCompressionOn();
-
           std::stringstream template_index_stream("");
           template_index_stream << mapIt->first << std::distance(mapIt->second.begin(), imIt);
           const std::string fn = this->m_OutputDebugDir + "/WARPED_ATLAS_INDEX_" + template_index_stream.str() +
                                  "_LEVEL_" + CurrentEMIteration_stream.str() + ".nii.gz";
-          writer->SetInput((*imIt));
-          writer->SetFileName(fn.c_str());
-          writer->Update();
-          muLogMacro(<< "DEBUG:  Wrote image " << fn << std::endl);
+          this->m_DebugImageWriter->Write(imIt->GetPointer(), fn);
+          muLogMacro(<< "DEBUG:  Queued image " << fn << std::endl);
         }
       }
     }
@@ -1721,12 +1689,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::UpdateIntensityBasedClippi
             logMessage << "Writing Subject Candidate Region: " << fn << std::endl;
             logMessage << std::endl;
 
-            using ByteWriterType = itk::ImageFileWriter<ByteImageType>;
-            typename ByteWriterType::Pointer writer = ByteWriterType::New();
-            writer->SetInput(probThreshImage);
-            writer->SetFileName(fn.c_str());
-            writer->UseCompressionOn();
-            writer->Update();
+            this->m_DebugImageWriter->Write(probThreshImage.GetPointer(), fn);
           }
 
           // All input images to the MultiModeHistogramThresholdBinaryImageFilter
@@ -1794,12 +1757,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::UpdateIntensityBasedClippi
             logMessage << "Writing Subject Candidate Region: " << fn << std::endl;
             logMessage << std::endl;
 
-            using ByteWriterType = itk::ImageFileWriter<ByteImageType>;
-            typename ByteWriterType::Pointer writer = ByteWriterType::New();
-            writer->SetInput(thresholdRegionFinder->GetOutput());
-            writer->SetFileName(fn.c_str());
-            writer->UseCompressionOn();
-            writer->Update();
+            this->m_DebugImageWriter->Write(thresholdRegionFinder->GetOutput(), fn);
           }
 
           // Now multiply the warped priors by the subject candidate regions.
@@ -1888,12 +1846,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::UpdateIntensityBasedClippi
         muLogMacro(<< "Writing Final Subject Candidate Region: " << fn << std::endl);
         muLogMacro(<< std::endl);
 
-        using ByteWriterType = itk::ImageFileWriter<ByteImageType>;
-        typename ByteWriterType::Pointer writer = ByteWriterType::New();
-        writer->SetInput(subjectCandidateRegions[i]);
-        writer->SetFileName(fn.c_str());
-        writer->UseCompressionOn();
-        writer->Update();
+        this->m_DebugImageWriter->Write(subjectCandidateRegions[i].GetPointer(), fn);
       }
     }
   } // END Valid regions section
@@ -2013,18 +1966,12 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugWarpedAtlasPrior
     {
       for (unsigned int vIndex = 0; vIndex < this->m_WarpedPriors.size(); vIndex++)
       {
-        using WriterType = itk::ImageFileWriter<InputImageType>;
-        typename WriterType::Pointer writer = WriterType::New();
-        writer->UseCompressionOn();
-
         std::stringstream template_index_stream("");
         template_index_stream << this->m_PriorNames[vIndex];
         const std::string fn = this->m_OutputDebugDir + "/WARPED_PRIOR_" + template_index_stream.str() + "_LEVEL_" +
                                CurrentEMIteration_stream.str() + ".nii.gz";
-        writer->SetInput(m_WarpedPriors[vIndex]);
-        writer->SetFileName(fn.c_str());
-        writer->Update();
-        muLogMacro(<< "DEBUG:  Wrote image " << fn << std::endl);
+        this->m_DebugImageWriter->Write(m_WarpedPriors[vIndex].GetPointer(), fn);
+        muLogMacro(<< "DEBUG:  Queued image " << fn << std::endl);
       }
     }
   }
@@ -2042,10 +1989,6 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugBlendClippedPrio
   { // DEBUG:  This code is for debugging purposes only;
     for (unsigned int k = 0; k < m_WarpedPriors.size(); k++)
     {
-      using WriterType = itk::ImageFileWriter<InputImageType>;
-      typename WriterType::Pointer writer = WriterType::New();
-      writer->UseCompressionOn();
-
       std::stringstream prior_index_stream("");
       prior_index_stream << k;
       // const std::string fn = this->m_OutputDebugDir +
@@ -2053,10 +1996,8 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugBlendClippedPrio
       // "PRIOR_INDEX_"+prior_index_stream.str()+"_LEVEL_"+CurrentEMIteration_stream.str()+".nii.gz";
       const std::string fn = this->m_OutputDebugDir + "BLENDCLIPPED_PRIOR_INDEX_" + this->m_PriorNames[k] + "_LEVEL_" +
                              CurrentEMIteration_stream.str() + ".nii.gz";
-      writer->SetInput(m_WarpedPriors[k]);
-      writer->SetFileName(fn.c_str());
-      writer->Update();
-      muLogMacro(<< "DEBUG:  Wrote image " << fn << std::endl);
+      this->m_DebugImageWriter->Write(m_WarpedPriors[k].GetPointer(), fn);
+      muLogMacro(<< "DEBUG:  Queued image " << fn << std::endl);
     }
   }
 }
@@ -2275,15 +2216,9 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::WriteDebugForegroundMask(
   std::stringstream CurrentEMIteration_stream("");
 
   CurrentEMIteration_stream << CurrentEMIteration;
-  using WriterType = itk::ImageFileWriter<ByteImageType>;
-  WriterType::Pointer writer = WriterType::New();
-  writer->UseCompressionOn();
-
   const std::string fn = this->m_OutputDebugDir + "/MASK_LEVEL_" + CurrentEMIteration_stream.str() + ".nii.gz";
-  writer->SetInput(currForgroundBrainMask);
-  writer->SetFileName(fn.c_str());
-  writer->Update();
-  muLogMacro(<< "DEBUG:  Wrote image " << fn << std::endl);
+  this->m_DebugImageWriter->Write(currForgroundBrainMask.GetPointer(), fn);
+  muLogMacro(<< "DEBUG:  Queued image " << fn << std::endl);
 }
 
 template <typename TInputImage, typename TProbabilityImage>
@@ -2309,6 +2244,8 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::Update()
     }
 
     this->EMLoop();
+    // The debug images of this run are on disk when Update() returns.
+    this->FlushDebugImages();
     m_UpdateRequired = false;
   }
 }
@@ -2358,11 +2295,7 @@ EMSegmentationFilter<TInputImage, TProbabilityImage>::EMLoop()
       if (this->m_DebugLevel > 6)
       {
         const std::string fn = this->m_OutputDebugDir + "/DEBUG_PURE_PLUGS_MASK.nii.gz";
-        using MaskWriterType = typename itk::ImageFileWriter<ByteImageType>;
-        typename MaskWriterType::Pointer maskwriter = MaskWriterType::New();
-        maskwriter->SetInput(this->m_PurePlugsMask);
-        maskwriter->SetFileName(fn);
-        maskwriter->Update();
+        this->m_DebugImageWriter->Write(this->m_PurePlugsMask.GetPointer(), fn, false);
       }
     }
   }
@@ -21,12 +21,10 @@
  */
 
 #include "itkImage.h"
-#include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
-#include "itkImageRegionIterator.h"
-#include <map>
 
 #include "GenerateLabelMapFromProbabilityMapCLP.h"
+#include "BRAINSProbabilityMapArgMax.h"
 #include "BRAINSThreadControl.h"
 #include <BRAINSCommonLib.h>
 
@@ -46,74 +44,37 @@ main(int argc, char * argv[])
     return EXIT_FAILURE;
   }
 
-  const unsigned int numberOfProbabilityMaps = inputVolumes.size();
-
   // Define Image Type
   using ProbabilityMapPixelType = float;
   constexpr unsigned int Dimension = 3;
   using ProbabilityMapImageType = itk::Image<ProbabilityMapPixelType, Dimension>;
 
   // Label Index should start from zero and increasing order.
-
-  // read in images
-
-  std::vector<ProbabilityMapImageType::Pointer> probabilityImages(numberOfProbabilityMaps);
-  for (unsigned int indexInputImages = 0; indexInputImages < numberOfProbabilityMaps; indexInputImages++)
-  {
-    std::cout << "- Read image::" << inputVolumes[indexInputImages] << std::endl;
-    using ProbabilityImageReaderType = itk::ImageFileReader<ProbabilityMapImageType>;
-
-    ProbabilityImageReaderType::Pointer probabilityReader = ProbabilityImageReaderType::New();
-
-    probabilityReader->SetFileName(inputVolumes[indexInputImages]);
-    probabilityReader->Update();
-
-    probabilityImages[indexInputImages] = probabilityReader->GetOutput();
-  }
-
-  // crerate empty label maps
-  std::cout << "Create Label Map" << std::endl;
   using LabelMapPixelType = unsigned int;
   using LabelMapImageType = itk::Image<LabelMapPixelType, Dimension>;
 
-  LabelMapImageType::Pointer labelImage = LabelMapImageType::New();
-
-  std::cerr << "here" << __FILE__ << " " << __LINE__ << std::endl;
-  std::cerr << " ProbImage:  " << probabilityImages[0] << std::endl;
-  labelImage->CopyInformation(probabilityImages[0]);
-  std::cerr << "here" << __FILE__ << " " << __LINE__ << std::endl;
-  labelImage->SetRegions(probabilityImages[0]->GetLargestPossibleRegion());
-  std::cerr << "here" << __FILE__ << " " << __LINE__ << std::endl;
-  labelImage->Allocate();
-  std::cerr << "here" << __FILE__ << " " << __LINE__ << std::endl;
-  labelImage->FillBuffer(0);
-  std::cerr << "here" << __FILE__ << " " << __LINE__ << std::endl;
-
-  std::cout << "start iteration " << std::endl;
-  // Iterate Images
-  using IteratorType = itk::ImageRegionIterator<ProbabilityMapImageType>;
-
-  IteratorType probabilityIterator(probabilityImages[0], probabilityImages[0]->GetLargestPossibleRegion());
-
-  using LabelIteratorType = itk::ImageRegionIterator<LabelMapImageType>;
-  LabelIteratorType labelIterator(labelImage, labelImage->GetLargestPossibleRegion());
-  for (probabilityIterator.GoToBegin(), labelIterator.GoToBegin(); !probabilityIterator.IsAtEnd();
-       ++probabilityIterator, ++labelIterator)
+  // The maps are read slab by slab, all of them at once, and the label of
+  // every voxel is the index of the map with the largest probability.
+  LabelMapImageType::Pointer labelImage;
+  try
   {
-    ProbabilityMapPixelType max = probabilityIterator.Get();
-    LabelMapPixelType       label = 0;
-    for (unsigned int indexInputImages = 1; indexInputImages < numberOfProbabilityMaps; indexInputImages++)
+    for (const auto & inputVolume : inputVolumes)
     {
-      ProbabilityMapPixelType pixelValue =
-        probabilityImages[indexInputImages]->GetPixel(probabilityIterator.GetIndex());
-      if (pixelValue > max)
-      {
-        max = pixelValue;
-        label = indexInputImages;
-      }
+      std::cout << "- Read image::" << inputVolume << std::endl;
     }
-
-    labelIterator.Set(label);
+    ProbabilityMapArgMaxStreamer<ProbabilityMapImageType> argMax(inputVolumes);
+
+    std::cout << "Create Label Map" << std::endl;
+    labelImage = argMax.AllocateImage<LabelMapImageType>();
+    LabelMapPixelType * labels = labelImage->GetBufferPointer();
+    argMax.Run([labels](const itk::OffsetValueType offset, const unsigned int classIndex, ProbabilityMapPixelType) {
+      labels[offset] = classIndex;
+    });
+  }
+  catch (itk::ExceptionObject & err)
+  {
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
   }
 
   // Image Writer
@@ -0,0 +1,180 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+//
+// //////////////////////////////////////////////////////////////////////////////
+//
+// Kruskal's algorithm over a bulk sorted edge array, with a union-find
+// (path compression, union by size) cycle test
+//
+// //////////////////////////////////////////////////////////////////////////////
+
+#ifndef __MSTKruskal_h
+#define __MSTKruskal_h
+
+#include "MSTEdge.h"
+#include "itkMultiThreaderBase.h"
+
+#include "vnl/vnl_vector.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/**
+ * \class MSTDisjointSets
+ * Union-find over vertex indices, amortized near constant time per operation
+ */
+class MSTDisjointSets
+{
+public:
+  explicit MSTDisjointSets(unsigned int n)
+    : m_Parent(n)
+    , m_Size(n, 1)
+  {
+    std::iota(m_Parent.begin(), m_Parent.end(), 0u);
+  }
+
+  unsigned int
+  Find(unsigned int v)
+  {
+    unsigned int root = v;
+    while (m_Parent[root] != root)
+    {
+      root = m_Parent[root];
+    }
+    // Path compression
+    while (m_Parent[v] != root)
+    {
+      const unsigned int next = m_Parent[v];
+      m_Parent[v] = root;
+      v = next;
+    }
+    return root;
+  }
+
+  // Returns false if a and b are already in the same set
+  bool
+  Union(unsigned int a, unsigned int b)
+  {
+    a = this->Find(a);
+    b = this->Find(b);
+    if (a == b)
+    {
+      return false;
+    }
+    if (m_Size[a] < m_Size[b])
+    {
+      std::swap(a, b);
+    }
+    m_Parent[b] = a;
+    m_Size[a] += m_Size[b];
+    return true;
+  }
+
+private:
+  std::vector<unsigned int> m_Parent;
+  std::vector<unsigned int> m_Size;
+};
+
+// Remove duplicate (i, j) pairs, e.g. edges shared by several Delaunay
+// facets; edges are stored with i < j
+inline void
+MSTRemoveDuplicateEdges(std::vector<MSTEdge> & edges)
+{
+  for (auto & e : edges)
+  {
+    if (e.i > e.j)
+    {
+      std::swap(e.i, e.j);
+    }
+  }
+  std::sort(edges.begin(), edges.end(), [](const MSTEdge & a, const MSTEdge & b) {
+    return a.i < b.i || (a.i == b.i && a.j < b.j);
+  });
+  edges.erase(std::unique(edges.begin(),
+                          edges.end(),
+                          [](const MSTEdge & a, const MSTEdge & b) { return a.i == b.i && a.j == b.j; }),
+              edges.end());
+}
+
+// Fill in the squared Euclidean length of every edge, in parallel.  The sum
+// is accumulated in single precision like the vnl_vector<float> difference
+// it replaces, but without a temporary vector per edge.
+inline void
+MSTComputeEdgeLengths(const std::vector<vnl_vector<float>> & vertices, std::vector<MSTEdge> & edges)
+{
+  if (edges.empty())
+  {
+    return;
+  }
+  itk::MultiThreaderBase::New()->ParallelizeArray(
+    0,
+    edges.size(),
+    [&](const itk::SizeValueType k) {
+      MSTEdge &                 e = edges[k];
+      const vnl_vector<float> & a = vertices[e.i];
+      const vnl_vector<float> & b = vertices[e.j];
+      float                     dist = 0;
+      for (unsigned int d = 0; d < a.size(); d++)
+      {
+        const float diff = a[d] - b[d];
+        dist += diff * diff;
+      }
+      e.dist = dist;
+    },
+    nullptr);
+}
+
+// Kruskal's algorithm: sorts the edges in ascending length once and writes
+// the spanning forest edges to mstEdges in the order they are accepted.
+// Equal lengths are ordered by vertex indices so the result does not depend
+// on the input order.  Returns the number of edges written, which is
+// numberOfVertices - 1 when the graph is connected.
+inline unsigned int
+MSTKruskal(unsigned int numberOfVertices, std::vector<MSTEdge> & edges, MSTEdge * mstEdges)
+{
+  std::sort(edges.begin(), edges.end(), [](const MSTEdge & a, const MSTEdge & b) {
+    if (a.dist != b.dist)
+    {
+      return a.dist < b.dist;
+    }
+    return a.i < b.i || (a.i == b.i && a.j < b.j);
+  });
+
+  MSTDisjointSets trees(numberOfVertices);
+  unsigned int    edgeCount = 0;
+  for (const auto & e : edges)
+  {
+    if (edgeCount + 1 >= numberOfVertices)
+    {
+      break;
+    }
+    // Skip if they belong to the same tree (will form cycle)
+    if (trees.Union(e.i, e.j))
+    {
+      mstEdges[edgeCount] = e;
+      edgeCount++;
+    }
+  }
+  return edgeCount;
+}
+
+#endif
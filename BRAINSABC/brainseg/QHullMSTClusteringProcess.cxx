@@ -17,9 +17,12 @@
  *
  *=========================================================================*/
 #include "Heap.h"
+#include "MSTKruskal.h"
 #include "QHullMSTClusteringProcess.h"
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include <cstdio>
 #include <cstdlib>
@@ -126,8 +129,8 @@ QHullMSTClusteringProcess ::SetInputVertices(const VertexList & vlist)
   qh_init_A(stdin, stdout, stderr, 0, NULL);
   const int exitcode = setjmp(qh errexit);
 
-  // Compute Delaunay triangulation and insert it to heap
-  Heap<MSTEdge> delaunayHeap;
+  // Collect the Delaunay edges, each edge once
+  std::vector<MSTEdge> delaunayEdges;
   if (!exitcode)
   {
     char options[BUF_SIZE];
@@ -149,16 +152,17 @@ QHullMSTClusteringProcess ::SetInputVertices(const VertexList & vlist)
         numfacets++;
       }
     }
+    delaunayEdges.reserve(numfacets * dim * (dim + 1) / 2);
 
-    vertexT *  vertex;
-    vertexT ** vertexp;
-    // Insert DT edges to heap
+    vertexT *                 vertex;
+    vertexT **                vertexp;
+    std::vector<unsigned int> ids;
+    ids.reserve(dim + 1);
     FORALLfacets
     {
       if (!facet->upperdelaunay)
       {
-        std::vector<unsigned int> ids;
-        ids.resize(dim + 1);
+        ids.clear();
         FOREACHvertex_(facet->vertices) { ids.push_back(qh_pointid(vertex->point)); }
         for (unsigned int s = 0; s < ids.size(); s++)
         {
@@ -167,9 +171,7 @@ QHullMSTClusteringProcess ::SetInputVertices(const VertexList & vlist)
             MSTEdge e;
             e.i = ids[s];
             e.j = ids[t];
-            const VertexType dij = vlist[e.i] - vlist[e.j];
-            e.dist = dij.squared_magnitude();
-            delaunayHeap.Insert(e);
+            delaunayEdges.push_back(e);
           }
         }
       }
@@ -189,53 +191,14 @@ QHullMSTClusteringProcess ::SetInputVertices(const VertexList & vlist)
     throw "QHull error";
   }
 
-  // Map vertex to set (tree) it belongs to, for cycle test
-  unsigned int * const treeMap = new unsigned int[m_NumberOfVertices];
-  for (unsigned int i = 0; i < m_NumberOfVertices; i++)
-  {
-    treeMap[i] = i;
-  }
-
-  // Number of edges in MST
-  unsigned int edgeCount = 0;
+  MSTRemoveDuplicateEdges(delaunayEdges);
+  MSTComputeEdgeLengths(vlist, delaunayEdges);
 
   // Build MST using Kruskal's algorithm
   // Edges added in ascending order
   m_MSTEdges = new MSTEdge[m_NumberOfVertices - 1];
-  while (!delaunayHeap.IsEmpty())
-  {
-    MSTEdge minEdge = delaunayHeap.ExtractMinimum();
-
-    const unsigned int a = minEdge.i;
-    const unsigned int b = minEdge.j;
-
-    const unsigned int map1 = treeMap[a];
-    const unsigned int map2 = treeMap[b];
-
-    // Skip if they belong to the same tree (will form cycle)
-    if (map1 == map2)
-    {
-      continue;
-    }
-    // Merge trees
-    for (unsigned int k = 0; k < m_NumberOfVertices; k++)
-    {
-      if (treeMap[k] == map2)
-      {
-        treeMap[k] = map1;
-      }
-    }
-    m_MSTEdges[edgeCount] = minEdge;
-    edgeCount++;
-
-    // See if a tree is formed already
-    if (edgeCount == (m_NumberOfVertices - 1))
-    {
-      break;
-    }
-  }
+  const unsigned int edgeCount = MSTKruskal(m_NumberOfVertices, delaunayEdges, m_MSTEdges);
 
-  delete[] treeMap;
   if (edgeCount != (m_NumberOfVertices - 1))
   {
     std::cerr << "MST construction failed, E != (V-1)" << std::endl;
@@ -299,94 +262,43 @@ QHullMSTClusteringProcess ::GetClusters(unsigned int * treeMap, float T)
   const unsigned int v = m_NumberOfVertices;
   const unsigned int e = v - 1;
 
-  // Allocate edge break flag array
-  unsigned char * const breakArray = new unsigned char[e];
-
+  // Break the long edges: an edge is broken when it is longer than T times
+  // the node average of either of its vertices, connect the rest
+  MSTDisjointSets trees(v);
+  unsigned int    numBroken = 0;
   for (unsigned int k = 0; k < e; k++)
   {
-    breakArray[k] = 0;
-  }
-
-  // Break edges
-  unsigned int numBroken = 0;
-  for (unsigned int i = 0; i < v; i++)
-  {
-    const float thres = T * m_NodeAverages[i];
-    // Break the coinciding long edges
-    for (unsigned int k = 0; k < e; k++)
+    const unsigned int a = m_MSTEdges[k].i;
+    const unsigned int b = m_MSTEdges[k].j;
+    if ((m_MSTEdges[k].dist > T * m_NodeAverages[a]) || (m_MSTEdges[k].dist > T * m_NodeAverages[b]))
     {
-      if (breakArray[k] != 0)
-      {
-        continue;
-      }
-
-      const unsigned int a = m_MSTEdges[k].i;
-      const unsigned int b = m_MSTEdges[k].j;
-      const bool         incident = (i == a) || (i == b);
-
-      // Never break zero length edges
-      if (incident && (m_MSTEdges[k].dist > thres))
-      {
-        breakArray[k] = 1;
-        numBroken++;
-      }
+      numBroken++;
+    }
+    else
+    {
+      trees.Union(a, b);
     }
   }
 
   if (numBroken == 0)
   {
     std::cerr << "No edges broken" << std::endl;
-    delete[] breakArray;
     // INFO: FIXME:
     // return whole tree with same label
     return 0;
   }
-  // Figure out distinct trees, merge connected vertices
+
+  // Label every vertex with the smallest vertex index of its tree
+  std::vector<unsigned int> rootMap(v, v);
   for (unsigned int k = 0; k < v; k++)
   {
-    treeMap[k] = k;
-  }
-  for (unsigned int i = 0; i < v; i++)
-  {
-    unsigned int map1 = treeMap[i];
-    // Check incident edges
-    for (unsigned int j = 0; j < e; j++)
+    const unsigned int root = trees.Find(k);
+    if (rootMap[root] == v)
     {
-      if (breakArray[j] != 0)
-      {
-        continue;
-      }
-
-      const unsigned int a = m_MSTEdges[j].i;
-      const unsigned int b = m_MSTEdges[j].j;
-      const bool         incident = (i == a) || (i == b);
-
-      if (!incident)
-      {
-        continue;
-      }
-
-      // Get the map of the other id
-      unsigned int map2 = treeMap[b];
-      if (i == b)
-      {
-        map2 = treeMap[a];
-      }
-      if (map1 == map2)
-      {
-        continue;
-      }
-      for (unsigned int k = 0; k < v; k++)
-      {
-        if (treeMap[k] == map2)
-        {
-          treeMap[k] = map1;
-        }
-      }
-    } // for neighbors
-  }   // for i
-
-  delete[] breakArray;
+      rootMap[root] = k;
+    }
+    treeMap[k] = rootMap[root];
+  }
 
   if (!m_SortFlag)
   {
@@ -394,59 +306,31 @@ QHullMSTClusteringProcess ::GetClusters(unsigned int * treeMap, float T)
   }
 
   // Sort the cluster maps based on cluster size (descending)
-  // Cluster 0 is the largest cluster
-
-  // Obtain cluster info
-  MSTCluster * const clusters = new MSTCluster[v];
-  unsigned int       numNonZero = 0;
+  // Cluster 0 is the largest cluster, equal sizes keep the label order
+  std::vector<MSTCluster> clusters(v);
   for (unsigned int i = 0; i < v; i++)
   {
     clusters[i].map = i;
-    unsigned int s = 0;
-    for (unsigned int j = 0; j < v; j++)
-    {
-      if (treeMap[j] == i)
-      {
-        s++;
-      }
-    }
-    if (s > 0)
-    {
-      numNonZero++;
-    }
-    clusters[i].size = s;
   }
-
-  Heap<MSTCluster> heap;
-  heap.Allocate(numNonZero);
   for (unsigned int i = 0; i < v; i++)
   {
-    if (clusters[i].size != 0)
-    {
-      heap.Insert(clusters[i]);
-    }
+    clusters[treeMap[i]].size++;
   }
-
-  delete[] clusters;
-
-  unsigned int * const sortedMap = new unsigned int[v];
-  for (unsigned int i = 0; i < numNonZero; i++)
+  clusters.erase(std::remove_if(clusters.begin(),
+                                clusters.end(),
+                                [](const MSTCluster & c) { return c.size == 0; }),
+                 clusters.end());
+  std::stable_sort(clusters.begin(), clusters.end());
+
+  std::vector<unsigned int> sortedMap(v);
+  for (unsigned int i = 0; i < clusters.size(); i++)
   {
-    const MSTCluster   c = heap.ExtractMinimum();
-    const unsigned int m = c.map;
-    for (unsigned int j = 0; j < v; j++)
-    {
-      if (treeMap[j] == m)
-      {
-        sortedMap[j] = i;
-      }
-    }
+    sortedMap[clusters[i].map] = i;
   }
   for (unsigned int i = 0; i < v; i++)
   {
-    treeMap[i] = sortedMap[i];
+    treeMap[i] = sortedMap[treeMap[i]];
   }
 
-  delete[] sortedMap;
   return numBroken + 1;
 }
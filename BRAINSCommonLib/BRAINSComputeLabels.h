@@ -32,6 +32,33 @@ using LabelCountMapType = std::map<size_t, size_t>;
 using ByteImageType = itk::Image<unsigned char, 3>;
 extern LabelCountMapType
 GetMinLabelCount(ByteImageType::Pointer & labelsImage, const vnl_vector<unsigned int> & PriorLabelCodeVector);
+// Label and foreground flag of a voxel whose largest posterior,
+// maxPosteriorClassValue, belongs to class indexMaxPosteriorClassValue
+template <typename TFloatingPrecision>
+inline void
+LabelFromMaximumPosterior(const TFloatingPrecision         maxPosteriorClassValue,
+                          const unsigned int               indexMaxPosteriorClassValue,
+                          const std::vector<bool> &        PriorIsForegroundPriorVector,
+                          const vnl_vector<unsigned int> & PriorLabelCodeVector,
+                          const TFloatingPrecision         InclusionThreshold,
+                          unsigned int &                   label,
+                          bool &                           fgflag)
+{
+  fgflag = PriorIsForegroundPriorVector[indexMaxPosteriorClassValue];
+  label = 99;
+  if (maxPosteriorClassValue > InclusionThreshold)
+  {
+    label = PriorLabelCodeVector[indexMaxPosteriorClassValue];
+  }
+
+  // Only use non-zero probabilities and foreground classes
+  if (!fgflag || (maxPosteriorClassValue < 0.001))
+  {
+    fgflag = false; // If priors are zero or negative, then set the
+    // fgflag back to false
+  }
+}
+
 // Labeling using maximum a posteriori, also do brain stripping using
 // mathematical morphology and connected component
 template <typename TProbabilityImage, typename TByteImage, typename TFloatingPrecision>
@@ -112,19 +139,15 @@ ComputeLabels(std::vector<typename TProbabilityImage::Pointer> & Posteriors,
             }
 
             {
-              bool         fgflag = PriorIsForegroundPriorVector[indexMaxPosteriorClassValue];
-              unsigned int label = 99;
-              if (maxPosteriorClassValue > InclusionThreshold)
-              {
-                label = PriorLabelCodeVector[indexMaxPosteriorClassValue];
-              }
-
-              // Only use non-zero probabilities and foreground classes
-              if (!fgflag || (maxPosteriorClassValue < 0.001))
-              {
-                fgflag = false; // If priors are zero or negative, then set the
-                // fgflag back to false
-              }
+              bool         fgflag;
+              unsigned int label;
+              LabelFromMaximumPosterior<TFloatingPrecision>(maxPosteriorClassValue,
+                                                            indexMaxPosteriorClassValue,
+                                                            PriorIsForegroundPriorVector,
+                                                            PriorLabelCodeVector,
+                                                            InclusionThreshold,
+                                                            label,
+                                                            fgflag);
               DirtyLabels->SetPixel(currIndex, label);
               foregroundMask->SetPixel(currIndex, fgflag);
             }
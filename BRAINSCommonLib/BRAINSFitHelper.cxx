@@ -21,6 +21,8 @@
 #include "BRAINSFitHelper.h"
 
 #include "genericRegistrationHelper.h"
+#include "itkBSplineSparseMattesMutualInformationImageToImageMetricv4.h"
+#include "itkBSplineSparseMeanSquaresImageToImageMetricv4.h"
 #include "itkCorrelationImageToImageMetricv4.h"
 #include "itkMeanSquaresImageToImageMetricv4.h"
 #include "itkKullbackLeiblerCompareHistogramImageToImageMetric.h"
@@ -373,8 +375,12 @@ BRAINSFitHelper::Update()
   GenericMetricType::Pointer metric;
   if (this->m_CostMetricName == "MMI")
   {
-    using MIMetricType =
-      itk::MattesMutualInformationImageToImageMetricv4<FixedImageType, MovingImageType, FixedImageType, RealType>;
+    // Same as MattesMutualInformationImageToImageMetricv4, but evaluates the
+    // BSpline stage through the sparse support of every sample.
+    using MIMetricType = itk::BSplineSparseMattesMutualInformationImageToImageMetricv4<FixedImageType,
+                                                                                       MovingImageType,
+                                                                                       FixedImageType,
+                                                                                       RealType>;
     MIMetricType::Pointer mutualInformationMetric = MIMetricType::New();
     // The next line was a hack for early ITKv4 mattes mutual informaiton
     // that was using a lot of memory
@@ -384,6 +390,7 @@ BRAINSFitHelper::Update()
     mutualInformationMetric->SetUseMovingImageGradientFilter(gradientfilter);
     mutualInformationMetric->SetUseFixedImageGradientFilter(gradientfilter);
     mutualInformationMetric->SetUseSampledPointSet(false);
+    mutualInformationMetric->SetDeterministicReduction(this->m_DeterministicBSplineMetric);
     metric = mutualInformationMetric;
 
     this->SetupRegistration<MIMetricType>(metric);
@@ -392,8 +399,9 @@ BRAINSFitHelper::Update()
   else if (this->m_CostMetricName == "MSE")
   {
     using MSEMetricType =
-      itk::MeanSquaresImageToImageMetricv4<FixedImageType, MovingImageType, FixedImageType, RealType>;
+      itk::BSplineSparseMeanSquaresImageToImageMetricv4<FixedImageType, MovingImageType, FixedImageType, RealType>;
     MSEMetricType::Pointer meanSquareMetric = MSEMetricType::New();
+    meanSquareMetric->SetDeterministicReduction(this->m_DeterministicBSplineMetric);
     metric = meanSquareMetric;
 
     this->SetupRegistration<MSEMetricType>(metric);
@@ -718,6 +726,11 @@ BRAINSFitHelper::PrintCommandLine(const bool dumpTempVolumes, const std::string
   oss << "--MaximumNumberOfEvaluations " << this->m_MaximumNumberOfEvaluations << " \\" << std::endl;
   oss << "--MaximumNumberOfCorrections " << this->m_MaximumNumberOfCorrections << " \\" << std::endl;
   oss << "--costFunctionConvergenceFactor " << this->m_CostFunctionConvergenceFactor << " \\" << std::endl;
+  if (!this->m_DeterministicBSplineMetric)
+  {
+    oss << "--fastBSplineMetricGradient "
+        << "  \\" << std::endl;
+  }
   oss << "--backgroundFillValue " << this->m_BackgroundFillValue << "  \\" << std::endl;
   oss << "--initializeTransformMode " << this->m_InitializeTransformMode << "  \\" << std::endl;
   oss << "--maskInferiorCutOffFromCenter " << this->m_MaskInferiorCutOffFromCenter << "  \\" << std::endl;
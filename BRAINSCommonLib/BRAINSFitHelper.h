@@ -204,6 +204,12 @@ public:
   itkSetMacro(WriteOutputTransformInFloat, bool);
   itkGetConstMacro(WriteOutputTransformInFloat, bool);
 
+  /** Sum the BSpline metric derivative in an order that does not depend on
+   * the number of threads (the default).  Only used by the MMI and MSE metrics.
+   */
+  itkSetMacro(DeterministicBSplineMetric, bool);
+  itkGetConstMacro(DeterministicBSplineMetric, bool);
+
   void
   SetSamplingStrategy(std::string strategy)
   {
@@ -322,6 +328,7 @@ private:
   int                             m_MaximumNumberOfCorrections{ 12 };
   bool                            m_SyNFull{ true };
   bool                            m_WriteOutputTransformInFloat{ false };
+  bool                            m_DeterministicBSplineMetric{ true };
 }; // end BRAINSFitHelper class
 
 template <typename TLocalCostMetric>
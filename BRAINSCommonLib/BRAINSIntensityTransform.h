@@ -2,10 +2,193 @@
 #ifndef BRAINSIntensityTransform_h__
 #define BRAINSIntensityTransform_h__
 
-#include "itkHistogram.h"
-#include "itkImageToHistogramFilter.h"
-#include "itkStatisticsImageFilter.h"
-#include <itkUnaryGeneratorImageFilter.h>
+#include "itkImageScanlineIterator.h"
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+/**
+ * Intensity range, moments and a fixed bin histogram of an image, as
+ * gathered by brains_intensity_histogram.  Voxels below BinMinimum or above
+ * BinMaximum are only counted in Underflow and Overflow, a voxel equal to
+ * BinMaximum goes to the last bin.
+ */
+struct BRAINSIntensityHistogram
+{
+  double                          Minimum{ 0.0 };
+  double                          Maximum{ 0.0 };
+  double                          Mean{ 0.0 };
+  double                          Sigma{ 0.0 };
+  itk::SizeValueType              Count{ 0 };
+  double                          BinMinimum{ 0.0 };
+  double                          BinMaximum{ 0.0 };
+  std::vector<itk::SizeValueType> Frequencies;
+  itk::SizeValueType              Underflow{ 0 };
+  itk::SizeValueType              Overflow{ 0 };
+
+  /** True when Quantile(p) falls inside the bins rather than among the
+   * voxels outside them. */
+  bool
+  QuantileIsInBins(const double p) const
+  {
+    return Underflow < p * Count && Overflow < (1.0 - p) * Count;
+  }
+
+  /** Quantile interpolated within its bin, the way
+   * itk::Statistics::Histogram::Quantile does: walking up from the bottom
+   * for p < 0.5, down from the top otherwise. */
+  double
+  Quantile(const double p) const
+  {
+    const auto   numberOfBins = static_cast<itk::SizeValueType>(Frequencies.size());
+    const double binWidth = (BinMaximum - BinMinimum) / numberOfBins;
+    const auto   total = static_cast<double>(Count);
+    double       f_n = 0.0;
+    if (p < 0.5)
+    {
+      double             cumulated = Underflow;
+      double             p_n = cumulated / total;
+      double             p_n_prev = p_n;
+      itk::SizeValueType n = 0;
+      do
+      {
+        f_n = Frequencies[n];
+        cumulated += f_n;
+        p_n_prev = p_n;
+        p_n = cumulated / total;
+        ++n;
+      } while (n < numberOfBins && p_n < p);
+      const double binMin = BinMinimum + (n - 1) * binWidth;
+      return binMin + ((p - p_n_prev) / (f_n / total)) * binWidth;
+    }
+    double             cumulated = Overflow;
+    double             p_n = 1.0 - cumulated / total;
+    double             p_n_prev = p_n;
+    itk::SizeValueType m = 0;
+    do
+    {
+      f_n = Frequencies[numberOfBins - 1 - m];
+      cumulated += f_n;
+      p_n_prev = p_n;
+      p_n = 1.0 - cumulated / total;
+      ++m;
+    } while (m < numberOfBins && p_n > p);
+    const double binMax = BinMinimum + (numberOfBins - m + 1) * binWidth;
+    return binMax - ((p_n_prev - p) / (f_n / total)) * binWidth;
+  }
+};
+
+/**
+ * Minimum, maximum, mean, sigma and a numberOfBins histogram over
+ * [binMinimum, binMaximum] of the buffered region of image, in one
+ * multi-threaded pass.  Sigma is normalized by N - 1 like
+ * itk::StatisticsImageFilter.
+ */
+template <typename InputImageType>
+BRAINSIntensityHistogram
+brains_intensity_histogram(const InputImageType * image,
+                           const double           binMinimum,
+                           const double           binMaximum,
+                           const unsigned int     numberOfBins)
+{
+  BRAINSIntensityHistogram histogram;
+  histogram.Minimum = std::numeric_limits<double>::max();
+  histogram.Maximum = std::numeric_limits<double>::lowest();
+  histogram.BinMinimum = binMinimum;
+  histogram.BinMaximum = binMaximum;
+  histogram.Frequencies.assign(numberOfBins, 0);
+  const double scale = (binMaximum > binMinimum) ? numberOfBins / (binMaximum - binMinimum) : 0.0;
+
+  double     sum = 0.0;
+  double     sumOfSquares = 0.0;
+  std::mutex mutex;
+  itk::MultiThreaderBase::New()->template ParallelizeImageRegion<InputImageType::ImageDimension>(
+    image->GetBufferedRegion(),
+    [&](const typename InputImageType::RegionType & region) {
+      std::vector<itk::SizeValueType> frequencies(numberOfBins, 0);
+      itk::SizeValueType              underflow = 0;
+      itk::SizeValueType              overflow = 0;
+      double                          minimum = std::numeric_limits<double>::max();
+      double                          maximum = std::numeric_limits<double>::lowest();
+      double                          localSum = 0.0;
+      double                          localSumOfSquares = 0.0;
+
+      itk::ImageScanlineConstIterator<InputImageType> it(image, region);
+      while (!it.IsAtEnd())
+      {
+        while (!it.IsAtEndOfLine())
+        {
+          const auto value = static_cast<double>(it.Get());
+          minimum = std::min(minimum, value);
+          maximum = std::max(maximum, value);
+          localSum += value;
+          localSumOfSquares += value * value;
+          if (value < binMinimum)
+          {
+            ++underflow;
+          }
+          else if (value > binMaximum)
+          {
+            ++overflow;
+          }
+          else
+          {
+            const auto bin = static_cast<itk::SizeValueType>((value - binMinimum) * scale);
+            ++frequencies[std::min<itk::SizeValueType>(bin, numberOfBins - 1)];
+          }
+          ++it;
+        }
+        it.NextLine();
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      histogram.Minimum = std::min(histogram.Minimum, minimum);
+      histogram.Maximum = std::max(histogram.Maximum, maximum);
+      sum += localSum;
+      sumOfSquares += localSumOfSquares;
+      histogram.Underflow += underflow;
+      histogram.Overflow += overflow;
+      for (unsigned int bin = 0; bin < numberOfBins; ++bin)
+      {
+        histogram.Frequencies[bin] += frequencies[bin];
+      }
+    },
+    nullptr);
+
+  histogram.Count = image->GetBufferedRegion().GetNumberOfPixels();
+  const auto count = static_cast<double>(histogram.Count);
+  histogram.Mean = sum / count;
+  histogram.Sigma = (histogram.Count > 1) ? std::sqrt((sumOfSquares - sum * sum / count) / (count - 1.0)) : 0.0;
+  return histogram;
+}
+
+/**
+ * Intensity range of a strided sample of about maximumNumberOfSamples
+ * voxels of the buffer of image, a cheap first guess at the histogram range.
+ */
+template <typename InputImageType>
+void
+brains_intensity_sample_range(const InputImageType *   image,
+                              double &                 minimum,
+                              double &                 maximum,
+                              const itk::SizeValueType maximumNumberOfSamples = 65536)
+{
+  const typename InputImageType::PixelType * buffer = image->GetBufferPointer();
+  const itk::SizeValueType                   numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+  const itk::SizeValueType stride = std::max<itk::SizeValueType>(1, numberOfPixels / maximumNumberOfSamples);
+  minimum = std::numeric_limits<double>::max();
+  maximum = std::numeric_limits<double>::lowest();
+  for (itk::SizeValueType i = 0; i < numberOfPixels; i += stride)
+  {
+    const auto value = static_cast<double>(buffer[i]);
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+  }
+}
 
 /**
  * Intensity normalize based on intensity intensity percentiles
@@ -48,63 +231,51 @@ brains_intensity_normalize_quantiles(typename InputImageType::Pointer input_imag
     return nullptr;
   }
 
-  // percentile based rescaling
-  // find min/max pixels for image
-  using StatisticsFilterType = itk::StatisticsImageFilter<InputImageType>;
-
-  typename StatisticsFilterType::Pointer statsFilter = StatisticsFilterType::New();
-  statsFilter->SetInput(input_image);
   try
   {
-    statsFilter->Update();
+    input_image->Update();
   }
   catch (itk::ExceptionObject & error)
   {
     std::cerr << "Stats Filter Error: " << error << std::endl;
     return nullptr;
   }
-  const typename InputImageType::PixelType minPixel(statsFilter->GetMinimum());
-  const typename InputImageType::PixelType maxPixel(statsFilter->GetMaximum());
-  if(print_diagnostics)
+  if (input_image->GetBufferedRegion().GetNumberOfPixels() == 0)
   {
-    const double variance = statsFilter->GetSigma();
-    const double mean = statsFilter->GetMean();
-    std::cout << "Input Image Min/Max/Mean/Variance = " << minPixel << "/" << maxPixel << "/" << mean << "/" << variance
-              << std::endl;
+    std::cerr << "ERROR: empty input image" << std::endl;
+    return nullptr;
   }
-  // generate histogram to find quantiles
-  constexpr unsigned int MeasurementVectorSize = 1; // Grayscale --> non-vector images
-  const auto             binsPerDimension = static_cast<unsigned int>(1000);
 
-  using ImageToHistogramFilterType = itk::Statistics::ImageToHistogramFilter<InputImageType>;
-  typename ImageToHistogramFilterType::HistogramType::MeasurementVectorType lowerBound(binsPerDimension);
-  lowerBound.Fill(minPixel);
+  // Percentile based rescaling.  Range, moments and histogram come from one
+  // pass, with the histogram range guessed from a sample of the voxels and
+  // 16 times finer bins than the 1000 over [min, max] used before, so the
+  // quantiles agree with that histogram within one of its bins.  Only when
+  // a quantile falls among the voxels outside the guessed range is the
+  // histogram gathered again over the exact range.
+  constexpr unsigned int binsPerDimension = 16 * 1000;
 
-  typename ImageToHistogramFilterType::HistogramType::MeasurementVectorType upperBound(binsPerDimension);
-  upperBound.Fill(maxPixel);
-
-  typename ImageToHistogramFilterType::HistogramType::SizeType size(MeasurementVectorSize);
-  size.Fill(binsPerDimension);
-
-  typename ImageToHistogramFilterType::Pointer imageToHistogramFilter = ImageToHistogramFilterType::New();
-  imageToHistogramFilter->SetInput(input_image);
-  imageToHistogramFilter->SetHistogramBinMinimum(lowerBound);
-  imageToHistogramFilter->SetHistogramBinMaximum(upperBound);
-  imageToHistogramFilter->SetHistogramSize(size);
-
-  try
+  double sampleMinimum;
+  double sampleMaximum;
+  brains_intensity_sample_range<InputImageType>(input_image.GetPointer(), sampleMinimum, sampleMaximum);
+  BRAINSIntensityHistogram histogram = brains_intensity_histogram<InputImageType>(
+    input_image.GetPointer(), sampleMinimum, sampleMaximum, binsPerDimension);
+  if (!histogram.QuantileIsInBins(lowerPercentile) || !histogram.QuantileIsInBins(upperPercentile))
   {
-    imageToHistogramFilter->Update();
+    histogram = brains_intensity_histogram<InputImageType>(
+      input_image.GetPointer(), histogram.Minimum, histogram.Maximum, binsPerDimension);
   }
-  catch (itk::ExceptionObject & error)
+
+  const typename InputImageType::PixelType minPixel(histogram.Minimum);
+  const typename InputImageType::PixelType maxPixel(histogram.Maximum);
+  if(print_diagnostics)
   {
-    std::cerr << "Histogram Error: " << error << std::endl;
-    return nullptr;
+    const double variance = histogram.Sigma;
+    const double mean = histogram.Mean;
+    std::cout << "Input Image Min/Max/Mean/Variance = " << minPixel << "/" << maxPixel << "/" << mean << "/" << variance
+              << std::endl;
   }
-
-  typename ImageToHistogramFilterType::HistogramType::Pointer histogram = imageToHistogramFilter->GetOutput();
-  const double lowerPercentileValue = histogram->Quantile(0, lowerPercentile);
-  const double upperPercentileValue = histogram->Quantile(0, upperPercentile);
+  const double lowerPercentileValue = histogram.Quantile(lowerPercentile);
+  const double upperPercentileValue = histogram.Quantile(upperPercentile);
 
   // Compute relative if neccesary
   double relativeLowerOutputIntensity = lowerOutputIntensity;
@@ -126,52 +297,56 @@ brains_intensity_normalize_quantiles(typename InputImageType::Pointer input_imag
     (relativeUpperOutputIntensity - relativeLowerOutputIntensity) / (upperPercentileValue - lowerPercentileValue);
   const double intercept = relativeUpperOutputIntensity - slope * upperPercentileValue;
 
-  typename OutputImageType::Pointer output_image;
-  using IntensityScalingFilter = typename itk::UnaryGeneratorImageFilter<InputImageType, OutputImageType>;
-  typename IntensityScalingFilter::Pointer filter = IntensityScalingFilter::New();
+  // Remap in one multi-threaded pass, tracking the output range for the
+  // diagnostics on the way
+  using OutputPixelType = typename OutputImageType::PixelType;
+  typename OutputImageType::Pointer output_image = OutputImageType::New();
+  output_image->CopyInformation(input_image);
+  output_image->SetRegions(input_image->GetBufferedRegion());
+  output_image->Allocate();
 
-  if (clip)
-  {
-    filter->SetFunctor([slope, intercept, upperOutputIntensity, lowerOutputIntensity](
-      const typename InputImageType::PixelType input_pixel_value_orig) ->
-                         typename OutputImageType::PixelType {
-      const auto input_pixel_value = static_cast<double>(input_pixel_value_orig);
-      const auto temp = input_pixel_value * slope + intercept;
-      const auto return_value = (temp > upperOutputIntensity)
-                                ? upperOutputIntensity
-                                : ((temp < lowerOutputIntensity) ? lowerOutputIntensity : temp);
-      return static_cast<typename OutputImageType::PixelType>(return_value);
-    });
-  }
-  else
-  {
-    filter->SetFunctor([slope, intercept](const typename InputImageType::PixelType input_pixel_value_orig) ->
-                         typename OutputImageType::PixelType {
-      const auto input_pixel_value = static_cast<double>(input_pixel_value_orig);
-      const auto temp = input_pixel_value * slope + intercept;
-      return static_cast<typename OutputImageType::PixelType>(temp);
-    });
-  }
-  filter->SetInput(input_image);
-  filter->Update();
-  output_image = filter->GetOutput();
+  double     outMinimum = std::numeric_limits<double>::max();
+  double     outMaximum = std::numeric_limits<double>::lowest();
+  std::mutex mutex;
+  itk::MultiThreaderBase::New()->template ParallelizeImageRegion<InputImageType::ImageDimension>(
+    output_image->GetBufferedRegion(),
+    [&](const typename OutputImageType::RegionType & region) {
+      double minimum = std::numeric_limits<double>::max();
+      double maximum = std::numeric_limits<double>::lowest();
+
+      itk::ImageScanlineConstIterator<InputImageType> inIt(input_image, region);
+      itk::ImageScanlineIterator<OutputImageType>     outIt(output_image, region);
+      while (!inIt.IsAtEnd())
+      {
+        while (!inIt.IsAtEndOfLine())
+        {
+          const auto input_pixel_value = static_cast<double>(inIt.Get());
+          const auto temp = input_pixel_value * slope + intercept;
+          const auto return_value =
+            clip ? ((temp > upperOutputIntensity) ? upperOutputIntensity
+                                                  : ((temp < lowerOutputIntensity) ? lowerOutputIntensity : temp))
+                 : temp;
+          const auto output_pixel_value = static_cast<OutputPixelType>(return_value);
+          outIt.Set(output_pixel_value);
+          minimum = std::min(minimum, static_cast<double>(output_pixel_value));
+          maximum = std::max(maximum, static_cast<double>(output_pixel_value));
+          ++inIt;
+          ++outIt;
+        }
+        inIt.NextLine();
+        outIt.NextLine();
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      outMinimum = std::min(outMinimum, minimum);
+      outMaximum = std::max(outMaximum, maximum);
+    },
+    nullptr);
 
   if(print_diagnostics)
   {
-    using OutStatisticsFilterType = itk::StatisticsImageFilter<OutputImageType>;
-    typename OutStatisticsFilterType::Pointer outStatsFilter = OutStatisticsFilterType::New();
-    outStatsFilter->SetInput(output_image);
-    try
-    {
-      outStatsFilter->Update();
-    }
-    catch (itk::ExceptionObject & error)
-    {
-      std::cerr << "Stats Filter Error: " << error << std::endl;
-      return nullptr;
-    }
-    const typename InputImageType::PixelType outMinPixel(outStatsFilter->GetMinimum());
-    const typename InputImageType::PixelType outMaxPixel(outStatsFilter->GetMaximum());
+    const typename InputImageType::PixelType outMinPixel(outMinimum);
+    const typename InputImageType::PixelType outMaxPixel(outMaximum);
     std::cout << "Output min/max: (" << outMinPixel << ", " << outMaxPixel << ")" << std::endl;
   }
   return output_image;
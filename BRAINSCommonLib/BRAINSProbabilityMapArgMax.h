@@ -0,0 +1,261 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef BRAINSProbabilityMapArgMax_h
+#define BRAINSProbabilityMapArgMax_h
+
+#include "itkIO.h"
+
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageScanlineConstIterator.h>
+#include <itkMultiThreaderBase.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/** \class ProbabilityMapArgMaxStreamer
+ * \brief Streams the class of the largest probability, voxel by voxel, out
+ * of a set of probability map files.
+ *
+ * The maps, and an optional mask, are read slab by slab along the last axis.
+ * All files of a slab are read concurrently, and the voxels of the slab are
+ * split across threads, so memory holds SlabDepth slices of every map instead
+ * of every map in full.  Files that cannot stream, including gzip compressed
+ * ones that NiftiImageIO would otherwise reread from the start for every
+ * slab, are read once in full with the first slab.
+ *
+ * Ties go to the first map, as a serial scan with > picks them.
+ */
+template <typename TProbabilityImage>
+class ProbabilityMapArgMaxStreamer
+{
+public:
+  static constexpr unsigned int ImageDimension = TProbabilityImage::ImageDimension;
+
+  using ProbabilityImageType = TProbabilityImage;
+  using ProbabilityPixelType = typename TProbabilityImage::PixelType;
+  using MaskImageType = itk::Image<unsigned char, ImageDimension>;
+  using RegionType = typename TProbabilityImage::RegionType;
+  using IndexType = typename TProbabilityImage::IndexType;
+
+  /** Reads the file headers.  Throws itk::ExceptionObject when a file can not
+   *  be read or its size differs from the first map. */
+  explicit ProbabilityMapArgMaxStreamer(const std::vector<std::string> & probabilityFileNames,
+                                        const std::string &              maskFileName = std::string())
+  {
+    if (probabilityFileNames.empty())
+    {
+      itkGenericExceptionMacro(<< "No probability maps given");
+    }
+    for (const auto & fileName : probabilityFileNames)
+    {
+      typename ProbabilityReaderType::Pointer reader = ProbabilityReaderType::New();
+      reader->SetFileName(fileName);
+      reader->SetUseStreaming(itkUtil::ImageFileCanStreamRead(fileName));
+      reader->UpdateOutputInformation();
+      this->CheckRegion(reader->GetOutput(), fileName);
+      m_ProbabilityReaders.push_back(reader);
+    }
+    if (!maskFileName.empty())
+    {
+      m_MaskReader = MaskReaderType::New();
+      m_MaskReader->SetFileName(maskFileName);
+      m_MaskReader->SetUseStreaming(itkUtil::ImageFileCanStreamRead(maskFileName));
+      m_MaskReader->UpdateOutputInformation();
+      this->CheckRegion(m_MaskReader->GetOutput(), maskFileName);
+    }
+  }
+
+  /** Number of slices along the last axis read at a time. */
+  void
+  SetSlabDepth(const unsigned int slabDepth)
+  {
+    m_SlabDepth = std::max(slabDepth, 1u);
+  }
+
+  unsigned int
+  GetSlabDepth() const
+  {
+    return m_SlabDepth;
+  }
+
+  /** A zero filled image with the geometry of the first map. */
+  template <typename TImage>
+  typename TImage::Pointer
+  AllocateImage() const
+  {
+    typename TImage::Pointer image = TImage::New();
+    image->CopyInformation(m_ProbabilityReaders[0]->GetOutput());
+    image->SetRegions(m_Region);
+    image->Allocate(true);
+    return image;
+  }
+
+  /** Calls voxelFunction(offset, classIndex, maximum) for every voxel inside
+   *  the mask (every voxel without a mask), where offset is the offset of the
+   *  voxel in the buffer of an AllocateImage() image, classIndex the index
+   *  of the map with the largest probability and maximum that probability.
+   *  The calls for different voxels may run concurrently. */
+  template <typename TVoxelFunction>
+  void
+  Run(TVoxelFunction voxelFunction)
+  {
+    constexpr unsigned int lastAxis = ImageDimension - 1;
+    const unsigned int     numberOfMaps = m_ProbabilityReaders.size();
+
+    // Offsets into a buffer of m_Region
+    itk::OffsetValueType stride[ImageDimension];
+    stride[0] = 1;
+    for (unsigned int i = 1; i < ImageDimension; i++)
+    {
+      stride[i] = stride[i - 1] * m_Region.GetSize(i - 1);
+    }
+
+    const itk::SizeValueType numberOfSlices = m_Region.GetSize(lastAxis);
+    for (itk::SizeValueType first = 0; first < numberOfSlices; first += m_SlabDepth)
+    {
+      RegionType slab = m_Region;
+      slab.SetIndex(lastAxis, m_Region.GetIndex(lastAxis) + first);
+      slab.SetSize(lastAxis, std::min<itk::SizeValueType>(m_SlabDepth, numberOfSlices - first));
+      this->ReadSlab(slab);
+
+      itk::MultiThreaderBase::New()->template ParallelizeImageRegion<ImageDimension>(
+        slab,
+        [&](const RegionType & lines) {
+          std::vector<const ProbabilityPixelType *> rows(numberOfMaps);
+          const itk::SizeValueType                  lineLength = lines.GetSize(0);
+
+          itk::ImageScanlineConstIterator<ProbabilityImageType> it(m_ProbabilityReaders[0]->GetOutput(), lines);
+          while (!it.IsAtEnd())
+          {
+            const IndexType lineIndex = it.GetIndex();
+            for (unsigned int k = 0; k < numberOfMaps; k++)
+            {
+              const ProbabilityImageType * map = m_ProbabilityReaders[k]->GetOutput();
+              rows[k] = map->GetBufferPointer() + map->ComputeOffset(lineIndex);
+            }
+            const unsigned char * maskRow = nullptr;
+            if (m_MaskReader)
+            {
+              const MaskImageType * mask = m_MaskReader->GetOutput();
+              maskRow = mask->GetBufferPointer() + mask->ComputeOffset(lineIndex);
+            }
+            itk::OffsetValueType offset = 0;
+            for (unsigned int i = 0; i < ImageDimension; i++)
+            {
+              offset += (lineIndex[i] - m_Region.GetIndex(i)) * stride[i];
+            }
+
+            for (itk::SizeValueType x = 0; x < lineLength; x++)
+            {
+              if (maskRow != nullptr && maskRow[x] == 0)
+              {
+                continue;
+              }
+              ProbabilityPixelType maximum = rows[0][x];
+              unsigned int         classIndex = 0;
+              for (unsigned int k = 1; k < numberOfMaps; k++)
+              {
+                if (rows[k][x] > maximum)
+                {
+                  maximum = rows[k][x];
+                  classIndex = k;
+                }
+              }
+              voxelFunction(offset + x, classIndex, maximum);
+            }
+            it.NextLine();
+          }
+        },
+        nullptr);
+    }
+
+    // Drop the last slab
+    for (auto & reader : m_ProbabilityReaders)
+    {
+      reader->GetOutput()->ReleaseData();
+    }
+    if (m_MaskReader)
+    {
+      m_MaskReader->GetOutput()->ReleaseData();
+    }
+  }
+
+private:
+  using ProbabilityReaderType = itk::ImageFileReader<ProbabilityImageType>;
+  using MaskReaderType = itk::ImageFileReader<MaskImageType>;
+
+  void
+  CheckRegion(const itk::ImageBase<ImageDimension> * image, const std::string & fileName)
+  {
+    if (m_ProbabilityReaders.empty() && !m_MaskReader)
+    {
+      m_Region = image->GetLargestPossibleRegion();
+    }
+    else if (image->GetLargestPossibleRegion().GetSize() != m_Region.GetSize())
+    {
+      itkGenericExceptionMacro(<< fileName << " has size " << image->GetLargestPossibleRegion().GetSize()
+                               << ", expected " << m_Region.GetSize());
+    }
+  }
+
+  /** Read the slab from every file at once.  Exceptions are collected and
+   *  rethrown here, outside the worker threads. */
+  void
+  ReadSlab(const RegionType & slab)
+  {
+    const unsigned int       numberOfMaps = m_ProbabilityReaders.size();
+    const unsigned int       numberOfFiles = numberOfMaps + (m_MaskReader ? 1 : 0);
+    std::vector<std::string> errors(numberOfFiles);
+    itk::MultiThreaderBase::New()->ParallelizeArray(
+      0,
+      numberOfFiles,
+      [&](const itk::SizeValueType k) {
+        try
+        {
+          itk::ImageBase<ImageDimension> * output = (k < numberOfMaps)
+                                                      ? static_cast<itk::ImageBase<ImageDimension> *>(
+                                                          m_ProbabilityReaders[k]->GetOutput())
+                                                      : m_MaskReader->GetOutput();
+          output->SetRequestedRegion(slab);
+          output->Update();
+        }
+        catch (itk::ExceptionObject & err)
+        {
+          errors[k] = err.what();
+        }
+      },
+      nullptr);
+    for (const auto & error : errors)
+    {
+      if (!error.empty())
+      {
+        itkGenericExceptionMacro(<< error);
+      }
+    }
+  }
+
+  std::vector<typename ProbabilityReaderType::Pointer> m_ProbabilityReaders;
+  typename MaskReaderType::Pointer                     m_MaskReader;
+  RegionType                                           m_Region;
+  unsigned int                                         m_SlabDepth{ 16 };
+};
+
+#endif // BRAINSProbabilityMapArgMax_h
@@ -30,7 +30,13 @@
 #    include <itkSpatialOrientation.h>
 #    include <itkSpatialOrientationAdapter.h>
 #    include <itkOrientImageFilter.h>
+#    include <algorithm>
+#    include <condition_variable>
 #    include <cstdio>
+#    include <deque>
+#    include <mutex>
+#    include <thread>
+#    include <vector>
 // #include <itkIO.h>
 // #include <itkIO2.h>
 
@@ -102,23 +108,26 @@ OrientImage(typename ImageType::Pointer & inputImage, const typename ImageType::
 }
 } // namespace DebugImageViewerUtil
 
+/** \class DebugImageViewerClient
+ * Sends images to a DebugImageViewer, by default on localhost:19345.
+ *
+ * SendImage() only rescales the image into an 8 bit snapshot and queues it;
+ * a background thread writes the queue to the socket, so the caller never
+ * waits on the viewer.  At most MaximumQueuedImages snapshots wait to be
+ * sent.  When the viewer falls behind the oldest waiting snapshot is
+ * dropped, so images that do arrive are always in the order they were sent
+ * and the latest one is never lost.
+ */
 class DebugImageViewerClient
 {
 public:
-  DebugImageViewerClient()
-    : m_Sock(0)
-    , m_Enabled(false)
-    , m_PromptUser(false)
-  {}
+  DebugImageViewerClient() = default;
 
-  ~DebugImageViewerClient()
-  {
-    if (m_Sock)
-    {
-      this->m_Sock->CloseSocket();
-      this->m_Sock->Delete();
-    }
-  }
+  ~DebugImageViewerClient() { this->SetEnabled(false); }
+
+  DebugImageViewerClient(const DebugImageViewerClient &) = delete;
+  DebugImageViewerClient &
+  operator=(const DebugImageViewerClient &) = delete;
 
   void
   SetPromptUser(bool x)
@@ -126,22 +135,37 @@ public:
     m_PromptUser = x;
   }
 
+  /** Where the viewer listens; used by the next SetEnabled(true). */
+  void
+  SetServer(const std::string & host, int port)
+  {
+    m_Host = host;
+    m_Port = port;
+  }
+
+  /** Bound of the send queue, at least one image. */
+  void
+  SetMaximumQueuedImages(size_t maximumQueuedImages)
+  {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    m_MaximumQueuedImages = std::max<size_t>(1, maximumQueuedImages);
+  }
+
+  /** Number of snapshots dropped because the viewer fell behind. */
+  size_t
+  GetNumberOfDroppedImages()
+  {
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    return m_NumberOfDroppedImages;
+  }
+
   /** Send an image to the viewer */
   template <typename ImageType>
   void
   SendImage(const typename ImageType::Pointer & image, unsigned viewIndex = 0)
   {
     this->Send<ImageType>(image, viewIndex);
-    if (this->m_PromptUser)
-    {
-      //
-      // make sure we connect to interactive input
-      FILE * in = fopen("/dev/tty", "r");
-      std::cerr << ">>>>>>>>>Hit enter to continue " << std::flush;
-      char buf[256];
-      fgets(buf, 255, in);
-      fclose(in);
-    }
+    this->PromptUser();
   }
 
   /** Send one component of a vector image to the viewer */
@@ -150,32 +174,46 @@ public:
   SendImage(const typename ImageType::Pointer & image, unsigned viewIndex, unsigned vectorIndex)
   {
     this->Send<ImageType>(image, viewIndex, vectorIndex);
-    if (this->m_PromptUser)
-    {
-      //
-      // make sure we connect to interactive input
-      FILE * in = fopen("/dev/tty", "r");
-      std::cerr << ">>>>>>>>>Hit enter to continue " << std::flush;
-      char buf[256];
-      fgets(buf, 255, in);
-      fclose(in);
-    }
+    this->PromptUser();
+  }
+
+  /** Wait until every queued snapshot has been written to the socket. */
+  void
+  Flush()
+  {
+    std::unique_lock<std::mutex> lock(m_QueueMutex);
+    m_QueueIdle.wait(lock, [this] { return m_Queue.empty() && !m_Sending; });
   }
 
   /** enable sending of images to the viewer */
   void
   SetEnabled(bool enabled)
   {
+    if (enabled == this->m_Enabled)
+    {
+      return;
+    }
     this->m_Enabled = enabled;
     if (enabled)
     {
       this->_Init();
+      return;
     }
-    else if (this->m_Sock != 0)
+    // Deliver what is still queued before closing the connection.
+    {
+      std::lock_guard<std::mutex> lock(m_QueueMutex);
+      m_StopSender = true;
+    }
+    m_QueueChanged.notify_all();
+    if (m_SenderThread.joinable())
+    {
+      m_SenderThread.join();
+    }
+    if (this->m_Sock != nullptr)
     {
       this->m_Sock->CloseSocket();
       this->m_Sock->Delete();
-      this->m_Sock = 0;
+      this->m_Sock = nullptr;
     }
   }
 
@@ -186,11 +224,84 @@ public:
   }
 
 private:
+  using TransferImageType = itk::Image<unsigned char, 3>;
+
+  /** A snapshot ready to be written: the fixed size header, then the pixels. */
+  struct QueuedImage
+  {
+    std::vector<char>          header;
+    TransferImageType::Pointer image;
+    size_t                     bufferSize{ 0 };
+  };
+
   void
   _Init()
   {
     this->m_Sock = vtkClientSocket::New();
-    this->m_Sock->ConnectToServer("localhost", 19345);
+    this->m_Sock->ConnectToServer(m_Host.c_str(), m_Port);
+    m_StopSender = false;
+    m_SenderThread = std::thread([this] { this->SendQueuedImages(); });
+  }
+
+  void
+  PromptUser()
+  {
+    if (this->m_PromptUser)
+    {
+      // the image has to be on screen before asking
+      this->Flush();
+      //
+      // make sure we connect to interactive input
+      FILE * in = fopen("/dev/tty", "r");
+      std::cerr << ">>>>>>>>>Hit enter to continue " << std::flush;
+      char buf[256];
+      fgets(buf, 255, in);
+      fclose(in);
+    }
+  }
+
+  void
+  Enqueue(QueuedImage && queuedImage)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_QueueMutex);
+      while (m_Queue.size() >= m_MaximumQueuedImages)
+      {
+        m_Queue.pop_front();
+        ++m_NumberOfDroppedImages;
+      }
+      m_Queue.push_back(std::move(queuedImage));
+    }
+    m_QueueChanged.notify_one();
+  }
+
+  /** Body of the sender thread, runs until SetEnabled(false) and the queue is empty. */
+  void
+  SendQueuedImages()
+  {
+    std::unique_lock<std::mutex> lock(m_QueueMutex);
+    while (true)
+    {
+      m_QueueChanged.wait(lock, [this] { return m_StopSender || !m_Queue.empty(); });
+      if (m_Queue.empty())
+      {
+        return;
+      }
+      QueuedImage queuedImage = std::move(m_Queue.front());
+      m_Queue.pop_front();
+      m_Sending = true;
+      lock.unlock();
+
+      this->m_Sock->Send(queuedImage.header.data(), static_cast<int>(queuedImage.header.size()));
+      this->m_Sock->Send(queuedImage.image->GetBufferPointer(), static_cast<int>(queuedImage.bufferSize));
+
+      lock.lock();
+      m_Sending = false;
+      if (m_Queue.empty())
+      {
+        m_QueueIdle.notify_all();
+      }
+    }
   }
 
   template <typename ImageType>
@@ -202,9 +313,21 @@ private:
   Send(const typename ImageType::Pointer & image, unsigned int viewIndex, unsigned int vectorIndex);
 
 private:
-  vtkClientSocket * m_Sock;
-  bool              m_Enabled;
-  bool              m_PromptUser;
+  vtkClientSocket * m_Sock{ nullptr };
+  bool              m_Enabled{ false };
+  bool              m_PromptUser{ false };
+  std::string       m_Host{ "localhost" };
+  int               m_Port{ 19345 };
+
+  std::thread             m_SenderThread;
+  std::mutex              m_QueueMutex;
+  std::condition_variable m_QueueChanged;
+  std::condition_variable m_QueueIdle;
+  std::deque<QueuedImage> m_Queue;
+  size_t                  m_MaximumQueuedImages{ 4 };
+  size_t                  m_NumberOfDroppedImages{ 0 };
+  bool                    m_StopSender{ false };
+  bool                    m_Sending{ false };
 };
 
 template <typename ImageType>
@@ -215,7 +338,6 @@ DebugImageViewerClient::Send(const typename ImageType::Pointer & image, unsigned
   {
     return;
   }
-  using TransferImageType = itk::Image<unsigned char, 3>;
   using SizeType = TransferImageType::SizeType;
   using SpacingType = TransferImageType::SpacingType;
   using PointType = TransferImageType::PointType;
@@ -247,24 +369,34 @@ DebugImageViewerClient::Send(const typename ImageType::Pointer & image, unsigned
     itk::SpatialOrientationAdapter().FromDirectionCosines(xferImage->GetDirection());
   // get origin
   PointType origin = xferImage->GetOrigin();
+  //
+  // xferImage is a private copy, so the caller may change image as soon as
+  // it is queued.
+  QueuedImage queuedImage;
+  auto        append = [&queuedImage](const void * data, size_t length) {
+    const char * bytes = static_cast<const char *>(data);
+    queuedImage.header.insert(queuedImage.header.end(), bytes, bytes + length);
+  };
   for (unsigned int i = 0; i < 3; i++)
   {
-    this->m_Sock->Send(&size[i], sizeof(SizeType::SizeValueType));
+    append(&size[i], sizeof(SizeType::SizeValueType));
   }
   for (unsigned int i = 0; i < 3; i++)
   {
-    this->m_Sock->Send(&spacing[i], sizeof(SpacingType::ValueType));
+    append(&spacing[i], sizeof(SpacingType::ValueType));
   }
-  this->m_Sock->Send(&orientation, sizeof(orientation));
+  append(&orientation, sizeof(orientation));
   // send origin
   for (unsigned int i = 0; i < 3; i++)
   {
     double x = origin[i];
-    this->m_Sock->Send(&x, sizeof(double));
+    append(&x, sizeof(double));
   }
-  this->m_Sock->Send(&viewIndex, sizeof(viewIndex));
+  append(&viewIndex, sizeof(viewIndex));
   // transfer image pixels
-  this->m_Sock->Send(xferImage->GetBufferPointer(), bufferSize);
+  queuedImage.image = xferImage;
+  queuedImage.bufferSize = bufferSize;
+  this->Enqueue(std::move(queuedImage));
   //   std::cerr << "DebugImageViewer: size = " << size
   //             << " spacing = " << spacing << std::endl
   //             << "orientation = " << orientation
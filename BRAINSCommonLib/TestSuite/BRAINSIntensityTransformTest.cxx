@@ -0,0 +1,176 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageToHistogramFilter.h>
+#include <itkStatisticsImageFilter.h>
+
+#include "BRAINSIntensityTransform.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Compare the one pass statistics and histogram of
+// brains_intensity_normalize_quantiles with the StatisticsImageFilter and
+// 1000 bin ImageToHistogramFilter it replaced, on a synthetic image with a
+// background and two outliers the range sample skips, then check the remap.
+using InputImageType = itk::Image<float, 3>;
+using OutputImageType = itk::Image<unsigned short, 3>;
+
+static double
+ReferenceQuantile(const InputImageType * image, const double minimum, const double maximum, const double p)
+{
+  using HistogramFilterType = itk::Statistics::ImageToHistogramFilter<InputImageType>;
+  HistogramFilterType::HistogramType::MeasurementVectorType lowerBound(1);
+  lowerBound.Fill(minimum);
+  HistogramFilterType::HistogramType::MeasurementVectorType upperBound(1);
+  upperBound.Fill(maximum);
+  HistogramFilterType::HistogramType::SizeType size(1);
+  size.Fill(1000);
+
+  HistogramFilterType::Pointer histogramFilter = HistogramFilterType::New();
+  histogramFilter->SetInput(image);
+  histogramFilter->SetHistogramBinMinimum(lowerBound);
+  histogramFilter->SetHistogramBinMaximum(upperBound);
+  histogramFilter->SetHistogramSize(size);
+  histogramFilter->Update();
+  return histogramFilter->GetOutput()->Quantile(0, p);
+}
+
+int
+main(int, char *[])
+{
+  InputImageType::SizeType size;
+  size[0] = 64;
+  size[1] = 64;
+  size[2] = 40;
+  InputImageType::Pointer image = InputImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  // Zero background around a gamma distributed foreground
+  std::mt19937                             generator(2020);
+  std::gamma_distribution<float>           foreground(4.0f, 150.0f);
+  itk::ImageRegionIterator<InputImageType> it(image, image->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    const InputImageType::IndexType index = it.GetIndex();
+    const bool inside = index[0] > 8 && index[0] < 56 && index[1] > 8 && index[1] < 56 && index[2] > 4 && index[2] < 36;
+    it.Set(inside ? foreground(generator) : 0.0f);
+  }
+  // Odd buffer offsets, between the samples of brains_intensity_sample_range
+  InputImageType::IndexType outlier;
+  outlier[0] = 1;
+  outlier[1] = 0;
+  outlier[2] = 0;
+  image->SetPixel(outlier, -500.0f);
+  outlier[0] = 33;
+  outlier[1] = 32;
+  outlier[2] = 20;
+  image->SetPixel(outlier, 9000.0f);
+
+  using StatisticsFilterType = itk::StatisticsImageFilter<InputImageType>;
+  StatisticsFilterType::Pointer statistics = StatisticsFilterType::New();
+  statistics->SetInput(image);
+  statistics->Update();
+  const double minimum = statistics->GetMinimum();
+  const double maximum = statistics->GetMaximum();
+  const double tolerance = (maximum - minimum) / 1000;
+
+  bool   passed = true;
+  double sampleMinimum;
+  double sampleMaximum;
+  brains_intensity_sample_range<InputImageType>(image.GetPointer(), sampleMinimum, sampleMaximum);
+  if (sampleMinimum <= minimum || sampleMaximum >= maximum)
+  {
+    std::cerr << "Sampled range (" << sampleMinimum << ", " << sampleMaximum << ") includes the outliers" << std::endl;
+    passed = false;
+  }
+  const BRAINSIntensityHistogram sampled =
+    brains_intensity_histogram<InputImageType>(image.GetPointer(), sampleMinimum, sampleMaximum, 16000);
+  const BRAINSIntensityHistogram exact =
+    brains_intensity_histogram<InputImageType>(image.GetPointer(), minimum, maximum, 16000);
+  if (sampled.Minimum != minimum || sampled.Maximum != maximum || sampled.Underflow != 1 || sampled.Overflow != 1 ||
+      std::abs(sampled.Mean - statistics->GetMean()) > 1e-9 * std::abs(statistics->GetMean()) ||
+      std::abs(sampled.Sigma - statistics->GetSigma()) > 1e-9 * statistics->GetSigma())
+  {
+    std::cerr << "Statistics differ from StatisticsImageFilter" << std::endl;
+    passed = false;
+  }
+  if (sampled.QuantileIsInBins(0.0) || !sampled.QuantileIsInBins(0.02) || !sampled.QuantileIsInBins(0.98) ||
+      exact.Underflow != 0 || exact.Overflow != 0)
+  {
+    std::cerr << "Unexpected underflow or overflow" << std::endl;
+    passed = false;
+  }
+
+  for (const double p : { 0.0, 0.02, 0.25, 0.5, 0.75, 0.98 })
+  {
+    const double reference = ReferenceQuantile(image, minimum, maximum, p);
+    const double quantile = (sampled.QuantileIsInBins(p) ? sampled : exact).Quantile(p);
+    std::cout << "Quantile " << p << ": " << quantile << " reference " << reference << std::endl;
+    if (std::abs(quantile - reference) > tolerance)
+    {
+      std::cerr << "Quantile " << p << " differs by more than one reference bin" << std::endl;
+      passed = false;
+    }
+  }
+
+  // The 0 and 1 quantiles are the exact range, so the unclipped remap is
+  // known up to rounding
+  OutputImageType::Pointer output =
+    brains_intensity_normalize_quantiles<InputImageType, OutputImageType>(image, 0.0, 1.0, 0, 4095, false, false, true);
+  if (output.IsNull() || output->GetBufferedRegion() != image->GetLargestPossibleRegion())
+  {
+    std::cerr << "Unexpected output region" << std::endl;
+    return EXIT_FAILURE;
+  }
+  itk::SizeValueType                             differences = 0;
+  itk::ImageRegionConstIterator<OutputImageType> outIt(output, output->GetBufferedRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it, ++outIt)
+  {
+    const double expected = (it.Get() - minimum) * 4095 / (maximum - minimum);
+    differences += std::abs(outIt.Get() - expected) > 1.0;
+  }
+  if (differences != 0)
+  {
+    std::cerr << differences << " remapped voxels differ" << std::endl;
+    passed = false;
+  }
+
+  // Clipped to the output range
+  output =
+    brains_intensity_normalize_quantiles<InputImageType, OutputImageType>(image, 0.02, 0.98, 100, 4000, true, false);
+  for (outIt = itk::ImageRegionConstIterator<OutputImageType>(output, output->GetBufferedRegion()); !outIt.IsAtEnd();
+       ++outIt)
+  {
+    if (outIt.Get() < 100 || outIt.Get() > 4000)
+    {
+      std::cerr << "Clipped output " << outIt.Get() << " outside (100, 4000)" << std::endl;
+      passed = false;
+      break;
+    }
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
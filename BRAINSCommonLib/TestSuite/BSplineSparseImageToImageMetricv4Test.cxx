@@ -0,0 +1,207 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include <itkAffineTransform.h>
+#include <itkBSplineTransform.h>
+#include <itkBSplineTransformInitializer.h>
+#include <itkCompositeTransform.h>
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include "itkBSplineSparseMattesMutualInformationImageToImageMetricv4.h"
+#include "itkBSplineSparseMeanSquaresImageToImageMetricv4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Compare the sparse BSpline evaluation with the superclass evaluation for
+// Mattes mutual information and mean squares, with the BSpline alone and
+// behind a fixed affine transform, and check that the deterministic
+// derivative does not depend on the number of work units, and that a
+// sample cache over MaximumSampleCacheBytes falls back to the superclass.
+using ImageType = itk::Image<float, 3>;
+using BSplineTransformType = itk::BSplineTransform<double, 3, 3>;
+using CompositeTransformType = itk::CompositeTransform<double, 3>;
+
+static ImageType::Pointer
+MakeBlobImage(const double shift)
+{
+  ImageType::SizeType size;
+  size.Fill(28);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x = index[0] - 13.0 - shift;
+    const double               y = index[1] - 14.0 + 0.5 * shift;
+    const double               z = index[2] - 13.5;
+    it.Set(static_cast<float>(100.0 * std::exp(-(x * x + 1.5 * y * y + z * z) / 40.0) + 0.2 * index[0]));
+  }
+  return image;
+}
+
+static BSplineTransformType::Pointer
+MakeBSpline(const ImageType * image)
+{
+  BSplineTransformType::Pointer bspline = BSplineTransformType::New();
+  using InitializerType = itk::BSplineTransformInitializer<BSplineTransformType, ImageType>;
+  InitializerType::Pointer           initializer = InitializerType::New();
+  BSplineTransformType::MeshSizeType meshSize;
+  meshSize[0] = 4;
+  meshSize[1] = 3;
+  meshSize[2] = 5;
+  initializer->SetTransform(bspline);
+  initializer->SetImage(image);
+  initializer->SetTransformDomainMeshSize(meshSize);
+  initializer->InitializeTransform();
+
+  BSplineTransformType::ParametersType parameters(bspline->GetNumberOfParameters());
+  for (unsigned int p = 0; p < parameters.GetSize(); ++p)
+  {
+    parameters[p] = 0.8 * std::sin(0.7 * p);
+  }
+  bspline->SetParameters(parameters);
+  return bspline;
+}
+
+template <typename TMetric>
+static bool
+CompareMetric(const char * metricName, const bool withAffine)
+{
+  const ImageType::Pointer            fixedImage = MakeBlobImage(0.0);
+  const ImageType::Pointer            movingImage = MakeBlobImage(1.5);
+  const BSplineTransformType::Pointer bspline = MakeBSpline(fixedImage);
+
+  typename TMetric::Pointer metric = TMetric::New();
+  metric->SetFixedImage(fixedImage);
+  metric->SetMovingImage(movingImage);
+  metric->SetVirtualDomainFromImage(fixedImage);
+  if (withAffine)
+  {
+    using AffineTransformType = itk::AffineTransform<double, 3>;
+    AffineTransformType::Pointer          affine = AffineTransformType::New();
+    AffineTransformType::OutputVectorType translation;
+    translation[0] = 0.6;
+    translation[1] = -0.4;
+    translation[2] = 0.3;
+    affine->Translate(translation);
+    affine->Scale(1.02);
+
+    CompositeTransformType::Pointer composite = CompositeTransformType::New();
+    composite->AddTransform(affine);
+    composite->AddTransform(bspline);
+    composite->SetOnlyMostRecentTransformToOptimizeOn();
+    metric->SetMovingTransform(composite);
+  }
+  else
+  {
+    metric->SetMovingTransform(bspline);
+  }
+
+  typename TMetric::MeasureType    values[3];
+  typename TMetric::DerivativeType derivatives[3];
+  for (unsigned int run = 0; run < 3; ++run)
+  {
+    // run 0: superclass, 1: sparse on one work unit, 2: sparse on four.
+    metric->SetUseSparseBSplineEvaluation(run != 0);
+    metric->SetMaximumNumberOfWorkUnits(run == 1 ? 1 : 4);
+    metric->Initialize();
+    metric->GetValueAndDerivative(values[run], derivatives[run]);
+  }
+
+  double maxDerivative = 0.0;
+  double maxDifference = 0.0;
+  for (unsigned int p = 0; p < derivatives[0].GetSize(); ++p)
+  {
+    maxDerivative = std::max(maxDerivative, std::abs(derivatives[0][p]));
+    maxDifference = std::max(maxDifference, std::abs(derivatives[0][p] - derivatives[1][p]));
+  }
+  bool passed = true;
+  if (std::abs(values[0] - values[1]) > 1e-6 * std::max(1.0, std::abs(values[0])))
+  {
+    std::cerr << metricName << ": sparse value " << values[1] << " differs from " << values[0] << std::endl;
+    passed = false;
+  }
+  if (maxDerivative == 0.0 || maxDifference > 1e-5 * maxDerivative)
+  {
+    std::cerr << metricName << ": sparse derivative differs by " << maxDifference << " (largest entry "
+              << maxDerivative << ")" << std::endl;
+    passed = false;
+  }
+  if (values[1] != values[2] || derivatives[1] != derivatives[2])
+  {
+    std::cerr << metricName << ": deterministic result depends on the number of work units" << std::endl;
+    passed = false;
+  }
+
+  typename TMetric::MeasureType    fastValue;
+  typename TMetric::DerivativeType fastDerivative;
+  metric->SetDeterministicReduction(false);
+  metric->GetValueAndDerivative(fastValue, fastDerivative);
+  for (unsigned int p = 0; p < fastDerivative.GetSize(); ++p)
+  {
+    if (std::abs(fastDerivative[p] - derivatives[2][p]) > 1e-10 * maxDerivative)
+    {
+      std::cerr << metricName << ": per work unit reduction differs at parameter " << p << std::endl;
+      passed = false;
+      break;
+    }
+  }
+
+  // A sample cache over the limit falls back to the superclass.
+  typename TMetric::MeasureType    fallbackValue;
+  typename TMetric::DerivativeType fallbackDerivative;
+  metric->SetMaximumSampleCacheBytes(1);
+  metric->Initialize();
+  metric->GetValueAndDerivative(fallbackValue, fallbackDerivative);
+  double maxFallbackDifference = 0.0;
+  for (unsigned int p = 0; p < fallbackDerivative.GetSize(); ++p)
+  {
+    maxFallbackDifference = std::max(maxFallbackDifference, std::abs(fallbackDerivative[p] - derivatives[0][p]));
+  }
+  if (metric->GetNumberOfCachedSamples() != 0 ||
+      std::abs(fallbackValue - values[0]) > 1e-10 * std::max(1.0, std::abs(values[0])) ||
+      maxFallbackDifference > 1e-10 * maxDerivative)
+  {
+    std::cerr << metricName << ": evaluation over the sample cache limit differs from the superclass" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+
+int
+main(int, char *[])
+{
+  using MattesMetricType = itk::BSplineSparseMattesMutualInformationImageToImageMetricv4<ImageType, ImageType>;
+  using MeanSquaresMetricType = itk::BSplineSparseMeanSquaresImageToImageMetricv4<ImageType, ImageType>;
+
+  bool passed = true;
+  for (const bool withAffine : { false, true })
+  {
+    passed = CompareMetric<MattesMetricType>("MattesMutualInformation", withAffine) && passed;
+    passed = CompareMetric<MeanSquaresMetricType>("MeanSquares", withAffine) && passed;
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
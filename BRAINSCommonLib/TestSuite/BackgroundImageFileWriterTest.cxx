@@ -0,0 +1,126 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include <itkImage.h>
+#include <itkImageFileReader.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+
+#include "itkBackgroundImageFileWriter.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Queue more images than the writer may hold, change each one right after
+// it is queued, and check that the files contain the images as they were
+// when queued.  A file in a missing directory must be reported by Flush().
+int
+main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <temporaryDirectory>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string tempDir(argv[1]);
+
+  constexpr unsigned int numTestImages = 12;
+  using ImageType = itk::Image<float, 3>;
+
+  ImageType::SizeType size;
+  size[0] = 17;
+  size[1] = 13;
+  size[2] = 11;
+
+  itk::BackgroundImageFileWriter::Pointer backgroundWriter = itk::BackgroundImageFileWriter::New();
+  backgroundWriter->SetNumberOfWorkers(3);
+  backgroundWriter->SetMaximumPendingImages(4);
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  std::vector<std::string> fileNames;
+  for (unsigned int i = 0; i < numTestImages; ++i)
+  {
+    float value = static_cast<float>(i);
+    for (itk::ImageRegionIterator<ImageType> it(image, image->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+    {
+      it.Set(value);
+      value += 0.5F;
+    }
+    std::ostringstream fileName;
+    fileName << tempDir << "/BackgroundImageFileWriterTest_" << i << ".nii.gz";
+    fileNames.push_back(fileName.str());
+    backgroundWriter->Write(image.GetPointer(), fileNames.back());
+    if (backgroundWriter->GetNumberOfPendingImages() > backgroundWriter->GetMaximumPendingImages())
+    {
+      std::cerr << "More images pending than MaximumPendingImages" << std::endl;
+      return EXIT_FAILURE;
+    }
+    image->FillBuffer(-1.0F);
+  }
+
+  try
+  {
+    backgroundWriter->Flush();
+  }
+  catch (itk::ExceptionObject & e)
+  {
+    std::cerr << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for (unsigned int i = 0; i < numTestImages; ++i)
+  {
+    using ReaderType = itk::ImageFileReader<ImageType>;
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName(fileNames[i]);
+    reader->Update();
+    float value = static_cast<float>(i);
+    for (itk::ImageRegionConstIterator<ImageType> it(reader->GetOutput(), reader->GetOutput()->GetBufferedRegion());
+         !it.IsAtEnd();
+         ++it)
+    {
+      if (it.Get() != value)
+      {
+        std::cerr << fileNames[i] << " has " << it.Get() << " where " << value << " was queued" << std::endl;
+        return EXIT_FAILURE;
+      }
+      value += 0.5F;
+    }
+  }
+
+  backgroundWriter->Write(image.GetPointer(), tempDir + "/no_such_directory/BackgroundImageFileWriterTest.nii.gz");
+  try
+  {
+    backgroundWriter->Flush();
+    std::cerr << "Flush() did not report the failed write" << std::endl;
+    return EXIT_FAILURE;
+  }
+  catch (itk::ExceptionObject & e)
+  {
+    std::cout << "Expected failure: " << e.GetDescription() << std::endl;
+  }
+
+  std::cout << "All " << numTestImages << " images written in the background match." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "DebugImageViewerClient.h"
+
+#include <itkImage.h>
+#include <itkImageRegionIterator.h>
+#include <vtkServerSocket.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Send a burst of images to a loopback server that does not read until the
+// burst has been queued.  SendImage must return without waiting on the
+// server, the images that arrive must be in send order ending with the last
+// one, and every image must be either received or counted as dropped.
+//
+//   DebugImageViewerClientTest [port]
+int
+main(int argc, char * argv[])
+{
+  const int          port = (argc > 1) ? std::atoi(argv[1]) : 19346;
+  constexpr unsigned numberOfImages = 24;
+  constexpr unsigned edgeLength = 128;
+
+  using ImageType = itk::Image<float, 3>;
+  using TransferImageType = itk::Image<unsigned char, 3>;
+  using SizeValueType = TransferImageType::SizeType::SizeValueType;
+  using OrientationType = itk::SpatialOrientation::ValidCoordinateOrientationFlags;
+
+  vtkServerSocket * server = vtkServerSocket::New();
+  if (server->CreateServer(port) != 0)
+  {
+    std::cerr << "Can't listen on port " << port << std::endl;
+    server->Delete();
+    return EXIT_FAILURE;
+  }
+
+  DebugImageViewerClient client;
+  client.SetServer("localhost", port);
+  client.SetMaximumQueuedImages(2);
+  client.SetEnabled(true);
+
+  vtkClientSocket * connection = server->WaitForConnection(10000);
+  if (connection == nullptr)
+  {
+    std::cerr << "Client did not connect" << std::endl;
+    client.SetEnabled(false);
+    server->Delete();
+    return EXIT_FAILURE;
+  }
+
+  std::atomic<bool>     startReading(false);
+  std::vector<unsigned> receivedViewIndices;
+  bool                  badMessage = false;
+  std::thread           reader([&] {
+    while (!startReading)
+    {
+      std::this_thread::yield();
+    }
+    while (true)
+    {
+      SizeValueType size[3];
+      if (connection->Receive(size, sizeof(size)) != sizeof(size))
+      {
+        return; // connection closed
+      }
+      double          spacing[3];
+      OrientationType orientation;
+      double          origin[3];
+      unsigned        viewIndex;
+      connection->Receive(spacing, sizeof(spacing));
+      connection->Receive(&orientation, sizeof(orientation));
+      connection->Receive(origin, sizeof(origin));
+      connection->Receive(&viewIndex, sizeof(viewIndex));
+      if (size[0] != edgeLength || size[1] != edgeLength || size[2] != edgeLength)
+      {
+        badMessage = true;
+        return;
+      }
+      std::vector<unsigned char> pixels(edgeLength * edgeLength * edgeLength);
+      if (connection->Receive(pixels.data(), static_cast<int>(pixels.size())) != static_cast<int>(pixels.size()) ||
+          pixels.front() != 0 || pixels.back() != 255)
+      {
+        badMessage = true;
+        return;
+      }
+      receivedViewIndices.push_back(viewIndex);
+    }
+  });
+
+  // The viewIndex carries the sequence number of each image.
+  for (unsigned n = 0; n < numberOfImages; ++n)
+  {
+    ImageType::Pointer  image = ImageType::New();
+    ImageType::SizeType size;
+    size.Fill(edgeLength);
+    image->SetRegions(size);
+    image->Allocate();
+    float value = 0.0F;
+    for (itk::ImageRegionIterator<ImageType> it(image, image->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+    {
+      it.Set(value);
+      value += 1.0F;
+    }
+    client.SendImage<ImageType>(image, n);
+    // The queued snapshot must not depend on the image staying unchanged.
+    image->FillBuffer(0.0F);
+  }
+  startReading = true;
+  client.SetEnabled(false);
+  reader.join();
+
+  connection->CloseSocket();
+  connection->Delete();
+  server->Delete();
+
+  const size_t dropped = client.GetNumberOfDroppedImages();
+  std::cout << "received " << receivedViewIndices.size() << " dropped " << dropped << " of " << numberOfImages
+            << std::endl;
+
+  int status = EXIT_SUCCESS;
+  if (badMessage)
+  {
+    std::cerr << "Received a malformed image" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  if (receivedViewIndices.size() + dropped != numberOfImages)
+  {
+    std::cerr << "Images were lost without being counted as dropped" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  for (size_t i = 1; i < receivedViewIndices.size(); ++i)
+  {
+    if (receivedViewIndices[i] <= receivedViewIndices[i - 1])
+    {
+      std::cerr << "Image " << receivedViewIndices[i] << " arrived after " << receivedViewIndices[i - 1] << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+  if (receivedViewIndices.empty() || receivedViewIndices.back() != numberOfImages - 1)
+  {
+    std::cerr << "The last image was not delivered" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  if (dropped == 0)
+  {
+    std::cerr << "Expected the stalled server to make the client drop images" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  return status;
+}
@@ -0,0 +1,214 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include <itkImage.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itksys/Directory.hxx>
+
+#include "itkIO.h"
+#include "itkImageFileReducer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Uniform random values in [0, maximum), different for every seed
+template <typename TImage>
+static typename TImage::Pointer
+MakeRandomImage(const typename TImage::SizeType & size, const unsigned int seed, const double maximum)
+{
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(size);
+  image->Allocate();
+  std::mt19937                           generator(seed);
+  std::uniform_real_distribution<double> distribution(0.0, maximum);
+  for (itk::ImageRegionIterator<TImage> it(image, image->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+  {
+    it.Set(static_cast<typename TImage::PixelType>(distribution(generator)));
+  }
+  return image;
+}
+
+// Alternate compressed NRRD, streamed from an uncompressed copy, with
+// uncompressed NRRD and uncompressed NIfTI, read slab by slab
+template <typename TImage>
+static std::string
+WriteTestImage(const TImage * image, const std::string & prefix, const unsigned int i)
+{
+  static const char * const extensions[3] = { ".nrrd", ".nrrd", ".nii" };
+  const std::string         fileName = prefix + std::to_string(i) + extensions[i % 3];
+  using WriterType = itk::ImageFileWriter<TImage>;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(image);
+  writer->SetFileName(fileName);
+  writer->SetUseCompression(i % 3 == 0);
+  writer->Update();
+  return fileName;
+}
+
+// Compare the streamed reductions against a direct computation over all
+// images held in memory.  A small buffer forces several slabs.
+int
+main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <temporaryDirectory>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string tempDir(argv[1]);
+
+  constexpr unsigned int numTestImages = 7;
+  using FloatImageType = itk::Image<float, 3>;
+  using LabelImageType = itk::Image<unsigned char, 3>;
+
+  FloatImageType::SizeType size;
+  size[0] = 6;
+  size[1] = 5;
+  size[2] = 9;
+
+  std::vector<FloatImageType::Pointer> floatImages;
+  std::vector<LabelImageType::Pointer> labelImages;
+  std::vector<std::string>             floatFiles;
+  std::vector<std::string>             labelFiles;
+  for (unsigned int i = 0; i < numTestImages; ++i)
+  {
+    floatImages.push_back(MakeRandomImage<FloatImageType>(size, 100 + i, 1000.0));
+    floatFiles.push_back(WriteTestImage<FloatImageType>(floatImages.back(), tempDir + "/ImageFileReducerTestFloat", i));
+    labelImages.push_back(MakeRandomImage<LabelImageType>(size, 200 + i, 4.0));
+    labelFiles.push_back(WriteTestImage<LabelImageType>(labelImages.back(), tempDir + "/ImageFileReducerTestLabel", i));
+  }
+  if (!itkUtil::ImageFileCanStreamRead(floatFiles[2]))
+  {
+    std::cerr << "Expected " << floatFiles[2] << " to be read slab by slab" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  using FloatReducerType = itk::ImageFileReducer<FloatImageType, FloatImageType>;
+  using LabelReducerType = itk::ImageFileReducer<LabelImageType, LabelImageType>;
+  const itk::SizeValueType twoSlices = 2 * size[0] * size[1] * numTestImages * sizeof(float);
+
+  FloatImageType::Pointer floatOutputs[3];
+  const FloatReducerType::ReductionType floatReductions[3] = { FloatReducerType::Mean,
+                                                                FloatReducerType::Variance,
+                                                                FloatReducerType::Median };
+  for (unsigned int r = 0; r < 3; ++r)
+  {
+    FloatReducerType::Pointer reducer = FloatReducerType::New();
+    reducer->SetFileNames(floatFiles);
+    reducer->SetReduction(floatReductions[r]);
+    reducer->SetNumberOfPrefetchedImages(1);
+    reducer->SetMaximumBufferBytes(twoSlices);
+    reducer->SetTemporaryDirectory(tempDir);
+    reducer->Update();
+    floatOutputs[r] = reducer->GetOutput();
+  }
+
+  LabelReducerType::Pointer labelReducer = LabelReducerType::New();
+  labelReducer->SetFileNames(labelFiles);
+  labelReducer->SetReduction(LabelReducerType::MajorityVote);
+  labelReducer->SetMaximumBufferBytes(twoSlices);
+  labelReducer->SetTemporaryDirectory(tempDir);
+  labelReducer->Update();
+  LabelImageType::Pointer majority = labelReducer->GetOutput();
+
+  itksys::Directory directory;
+  directory.Load(tempDir);
+  for (unsigned long i = 0; i < directory.GetNumberOfFiles(); ++i)
+  {
+    const std::string fileName = directory.GetFile(i);
+    if (fileName.compare(0, 17, "ImageFileReducer_") == 0)
+    {
+      std::cerr << "The uncompressed copy " << fileName << " was not removed" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  unsigned int failures = 0;
+  unsigned int medianDiffersFromFirst = 0;
+  for (itk::ImageRegionConstIterator<FloatImageType> it(floatImages[0], floatImages[0]->GetLargestPossibleRegion());
+       !it.IsAtEnd();
+       ++it)
+  {
+    const FloatImageType::IndexType index = it.GetIndex();
+    std::vector<double>             values;
+    std::map<int, unsigned int>     labelCounts;
+    for (unsigned int i = 0; i < numTestImages; ++i)
+    {
+      values.push_back(floatImages[i]->GetPixel(index));
+      ++labelCounts[labelImages[i]->GetPixel(index)];
+    }
+    double mean = 0.0;
+    for (const double v : values)
+    {
+      mean += v;
+    }
+    mean /= numTestImages;
+    double variance = 0.0;
+    for (const double v : values)
+    {
+      variance += (v - mean) * (v - mean);
+    }
+    variance /= (numTestImages - 1);
+    std::sort(values.begin(), values.end());
+    const double median = values[numTestImages / 2];
+
+    int          expectedLabel = 0;
+    unsigned int expectedCount = 0;
+    for (const auto & labelCount : labelCounts)
+    {
+      if (labelCount.second > expectedCount)
+      {
+        expectedLabel = labelCount.first;
+        expectedCount = labelCount.second;
+      }
+    }
+
+    medianDiffersFromFirst += (floatImages[0]->GetPixel(index) != static_cast<float>(median));
+
+    if (std::abs(floatOutputs[0]->GetPixel(index) - mean) > 1e-3 ||
+        std::abs(floatOutputs[1]->GetPixel(index) - variance) > 1e-6 * variance + 1e-2 ||
+        floatOutputs[2]->GetPixel(index) != static_cast<float>(median) ||
+        static_cast<int>(majority->GetPixel(index)) != expectedLabel)
+    {
+      std::cerr << "Mismatch at " << index << ": mean " << floatOutputs[0]->GetPixel(index) << " vs " << mean
+                << ", variance " << floatOutputs[1]->GetPixel(index) << " vs " << variance << ", median "
+                << floatOutputs[2]->GetPixel(index) << " vs " << median << ", label "
+                << static_cast<int>(majority->GetPixel(index)) << " vs " << expectedLabel << std::endl;
+      ++failures;
+    }
+  }
+  if (medianDiffersFromFirst == 0)
+  {
+    std::cerr << "The test images do not differ" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (failures != 0)
+  {
+    std::cerr << failures << " voxels differ" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
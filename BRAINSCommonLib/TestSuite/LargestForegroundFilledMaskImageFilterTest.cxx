@@ -0,0 +1,214 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkLargestForegroundFilledMaskImageFilter.h"
+
+#include "itkBinaryBallStructuringElement.h"
+#include "itkBinaryDilateImageFilter.h"
+#include "itkBinaryErodeImageFilter.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkConnectedComponentImageFilter.h"
+#include "itkConnectedThresholdImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMath.h"
+#include "itkRelabelComponentImageFilter.h"
+
+#include <cstdlib>
+#include <iostream>
+
+// Mask an anisotropic two valued image with LargestForegroundFilledMaskImageFilter
+// and compare with the ball kernel closing, seeded hole fill and ball kernel
+// dilation the filter used before it switched to distance maps.
+
+using ImageType = itk::Image<short, 3>;
+using MaskImageType = itk::Image<unsigned short, 3>;
+
+static constexpr double ClosingSize = 4.0;
+static constexpr double DilateSize = 3.0;
+
+// An ellipsoid with an enclosed cavity and a narrow cleft, and a small blob
+// apart from it that is not the largest object
+static ImageType::Pointer
+MakeImage()
+{
+  ImageType::SizeType size;
+  size[0] = 52;
+  size[1] = 44;
+  size[2] = 20;
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.9;
+  spacing[1] = 1.2;
+  spacing[2] = 3.0;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(size);
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x = (index[0] - 26.0) * spacing[0];
+    const double               y = (index[1] - 22.0) * spacing[1];
+    const double               z = (index[2] - 10.0) * spacing[2];
+
+    const bool insideEllipsoid = (x * x + y * y) / (14.0 * 14.0) + z * z / (18.0 * 18.0) <= 1.0;
+    const bool insideCavity = x * x + y * y + z * z <= 5.0 * 5.0;
+    const bool insideCleft = y > 6.0 && x >= 0.0 && x < 2.0;
+    const bool insideBlob = index[0] >= 2 && index[0] < 5 && index[1] >= 2 && index[1] < 5 && index[2] >= 9 &&
+                            index[2] < 11;
+    it.Set(((insideEllipsoid && !insideCavity && !insideCleft) || insideBlob) ? 100 : 0);
+  }
+  return image;
+}
+
+static MaskImageType::Pointer
+BallDilate(const MaskImageType * mask, const double ballSize, const bool erode)
+{
+  using KernelType = itk::BinaryBallStructuringElement<MaskImageType::PixelType, 3>;
+  KernelType           ball;
+  KernelType::SizeType ballRadius;
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    ballRadius[d] = itk::Math::ceil(ballSize / mask->GetSpacing()[d]);
+  }
+  ball.SetRadius(ballRadius);
+  ball.CreateStructuringElement();
+
+  if (erode)
+  {
+    using ErodeFilterType = itk::BinaryErodeImageFilter<MaskImageType, MaskImageType, KernelType>;
+    ErodeFilterType::Pointer erodeFilter = ErodeFilterType::New();
+    erodeFilter->SetErodeValue(1);
+    erodeFilter->SetBackgroundValue(0);
+    erodeFilter->SetKernel(ball);
+    erodeFilter->SetInput(mask);
+    erodeFilter->Update();
+    return erodeFilter->GetOutput();
+  }
+  using DilateFilterType = itk::BinaryDilateImageFilter<MaskImageType, MaskImageType, KernelType>;
+  DilateFilterType::Pointer dilateFilter = DilateFilterType::New();
+  dilateFilter->SetDilateValue(1);
+  dilateFilter->SetBackgroundValue(0);
+  dilateFilter->SetKernel(ball);
+  dilateFilter->SetInput(mask);
+  dilateFilter->Update();
+  return dilateFilter->GetOutput();
+}
+
+// The morphology of the filter before the distance map version, on the
+// foreground the unchanged threshold step picks for a two valued image
+static MaskImageType::Pointer
+BallKernelMask(const ImageType * image)
+{
+  using ThresholdType = itk::BinaryThresholdImageFilter<ImageType, MaskImageType>;
+  ThresholdType::Pointer threshold = ThresholdType::New();
+  threshold->SetInput(image);
+  threshold->SetLowerThreshold(100);
+  threshold->SetInsideValue(1);
+  threshold->SetOutsideValue(0);
+
+  using ComponentsType = itk::ConnectedComponentImageFilter<MaskImageType, MaskImageType>;
+  ComponentsType::Pointer components = ComponentsType::New();
+  components->SetInput(threshold->GetOutput());
+  using RelabelType = itk::RelabelComponentImageFilter<MaskImageType, MaskImageType>;
+  RelabelType::Pointer relabel = RelabelType::New();
+  relabel->SetInput(components->GetOutput());
+  using LabelThresholdType = itk::BinaryThresholdImageFilter<MaskImageType, MaskImageType>;
+  LabelThresholdType::Pointer largest = LabelThresholdType::New();
+  largest->SetInput(relabel->GetOutput());
+  largest->SetLowerThreshold(1);
+  largest->SetUpperThreshold(1);
+  largest->SetInsideValue(1);
+  largest->SetOutsideValue(0);
+  largest->Update();
+
+  const MaskImageType::Pointer closed =
+    BallDilate(BallDilate(largest->GetOutput(), ClosingSize, false), ClosingSize, true);
+
+  using FillType = itk::ConnectedThresholdImageFilter<MaskImageType, MaskImageType>;
+  FillType::Pointer fill = FillType::New();
+  const MaskImageType::SizeType size = closed->GetLargestPossibleRegion().GetSize();
+  for (unsigned int corner = 0; corner < 8; ++corner)
+  {
+    MaskImageType::IndexType seed;
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      seed[d] = (corner & (1U << d)) ? static_cast<itk::IndexValueType>(size[d]) - 1 : 0;
+    }
+    fill->AddSeed(seed);
+  }
+  fill->SetReplaceValue(100);
+  fill->SetLower(0);
+  fill->SetUpper(0);
+  fill->SetInput(closed);
+
+  LabelThresholdType::Pointer filled = LabelThresholdType::New();
+  filled->SetInput(fill->GetOutput());
+  filled->SetLowerThreshold(100);
+  filled->SetUpperThreshold(100);
+  filled->SetInsideValue(0);
+  filled->SetOutsideValue(1);
+  filled->Update();
+
+  return BallDilate(filled->GetOutput(), DilateSize, false);
+}
+
+int
+main(int, char *[])
+{
+  const ImageType::Pointer image = MakeImage();
+
+  using FilterType = itk::LargestForegroundFilledMaskImageFilter<ImageType, MaskImageType>;
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(image);
+  filter->SetClosingSize(ClosingSize);
+  filter->SetDilateSize(DilateSize);
+  filter->Update();
+
+  const MaskImageType::Pointer expected = BallKernelMask(image);
+  const MaskImageType *        actual = filter->GetOutput();
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    if (actual->GetSpacing()[d] != image->GetSpacing()[d])
+    {
+      std::cerr << "Mask spacing " << actual->GetSpacing() << " differs from the input " << image->GetSpacing()
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  unsigned int                                 differences = 0;
+  unsigned int                                 insideCount = 0;
+  itk::ImageRegionConstIterator<MaskImageType> expectedIt(expected, expected->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<MaskImageType> actualIt(actual, actual->GetLargestPossibleRegion());
+  for (; !expectedIt.IsAtEnd(); ++expectedIt, ++actualIt)
+  {
+    differences += (expectedIt.Get() != actualIt.Get()) ? 1 : 0;
+    insideCount += (expectedIt.Get() != 0) ? 1 : 0;
+  }
+  if (insideCount == 0 || differences != 0)
+  {
+    std::cerr << differences << " of " << expected->GetLargestPossibleRegion().GetNumberOfPixels()
+              << " voxels differ from the ball kernel mask (" << insideCount << " inside)" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,287 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkMultiModeHistogramThresholdBinaryImageFilter.h"
+
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkComputeHistogramQuantileThresholds.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiplyImageFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Compare the fused MultiModeHistogramThresholdBinaryImageFilter with the
+// per input path it replaced: ComputeHistogramQuantileThresholds::Calculate()
+// on every input, the same linearization of the quantiles, and one
+// BinaryThresholdImageFilter per input intersected with MultiplyImageFilter.
+// The intensity thresholds and the masks must be identical, for several
+// modalities with quantiles in all three linear regions, a two valued
+// modality, and with and without a binary portion image.
+
+using ImageType = itk::Image<float, 3>;
+using MaskImageType = itk::Image<unsigned char, 3>;
+using FilterType = itk::MultiModeHistogramThresholdBinaryImageFilter<ImageType, MaskImageType>;
+using ThresholdArrayType = FilterType::ThresholdArrayType;
+
+static constexpr double LinearQuantileThreshold = 0.01;
+
+// Integer valued noisy tissue classes, so that no voxel falls on a histogram
+// bin boundary that the two binnings could round differently
+static ImageType::Pointer
+MakeModality(const double classMeans[3], const double noise, const unsigned int seed)
+{
+  ImageType::SizeType size;
+  size[0] = 40;
+  size[1] = 36;
+  size[2] = 24;
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  std::mt19937                     generator(seed);
+  std::normal_distribution<double> distribution(0.0, noise);
+  for (itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x = (index[0] - 20.0) / 16.0;
+    const double               y = (index[1] - 18.0) / 14.0;
+    const double               z = (index[2] - 12.0) / 10.0;
+    const double               r = std::sqrt(x * x + y * y + z * z);
+    const unsigned int         tissue = (r > 1.0) ? 0 : ((r > 0.6) ? 1 : 2);
+    it.Set(static_cast<float>(std::max(0.0, std::round(classMeans[tissue] + distribution(generator)))));
+  }
+  return image;
+}
+
+static ImageType::Pointer
+MakeTwoValuedModality(const ImageType * shape)
+{
+  ImageType::Pointer image = ImageType::New();
+  image->CopyInformation(shape);
+  image->SetRegions(shape->GetLargestPossibleRegion());
+  image->Allocate();
+  for (itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+  {
+    it.Set((it.GetIndex()[0] + it.GetIndex()[2] > 30) ? 100.0f : 0.0f);
+  }
+  return image;
+}
+
+static MaskImageType::Pointer
+MakePortionImage(const ImageType * shape)
+{
+  MaskImageType::Pointer portion = MaskImageType::New();
+  portion->CopyInformation(shape);
+  portion->SetRegions(shape->GetLargestPossibleRegion());
+  portion->Allocate();
+  for (itk::ImageRegionIteratorWithIndex<MaskImageType> it(portion, portion->GetLargestPossibleRegion()); !it.IsAtEnd();
+       ++it)
+  {
+    const MaskImageType::IndexType index = it.GetIndex();
+    it.Set((index[0] >= 6 && index[0] < 34 && index[1] >= 5 && index[1] < 31 && index[2] >= 3) ? 1 : 0);
+  }
+  return portion;
+}
+
+// The per input linearization of the quantiles onto intensities, as the
+// filter computed it before the fused passes
+static MaskImageType::Pointer
+PerInputMask(const std::vector<ImageType::Pointer> & inputs,
+             const ThresholdArrayType &              quantileLower,
+             const ThresholdArrayType &              quantileUpper,
+             MaskImageType *                         portion,
+             std::vector<double> &                   lowerThresholds,
+             std::vector<double> &                   upperThresholds)
+{
+  MaskImageType::Pointer accumulate;
+  for (unsigned int j = 0; j < inputs.size(); ++j)
+  {
+    using ImageCalcType = itk::ComputeHistogramQuantileThresholds<ImageType, MaskImageType>;
+    ImageCalcType::Pointer imageCalc = ImageCalcType::New();
+    imageCalc->SetImage(inputs[j]);
+    imageCalc->SetQuantileLowerThreshold(LinearQuantileThreshold);
+    imageCalc->SetQuantileUpperThreshold(1.0 - LinearQuantileThreshold);
+    imageCalc->SetBinaryPortionImage(portion);
+    imageCalc->Calculate();
+
+    const float thresholdLower = imageCalc->GetLowerIntensityThresholdValue();
+    const float thresholdUpper = imageCalc->GetUpperIntensityThresholdValue();
+    const float imageMin = imageCalc->GetImageMin();
+    const float imageMax = imageCalc->GetImageMax();
+    const float thresholdLowerForeground =
+      (imageCalc->GetNumberOfValidHistogramsEntries() <= 2) ? thresholdUpper : thresholdLower;
+
+    float lower;
+    float upper;
+    if (quantileLower[j] < LinearQuantileThreshold)
+    {
+      const double percentValue = quantileLower[j] / LinearQuantileThreshold;
+      lower = static_cast<float>(imageMin + (thresholdLowerForeground - imageMin) * percentValue);
+    }
+    else
+    {
+      const double range = (1.0 - LinearQuantileThreshold) - LinearQuantileThreshold;
+      const double percentValue = (quantileLower[j] - LinearQuantileThreshold) / range;
+      lower = static_cast<float>(thresholdLowerForeground + (thresholdUpper - thresholdLowerForeground) * percentValue);
+    }
+    if (quantileUpper[j] > (1.0 - LinearQuantileThreshold))
+    {
+      const double range = 1.0 - LinearQuantileThreshold;
+      const double percentValue = (quantileUpper[j] - LinearQuantileThreshold) / range;
+      upper = static_cast<float>(thresholdUpper + (imageMax - thresholdUpper) * percentValue);
+    }
+    else
+    {
+      const double range = (1.0 - LinearQuantileThreshold) - LinearQuantileThreshold;
+      const double percentValue = (quantileUpper[j] - LinearQuantileThreshold) / range;
+      upper = static_cast<float>(thresholdLowerForeground + (thresholdUpper - thresholdLowerForeground) * percentValue);
+    }
+    lowerThresholds.push_back(lower);
+    upperThresholds.push_back(upper);
+
+    using ThresholdFilterType = itk::BinaryThresholdImageFilter<ImageType, MaskImageType>;
+    ThresholdFilterType::Pointer threshold = ThresholdFilterType::New();
+    threshold->SetInput(inputs[j]);
+    threshold->SetInsideValue(1);
+    threshold->SetOutsideValue(0);
+    threshold->SetLowerThreshold(lower);
+    threshold->SetUpperThreshold(upper);
+    threshold->Update();
+    if (j == 0)
+    {
+      accumulate = threshold->GetOutput();
+    }
+    else
+    {
+      using IntersectMasksFilterType = itk::MultiplyImageFilter<MaskImageType, MaskImageType>;
+      IntersectMasksFilterType::Pointer intersect = IntersectMasksFilterType::New();
+      intersect->SetInput1(accumulate);
+      intersect->SetInput2(threshold->GetOutput());
+      intersect->Update();
+      accumulate = intersect->GetOutput();
+    }
+  }
+  return accumulate;
+}
+
+static bool
+CompareWithPerInputPath(const char *                            caseName,
+                        const std::vector<ImageType::Pointer> & inputs,
+                        const ThresholdArrayType &              quantileLower,
+                        const ThresholdArrayType &              quantileUpper,
+                        MaskImageType *                         portion)
+{
+  FilterType::Pointer filter = FilterType::New();
+  for (unsigned int j = 0; j < inputs.size(); ++j)
+  {
+    filter->SetInput(j, inputs[j]);
+  }
+  filter->SetQuantileLowerThreshold(quantileLower);
+  filter->SetQuantileUpperThreshold(quantileUpper);
+  filter->SetLinearQuantileThreshold(LinearQuantileThreshold);
+  filter->SetBinaryPortionImage(portion);
+  filter->SetInsideValue(1);
+  filter->SetOutsideValue(0);
+  filter->Update();
+
+  std::vector<double>          lowerThresholds;
+  std::vector<double>          upperThresholds;
+  const MaskImageType::Pointer expected =
+    PerInputMask(inputs, quantileLower, quantileUpper, portion, lowerThresholds, upperThresholds);
+
+  bool passed = true;
+  for (unsigned int j = 0; j < inputs.size(); ++j)
+  {
+    if (filter->GetLowerIntensityThresholds()[j] != lowerThresholds[j] ||
+        filter->GetUpperIntensityThresholds()[j] != upperThresholds[j])
+    {
+      std::cerr << caseName << ": input " << j << " thresholds [" << filter->GetLowerIntensityThresholds()[j] << ", "
+                << filter->GetUpperIntensityThresholds()[j] << "], per input path [" << lowerThresholds[j] << ", "
+                << upperThresholds[j] << "]" << std::endl;
+      passed = false;
+    }
+  }
+
+  itk::SizeValueType                           differences = 0;
+  itk::SizeValueType                           insideCount = 0;
+  itk::ImageRegionConstIterator<MaskImageType> expectedIt(expected, expected->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<MaskImageType> actualIt(filter->GetOutput(), expected->GetLargestPossibleRegion());
+  for (; !expectedIt.IsAtEnd(); ++expectedIt, ++actualIt)
+  {
+    differences += (expectedIt.Get() != actualIt.Get()) ? 1 : 0;
+    insideCount += (expectedIt.Get() != 0) ? 1 : 0;
+  }
+  const itk::SizeValueType numberOfPixels = expected->GetLargestPossibleRegion().GetNumberOfPixels();
+  if (differences != 0 || insideCount == 0 || insideCount == numberOfPixels)
+  {
+    std::cerr << caseName << ": " << differences << " of " << numberOfPixels
+              << " voxels differ from the per input mask (" << insideCount << " inside)" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+
+int
+main(int, char *[])
+{
+  const double                    t1Means[3] = { 20.0, 620.0, 880.0 };
+  const double                    t2Means[3] = { 15.0, 900.0, 540.0 };
+  const double                    pdMeans[3] = { 10.0, 700.0, 760.0 };
+  std::vector<ImageType::Pointer> inputs;
+  inputs.push_back(MakeModality(t1Means, 40.0, 1));
+  inputs.push_back(MakeModality(t2Means, 60.0, 2));
+  inputs.push_back(MakeModality(pdMeans, 30.0, 3));
+
+  // Lower quantiles below, inside and above the linear region, upper ones
+  // above and inside it
+  ThresholdArrayType quantileLower(3);
+  ThresholdArrayType quantileUpper(3);
+  quantileLower[0] = 0.005;
+  quantileLower[1] = 0.2;
+  quantileLower[2] = 0.5;
+  quantileUpper[0] = 0.995;
+  quantileUpper[1] = 0.95;
+  quantileUpper[2] = 0.9;
+  bool passed = CompareWithPerInputPath("three modalities", inputs, quantileLower, quantileUpper, nullptr);
+
+  const MaskImageType::Pointer portion = MakePortionImage(inputs[0]);
+  passed = CompareWithPerInputPath("three modalities in a portion", inputs, quantileLower, quantileUpper, portion) &&
+           passed;
+
+  inputs.push_back(MakeTwoValuedModality(inputs[0]));
+  ThresholdArrayType fourLower(4);
+  ThresholdArrayType fourUpper(4);
+  fourLower[0] = 0.0;
+  fourLower[1] = 0.3;
+  fourLower[2] = 0.1;
+  fourLower[3] = 0.5;
+  fourUpper[0] = 1.0;
+  fourUpper[1] = 0.8;
+  fourUpper[2] = 0.999;
+  fourUpper[3] = 1.0;
+  passed = CompareWithPerInputPath("four modalities in a portion", inputs, fourLower, fourUpper, portion) && passed;
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
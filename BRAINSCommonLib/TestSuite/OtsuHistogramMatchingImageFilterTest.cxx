@@ -0,0 +1,87 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkRandomImageSource.h>
+
+#include "itkOtsuHistogramMatchingImageFilter.h"
+
+#include <cstdlib>
+#include <iostream>
+
+// Map a random volume through the compiled intensity mapping, a lookup
+// table for short and a breakpoint search for float, and compare every
+// voxel with the original scan of the match points (UseIntensityLookupOff).
+template <typename TImage>
+static bool
+CompareWithMatchPointScan(const char * pixelTypeName)
+{
+  using ImageType = TImage;
+  using SourceType = itk::RandomImageSource<ImageType>;
+  using FilterType = itk::OtsuHistogramMatchingImageFilter<ImageType, ImageType>;
+
+  typename ImageType::SizeType size;
+  size.Fill(32);
+  typename ImageType::Pointer images[2];
+  for (unsigned int i = 0; i < 2; ++i)
+  {
+    typename SourceType::Pointer source = SourceType::New();
+    source->SetSize(size);
+    source->SetMin(static_cast<typename ImageType::PixelType>(10 * (i + 1)));
+    source->SetMax(static_cast<typename ImageType::PixelType>(2000 * (i + 1)));
+    source->Update();
+    images[i] = source->GetOutput();
+  }
+
+  typename ImageType::Pointer outputs[2];
+  for (unsigned int useLookup = 0; useLookup < 2; ++useLookup)
+  {
+    typename FilterType::Pointer filter = FilterType::New();
+    filter->SetSourceImage(images[0]);
+    filter->SetReferenceImage(images[1]);
+    filter->SetNumberOfHistogramLevels(1024);
+    filter->SetNumberOfMatchPoints(7);
+    filter->SetUseIntensityLookup(useLookup != 0);
+    filter->Update();
+    outputs[useLookup] = filter->GetOutput();
+  }
+
+  itk::SizeValueType                       differences = 0;
+  itk::ImageRegionConstIterator<ImageType> scanIt(outputs[0], outputs[0]->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> lookupIt(outputs[1], outputs[1]->GetBufferedRegion());
+  for (; !scanIt.IsAtEnd(); ++scanIt, ++lookupIt)
+  {
+    differences += (scanIt.Get() != lookupIt.Get());
+  }
+  if (differences != 0)
+  {
+    std::cerr << pixelTypeName << ": " << differences << " voxels differ from the match point scan" << std::endl;
+  }
+  return differences == 0;
+}
+
+int
+main(int, char *[])
+{
+  bool success = true;
+  success &= CompareWithMatchPointScan<itk::Image<short, 3>>("short");
+  success &= CompareWithMatchPointScan<itk::Image<float, 3>>("float");
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
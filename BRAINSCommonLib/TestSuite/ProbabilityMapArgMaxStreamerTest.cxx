@@ -0,0 +1,168 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include <itkImage.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionIterator.h>
+
+#include "BRAINSProbabilityMapArgMax.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Write random probability maps (streamable raw .nrrd and compressed
+// .nii.gz) and a mask, and check the streamed argmax against an in memory
+// scan for several slab depths.  A map of another size must be rejected.
+using ProbabilityImageType = itk::Image<float, 3>;
+using MaskImageType = itk::Image<unsigned char, 3>;
+using LabelImageType = itk::Image<unsigned int, 3>;
+
+template <typename TImage>
+static void
+WriteImage(const TImage * image, const std::string & fileName)
+{
+  typename itk::ImageFileWriter<TImage>::Pointer writer = itk::ImageFileWriter<TImage>::New();
+  writer->SetInput(image);
+  writer->SetFileName(fileName);
+  writer->Update();
+}
+
+template <typename TImage>
+static typename TImage::Pointer
+MakeImage(const typename TImage::SizeType & size)
+{
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(size);
+  image->Allocate();
+  return image;
+}
+
+int
+main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <temporaryDirectory>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string tempDir(argv[1]);
+
+  constexpr unsigned int numberOfMaps = 7;
+  ProbabilityImageType::SizeType size;
+  size[0] = 23;
+  size[1] = 19;
+  size[2] = 17;
+
+  // Probabilities on a coarse grid of values, so that ties occur
+  std::mt19937                       generator(numberOfMaps);
+  std::uniform_int_distribution<int> level(0, 8);
+
+  std::vector<ProbabilityImageType::Pointer> maps;
+  std::vector<std::string>                   fileNames;
+  for (unsigned int k = 0; k < numberOfMaps; k++)
+  {
+    ProbabilityImageType::Pointer map = MakeImage<ProbabilityImageType>(size);
+    for (itk::ImageRegionIterator<ProbabilityImageType> it(map, map->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+    {
+      it.Set(level(generator) / 8.0f);
+    }
+    const std::string fileName =
+      tempDir + "/ProbabilityMapArgMax_" + std::to_string(k) + ((k % 2 == 0) ? ".nrrd" : ".nii.gz");
+    WriteImage<ProbabilityImageType>(map, fileName);
+    maps.push_back(map);
+    fileNames.push_back(fileName);
+  }
+
+  MaskImageType::Pointer mask = MakeImage<MaskImageType>(size);
+  for (itk::ImageRegionIterator<MaskImageType> it(mask, mask->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+  {
+    it.Set(level(generator) > 2 ? 1 : 0);
+  }
+  const std::string maskFileName = tempDir + "/ProbabilityMapArgMax_mask.nrrd";
+  WriteImage<MaskImageType>(mask, maskFileName);
+
+  // In memory scan, as the tools did it, 0 outside the mask
+  LabelImageType::Pointer reference = MakeImage<LabelImageType>(size);
+  for (itk::ImageRegionIterator<LabelImageType> it(reference, reference->GetLargestPossibleRegion()); !it.IsAtEnd();
+       ++it)
+  {
+    float        maximum = maps[0]->GetPixel(it.GetIndex());
+    unsigned int label = 0;
+    for (unsigned int k = 1; k < numberOfMaps; k++)
+    {
+      if (maps[k]->GetPixel(it.GetIndex()) > maximum)
+      {
+        maximum = maps[k]->GetPixel(it.GetIndex());
+        label = k;
+      }
+    }
+    it.Set(mask->GetPixel(it.GetIndex()) ? label + 1 : 0);
+  }
+
+  bool               passed = true;
+  const unsigned int slabDepths[] = { 1, 4, 16, 100 };
+  for (const auto slabDepth : slabDepths)
+  {
+    ProbabilityMapArgMaxStreamer<ProbabilityImageType> argMax(fileNames, maskFileName);
+    argMax.SetSlabDepth(slabDepth);
+    LabelImageType::Pointer labels = argMax.AllocateImage<LabelImageType>();
+    unsigned int *          buffer = labels->GetBufferPointer();
+    argMax.Run([buffer](const itk::OffsetValueType offset, const unsigned int classIndex, float) {
+      buffer[offset] = classIndex + 1;
+    });
+
+    itk::SizeValueType                      differences = 0;
+    itk::ImageRegionIterator<LabelImageType> lIt(labels, labels->GetLargestPossibleRegion());
+    itk::ImageRegionIterator<LabelImageType> rIt(reference, reference->GetLargestPossibleRegion());
+    for (; !lIt.IsAtEnd(); ++lIt, ++rIt)
+    {
+      differences += lIt.Get() != rIt.Get();
+    }
+    std::cout << "slab depth " << slabDepth << ": " << differences << " voxels differ" << std::endl;
+    passed &= differences == 0;
+  }
+
+  // A map of another size
+  ProbabilityImageType::SizeType otherSize = size;
+  otherSize[2] += 1;
+  ProbabilityImageType::Pointer other = MakeImage<ProbabilityImageType>(otherSize);
+  other->FillBuffer(0.0f);
+  const std::string otherFileName = tempDir + "/ProbabilityMapArgMax_other.nrrd";
+  WriteImage<ProbabilityImageType>(other, otherFileName);
+  std::vector<std::string> mismatched = fileNames;
+  mismatched.push_back(otherFileName);
+  try
+  {
+    ProbabilityMapArgMaxStreamer<ProbabilityImageType> argMax(mismatched);
+    std::cerr << "A map of another size was accepted" << std::endl;
+    passed = false;
+  }
+  catch (itk::ExceptionObject &)
+  {
+  }
+
+  if (!passed)
+  {
+    std::cerr << "Streamed argmax differs from the in memory scan" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
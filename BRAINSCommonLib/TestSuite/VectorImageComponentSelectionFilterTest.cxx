@@ -0,0 +1,131 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkStreamingImageFilter.h>
+#include <itkVectorImage.h>
+
+#include "itkVectorImageComponentSelectionFilter.h"
+
+#include <iostream>
+#include <vector>
+
+// Select components of a synthetic DWI-like VectorImage in one piece and
+// streamed in slabs, and compare each pixel with the selected input
+// components.  Out of range components must be rejected.
+using ImageType = itk::VectorImage<short, 3>;
+using SelectionFilterType = itk::VectorImageComponentSelectionFilter<ImageType>;
+using StreamerType = itk::StreamingImageFilter<ImageType, ImageType>;
+
+static bool
+CompareSelection(const ImageType *                                 input,
+                 const ImageType *                                 output,
+                 const SelectionFilterType::ComponentIndicesType & components)
+{
+  if (output->GetNumberOfComponentsPerPixel() != components.size() ||
+      output->GetBufferedRegion() != input->GetLargestPossibleRegion())
+  {
+    std::cerr << "Unexpected output components or region" << std::endl;
+    return false;
+  }
+  itk::SizeValueType differences = 0;
+  for (itk::ImageRegionConstIteratorWithIndex<ImageType> it(output, output->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    const ImageType::PixelType outputPixel = it.Get();
+    const ImageType::PixelType inputPixel = input->GetPixel(it.GetIndex());
+    for (unsigned int c = 0; c < components.size(); ++c)
+    {
+      differences += outputPixel[c] != inputPixel[components[c]];
+    }
+  }
+  if (differences != 0)
+  {
+    std::cerr << differences << " components differ" << std::endl;
+  }
+  return differences == 0;
+}
+
+int
+main(int, char *[])
+{
+  constexpr unsigned int numberOfComponents = 11;
+
+  ImageType::SizeType size;
+  size[0] = 13;
+  size[1] = 9;
+  size[2] = 7;
+  ImageType::Pointer input = ImageType::New();
+  input->SetRegions(size);
+  input->SetNumberOfComponentsPerPixel(numberOfComponents);
+  input->Allocate();
+  for (itk::ImageRegionConstIteratorWithIndex<ImageType> it(input, input->GetLargestPossibleRegion()); !it.IsAtEnd();
+       ++it)
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    ImageType::PixelType       pixel(numberOfComponents);
+    for (unsigned int c = 0; c < numberOfComponents; ++c)
+    {
+      pixel[c] = static_cast<short>(((index[2] * 16 + index[1]) * 16 + index[0]) * 16 + c);
+    }
+    input->SetPixel(index, pixel);
+  }
+
+  // Unordered and repeated components are allowed
+  const SelectionFilterType::ComponentIndicesType components = { 0, 2, 3, 7, 10, 5, 5 };
+
+  bool passed = true;
+
+  SelectionFilterType::Pointer selector = SelectionFilterType::New();
+  selector->SetInput(input);
+  selector->SetComponentIndices(components);
+  selector->Update();
+  passed &= CompareSelection(input, selector->GetOutput(), components);
+
+  for (const unsigned int numberOfSlabs : { 2u, 3u, 7u })
+  {
+    SelectionFilterType::Pointer streamedSelector = SelectionFilterType::New();
+    streamedSelector->SetInput(input);
+    streamedSelector->SetComponentIndices(components);
+    StreamerType::Pointer streamer = StreamerType::New();
+    streamer->SetInput(streamedSelector->GetOutput());
+    streamer->SetNumberOfStreamDivisions(numberOfSlabs);
+    streamer->Update();
+    passed &= CompareSelection(input, streamer->GetOutput(), components);
+  }
+
+  SelectionFilterType::Pointer invalid = SelectionFilterType::New();
+  invalid->SetInput(input);
+  invalid->SetComponentIndices(SelectionFilterType::ComponentIndicesType{ 1, numberOfComponents });
+  try
+  {
+    invalid->Update();
+    std::cerr << "An out of range component was accepted" << std::endl;
+    passed = false;
+  }
+  catch (itk::ExceptionObject &)
+  {
+  }
+
+  if (!passed)
+  {
+    std::cerr << "VectorImageComponentSelectionFilterTest failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -22,7 +22,201 @@
 #include "itkIO.h"
 #include "CrossOverAffineSystem.h"
 
+#include <itkAffineTransform.h>
+#include <itkCompositeTransform.h>
+#include <itkImageFileWriter.h>
+#include <itkMatrixOffsetTransformBase.h>
 #include <itkTransformToDisplacementFieldFilter.h>
+#include <itkTranslationTransform.h>
+
+#include <algorithm>
+
+/**
+ * Collapse a single linear transform (or a composite of linear transforms)
+ * into one equivalent AffineTransform.  MatrixOffset and Translation
+ * transforms are converted exactly, any other linear transform is
+ * recovered by mapping the origin and the unit axes.
+ */
+template <typename TParametersValueType, unsigned int VDimension>
+typename itk::AffineTransform<TParametersValueType, VDimension>::Pointer
+CollapseLinearTransform(const itk::Transform<TParametersValueType, VDimension, VDimension> * linearXfrm)
+{
+  using AffineTransformType = itk::AffineTransform<TParametersValueType, VDimension>;
+  using MatrixOffsetTransformType = itk::MatrixOffsetTransformBase<TParametersValueType, VDimension, VDimension>;
+  using TranslationTransformType = itk::TranslationTransform<TParametersValueType, VDimension>;
+  using CompositeTransformType = itk::CompositeTransform<TParametersValueType, VDimension>;
+
+  typename AffineTransformType::Pointer result = AffineTransformType::New();
+  result->SetIdentity();
+
+  const auto * matOffsetXfrm = dynamic_cast<const MatrixOffsetTransformType *>(linearXfrm);
+  const auto * translationXfrm = dynamic_cast<const TranslationTransformType *>(linearXfrm);
+  const auto * compXfrm = dynamic_cast<const CompositeTransformType *>(linearXfrm);
+  if (matOffsetXfrm != nullptr)
+  {
+    result->SetMatrix(matOffsetXfrm->GetMatrix());
+    result->SetOffset(matOffsetXfrm->GetOffset());
+  }
+  else if (translationXfrm != nullptr)
+  {
+    result->SetOffset(translationXfrm->GetOffset());
+  }
+  else if (compXfrm != nullptr)
+  {
+    // The composite queue is applied back to front, so
+    // accumulate y = M x + o starting from the last transform.
+    for (itk::SizeValueType n = compXfrm->GetNumberOfTransforms(); n > 0; --n)
+    {
+      typename AffineTransformType::Pointer current =
+        CollapseLinearTransform<TParametersValueType, VDimension>(compXfrm->GetNthTransformConstPointer(n - 1));
+      result->Compose(current, false);
+    }
+  }
+  else
+  {
+    using InputPointType = typename AffineTransformType::InputPointType;
+    InputPointType origin;
+    origin.Fill(0.0);
+    const typename AffineTransformType::OutputPointType mappedOrigin = linearXfrm->TransformPoint(origin);
+
+    typename AffineTransformType::MatrixType matrix;
+    for (unsigned int c = 0; c < VDimension; ++c)
+    {
+      InputPointType axis = origin;
+      axis[c] = 1.0;
+      const typename AffineTransformType::OutputPointType mappedAxis = linearXfrm->TransformPoint(axis);
+      for (unsigned int r = 0; r < VDimension; ++r)
+      {
+        matrix[r][c] = mappedAxis[r] - mappedOrigin[r];
+      }
+    }
+    result->SetMatrix(matrix);
+    result->SetOffset(mappedOrigin.GetVectorFromOrigin());
+  }
+  return result;
+}
+
+/**
+ * Reduce a transform to the cheapest equivalent form for per-voxel
+ * evaluation.  Nested composites are unrolled, and every run of
+ * consecutive linear transforms in a CompositeTransform is replaced
+ * by a single AffineTransform, so that a chain like
+ * [ Affine, VersorRigid, BSpline ] costs one matrix multiply plus the
+ * BSpline evaluation per point.  Non-composite transforms are returned
+ * unchanged.
+ */
+template <typename TParametersValueType, unsigned int VDimension>
+typename itk::Transform<TParametersValueType, VDimension, VDimension>::ConstPointer
+FlattenLinearTransformChain(const itk::Transform<TParametersValueType, VDimension, VDimension> * xfrm)
+{
+  using GenericTransformType = itk::Transform<TParametersValueType, VDimension, VDimension>;
+  using CompositeTransformType = itk::CompositeTransform<TParametersValueType, VDimension>;
+
+  const auto * compXfrm = dynamic_cast<const CompositeTransformType *>(xfrm);
+  if (compXfrm == nullptr || compXfrm->GetNumberOfTransforms() == 0)
+  {
+    return xfrm;
+  }
+
+  // Share the sub-transforms rather than cloning them; displacement
+  // field components can be very large.
+  typename CompositeTransformType::Pointer unrolled = CompositeTransformType::New();
+  for (itk::SizeValueType n = 0; n < compXfrm->GetNumberOfTransforms(); ++n)
+  {
+    unrolled->AddTransform(compXfrm->GetNthTransform(n));
+  }
+  unrolled->FlattenTransformQueue();
+
+  typename CompositeTransformType::Pointer flattened = CompositeTransformType::New();
+  typename CompositeTransformType::Pointer linearRun = CompositeTransformType::New();
+  auto                                     flushLinearRun = [&flattened, &linearRun]() {
+    if (linearRun->GetNumberOfTransforms() > 0)
+    {
+      flattened->AddTransform(CollapseLinearTransform<TParametersValueType, VDimension>(linearRun.GetPointer()));
+      linearRun = CompositeTransformType::New();
+    }
+  };
+  for (itk::SizeValueType n = 0; n < unrolled->GetNumberOfTransforms(); ++n)
+  {
+    typename GenericTransformType::Pointer current = unrolled->GetNthTransform(n);
+    if (current->IsLinear())
+    {
+      linearRun->AddTransform(current);
+    }
+    else
+    {
+      flushLinearRun();
+      flattened->AddTransform(current);
+    }
+  }
+  flushLinearRun();
+
+  if (flattened->GetNumberOfTransforms() == 1)
+  {
+    return flattened->GetNthTransformConstPointer(0);
+  }
+  return flattened.GetPointer();
+}
+
+/**
+ * Build the transform to displacement field pipeline on the grid of
+ * referenceImage.  Only the meta information of referenceImage is used,
+ * so it does not need to have its buffer loaded.  The transform is
+ * flattened first, and the returned filter evaluates it multi-threaded
+ * over the requested region, so it can be streamed by a downstream writer.
+ */
+template <typename TDisplacementField, typename TParametersValueType>
+typename itk::TransformToDisplacementFieldFilter<TDisplacementField, TParametersValueType>::Pointer
+MakeTransformToDisplacementFieldFilter(
+  const itk::ImageBase<TDisplacementField::ImageDimension> * referenceImage,
+  const typename itk::TransformToDisplacementFieldFilter<TDisplacementField, TParametersValueType>::TransformType *
+    xfrm)
+{
+  using TodefType = itk::TransformToDisplacementFieldFilter<TDisplacementField, TParametersValueType>;
+  typename TodefType::Pointer todef = TodefType::New();
+  todef->SetUseReferenceImage(true);
+  todef->SetReferenceImage(referenceImage);
+  todef->SetTransform(
+    FlattenLinearTransformChain<TParametersValueType, TDisplacementField::ImageDimension>(xfrm).GetPointer());
+  return todef;
+}
+
+/**
+ * Write the displacement field of xfrm sampled on the grid of
+ * referenceImage directly to filename.  Without compression the field is
+ * generated in slabs of at most maxBytesPerStream bytes when the output
+ * ImageIO supports streamed writing, so the whole field is never resident.
+ * The NRRD and NIfTI writers can not stream compressed output, so with
+ * useCompression the whole field is generated at once.
+ */
+template <typename TDisplacementField, typename TParametersValueType>
+void
+WriteTransformAsDisplacementField(
+  const itk::ImageBase<TDisplacementField::ImageDimension> * referenceImage,
+  const typename itk::TransformToDisplacementFieldFilter<TDisplacementField, TParametersValueType>::TransformType *
+                           xfrm,
+  const std::string &      filename,
+  const bool               useCompression = true,
+  const itk::SizeValueType maxBytesPerStream = 512UL * 1024UL * 1024UL)
+{
+  using TodefType = itk::TransformToDisplacementFieldFilter<TDisplacementField, TParametersValueType>;
+  typename TodefType::Pointer todef =
+    MakeTransformToDisplacementFieldFilter<TDisplacementField, TParametersValueType>(referenceImage, xfrm);
+
+  const itk::SizeValueType fieldBytes =
+    referenceImage->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(typename TDisplacementField::PixelType);
+  const itk::SizeValueType bytesPerStream = std::max<itk::SizeValueType>(1, maxBytesPerStream);
+  const itk::SizeValueType numberOfStreamDivisions =
+    useCompression ? 1 : std::max<itk::SizeValueType>(1, (fieldBytes + bytesPerStream - 1) / bytesPerStream);
+
+  using WriterType = itk::ImageFileWriter<TDisplacementField>;
+  typename WriterType::Pointer writer = WriterType::New();
+  writer->SetUseCompression(useCompression);
+  writer->SetFileName(filename.c_str());
+  writer->SetInput(todef->GetOutput());
+  writer->SetNumberOfStreamDivisions(static_cast<unsigned int>(numberOfStreamDivisions));
+  writer->Update();
+}
 
 /**
  * Go from any subclass of Transform, to the corresponding deformation field
@@ -34,10 +228,10 @@ TransformToDisplacementField(itk::ImageBase<DisplacementFieldPointerType::Object
 {
   using OutputType = typename DisplacementFieldPointerType::ObjectType;
   using TodefType = typename itk::TransformToDisplacementFieldFilter<OutputType, double>;
-  typename TodefType::Pointer todef(TodefType::New());
-  todef->SetUseReferenceImage(true);
-  todef->SetReferenceImage(templateImage);
-  todef->SetTransform(xfrm);
+  using TransformType = typename TodefType::TransformType;
+  const TransformType *       genericXfrm = xfrm;
+  typename TodefType::Pointer todef =
+    MakeTransformToDisplacementFieldFilter<OutputType, double>(templateImage, genericXfrm);
   try
   {
     todef->Update();
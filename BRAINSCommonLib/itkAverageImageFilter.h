@@ -45,6 +45,9 @@ namespace itk
  * to that type by a cast operation. There is currently no rounding
  * implemented.
  *
+ * All inputs must be in memory at the same time.  To average many images
+ * with bounded memory, see RunningImageAccumulator and ImageFileReducer.
+ *
  * \author Torsten Rohlfing, SRI International, Neuroscience Program
  *
  * Funding for the implementation of this class was provided by NIAAA under
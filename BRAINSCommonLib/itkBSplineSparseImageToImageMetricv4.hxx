@@ -0,0 +1,654 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineSparseImageToImageMetricv4_hxx
+#define __itkBSplineSparseImageToImageMetricv4_hxx
+
+#include "itkBSplineSparseImageToImageMetricv4.h"
+#include "itkMath.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+template <typename TSuperclass>
+constexpr unsigned int BSplineSparseImageToImageMetricv4<TSuperclass>::SpaceDimension;
+
+template <typename TSuperclass>
+constexpr unsigned int BSplineSparseImageToImageMetricv4<TSuperclass>::SplineOrder;
+
+template <typename TSuperclass>
+constexpr unsigned int BSplineSparseImageToImageMetricv4<TSuperclass>::SupportWidth;
+
+template <typename TSuperclass>
+constexpr unsigned int BSplineSparseImageToImageMetricv4<TSuperclass>::NumberOfSupportPoints;
+
+template <typename TSuperclass>
+BSplineSparseImageToImageMetricv4<TSuperclass>::BSplineSparseImageToImageMetricv4()
+  : m_SparseThreader(MultiThreaderBase::New())
+{
+  m_PostMatrix.SetIdentity();
+  std::fill(m_PostOffset, m_PostOffset + SpaceDimension, 0.0);
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::Initialize()
+{
+  Superclass::Initialize();
+  // Sample points, masks or the fixed image may have changed.
+  m_SampleCacheIsValid = false;
+  m_SampleCacheTooLarge = false;
+}
+
+template <typename TSuperclass>
+typename BSplineSparseImageToImageMetricv4<TSuperclass>::MeasureType
+BSplineSparseImageToImageMetricv4<TSuperclass>::GetValue() const
+{
+  if (!this->PrepareSparseEvaluation())
+  {
+    return Superclass::GetValue();
+  }
+  return this->EvaluateSparse(nullptr);
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::GetDerivative(DerivativeType & derivative) const
+{
+  MeasureType value;
+  this->GetValueAndDerivative(value, derivative);
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::GetValueAndDerivative(MeasureType &    value,
+                                                                     DerivativeType & derivative) const
+{
+  if (!this->PrepareSparseEvaluation())
+  {
+    Superclass::GetValueAndDerivative(value, derivative);
+    return;
+  }
+  value = this->EvaluateSparse(&derivative);
+}
+
+template <typename TSuperclass>
+SizeValueType
+BSplineSparseImageToImageMetricv4<TSuperclass>::GetNumberOfSampleBlocks(const SizeValueType numberOfSamples) const
+{
+  // Enough blocks to balance 32 cores, few enough to keep per block
+  // histograms small.
+  constexpr SizeValueType maximumNumberOfBlocks = 256;
+  constexpr SizeValueType minimumBlockSize = 1024;
+  const SizeValueType     blockSize =
+    std::max(minimumBlockSize, (numberOfSamples + maximumNumberOfBlocks - 1) / maximumNumberOfBlocks);
+  return (numberOfSamples + blockSize - 1) / blockSize;
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::ParallelizeSampleBlocks(
+  const SizeValueType             numberOfSamples,
+  const SampleBlockFunctionType & blockFunction) const
+{
+  const SizeValueType numberOfBlocks = this->GetNumberOfSampleBlocks(numberOfSamples);
+  if (numberOfBlocks == 0)
+  {
+    return;
+  }
+  m_SparseThreader->SetNumberOfWorkUnits(this->GetMaximumNumberOfWorkUnits());
+  m_SparseThreader->ParallelizeArray(
+    0,
+    numberOfBlocks,
+    [numberOfSamples, numberOfBlocks, &blockFunction](const SizeValueType block) {
+      blockFunction(numberOfSamples * block / numberOfBlocks, numberOfSamples * (block + 1) / numberOfBlocks, block);
+    },
+    nullptr);
+}
+
+template <typename TSuperclass>
+bool
+BSplineSparseImageToImageMetricv4<TSuperclass>::PrepareSparseEvaluation() const
+{
+  if (!m_UseSparseBSplineEvaluation)
+  {
+    return false;
+  }
+
+  const auto *         movingTransform = this->m_MovingTransform.GetPointer();
+  const auto *         bspline = dynamic_cast<const BSplineTransformType *>(movingTransform);
+  PostMatrixType       postMatrix;
+  MovingImagePointType postOrigin;
+  postMatrix.SetIdentity();
+  postOrigin.Fill(0.0);
+  bool hasPostTransform = false;
+  if (bspline == nullptr)
+  {
+    const auto * composite = dynamic_cast<const CompositeTransformType *>(movingTransform);
+    if (composite == nullptr || composite->GetNumberOfTransforms() == 0)
+    {
+      return false;
+    }
+    // The queue is applied back to front, so the BSpline has to be last.
+    const SizeValueType last = composite->GetNumberOfTransforms() - 1;
+    bspline = dynamic_cast<const BSplineTransformType *>(composite->GetNthTransformConstPointer(last));
+    if (bspline == nullptr || !composite->GetNthTransformToOptimize(last))
+    {
+      return false;
+    }
+    for (SizeValueType n = 0; n < last; ++n)
+    {
+      if (composite->GetNthTransformToOptimize(n) || !composite->GetNthTransformConstPointer(n)->IsLinear())
+      {
+        return false;
+      }
+    }
+    if (last > 0)
+    {
+      // Collapse the linear tail into y -> A y + b by mapping the origin and
+      // the unit axes.
+      auto mapThroughTail = [composite, last](MovingImagePointType point) {
+        for (SizeValueType n = last; n > 0; --n)
+        {
+          point = composite->GetNthTransformConstPointer(n - 1)->TransformPoint(point);
+        }
+        return point;
+      };
+      MovingImagePointType origin;
+      origin.Fill(0.0);
+      postOrigin = mapThroughTail(origin);
+      for (unsigned int c = 0; c < SpaceDimension; ++c)
+      {
+        MovingImagePointType axis = origin;
+        axis[c] = 1.0;
+        const MovingImagePointType mappedAxis = mapThroughTail(axis);
+        for (unsigned int r = 0; r < SpaceDimension; ++r)
+        {
+          postMatrix[r][c] = mappedAxis[r] - postOrigin[r];
+        }
+      }
+      hasPostTransform = true;
+    }
+  }
+
+  m_HasPostTransform = hasPostTransform;
+  m_PostMatrix = postMatrix;
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    m_PostOffset[d] = postOrigin[d];
+  }
+
+  if (!m_SampleCacheIsValid || bspline != m_SparseBSpline ||
+      bspline->GetFixedParameters() != m_CachedFixedParameters)
+  {
+    m_SparseBSpline = bspline;
+    const SizeValueType numberOfPoints = this->GetUseSampledPointSet()
+                                           ? this->m_VirtualSampledPointSet->GetNumberOfPoints()
+                                           : this->GetVirtualRegion().GetNumberOfPixels();
+    const SizeValueType cacheBytes = this->EstimateSampleCacheBytes(numberOfPoints);
+    if (cacheBytes > m_MaximumSampleCacheBytes)
+    {
+      if (!m_SampleCacheTooLarge)
+      {
+        itkWarningMacro(<< "The sparse BSpline cache for " << numberOfPoints << " samples would take " << cacheBytes
+                        << " bytes, more than MaximumSampleCacheBytes " << m_MaximumSampleCacheBytes
+                        << "; using the superclass evaluation instead. Sample fewer points to use the sparse path.");
+        m_SampleCacheTooLarge = true;
+      }
+      this->ReleaseSampleCache();
+      return false;
+    }
+    this->BuildSampleCache();
+  }
+  return this->GetNumberOfParameters() == SpaceDimension * m_NumberOfControlPoints;
+}
+
+template <typename TSuperclass>
+SizeValueType
+BSplineSparseImageToImageMetricv4<TSuperclass>::EstimateSampleCacheBytes(const SizeValueType numberOfPoints) const
+{
+  SizeValueType bytes = numberOfPoints * (sizeof(SparseSample) + sizeof(SparseSampleState) + sizeof(SizeValueType));
+  if (!m_DeterministicReduction)
+  {
+    bytes += static_cast<SizeValueType>(this->GetMaximumNumberOfWorkUnits()) * this->GetNumberOfParameters() *
+             sizeof(double);
+  }
+  return bytes;
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::ReleaseSampleCache() const
+{
+  m_SampleCacheIsValid = false;
+  std::vector<SparseSample>().swap(m_SparseSamples);
+  std::vector<SparseSampleState>().swap(m_SparseStates);
+  std::vector<SizeValueType>().swap(m_SupportBucketBegin);
+  std::vector<SizeValueType>().swap(m_SupportBucketSamples);
+  std::vector<std::vector<double>>().swap(m_WorkUnitDerivatives);
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::BuildSampleCache() const
+{
+  const auto * grid = m_SparseBSpline->GetCoefficientImages()[0].GetPointer();
+  const auto   gridSize = grid->GetLargestPossibleRegion().GetSize();
+  m_NumberOfControlPoints = 1;
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    m_GridSize[d] = gridSize[d];
+    m_GridStride[d] = static_cast<OffsetValueType>(m_NumberOfControlPoints);
+    m_NumberOfControlPoints *= gridSize[d];
+  }
+
+  const bool          useSampledPoints = this->GetUseSampledPointSet();
+  const auto          virtualRegion = this->GetVirtualRegion();
+  const SizeValueType numberOfPoints =
+    useSampledPoints ? this->m_VirtualSampledPointSet->GetNumberOfPoints() : virtualRegion.GetNumberOfPixels();
+
+  // Evaluate the candidates in parallel blocks, each keeping only the ones
+  // inside the fixed image and its mask, then concatenate the blocks in
+  // order.  Only the surviving samples are ever stored.
+  std::vector<std::vector<SparseSample>> blockSamples(this->GetNumberOfSampleBlocks(numberOfPoints));
+  this->ParallelizeSampleBlocks(numberOfPoints, [&](SizeValueType first, SizeValueType last, SizeValueType block) {
+    std::vector<SparseSample> & kept = blockSamples[block];
+    for (SizeValueType n = first; n < last; ++n)
+    {
+      SparseSample sample;
+      if (useSampledPoints)
+      {
+        sample.point = this->m_VirtualSampledPointSet->GetPoints()->ElementAt(n);
+      }
+      else
+      {
+        typename Superclass::VirtualIndexType index = virtualRegion.GetIndex();
+        SizeValueType                         remainder = n;
+        for (unsigned int d = 0; d < SpaceDimension; ++d)
+        {
+          index[d] += static_cast<IndexValueType>(remainder % virtualRegion.GetSize(d));
+          remainder /= virtualRegion.GetSize(d);
+        }
+        this->TransformVirtualIndexToPhysicalPoint(index, sample.point);
+      }
+
+      typename Superclass::FixedImagePointType mappedFixedPoint;
+      typename Superclass::FixedImagePixelType fixedValue;
+      if (!this->TransformAndEvaluateFixedPoint(sample.point, mappedFixedPoint, fixedValue))
+      {
+        continue;
+      }
+      sample.fixedValue = static_cast<double>(fixedValue);
+
+      // Same support and weights as BSplineTransform::TransformPoint.
+      ContinuousIndex<double, SpaceDimension> cindex;
+      grid->TransformPhysicalPointToContinuousIndex(sample.point, cindex);
+      constexpr double minLimit = 0.5 * (SplineOrder - 1);
+      bool             inside = true;
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        const double maxLimit = static_cast<double>(m_GridSize[d]) - 0.5 * (SplineOrder - 1) - 1.0;
+        if (cindex[d] < minLimit || cindex[d] >= maxLimit)
+        {
+          inside = false;
+        }
+      }
+      sample.supportStart = -1;
+      if (!inside)
+      {
+        kept.push_back(sample);
+        continue;
+      }
+      sample.supportStart = 0;
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        const auto   start = Math::Floor<OffsetValueType>(cindex[d] - 0.5 * (SplineOrder - 1));
+        const double t = cindex[d] - static_cast<double>(start) - 1.0;
+        const double t2 = t * t;
+        const double t3 = t2 * t;
+        sample.weights[d][0] = (1.0 - t) * (1.0 - t) * (1.0 - t) / 6.0;
+        sample.weights[d][1] = (3.0 * t3 - 6.0 * t2 + 4.0) / 6.0;
+        sample.weights[d][2] = (-3.0 * t3 + 3.0 * t2 + 3.0 * t + 1.0) / 6.0;
+        sample.weights[d][3] = t3 / 6.0;
+        sample.supportStart += start * m_GridStride[d];
+      }
+      kept.push_back(sample);
+    }
+  });
+
+  SizeValueType numberOfSamples = 0;
+  for (const auto & kept : blockSamples)
+  {
+    numberOfSamples += kept.size();
+  }
+  m_SparseSamples.clear();
+  m_SparseSamples.shrink_to_fit();
+  m_SparseSamples.reserve(numberOfSamples);
+  for (auto & kept : blockSamples)
+  {
+    m_SparseSamples.insert(m_SparseSamples.end(), kept.begin(), kept.end());
+    std::vector<SparseSample>().swap(kept);
+  }
+
+  // Bucket the samples by the first control point of their support, in
+  // sample order, for the gather in GatherDerivative.
+  m_SupportBucketBegin.assign(m_NumberOfControlPoints + 1, 0);
+  for (const auto & sample : m_SparseSamples)
+  {
+    if (sample.supportStart >= 0)
+    {
+      ++m_SupportBucketBegin[sample.supportStart + 1];
+    }
+  }
+  for (SizeValueType cp = 0; cp < m_NumberOfControlPoints; ++cp)
+  {
+    m_SupportBucketBegin[cp + 1] += m_SupportBucketBegin[cp];
+  }
+  m_SupportBucketSamples.resize(m_SupportBucketBegin[m_NumberOfControlPoints]);
+  std::vector<SizeValueType> next(m_SupportBucketBegin.begin(), m_SupportBucketBegin.end() - 1);
+  for (SizeValueType s = 0; s < m_SparseSamples.size(); ++s)
+  {
+    if (m_SparseSamples[s].supportStart >= 0)
+    {
+      m_SupportBucketSamples[next[m_SparseSamples[s].supportStart]++] = s;
+    }
+  }
+
+  m_SparseStates.resize(m_SparseSamples.size());
+  m_CachedFixedParameters = m_SparseBSpline->GetFixedParameters();
+  m_SampleCacheIsValid = true;
+}
+
+template <typename TSuperclass>
+typename BSplineSparseImageToImageMetricv4<TSuperclass>::MeasureType
+BSplineSparseImageToImageMetricv4<TSuperclass>::EvaluateSparse(DerivativeType * derivative) const
+{
+  const bool          computeDerivative = derivative != nullptr;
+  const SizeValueType numberOfSamples = m_SparseSamples.size();
+  const SizeValueType numberOfBlocks = this->GetNumberOfSampleBlocks(numberOfSamples);
+
+  const InternalComputationValueType * coefficients[SpaceDimension];
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    coefficients[d] = m_SparseBSpline->GetCoefficientImages()[d]->GetBufferPointer();
+  }
+
+  std::vector<SizeValueType> validPerBlock(numberOfBlocks, 0);
+  this->ParallelizeSampleBlocks(numberOfSamples, [&](SizeValueType first, SizeValueType last, SizeValueType block) {
+    for (SizeValueType s = first; s < last; ++s)
+    {
+      const SparseSample & sample = m_SparseSamples[s];
+      SparseSampleState &  state = m_SparseStates[s];
+
+      double y[SpaceDimension];
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        y[d] = sample.point[d];
+      }
+      if (sample.supportStart >= 0)
+      {
+        for (unsigned int k = 0; k < NumberOfSupportPoints; ++k)
+        {
+          double          weight = 1.0;
+          OffsetValueType offset = sample.supportStart;
+          unsigned int    digits = k;
+          for (unsigned int d = 0; d < SpaceDimension; ++d)
+          {
+            weight *= sample.weights[d][digits % SupportWidth];
+            offset += (digits % SupportWidth) * m_GridStride[d];
+            digits /= SupportWidth;
+          }
+          for (unsigned int d = 0; d < SpaceDimension; ++d)
+          {
+            y[d] += weight * coefficients[d][offset];
+          }
+        }
+      }
+
+      MovingImagePointType mappedPoint;
+      for (unsigned int r = 0; r < SpaceDimension; ++r)
+      {
+        mappedPoint[r] = y[r];
+        if (m_HasPostTransform)
+        {
+          mappedPoint[r] = m_PostOffset[r];
+          for (unsigned int c = 0; c < SpaceDimension; ++c)
+          {
+            mappedPoint[r] += m_PostMatrix[r][c] * y[c];
+          }
+        }
+      }
+
+      state.valid = (this->m_MovingImageMask.IsNull() || this->m_MovingImageMask->IsInsideInWorldSpace(mappedPoint)) &&
+                    this->m_MovingInterpolator->IsInsideBuffer(mappedPoint);
+      if (state.valid)
+      {
+        state.movingValue = static_cast<double>(this->m_MovingInterpolator->Evaluate(mappedPoint));
+        state.valid = this->AcceptsMovingValue(state.movingValue);
+      }
+      if (!state.valid)
+      {
+        continue;
+      }
+      ++validPerBlock[block];
+      if (computeDerivative)
+      {
+        typename Superclass::MovingImageGradientType gradient;
+        this->ComputeMovingImageGradientAtPoint(mappedPoint, gradient);
+        // Chain the gradient through the linear tail: dI/dy = A^T dI/dx.
+        for (unsigned int c = 0; c < SpaceDimension; ++c)
+        {
+          state.derivative[c] = gradient[c];
+          if (m_HasPostTransform)
+          {
+            state.derivative[c] = 0.0;
+            for (unsigned int r = 0; r < SpaceDimension; ++r)
+            {
+              state.derivative[c] += m_PostMatrix[r][c] * gradient[r];
+            }
+          }
+        }
+      }
+    }
+  });
+
+  SizeValueType numberOfValidPoints = 0;
+  for (const SizeValueType valid : validPerBlock)
+  {
+    numberOfValidPoints += valid;
+  }
+  this->m_NumberOfValidPoints = numberOfValidPoints;
+
+  if (computeDerivative)
+  {
+    derivative->SetSize(this->GetNumberOfParameters());
+    derivative->Fill(NumericTraits<typename DerivativeType::ValueType>::ZeroValue());
+  }
+  if (numberOfValidPoints == 0)
+  {
+    itkWarningMacro("No valid points were found during metric evaluation.");
+    this->m_Value = NumericTraits<MeasureType>::max();
+    return this->m_Value;
+  }
+
+  this->m_Value = this->ComputeSparseMeasure(m_SparseSamples, m_SparseStates, numberOfValidPoints, computeDerivative);
+  if (computeDerivative)
+  {
+    if (m_DeterministicReduction)
+    {
+      this->GatherDerivative(*derivative);
+    }
+    else
+    {
+      this->ScatterDerivative(*derivative);
+    }
+  }
+  return this->m_Value;
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::GatherDerivative(DerivativeType & derivative) const
+{
+  // Each control point sums the samples of the (up to) 4^D support buckets
+  // that cover it, always in the same order, and owns its own entries of
+  // the derivative.
+  m_SparseThreader->SetNumberOfWorkUnits(this->GetMaximumNumberOfWorkUnits());
+  m_SparseThreader->ParallelizeArray(
+    0,
+    m_NumberOfControlPoints,
+    [this, &derivative](const SizeValueType cp) {
+      OffsetValueType controlPoint[SpaceDimension];
+      SizeValueType   remainder = cp;
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        controlPoint[d] = static_cast<OffsetValueType>(remainder % m_GridSize[d]);
+        remainder /= m_GridSize[d];
+      }
+
+      double sum[SpaceDimension] = {};
+      for (unsigned int k = 0; k < NumberOfSupportPoints; ++k)
+      {
+        unsigned int    position[SpaceDimension];
+        OffsetValueType bucket = 0;
+        bool            insideGrid = true;
+        unsigned int    digits = k;
+        for (unsigned int d = 0; d < SpaceDimension; ++d)
+        {
+          position[d] = digits % SupportWidth;
+          digits /= SupportWidth;
+          const OffsetValueType start = controlPoint[d] - position[d];
+          insideGrid = insideGrid && start >= 0 && start + SupportWidth <= m_GridSize[d];
+          bucket += start * m_GridStride[d];
+        }
+        if (!insideGrid)
+        {
+          continue;
+        }
+        for (SizeValueType i = m_SupportBucketBegin[bucket]; i < m_SupportBucketBegin[bucket + 1]; ++i)
+        {
+          const SizeValueType       s = m_SupportBucketSamples[i];
+          const SparseSampleState & state = m_SparseStates[s];
+          if (!state.valid)
+          {
+            continue;
+          }
+          double weight = 1.0;
+          for (unsigned int d = 0; d < SpaceDimension; ++d)
+          {
+            weight *= m_SparseSamples[s].weights[d][position[d]];
+          }
+          for (unsigned int d = 0; d < SpaceDimension; ++d)
+          {
+            sum[d] += weight * state.derivative[d];
+          }
+        }
+      }
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        derivative[d * m_NumberOfControlPoints + cp] = sum[d];
+      }
+    },
+    nullptr);
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::ScatterDerivative(DerivativeType & derivative) const
+{
+  const SizeValueType numberOfParameters = derivative.GetSize();
+  const SizeValueType numberOfSamples = m_SparseSamples.size();
+  const SizeValueType numberOfWorkUnits =
+    std::max<SizeValueType>(1, std::min<SizeValueType>(this->GetMaximumNumberOfWorkUnits(), numberOfSamples));
+  m_WorkUnitDerivatives.resize(numberOfWorkUnits);
+
+  m_SparseThreader->SetNumberOfWorkUnits(static_cast<ThreadIdType>(numberOfWorkUnits));
+  m_SparseThreader->ParallelizeArray(
+    0,
+    numberOfWorkUnits,
+    [&](const SizeValueType workUnit) {
+      std::vector<double> & local = m_WorkUnitDerivatives[workUnit];
+      local.assign(numberOfParameters, 0.0);
+      const SizeValueType last = numberOfSamples * (workUnit + 1) / numberOfWorkUnits;
+      for (SizeValueType s = numberOfSamples * workUnit / numberOfWorkUnits; s < last; ++s)
+      {
+        const SparseSample &      sample = m_SparseSamples[s];
+        const SparseSampleState & state = m_SparseStates[s];
+        if (!state.valid || sample.supportStart < 0)
+        {
+          continue;
+        }
+        for (unsigned int k = 0; k < NumberOfSupportPoints; ++k)
+        {
+          double          weight = 1.0;
+          OffsetValueType offset = sample.supportStart;
+          unsigned int    digits = k;
+          for (unsigned int d = 0; d < SpaceDimension; ++d)
+          {
+            weight *= sample.weights[d][digits % SupportWidth];
+            offset += (digits % SupportWidth) * m_GridStride[d];
+            digits /= SupportWidth;
+          }
+          for (unsigned int d = 0; d < SpaceDimension; ++d)
+          {
+            local[d * m_NumberOfControlPoints + offset] += weight * state.derivative[d];
+          }
+        }
+      }
+    },
+    nullptr);
+
+  // Sum the private copies in parallel over ranges of parameters.
+  constexpr SizeValueType parametersPerRange = 4096;
+  const SizeValueType     numberOfRanges = (numberOfParameters + parametersPerRange - 1) / parametersPerRange;
+  m_SparseThreader->SetNumberOfWorkUnits(this->GetMaximumNumberOfWorkUnits());
+  m_SparseThreader->ParallelizeArray(
+    0,
+    numberOfRanges,
+    [&](const SizeValueType range) {
+      const SizeValueType last = std::min(numberOfParameters, (range + 1) * parametersPerRange);
+      for (SizeValueType p = range * parametersPerRange; p < last; ++p)
+      {
+        double sum = 0.0;
+        for (const auto & local : m_WorkUnitDerivatives)
+        {
+          sum += local[p];
+        }
+        derivative[p] = sum;
+      }
+    },
+    nullptr);
+}
+
+template <typename TSuperclass>
+void
+BSplineSparseImageToImageMetricv4<TSuperclass>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "UseSparseBSplineEvaluation: " << m_UseSparseBSplineEvaluation << std::endl;
+  os << indent << "DeterministicReduction: " << m_DeterministicReduction << std::endl;
+  os << indent << "MaximumSampleCacheBytes: " << m_MaximumSampleCacheBytes << std::endl;
+  os << indent << "NumberOfCachedSamples: " << m_SparseSamples.size() << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineSparseMattesMutualInformationImageToImageMetricv4_h
+#define __itkBSplineSparseMattesMutualInformationImageToImageMetricv4_h
+
+#include "itkBSplineSparseImageToImageMetricv4.h"
+#include "itkMattesMutualInformationImageToImageMetricv4.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+/** \class BSplineSparseMattesMutualInformationImageToImageMetricv4
+ * \brief MattesMutualInformationImageToImageMetricv4 with the sparse
+ * BSpline evaluation of BSplineSparseImageToImageMetricv4.
+ *
+ * The joint histogram uses the same bins and Parzen windows as the
+ * superclass (zero order for the fixed image, cubic for the moving image),
+ * and is built from per block histograms summed in block order, with the
+ * intensity limits and bin sizes the superclass Initialize() computes.  The
+ * derivative with respect to the mapped point of a sample is the Parzen
+ * window derivative weighted by log(p(f,m) / p(m)), as in the superclass.
+ */
+template <typename TFixedImage,
+          typename TMovingImage,
+          typename TVirtualImage = TFixedImage,
+          typename TInternalComputationValueType = double>
+class BSplineSparseMattesMutualInformationImageToImageMetricv4
+  : public BSplineSparseImageToImageMetricv4<MattesMutualInformationImageToImageMetricv4<TFixedImage,
+                                                                                         TMovingImage,
+                                                                                         TVirtualImage,
+                                                                                         TInternalComputationValueType>>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BSplineSparseMattesMutualInformationImageToImageMetricv4);
+
+  using Self = BSplineSparseMattesMutualInformationImageToImageMetricv4;
+  using Superclass = BSplineSparseImageToImageMetricv4<MattesMutualInformationImageToImageMetricv4<
+    TFixedImage, TMovingImage, TVirtualImage, TInternalComputationValueType>>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  itkNewMacro(Self);
+
+  itkTypeMacro(BSplineSparseMattesMutualInformationImageToImageMetricv4, BSplineSparseImageToImageMetricv4);
+
+  using MeasureType = typename Superclass::MeasureType;
+  using SparseSample = typename Superclass::SparseSample;
+  using SparseSampleState = typename Superclass::SparseSampleState;
+
+protected:
+  BSplineSparseMattesMutualInformationImageToImageMetricv4() = default;
+  ~BSplineSparseMattesMutualInformationImageToImageMetricv4() override = default;
+
+  MeasureType
+  ComputeSparseMeasure(const std::vector<SparseSample> & samples,
+                       std::vector<SparseSampleState> &  states,
+                       SizeValueType                     numberOfValidPoints,
+                       bool                              computeDerivative) const override;
+
+  bool
+  AcceptsMovingValue(double movingValue) const override;
+
+private:
+  /** Cubic BSpline Parzen window of the moving image and its derivative. */
+  static double
+  CubicBSpline(const double x)
+  {
+    const double absX = std::abs(x);
+    if (absX < 1.0)
+    {
+      return (4.0 - 6.0 * absX * absX + 3.0 * absX * absX * absX) / 6.0;
+    }
+    if (absX < 2.0)
+    {
+      const double u = 2.0 - absX;
+      return u * u * u / 6.0;
+    }
+    return 0.0;
+  }
+
+  static double
+  CubicBSplineDerivative(const double x)
+  {
+    const double absX = std::abs(x);
+    if (absX < 1.0)
+    {
+      return x * (1.5 * absX - 2.0);
+    }
+    if (absX < 2.0)
+    {
+      const double u = 2.0 - absX;
+      return (x < 0.0 ? 0.5 : -0.5) * u * u;
+    }
+    return 0.0;
+  }
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkBSplineSparseMattesMutualInformationImageToImageMetricv4.hxx"
+#endif
+
+#endif
@@ -0,0 +1,184 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineSparseMattesMutualInformationImageToImageMetricv4_hxx
+#define __itkBSplineSparseMattesMutualInformationImageToImageMetricv4_hxx
+
+#include "itkBSplineSparseMattesMutualInformationImageToImageMetricv4.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace itk
+{
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+bool
+BSplineSparseMattesMutualInformationImageToImageMetricv4<TFixedImage,
+                                                         TMovingImage,
+                                                         TVirtualImage,
+                                                         TInternalComputationValueType>::
+  AcceptsMovingValue(const double movingValue) const
+{
+  return movingValue >= this->m_MovingImageTrueMin && movingValue <= this->m_MovingImageTrueMax;
+}
+
+template <typename TFixedImage, typename TMovingImage, typename TVirtualImage, typename TInternalComputationValueType>
+typename BSplineSparseMattesMutualInformationImageToImageMetricv4<TFixedImage,
+                                                                  TMovingImage,
+                                                                  TVirtualImage,
+                                                                  TInternalComputationValueType>::MeasureType
+BSplineSparseMattesMutualInformationImageToImageMetricv4<TFixedImage,
+                                                         TMovingImage,
+                                                         TVirtualImage,
+                                                         TInternalComputationValueType>::
+  ComputeSparseMeasure(const std::vector<SparseSample> & samples,
+                       std::vector<SparseSampleState> &  states,
+                       const SizeValueType               numberOfValidPoints,
+                       const bool                        computeDerivative) const
+{
+  const auto          numberOfBins = static_cast<OffsetValueType>(this->GetNumberOfHistogramBins());
+  const SizeValueType jointSize = numberOfBins * numberOfBins;
+  auto                fixedBin = [this, numberOfBins](const double value) {
+    const auto bin = static_cast<OffsetValueType>(value / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin);
+    return std::max<OffsetValueType>(2, std::min<OffsetValueType>(numberOfBins - 3, bin));
+  };
+  auto movingTerm = [this](const double value) {
+    return value / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
+  };
+  auto firstMovingBin = [numberOfBins](const double term) {
+    const auto bin = static_cast<OffsetValueType>(term);
+    return std::max<OffsetValueType>(2, std::min<OffsetValueType>(numberOfBins - 3, bin)) - 1;
+  };
+
+  // Per block Parzen histograms, summed in block order.
+  const SizeValueType numberOfSamples = samples.size();
+  const SizeValueType numberOfBlocks = this->GetNumberOfSampleBlocks(numberOfSamples);
+  std::vector<double> blockJointPDF(numberOfBlocks * jointSize, 0.0);
+  std::vector<double> blockFixedPDF(numberOfBlocks * numberOfBins, 0.0);
+  this->ParallelizeSampleBlocks(numberOfSamples, [&](SizeValueType first, SizeValueType last, SizeValueType block) {
+    double * jointPDF = &blockJointPDF[block * jointSize];
+    double * fixedPDF = &blockFixedPDF[block * numberOfBins];
+    for (SizeValueType s = first; s < last; ++s)
+    {
+      if (!states[s].valid)
+      {
+        continue;
+      }
+      const OffsetValueType fixedIndex = fixedBin(samples[s].fixedValue);
+      const double          term = movingTerm(states[s].movingValue);
+      const OffsetValueType movingIndex = firstMovingBin(term);
+      fixedPDF[fixedIndex] += 1.0;
+      for (OffsetValueType m = movingIndex; m < movingIndex + 4; ++m)
+      {
+        jointPDF[fixedIndex * numberOfBins + m] += Self::CubicBSpline(static_cast<double>(m) - term);
+      }
+    }
+  });
+  std::vector<double> jointPDF(jointSize, 0.0);
+  std::vector<double> fixedPDF(numberOfBins, 0.0);
+  for (SizeValueType block = 0; block < numberOfBlocks; ++block)
+  {
+    for (SizeValueType i = 0; i < jointSize; ++i)
+    {
+      jointPDF[i] += blockJointPDF[block * jointSize + i];
+    }
+    for (OffsetValueType i = 0; i < numberOfBins; ++i)
+    {
+      fixedPDF[i] += blockFixedPDF[block * numberOfBins + i];
+    }
+  }
+
+  double jointPDFSum = 0.0;
+  for (const double value : jointPDF)
+  {
+    jointPDFSum += value;
+  }
+  double fixedPDFSum = 0.0;
+  for (const double value : fixedPDF)
+  {
+    fixedPDFSum += value;
+  }
+  std::vector<double> movingPDF(numberOfBins, 0.0);
+  for (OffsetValueType f = 0; f < numberOfBins; ++f)
+  {
+    fixedPDF[f] /= fixedPDFSum;
+    for (OffsetValueType m = 0; m < numberOfBins; ++m)
+    {
+      jointPDF[f * numberOfBins + m] /= jointPDFSum;
+      movingPDF[m] += jointPDF[f * numberOfBins + m];
+    }
+  }
+
+  // Mutual information, and log(p(f,m) / p(m)) for the derivative.
+  const double        closeToZero = std::numeric_limits<double>::epsilon();
+  std::vector<double> pRatio(jointSize, 0.0);
+  double              sum = 0.0;
+  for (OffsetValueType f = 0; f < numberOfBins; ++f)
+  {
+    for (OffsetValueType m = 0; m < numberOfBins; ++m)
+    {
+      const double jointValue = jointPDF[f * numberOfBins + m];
+      if (jointValue > closeToZero && movingPDF[m] > closeToZero)
+      {
+        const double ratio = std::log(jointValue / movingPDF[m]);
+        pRatio[f * numberOfBins + m] = ratio;
+        if (fixedPDF[f] > closeToZero)
+        {
+          sum += jointValue * (ratio - std::log(fixedPDF[f]));
+        }
+      }
+    }
+  }
+
+  if (computeDerivative)
+  {
+    // d(MI)/dy = -1 / (N * movingBinSize) * sum_m B3'(m - t) * pRatio(f, m) * dI/dy,
+    // which is the derivative of the v4 value -MI with the sign flipped.
+    const double nFactor = 1.0 / (this->m_MovingImageBinSize * static_cast<double>(numberOfValidPoints));
+    this->ParallelizeSampleBlocks(numberOfSamples, [&](SizeValueType first, SizeValueType last, SizeValueType) {
+      for (SizeValueType s = first; s < last; ++s)
+      {
+        SparseSampleState & state = states[s];
+        if (!state.valid)
+        {
+          std::fill(state.derivative, state.derivative + Superclass::SpaceDimension, 0.0);
+          continue;
+        }
+        const double *        ratioRow = &pRatio[fixedBin(samples[s].fixedValue) * numberOfBins];
+        const double          term = movingTerm(state.movingValue);
+        const OffsetValueType movingIndex = firstMovingBin(term);
+        double                weight = 0.0;
+        for (OffsetValueType m = movingIndex; m < movingIndex + 4; ++m)
+        {
+          weight += Self::CubicBSplineDerivative(static_cast<double>(m) - term) * ratioRow[m];
+        }
+        for (unsigned int d = 0; d < Superclass::SpaceDimension; ++d)
+        {
+          state.derivative[d] *= -nFactor * weight;
+        }
+      }
+    });
+  }
+  return -sum;
+}
+
+} // end namespace itk
+
+#endif
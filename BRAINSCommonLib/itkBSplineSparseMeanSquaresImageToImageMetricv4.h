@@ -0,0 +1,72 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineSparseMeanSquaresImageToImageMetricv4_h
+#define __itkBSplineSparseMeanSquaresImageToImageMetricv4_h
+
+#include "itkBSplineSparseImageToImageMetricv4.h"
+#include "itkMeanSquaresImageToImageMetricv4.h"
+
+namespace itk
+{
+/** \class BSplineSparseMeanSquaresImageToImageMetricv4
+ * \brief MeanSquaresImageToImageMetricv4 with the sparse BSpline evaluation
+ * of BSplineSparseImageToImageMetricv4.
+ */
+template <typename TFixedImage,
+          typename TMovingImage,
+          typename TVirtualImage = TFixedImage,
+          typename TInternalComputationValueType = double>
+class BSplineSparseMeanSquaresImageToImageMetricv4
+  : public BSplineSparseImageToImageMetricv4<
+      MeanSquaresImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage, TInternalComputationValueType>>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BSplineSparseMeanSquaresImageToImageMetricv4);
+
+  using Self = BSplineSparseMeanSquaresImageToImageMetricv4;
+  using Superclass = BSplineSparseImageToImageMetricv4<
+    MeanSquaresImageToImageMetricv4<TFixedImage, TMovingImage, TVirtualImage, TInternalComputationValueType>>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  itkNewMacro(Self);
+
+  itkTypeMacro(BSplineSparseMeanSquaresImageToImageMetricv4, BSplineSparseImageToImageMetricv4);
+
+  using MeasureType = typename Superclass::MeasureType;
+  using SparseSample = typename Superclass::SparseSample;
+  using SparseSampleState = typename Superclass::SparseSampleState;
+
+protected:
+  BSplineSparseMeanSquaresImageToImageMetricv4() = default;
+  ~BSplineSparseMeanSquaresImageToImageMetricv4() override = default;
+
+  MeasureType
+  ComputeSparseMeasure(const std::vector<SparseSample> & samples,
+                       std::vector<SparseSampleState> &  states,
+                       SizeValueType                     numberOfValidPoints,
+                       bool                              computeDerivative) const override;
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkBSplineSparseMeanSquaresImageToImageMetricv4.hxx"
+#endif
+
+#endif
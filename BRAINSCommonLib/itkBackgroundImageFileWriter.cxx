@@ -0,0 +1,140 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkBackgroundImageFileWriter.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace itk
+{
+BackgroundImageFileWriter::BackgroundImageFileWriter()
+  : m_NumberOfWorkers(std::max(1U, std::min(4U, std::thread::hardware_concurrency() / 2)))
+{}
+
+BackgroundImageFileWriter::~BackgroundImageFileWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_StopWorkers = true;
+  }
+  m_JobQueued.notify_all();
+  for (auto & worker : m_Workers)
+  {
+    worker.join();
+  }
+  for (const auto & failure : m_Failures)
+  {
+    std::cerr << "BackgroundImageFileWriter: " << failure << std::endl;
+  }
+}
+
+void
+BackgroundImageFileWriter::Flush()
+{
+  std::vector<std::string> failures;
+  {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_JobFinished.wait(lock, [this] { return m_Jobs.empty() && m_NumberOfActiveJobs == 0; });
+    failures.swap(m_Failures);
+  }
+  if (!failures.empty())
+  {
+    std::ostringstream msg;
+    msg << failures.size() << " image(s) could not be written:";
+    for (const auto & failure : failures)
+    {
+      msg << std::endl << "  " << failure;
+    }
+    itkExceptionMacro(<< msg.str());
+  }
+}
+
+unsigned int
+BackgroundImageFileWriter::GetNumberOfPendingImages()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return static_cast<unsigned int>(m_Jobs.size()) + m_NumberOfActiveJobs;
+}
+
+void
+BackgroundImageFileWriter::Enqueue(const std::string & fileName, std::function<void()> write)
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  if (m_Workers.empty())
+  {
+    for (unsigned int i = 0; i < m_NumberOfWorkers; ++i)
+    {
+      m_Workers.emplace_back([this] { this->RunWorker(); });
+    }
+  }
+  m_JobFinished.wait(lock, [this] { return m_Jobs.size() + m_NumberOfActiveJobs < m_MaximumPendingImages; });
+  m_Jobs.push_back(Job{ fileName, std::move(write) });
+  lock.unlock();
+  m_JobQueued.notify_one();
+}
+
+void
+BackgroundImageFileWriter::RunWorker()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while (true)
+  {
+    m_JobQueued.wait(lock, [this] { return m_StopWorkers || !m_Jobs.empty(); });
+    if (m_Jobs.empty())
+    {
+      return;
+    }
+    Job job = std::move(m_Jobs.front());
+    m_Jobs.pop_front();
+    ++m_NumberOfActiveJobs;
+    lock.unlock();
+
+    std::string failure;
+    try
+    {
+      job.write();
+    }
+    catch (ExceptionObject & e)
+    {
+      failure = job.fileName + ": " + e.GetDescription();
+    }
+    catch (std::exception & e)
+    {
+      failure = job.fileName + ": " + e.what();
+    }
+
+    lock.lock();
+    --m_NumberOfActiveJobs;
+    if (!failure.empty())
+    {
+      m_Failures.push_back(failure);
+    }
+    // Wakes both Flush() and producers waiting for a free slot.
+    m_JobFinished.notify_all();
+  }
+}
+
+void
+BackgroundImageFileWriter::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfWorkers: " << m_NumberOfWorkers << std::endl;
+  os << indent << "MaximumPendingImages: " << m_MaximumPendingImages << std::endl;
+}
+} // end namespace itk
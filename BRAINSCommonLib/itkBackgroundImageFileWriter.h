@@ -0,0 +1,145 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBackgroundImageFileWriter_h
+#define __itkBackgroundImageFileWriter_h
+
+#include <itkImageDuplicator.h>
+#include <itkImageFileWriter.h>
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace itk
+{
+/** \class BackgroundImageFileWriter
+ *
+ * \brief Writes images to files on worker threads.
+ *
+ * Write() copies the image and returns; the copy is encoded and written,
+ * with compression by default, by one of NumberOfWorkers threads, so
+ * several files are compressed at the same time and none of them on the
+ * caller's thread.  Because of the copy the caller may change or release
+ * the image as soon as Write() returns.
+ *
+ * At most MaximumPendingImages copies are queued or being written; Write()
+ * waits for a free slot beyond that, which bounds the memory held.
+ * Flush() waits for all queued writes and reports the ones that failed.
+ * Destroying the writer also waits for them, but can only print failures.
+ *
+ * One writer can be shared by several producers through its SmartPointer.
+ *
+ * \ingroup ITKBRAINSFilterPack
+ */
+class BackgroundImageFileWriter : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(BackgroundImageFileWriter);
+
+  /** Standard class type alias. */
+  using Self = BackgroundImageFileWriter;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods) */
+  itkTypeMacro(BackgroundImageFileWriter, Object);
+
+  /** Number of writer threads, started by the first Write(). */
+  itkSetClampMacro(NumberOfWorkers, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(NumberOfWorkers, unsigned int);
+
+  /** Number of images that may be queued or being written at once, at least 1. */
+  itkSetClampMacro(MaximumPendingImages, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(MaximumPendingImages, unsigned int);
+
+  /** Queue a copy of image to be written to fileName. */
+  template <typename TImage>
+  void
+  Write(const TImage * image, const std::string & fileName, const bool useCompression = true)
+  {
+    using DuplicatorType = ImageDuplicator<TImage>;
+    typename DuplicatorType::Pointer duplicator = DuplicatorType::New();
+    duplicator->SetInputImage(image);
+    duplicator->Update();
+    typename TImage::Pointer copy = duplicator->GetOutput();
+
+    this->Enqueue(fileName, [copy, fileName, useCompression]() {
+      using WriterType = ImageFileWriter<TImage>;
+      typename WriterType::Pointer writer = WriterType::New();
+      writer->SetInput(copy);
+      writer->SetFileName(fileName);
+      writer->SetUseCompression(useCompression);
+      writer->Update();
+    });
+  }
+
+  /** Wait until every queued image is written.  Throws an ExceptionObject
+   * naming the files that could not be written since the last Flush(). */
+  void
+  Flush();
+
+  /** Number of images queued or being written. */
+  unsigned int
+  GetNumberOfPendingImages();
+
+protected:
+  BackgroundImageFileWriter();
+  ~BackgroundImageFileWriter() override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  struct Job
+  {
+    std::string           fileName;
+    std::function<void()> write;
+  };
+
+  void
+  Enqueue(const std::string & fileName, std::function<void()> write);
+
+  void
+  RunWorker();
+
+  unsigned int m_NumberOfWorkers;
+  unsigned int m_MaximumPendingImages{ 8 };
+
+  std::vector<std::thread> m_Workers;
+  std::mutex               m_Mutex;
+  std::condition_variable  m_JobQueued;
+  std::condition_variable  m_JobFinished;
+  std::deque<Job>          m_Jobs;
+  unsigned int             m_NumberOfActiveJobs{ 0 };
+  std::vector<std::string> m_Failures;
+  bool                     m_StopWorkers{ false };
+};
+} // end namespace itk
+
+#endif
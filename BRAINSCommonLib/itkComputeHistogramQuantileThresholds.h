@@ -20,6 +20,7 @@
 #define __itkComputeHistogramQuantileThresholds_h
 
 #include <itkImage.h>
+#include <itkHistogram.h>
 #include <itkNumericTraits.h>
 
 namespace itk
@@ -49,6 +50,7 @@ public:
   using Superclass = Object;
   using Pointer = SmartPointer<Self>;
   using MaskPixelType = typename TMaskImage::PixelType;
+  using HistogramType = Statistics::Histogram<double>;
 
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
@@ -80,6 +82,13 @@ public:
   void
   Calculate();
 
+  /** Compute the thresholds from an already built histogram of the image
+   * whose intensity range is [imageMin, imageMax].  This lets callers that
+   * build the histograms of several images in one sweep share the
+   * threshold selection. */
+  void
+  CalculateFromHistogram(const HistogramType * histogram, const InputPixelType imageMin, const InputPixelType imageMax);
+
 protected:
   ComputeHistogramQuantileThresholds();
   ~ComputeHistogramQuantileThresholds() override;
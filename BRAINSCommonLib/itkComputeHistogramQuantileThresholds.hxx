@@ -100,15 +100,24 @@ ComputeHistogramQuantileThresholds<TInputImage, TMaskImage>::Calculate()
   histogramGenerator->SetHistogramMax(m_ImageMax);
 
   histogramGenerator->Compute();
-  using HistogramType = typename HistogramGeneratorType::HistogramType;
-  auto * histogram = const_cast<HistogramType *>(histogramGenerator->GetOutput());
+  this->CalculateFromHistogram(histogramGenerator->GetOutput(), this->m_ImageMin, this->m_ImageMax);
+}
+
+template <typename TInputImage, typename TMaskImage>
+void
+ComputeHistogramQuantileThresholds<TInputImage, TMaskImage>::CalculateFromHistogram(const HistogramType * histogram,
+                                                                                    const InputPixelType  imageMin,
+                                                                                    const InputPixelType  imageMax)
+{
+  this->m_ImageMin = imageMin;
+  this->m_ImageMax = imageMax;
   //  If the number of non-zero bins is <= 2, then it is a binary image, and
   // Otsu won't do:
   //
   m_NumberOfValidHistogramsEntries = 0;
   {
-    typename HistogramType::Iterator histIt = histogram->Begin();
-    bool                             saw_lowest = false;
+    typename HistogramType::ConstIterator histIt = histogram->Begin();
+    bool                                  saw_lowest = false;
     while (histIt != histogram->End())
     {
       // walking a 1-dimensional histogram from low to high:
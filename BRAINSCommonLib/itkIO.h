@@ -115,6 +115,26 @@ ReadImage(const std::string & fileName)
   return image;
 }
 
+/** True when reading a region of fileName decodes only that region: its
+ * ImageIO streams reads and the voxel data is not compressed.  NiftiImageIO
+ * claims to stream .nii.gz files, but does so by seeking through the gzip
+ * stream from its start, so every region read decompresses most of the file;
+ * such files are cheaper to read once in full. */
+inline bool
+ImageFileCanStreamRead(const std::string & fileName)
+{
+  itk::ImageIOBase::Pointer imageIO =
+    itk::ImageIOFactory::CreateImageIO(fileName.c_str(), itk::ImageIOFactory::FileModeType::ReadMode);
+  if (imageIO.IsNull())
+  {
+    return false;
+  }
+  imageIO->SetFileName(fileName);
+  imageIO->ReadImageInformation();
+  const std::string extension = itksys::SystemTools::LowerCase(itksys::SystemTools::GetFilenameLastExtension(fileName));
+  return imageIO->CanStreamRead() && !imageIO->GetUseCompression() && extension != ".gz";
+}
+
 /**
  *
  *
@@ -0,0 +1,189 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageFileReducer_h
+#define __itkImageFileReducer_h
+
+#include "itkRunningImageAccumulator.h"
+
+#include <itkImage.h>
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/** \class ImageFileReducer
+ *
+ * \brief Voxelwise reduction of a list of image files with bounded memory.
+ *
+ * Builds population templates and probabilistic atlases from many
+ * subjects without holding all of them in memory.  The files are read by
+ * a background loader thread that stays at most NumberOfPrefetchedImages
+ * reads ahead of the reduction, so I/O overlaps with computation.
+ *
+ * \par Mean and Variance
+ * Each image is folded into a RunningImageAccumulator as soon as it is
+ * read and released, so memory is independent of the number of files.
+ *
+ * \par Median and MajorityVote
+ * Order statistics need all N values of a voxel at once.  The volume is
+ * processed in slabs along its last axis, sized so that the N values of a
+ * slab fit in MaximumBufferBytes, and only that slab is requested from
+ * each file.  Files that can not be read region by region without decoding
+ * all of them (compressed files, or formats whose ImageIO does not stream)
+ * are read once in full when their first slab is needed, copied to an
+ * uncompressed MetaImage in TemporaryDirectory and released, and their
+ * other slabs are streamed from that copy.  So they are decompressed once,
+ * at most one of them is held in full at a time, and the copies are deleted
+ * when the reduction ends.  The median of an even number of values is the mean of the two middle ones.
+ * MajorityVote returns the most frequent value of each voxel, the
+ * smallest one on ties.
+ *
+ * All files must have the same LargestPossibleRegion as the first one,
+ * which also provides the meta information of the output.
+ *
+ * \ingroup ITKBRAINSFilterPack
+ */
+template <typename TInputImage, typename TOutputImage = Image<float, TInputImage::ImageDimension>>
+class ImageFileReducer : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(ImageFileReducer);
+
+  /** Standard class type alias. */
+  using Self = ImageFileReducer;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods) */
+  itkTypeMacro(ImageFileReducer, Object);
+
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  using InputImageType = TInputImage;
+  using InputImagePointer = typename InputImageType::Pointer;
+  using InputPixelType = typename InputImageType::PixelType;
+  using OutputImageType = TOutputImage;
+  using OutputImagePointer = typename OutputImageType::Pointer;
+  using OutputPixelType = typename OutputImageType::PixelType;
+  using RegionType = typename InputImageType::RegionType;
+  using FileNamesContainer = std::vector<std::string>;
+  using AccumulatorType = RunningImageAccumulator<InputImageType, OutputImageType>;
+
+  using ReductionType = enum { Mean, Variance, Median, MajorityVote };
+
+  void
+  SetFileNames(const FileNamesContainer & fileNames)
+  {
+    m_FileNames = fileNames;
+    this->Modified();
+  }
+  const FileNamesContainer &
+  GetFileNames() const
+  {
+    return m_FileNames;
+  }
+
+  itkSetMacro(Reduction, ReductionType);
+  itkGetConstMacro(Reduction, ReductionType);
+
+  /** The number of images (or slabs) the loader may read ahead, at least 1. */
+  itkSetClampMacro(NumberOfPrefetchedImages, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(NumberOfPrefetchedImages, unsigned int);
+
+  /** Upper bound in bytes of the slab buffer used by Median and
+   * MajorityVote.  A slab is never thinner than one slice. */
+  itkSetMacro(MaximumBufferBytes, SizeValueType);
+  itkGetConstMacro(MaximumBufferBytes, SizeValueType);
+
+  /** Directory of the uncompressed copies of the files that do not stream.
+   * Defaults to the TMPDIR (TEMP on Windows) environment variable, else /tmp. */
+  itkSetStringMacro(TemporaryDirectory);
+  itkGetStringMacro(TemporaryDirectory);
+
+  /** Read and reduce all files. */
+  void
+  Update();
+
+  OutputImageType *
+  GetOutput()
+  {
+    return m_Output.GetPointer();
+  }
+
+protected:
+  ImageFileReducer() = default;
+  ~ImageFileReducer() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  struct LoadRequest
+  {
+    SizeValueType fileIndex;
+    RegionType    region;
+  };
+
+  /** Read the requested regions in order on a background thread and hand
+   * each image to consume() on the calling thread. */
+  template <typename TConsumer>
+  void
+  LoadInBackground(const std::vector<LoadRequest> & requests, TConsumer consume);
+
+  /** Runs on the loader thread, the only one touching m_StreamedCopies. */
+  InputImagePointer
+  ReadRegion(const LoadRequest & request);
+
+  /** Delete the uncompressed copies written by ReadRegion. */
+  void
+  RemoveStreamedCopies();
+
+  void
+  ReduceMoments(const RegionType & largestRegion);
+
+  void
+  ReduceOrderStatistics(const RegionType & largestRegion);
+
+  FileNamesContainer m_FileNames;
+  ReductionType      m_Reduction{ Mean };
+  unsigned int       m_NumberOfPrefetchedImages{ 2 };
+  SizeValueType      m_MaximumBufferBytes{ 1024UL * 1024UL * 1024UL };
+  OutputImagePointer m_Output;
+  InputImagePointer  m_Reference;
+  std::string        m_TemporaryDirectory;
+
+  /** Per file: whether its slabs are streamed from it directly, else the
+   * uncompressed copy they are streamed from, empty until it is written. */
+  std::vector<bool>        m_StreamReadable;
+  std::vector<std::string> m_StreamedCopies;
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkImageFileReducer.hxx"
+#endif
+
+#endif
@@ -0,0 +1,355 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageFileReducer_hxx
+#define __itkImageFileReducer_hxx
+
+#include "itkImageFileReducer.h"
+#include "itkIO.h"
+
+#include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkMultiThreaderBase.h>
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TOutputImage>
+void
+ImageFileReducer<TInputImage, TOutputImage>::Update()
+{
+  if (m_FileNames.empty())
+  {
+    itkExceptionMacro(<< "No input file names given");
+  }
+
+  using ReaderType = ImageFileReader<InputImageType>;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(m_FileNames.front());
+  reader->UpdateOutputInformation();
+  m_Reference = reader->GetOutput();
+  m_Reference->DisconnectPipeline();
+  const RegionType largestRegion = m_Reference->GetLargestPossibleRegion();
+
+  m_Output = nullptr;
+  if (m_Reduction == Mean || m_Reduction == Variance)
+  {
+    this->ReduceMoments(largestRegion);
+  }
+  else
+  {
+    this->ReduceOrderStatistics(largestRegion);
+  }
+  m_Reference = nullptr;
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+ImageFileReducer<TInputImage, TOutputImage>::ReduceMoments(const RegionType & largestRegion)
+{
+  std::vector<LoadRequest> requests;
+  for (SizeValueType f = 0; f < m_FileNames.size(); ++f)
+  {
+    requests.push_back(LoadRequest{ f, largestRegion });
+  }
+
+  typename AccumulatorType::Pointer accumulator = AccumulatorType::New();
+  accumulator->SetComputeVariance(m_Reduction == Variance);
+  this->LoadInBackground(requests,
+                         [&accumulator](const LoadRequest &, const InputImageType * image) {
+                           accumulator->AddImage(image);
+                         });
+  m_Output = (m_Reduction == Variance) ? accumulator->GetVariance() : accumulator->GetMean();
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+ImageFileReducer<TInputImage, TOutputImage>::ReduceOrderStatistics(const RegionType & largestRegion)
+{
+  m_Output = OutputImageType::New();
+  m_Output->CopyInformation(m_Reference);
+  m_Output->SetRegions(largestRegion);
+  m_Output->Allocate();
+
+  // Split along the slowest axis so that every slab is a contiguous run of
+  // the output buffer.
+  const SizeValueType numberOfFiles = m_FileNames.size();
+  const SizeValueType numberOfSlices = largestRegion.GetSize(ImageDimension - 1);
+  const SizeValueType pixelsPerSlice = largestRegion.GetNumberOfPixels() / std::max<SizeValueType>(1, numberOfSlices);
+  const SizeValueType bytesPerSlice =
+    std::max<SizeValueType>(1, numberOfFiles * pixelsPerSlice * sizeof(InputPixelType));
+  const SizeValueType slicesPerSlab =
+    std::min(numberOfSlices, std::max<SizeValueType>(1, m_MaximumBufferBytes / bytesPerSlice));
+
+  std::vector<LoadRequest> requests;
+  for (SizeValueType firstSlice = 0; firstSlice < numberOfSlices; firstSlice += slicesPerSlab)
+  {
+    RegionType slab = largestRegion;
+    slab.SetIndex(ImageDimension - 1, largestRegion.GetIndex(ImageDimension - 1) + firstSlice);
+    slab.SetSize(ImageDimension - 1, std::min(slicesPerSlab, numberOfSlices - firstSlice));
+    for (SizeValueType f = 0; f < numberOfFiles; ++f)
+    {
+      requests.push_back(LoadRequest{ f, slab });
+    }
+  }
+
+  // Reading a slab of a compressed file decompresses (most of) the file, so
+  // those are decompressed once to an uncompressed copy the slabs are read from.
+  m_StreamReadable.clear();
+  for (const auto & fileName : m_FileNames)
+  {
+    m_StreamReadable.push_back(itkUtil::ImageFileCanStreamRead(fileName));
+  }
+  m_StreamedCopies.assign(numberOfFiles, std::string());
+  if (m_TemporaryDirectory.empty())
+  {
+#ifdef _WIN32
+    const char * const environmentTemporaryDirectory = itksys::SystemTools::GetEnv("TEMP");
+#else
+    const char * const environmentTemporaryDirectory = itksys::SystemTools::GetEnv("TMPDIR");
+#endif
+    m_TemporaryDirectory = environmentTemporaryDirectory ? environmentTemporaryDirectory : "/tmp";
+  }
+
+  // values[p * N + f] is the value of pixel p of the current slab in file f,
+  // so the reduction of a pixel works on one contiguous run.
+  std::vector<InputPixelType> values(slicesPerSlab * pixelsPerSlice * numberOfFiles);
+  OutputPixelType * const     outputBuffer = m_Output->GetBufferPointer();
+  const bool                  majorityVote = (m_Reduction == MajorityVote);
+
+  const auto consume = [&](const LoadRequest & request, const InputImageType * image) {
+    const SizeValueType fileIndex = request.fileIndex;
+    InputPixelType *    slot = values.data() + fileIndex;
+    for (ImageRegionConstIterator<InputImageType> it(image, request.region); !it.IsAtEnd(); ++it)
+    {
+      *slot = it.Get();
+      slot += numberOfFiles;
+    }
+    if (fileIndex + 1 < numberOfFiles)
+    {
+      return;
+    }
+
+    const SizeValueType slabPixels = request.region.GetNumberOfPixels();
+    OutputPixelType * const slabOutput = outputBuffer + m_Output->ComputeOffset(request.region.GetIndex());
+    InputPixelType * const  slabValues = values.data();
+    MultiThreaderBase::New()->ParallelizeArray(
+      0,
+      slabPixels,
+      [slabValues, slabOutput, numberOfFiles, majorityVote](SizeValueType p) {
+        InputPixelType * const first = slabValues + p * numberOfFiles;
+        InputPixelType * const last = first + numberOfFiles;
+        if (majorityVote)
+        {
+          std::sort(first, last);
+          InputPixelType best = *first;
+          SizeValueType  bestCount = 0;
+          for (InputPixelType * run = first; run != last;)
+          {
+            InputPixelType * const runEnd = std::upper_bound(run, last, *run);
+            const SizeValueType    runCount = static_cast<SizeValueType>(runEnd - run);
+            if (runCount > bestCount)
+            {
+              best = *run;
+              bestCount = runCount;
+            }
+            run = runEnd;
+          }
+          slabOutput[p] = static_cast<OutputPixelType>(best);
+        }
+        else
+        {
+          InputPixelType * const middle = first + numberOfFiles / 2;
+          std::nth_element(first, middle, last);
+          double median = static_cast<double>(*middle);
+          if (numberOfFiles % 2 == 0)
+          {
+            median = 0.5 * (median + static_cast<double>(*std::max_element(first, middle)));
+          }
+          slabOutput[p] = static_cast<OutputPixelType>(median);
+        }
+      },
+      nullptr);
+  };
+  try
+  {
+    this->LoadInBackground(requests, consume);
+  }
+  catch (...)
+  {
+    this->RemoveStreamedCopies();
+    throw;
+  }
+  this->RemoveStreamedCopies();
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+ImageFileReducer<TInputImage, TOutputImage>::RemoveStreamedCopies()
+{
+  for (const auto & copyName : m_StreamedCopies)
+  {
+    if (!copyName.empty())
+    {
+      itksys::SystemTools::RemoveFile(copyName);
+    }
+  }
+  m_StreamReadable.clear();
+  m_StreamedCopies.clear();
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename ImageFileReducer<TInputImage, TOutputImage>::InputImagePointer
+ImageFileReducer<TInputImage, TOutputImage>::ReadRegion(const LoadRequest & request)
+{
+  const SizeValueType f = request.fileIndex;
+  const bool          streamFromCopy = f < m_StreamReadable.size() && !m_StreamReadable[f];
+  const bool          writeCopy = streamFromCopy && m_StreamedCopies[f].empty();
+
+  using ReaderType = ImageFileReader<InputImageType>;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName(streamFromCopy && !writeCopy ? m_StreamedCopies[f] : m_FileNames[f]);
+  reader->UpdateOutputInformation();
+  if (reader->GetOutput()->GetLargestPossibleRegion() != m_Reference->GetLargestPossibleRegion())
+  {
+    itkExceptionMacro(<< m_FileNames[f] << " has region " << reader->GetOutput()->GetLargestPossibleRegion() << " but "
+                      << m_FileNames.front() << " has region " << m_Reference->GetLargestPossibleRegion());
+  }
+  if (!writeCopy)
+  {
+    reader->GetOutput()->SetRequestedRegion(request.region);
+  }
+  reader->Update();
+  InputImagePointer image = reader->GetOutput();
+  image->DisconnectPipeline();
+  if (writeCopy)
+  {
+    // The full image serves this slab and is released with it
+    std::random_device randomDevice;
+    const std::string  copyName = m_TemporaryDirectory + "/ImageFileReducer_" + std::to_string(randomDevice()) + "_" +
+                                 std::to_string(f) + ".mha";
+    using WriterType = ImageFileWriter<InputImageType>;
+    typename WriterType::Pointer writer = WriterType::New();
+    writer->SetInput(image);
+    writer->SetFileName(copyName);
+    writer->SetUseCompression(false);
+    m_StreamedCopies[f] = copyName;
+    writer->Update();
+  }
+  return image;
+}
+
+template <typename TInputImage, typename TOutputImage>
+template <typename TConsumer>
+void
+ImageFileReducer<TInputImage, TOutputImage>::LoadInBackground(const std::vector<LoadRequest> & requests,
+                                                              TConsumer                        consume)
+{
+  std::mutex                    queueMutex;
+  std::condition_variable       queueChanged;
+  std::deque<InputImagePointer> loaded;
+  std::exception_ptr            loadError;
+  bool                          stopLoading = false;
+
+  std::thread loader([&]() {
+    for (const auto & request : requests)
+    {
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueChanged.wait(lock, [&]() { return stopLoading || loaded.size() < m_NumberOfPrefetchedImages; });
+        if (stopLoading)
+        {
+          return;
+        }
+      }
+      InputImagePointer image;
+      try
+      {
+        image = this->ReadRegion(request);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        loadError = std::current_exception();
+        loaded.push_back(nullptr);
+        queueChanged.notify_all();
+        return;
+      }
+      std::lock_guard<std::mutex> lock(queueMutex);
+      loaded.push_back(image);
+      queueChanged.notify_all();
+    }
+  });
+
+  try
+  {
+    for (const auto & request : requests)
+    {
+      InputImagePointer image;
+      {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        queueChanged.wait(lock, [&]() { return !loaded.empty(); });
+        image = loaded.front();
+        loaded.pop_front();
+        queueChanged.notify_all();
+        if (image.IsNull())
+        {
+          std::rethrow_exception(loadError);
+        }
+      }
+      consume(request, image.GetPointer());
+    }
+  }
+  catch (...)
+  {
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      stopLoading = true;
+      queueChanged.notify_all();
+    }
+    loader.join();
+    throw;
+  }
+  loader.join();
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+ImageFileReducer<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfFiles: " << m_FileNames.size() << std::endl;
+  os << indent << "Reduction: " << static_cast<int>(m_Reduction) << std::endl;
+  os << indent << "NumberOfPrefetchedImages: " << m_NumberOfPrefetchedImages << std::endl;
+  os << indent << "MaximumBufferBytes: " << m_MaximumBufferBytes << std::endl;
+  os << indent << "TemporaryDirectory: " << m_TemporaryDirectory << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -140,6 +140,18 @@ private:
   void
   ImageMinMax(InputPixelType & imageMin, InputPixelType & imageMax) const;
 
+  /** Dilate the pixels of image that differ from backgroundValue by the
+   * BinaryBallStructuringElement of ceil( ballSize / spacing ) voxels per
+   * axis.  The ball is found by thresholding a Euclidean distance map, so the
+   * cost does not grow with the ball size.  Dilated pixels are set to
+   * dilatedValue and all others to otherValue. */
+  typename IntegerImageType::Pointer
+  DistanceMapDilate(const IntegerImageType * image,
+                    const IntegerPixelType   backgroundValue,
+                    const double             ballSize,
+                    const IntegerPixelType   dilatedValue,
+                    const IntegerPixelType   otherValue) const;
+
   // No longer used  double m_OtsuPercentileThreshold;
   double           m_OtsuPercentileLowerThreshold{ 0.01 };
   double           m_OtsuPercentileUpperThreshold;
@@ -26,13 +26,14 @@
 #include <itkBinaryThresholdImageFilter.h>
 #include <itkImageRegionIterator.h>
 // #include <itkSimpleFilterWatcher.h>
-#include <itkImageRegionIterator.h>
-#include <itkBinaryBallStructuringElement.h>
-#include <itkBinaryDilateImageFilter.h>
-#include <itkBinaryErodeImageFilter.h>
+#include <itkSignedMaurerDistanceMapImageFilter.h>
+#include <itkChangeInformationImageFilter.h>
+#include <itkUnaryGeneratorImageFilter.h>
 #include <vnl/vnl_sample.h>
 #include <itkMath.h>
-#include <itkConnectedThresholdImageFilter.h>
+
+#include <algorithm>
+#include <vector>
 
 #include <itkNumericTraits.h>
 #include <itkMinimumMaximumImageFilter.h>
@@ -80,6 +81,60 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>::ImageMinMax(
   imageMin = minmaxFilter->GetMinimum();
 }
 
+template <typename TInputImage, typename TOutputImage>
+typename LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>::IntegerImageType::Pointer
+LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>::DistanceMapDilate(
+  const IntegerImageType * image,
+  const IntegerPixelType   backgroundValue,
+  const double             ballSize,
+  const IntegerPixelType   dilatedValue,
+  const IntegerPixelType   otherValue) const
+{
+  // A BinaryBallStructuringElement of radius r_d = ceil( ballSize / spacing_d )
+  // voxels along axis d holds the offsets x with sum_d ( x_d / (r_d + 0.5) )^2 <= 1,
+  // an ellipsoid in physical space when the spacing is anisotropic.  Measuring
+  // distances with spacing 1 / (r_d + 0.5) turns that ellipsoid into the unit
+  // ball, so thresholding the squared distance at 1 reproduces the ball kernel
+  // morphology on every axis.
+  using ChangeInformationType = ChangeInformationImageFilter<IntegerImageType>;
+  typename IntegerImageType::SpacingType ballSpacing;
+  for (unsigned int d = 0; d < IntegerImageType::ImageDimension; ++d)
+  {
+    const double ballVoxels = itk::Math::ceil(ballSize / image->GetSpacing()[d]);
+    ballSpacing[d] = 1.0 / (ballVoxels + 0.5);
+  }
+  typename ChangeInformationType::Pointer ballGrid = ChangeInformationType::New();
+  ballGrid->SetInput(image);
+  ballGrid->SetOutputSpacing(ballSpacing);
+  ballGrid->ChangeSpacingOn();
+
+  using DistanceImageType = Image<float, IntegerImageType::ImageDimension>;
+  using DistanceMapType = SignedMaurerDistanceMapImageFilter<IntegerImageType, DistanceImageType>;
+  typename DistanceMapType::Pointer distanceMap = DistanceMapType::New();
+  distanceMap->SetInput(ballGrid->GetOutput());
+  distanceMap->SetBackgroundValue(backgroundValue);
+  distanceMap->SetInsideIsPositive(false);
+  distanceMap->SetSquaredDistance(true);
+  distanceMap->SetUseImageSpacing(true);
+
+  // Outside the object the signed distance is the exact distance to the
+  // nearest object pixel, inside it is not positive.
+  using ThresholdType = UnaryGeneratorImageFilter<DistanceImageType, IntegerImageType>;
+  typename ThresholdType::Pointer threshold = ThresholdType::New();
+  threshold->SetInput(distanceMap->GetOutput());
+  threshold->SetFunctor([dilatedValue, otherValue](const float distance) -> IntegerPixelType {
+    return (distance <= 1.0f) ? dilatedValue : otherValue;
+  });
+  threshold->Update();
+
+  // Back to the spacing of image, detached so that downstream updates do not
+  // restore the ball spacing
+  typename IntegerImageType::Pointer dilated = threshold->GetOutput();
+  dilated->DisconnectPipeline();
+  dilated->CopyInformation(image);
+  return dilated;
+}
+
 template <typename TInputImage, typename TOutputImage>
 void
 LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>::GenerateData()
@@ -199,144 +254,95 @@ LargestForegroundFilledMaskImageFilter<TInputImage, TOutputImage>::GenerateData(
   LargestFilter->SetUpperThreshold(1);
   LargestFilter->Update();
 
-  using myKernelType =
-    BinaryBallStructuringElement<typename IntegerImageType::PixelType, IntegerImageType::ImageDimension>;
-
-  using ErodeFilterType = BinaryErodeImageFilter<IntegerImageType, IntegerImageType, myKernelType>;
-  typename ErodeFilterType::Pointer ErodeFilter = ErodeFilterType::New();
+  for (unsigned int d = 0; d < 3; ++d)
   {
-    myKernelType                    dilateBall;
-    myKernelType                    erodeBall;
-    typename myKernelType::SizeType dilateBallSize;
-    typename myKernelType::SizeType erodeBallSize;
-    for (unsigned int d = 0; d < 3; ++d)
+    const unsigned int ClosingVoxels = itk::Math::ceil(m_ClosingSize / (relabel->GetOutput()->GetSpacing()[d]));
+    if (ClosingVoxels > 20)
     {
-      const unsigned int ClosingVoxels = itk::Math::ceil(m_ClosingSize / (relabel->GetOutput()->GetSpacing()[d]));
-      if (ClosingVoxels > 20)
-      {
-        std::cout << "WARNING:  Attempting to close with a very large number of voxels:  " << m_ClosingSize << " / "
-                  << (relabel->GetOutput()->GetSpacing()[d]) << " = " << ClosingVoxels << std::endl;
-        std::cout << "Perhaps there is a mis-match between the voxel spacing"
-                  << " and the assumption that  ClosingSize is given in mm" << std::endl;
-      }
-      dilateBallSize[d] = ClosingVoxels;
-      erodeBallSize[d] = ClosingVoxels;
+      std::cout << "WARNING:  Attempting to close with a very large number of voxels:  " << m_ClosingSize << " / "
+                << (relabel->GetOutput()->GetSpacing()[d]) << " = " << ClosingVoxels << std::endl;
+      std::cout << "Perhaps there is a mis-match between the voxel spacing"
+                << " and the assumption that  ClosingSize is given in mm" << std::endl;
     }
-    dilateBall.SetRadius(dilateBallSize);
-    dilateBall.CreateStructuringElement();
-    erodeBall.SetRadius(erodeBallSize);
-    erodeBall.CreateStructuringElement();
-
-    using DilateFilterType = BinaryDilateImageFilter<IntegerImageType, IntegerImageType, myKernelType>;
-    typename DilateFilterType::Pointer DilateFilter = DilateFilterType::New();
-
-    // DilateFilter->SetForegroundValue(1);
-    DilateFilter->SetDilateValue(1);
-    DilateFilter->SetBackgroundValue(0);
-    DilateFilter->SetInput(LargestFilter->GetOutput());
-    DilateFilter->SetKernel(dilateBall);
-    DilateFilter->Update();
-
-    // ErodeFilter->SetForegroundValue(1);
-    ErodeFilter->SetErodeValue(1);
-    ErodeFilter->SetBackgroundValue(0);
-    ErodeFilter->SetInput(DilateFilter->GetOutput());
-    ErodeFilter->SetKernel(erodeBall);
-    ErodeFilter->Update();
   }
 
-  // silence warnings by converting the size to index
-  typename IntegerImageType::IndexType IndImageSize;
-  for (unsigned int _i = 0; _i < IntegerImageType::ImageDimension; ++_i)
+  // Closing:  dilate the largest object, then erode it by dilating its complement.
+  typename IntegerImageType::Pointer closedMask = nullptr;
   {
-    IndImageSize[_i] = static_cast<typename IntegerImageType::IndexValueType>(
-      ErodeFilter->GetOutput()->GetLargestPossibleRegion().GetSize()[_i]);
+    typename IntegerImageType::Pointer dilatedMask = this->DistanceMapDilate(
+      LargestFilter->GetOutput(), this->m_OutsideValue, m_ClosingSize, this->m_InsideValue, this->m_OutsideValue);
+    closedMask = this->DistanceMapDilate(
+      dilatedMask, this->m_InsideValue, m_ClosingSize, this->m_OutsideValue, this->m_InsideValue);
   }
+
+  // Fill the holes:  label the connected background regions with the
+  // multi-threaded union-find ConnectedComponentImageFilter, and keep as
+  // background only the regions touching a corner of the image.
   // NOTE:  The most robust way to do this would be to find the largest
   // background labeled image, and then choose one of those locations as the
   // seed.
   // For now just choose all the corners as seed points
-  using seededConnectedThresholdFilterType = ConnectedThresholdImageFilter<IntegerImageType, IntegerImageType>;
-  typename seededConnectedThresholdFilterType::Pointer seededConnectedThresholdFilter =
-    seededConnectedThresholdFilterType::New();
-
-  {
-    const typename IntegerImageType::IndexType SeedLocation = { { 0, 0, 0 } };
-    seededConnectedThresholdFilter->SetSeed(SeedLocation);
-  }
-  {
-    const typename IntegerImageType::IndexType SeedLocation = { { IndImageSize[0] - 1, 0, 0 } };
-    seededConnectedThresholdFilter->SetSeed(SeedLocation);
-  }
-  {
-    const typename IntegerImageType::IndexType SeedLocation = { { 0, IndImageSize[1] - 1, 0 } };
-    seededConnectedThresholdFilter->SetSeed(SeedLocation);
-  }
+  using BackgroundLabelImageType = Image<unsigned int, IntegerImageType::ImageDimension>;
+  using BackgroundThresholdType = BinaryThresholdImageFilter<IntegerImageType, IntegerImageType>;
+  typename BackgroundThresholdType::Pointer backgroundThreshold = BackgroundThresholdType::New();
+  backgroundThreshold->SetInput(closedMask);
+  backgroundThreshold->SetInsideValue(1);
+  backgroundThreshold->SetOutsideValue(0);
+  backgroundThreshold->SetLowerThreshold(this->m_OutsideValue);
+  backgroundThreshold->SetUpperThreshold(this->m_OutsideValue);
+
+  using BackgroundComponentsType = ConnectedComponentImageFilter<IntegerImageType, BackgroundLabelImageType>;
+  typename BackgroundComponentsType::Pointer backgroundComponents = BackgroundComponentsType::New();
+  backgroundComponents->SetInput(backgroundThreshold->GetOutput());
+  backgroundComponents->SetFullyConnected(false);
+  backgroundComponents->Update();
+
+  std::vector<typename BackgroundLabelImageType::PixelType> cornerLabels;
   {
-    const typename IntegerImageType::IndexType SeedLocation = { { IndImageSize[0] - 1, IndImageSize[1] - 1, 0 } };
-    seededConnectedThresholdFilter->SetSeed(SeedLocation);
-  }
-  {
-    const typename IntegerImageType::IndexType SeedLocation = { { 0, 0, IndImageSize[2] - 1 } };
-    seededConnectedThresholdFilter->SetSeed(SeedLocation);
-  }
-  {
-    const typename IntegerImageType::IndexType SeedLocation = { { IndImageSize[0] - 1, 0, IndImageSize[2] - 1 } };
-    seededConnectedThresholdFilter->SetSeed(SeedLocation);
-  }
-  {
-    const typename IntegerImageType::IndexType SeedLocation = { { 0, IndImageSize[1] - 1, IndImageSize[2] - 1 } };
-    seededConnectedThresholdFilter->SetSeed(SeedLocation);
-  }
-  {
-    const typename IntegerImageType::IndexType SeedLocation = {
-      { IndImageSize[0] - 1, IndImageSize[1] - 1, IndImageSize[2] - 1 }
-    };
-    seededConnectedThresholdFilter->SetSeed(SeedLocation);
+    const typename BackgroundLabelImageType::RegionType labelRegion =
+      backgroundComponents->GetOutput()->GetLargestPossibleRegion();
+    for (unsigned int corner = 0; corner < (1U << BackgroundLabelImageType::ImageDimension); ++corner)
+    {
+      typename BackgroundLabelImageType::IndexType cornerIndex = labelRegion.GetIndex();
+      for (unsigned int d = 0; d < BackgroundLabelImageType::ImageDimension; ++d)
+      {
+        if (corner & (1U << d))
+        {
+          cornerIndex[d] += static_cast<IndexValueType>(labelRegion.GetSize()[d]) - 1;
+        }
+      }
+      const typename BackgroundLabelImageType::PixelType label =
+        backgroundComponents->GetOutput()->GetPixel(cornerIndex);
+      if (label != 0 && std::find(cornerLabels.begin(), cornerLabels.end(), label) == cornerLabels.end())
+      {
+        cornerLabels.push_back(label);
+      }
+    }
   }
 
-  seededConnectedThresholdFilter->SetReplaceValue(100);
-  seededConnectedThresholdFilter->SetUpper(0);
-  seededConnectedThresholdFilter->SetLower(0);
-  seededConnectedThresholdFilter->SetInput(ErodeFilter->GetOutput());
-  seededConnectedThresholdFilter->Update();
-
   typename IntegerImageType::Pointer dilateMask = nullptr;
   {
-    typename ThresholdFilterType::Pointer FinalThreshold = ThresholdFilterType::New();
-    FinalThreshold->SetInput(seededConnectedThresholdFilter->GetOutput());
-    FinalThreshold->SetInsideValue(this->m_OutsideValue);
-    FinalThreshold->SetOutsideValue(this->m_InsideValue);
-    FinalThreshold->SetLowerThreshold(100);
-    FinalThreshold->SetUpperThreshold(100);
-    FinalThreshold->Update();
+    const IntegerPixelType insideValue = this->m_InsideValue;
+    const IntegerPixelType outsideValue = this->m_OutsideValue;
+    using FillType = UnaryGeneratorImageFilter<BackgroundLabelImageType, IntegerImageType>;
+    typename FillType::Pointer fill = FillType::New();
+    fill->SetInput(backgroundComponents->GetOutput());
+    fill->SetFunctor([cornerLabels, insideValue, outsideValue](
+                       const typename BackgroundLabelImageType::PixelType label) -> IntegerPixelType {
+      return (std::find(cornerLabels.begin(), cornerLabels.end(), label) != cornerLabels.end()) ? outsideValue
+                                                                                                : insideValue;
+    });
+    fill->Update();
 
     if (m_DilateSize > 0.0)
     {
       // Dilate to get some background to better drive BSplineRegistration
-      using DilateType = itk::BinaryDilateImageFilter<IntegerImageType, IntegerImageType, myKernelType>;
-
-      myKernelType                    dilateBall;
-      typename myKernelType::SizeType dilateBallSize;
-      for (unsigned int d = 0; d < 3; ++d)
-      {
-        const unsigned int DilateVoxels =
-          itk::Math::ceil(m_DilateSize / (FinalThreshold->GetOutput()->GetSpacing()[d]));
-        dilateBallSize[d] = DilateVoxels;
-      }
-      dilateBall.SetRadius(dilateBallSize);
-      dilateBall.CreateStructuringElement();
-
-      typename DilateType::Pointer dil = DilateType::New();
-      dil->SetDilateValue(this->m_InsideValue);
-      dil->SetKernel(dilateBall);
-      dil->SetInput(FinalThreshold->GetOutput());
-      dil->Update();
-      dilateMask = dil->GetOutput();
+      dilateMask = this->DistanceMapDilate(
+        fill->GetOutput(), this->m_OutsideValue, m_DilateSize, this->m_InsideValue, this->m_OutsideValue);
     }
     else
     {
-      dilateMask = FinalThreshold->GetOutput();
+      dilateMask = fill->GetOutput();
     }
   }
 
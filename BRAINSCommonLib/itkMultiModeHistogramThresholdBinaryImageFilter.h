@@ -29,8 +29,12 @@ namespace itk
 /**
  * \author Hans J. Johnson
  *
- * This filter
+ * This filter intersects one intensity threshold mask per input, with
+ * the thresholds chosen from the histogram quantiles of that input.
  *
+ * The intensity range and histogram of every input are gathered in shared
+ * multi-threaded sweeps with per-thread bins, and the per-input threshold
+ * masks are intersected directly into the output in one fused pass.
  */
 template <typename TInputImage, typename TOutputImage = Image<unsigned short, TInputImage::ImageDimension>>
 class MultiModeHistogramThresholdBinaryImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
@@ -77,6 +81,11 @@ public:
   itkGetConstObjectMacro(BinaryPortionImage, IntegerImageType);
   itkSetObjectMacro(BinaryPortionImage, IntegerImageType);
 
+  /** The intensity thresholds the quantiles of every input map to, set by
+   * Update().  Voxels of input j in [lower[j], upper[j]] are inside. */
+  itkGetConstReferenceMacro(LowerIntensityThresholds, ThresholdArrayType);
+  itkGetConstReferenceMacro(UpperIntensityThresholds, ThresholdArrayType);
+
   itkSetMacro(InsideValue, IntegerPixelType);
   itkGetConstMacro(InsideValue, IntegerPixelType);
   itkSetMacro(OutsideValue, IntegerPixelType);
@@ -88,6 +97,10 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** The histograms need all of every input. */
+  void
+  GenerateInputRequestedRegion() override;
+
   void
   GenerateData() override;
 
@@ -95,6 +108,8 @@ private:
   ThresholdArrayType m_QuantileLowerThreshold;
   ThresholdArrayType m_QuantileUpperThreshold;
   double             m_LinearQuantileThreshold{ 0.01 };
+  ThresholdArrayType m_LowerIntensityThresholds;
+  ThresholdArrayType m_UpperIntensityThresholds;
 
   typename IntegerImageType::Pointer m_BinaryPortionImage;
 
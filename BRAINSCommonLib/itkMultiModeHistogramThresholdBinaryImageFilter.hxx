@@ -19,12 +19,13 @@
 #include "itkMultiModeHistogramThresholdBinaryImageFilter.h"
 #include "itkComputeHistogramQuantileThresholds.h"
 
-#include <itkBinaryThresholdImageFilter.h>
-#include <itkMultiplyImageFilter.h>
-
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
 #include <itkNumericTraits.h>
-#include <itkMinimumMaximumImageFilter.h>
-#include <itkCastImageFilter.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
 
 namespace itk
 {
@@ -59,30 +60,153 @@ MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>::PrintSe
      << "OutsideValue " << m_OutsideValue << std::endl;
 }
 
+template <typename TInputImage, typename TOutputImage>
+void
+MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  for (unsigned int j = 0; j < this->GetNumberOfInputs(); ++j)
+  {
+    auto * input = const_cast<InputImageType *>(this->GetInput(j));
+    if (input != nullptr)
+    {
+      input->SetRequestedRegionToLargestPossibleRegion();
+    }
+  }
+}
+
 template <typename TInputImage, typename TOutputImage>
 void
 MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>::GenerateData()
 {
   this->AllocateOutputs();
 
-  typename IntegerImageType::Pointer accumulate = IntegerImageType::New();
-
   const unsigned int NumInputs = this->GetNumberOfInputs();
+
+  std::vector<const InputImageType *> inputs(NumInputs);
+  for (unsigned int j = 0; j < NumInputs; ++j)
+  {
+    inputs[j] = this->GetInput(j);
+    if (inputs[j]->GetLargestPossibleRegion().GetSize() != inputs[0]->GetLargestPossibleRegion().GetSize())
+    {
+      itkExceptionMacro(<< "Image data size mismatch " << inputs[0]->GetLargestPossibleRegion().GetSize()
+                        << " != " << inputs[j]->GetLargestPossibleRegion().GetSize() << "." << std::endl);
+    }
+    if (inputs[j]->GetSpacing() != inputs[0]->GetSpacing())
+    {
+      itkExceptionMacro(<< "Image data spacing mismatch " << inputs[0]->GetSpacing()
+                        << " != " << inputs[j]->GetSpacing() << "." << std::endl);
+    }
+    if (inputs[j]->GetDirection() != inputs[0]->GetDirection())
+    {
+      itkExceptionMacro(<< "Image data spacing mismatch " << inputs[0]->GetDirection()
+                        << " != " << inputs[j]->GetDirection() << "." << std::endl);
+    }
+    if (inputs[j]->GetOrigin() != inputs[0]->GetOrigin())
+    {
+      itkExceptionMacro(<< "Image data spacing mismatch " << inputs[0]->GetOrigin()
+                        << " != " << inputs[j]->GetOrigin() << "." << std::endl);
+    }
+  }
+  const IntegerImageType *   portionImage = this->m_BinaryPortionImage.GetPointer();
+  const IntegerPixelType     portionValue = NumericTraits<IntegerPixelType>::OneValue();
+  const InputImageRegionType wholeRegion = inputs[0]->GetLargestPossibleRegion();
+  MultiThreaderBase *        threader = this->GetMultiThreader();
+  std::mutex                 mergeMutex;
+
+  // Sweep 1: the intensity range of every input.
+  std::vector<InputPixelType> imageMin(NumInputs, NumericTraits<InputPixelType>::max());
+  std::vector<InputPixelType> imageMax(NumInputs, NumericTraits<InputPixelType>::NonpositiveMin());
+  threader->template ParallelizeImageRegion<InputImageDimension>(
+    wholeRegion,
+    [&](const InputImageRegionType & region) {
+      for (unsigned int j = 0; j < NumInputs; ++j)
+      {
+        InputPixelType localMin = NumericTraits<InputPixelType>::max();
+        InputPixelType localMax = NumericTraits<InputPixelType>::NonpositiveMin();
+        for (ImageRegionConstIterator<InputImageType> it(inputs[j], region); !it.IsAtEnd(); ++it)
+        {
+          const InputPixelType value = it.Get();
+          localMin = std::min(localMin, value);
+          localMax = std::max(localMax, value);
+        }
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        imageMin[j] = std::min(imageMin[j], localMin);
+        imageMax[j] = std::max(imageMax[j], localMax);
+      }
+    },
+    nullptr);
+
+  // Sweep 2: the histograms of all inputs, one bin per intensity unit over
+  // [min, max], restricted to the binary portion image when one is set.
+  std::vector<SizeValueType>              numberOfBins(NumInputs);
+  std::vector<double>                     binsPerIntensity(NumInputs);
+  std::vector<std::vector<SizeValueType>> frequencies(NumInputs);
+  for (unsigned int j = 0; j < NumInputs; ++j)
+  {
+    numberOfBins[j] = static_cast<unsigned int>(imageMax[j] - imageMin[j] + 1);
+    const double range = static_cast<double>(imageMax[j]) - static_cast<double>(imageMin[j]);
+    binsPerIntensity[j] = (range > 0.0) ? numberOfBins[j] / range : 0.0;
+    frequencies[j].assign(numberOfBins[j], 0);
+  }
+  threader->template ParallelizeImageRegion<InputImageDimension>(
+    wholeRegion,
+    [&](const InputImageRegionType & region) {
+      for (unsigned int j = 0; j < NumInputs; ++j)
+      {
+        std::vector<SizeValueType> localFrequencies(numberOfBins[j], 0);
+        const double               minValue = imageMin[j];
+        const auto                 lastBin = static_cast<double>(numberOfBins[j] - 1);
+        for (ImageRegionConstIterator<InputImageType> it(inputs[j], region); !it.IsAtEnd(); ++it)
+        {
+          if (portionImage != nullptr && portionImage->GetPixel(it.GetIndex()) != portionValue)
+          {
+            continue;
+          }
+          const double bin = (static_cast<double>(it.Get()) - minValue) * binsPerIntensity[j];
+          ++localFrequencies[static_cast<SizeValueType>(std::min(std::max(bin, 0.0), lastBin))];
+        }
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        for (SizeValueType b = 0; b < numberOfBins[j]; ++b)
+        {
+          frequencies[j][b] += localFrequencies[b];
+        }
+      }
+    },
+    nullptr);
+
+  std::vector<InputPixelType> lowerThresholds(NumInputs);
+  std::vector<InputPixelType> upperThresholds(NumInputs);
+  m_LowerIntensityThresholds.SetSize(NumInputs);
+  m_UpperIntensityThresholds.SetSize(NumInputs);
   for (unsigned int j = 0; j < NumInputs; ++j)
   {
     // Compute the quantile regions for linearizing the percentages.
     using ImageCalcType = ComputeHistogramQuantileThresholds<TInputImage, TOutputImage>;
-    typename ImageCalcType::Pointer ImageCalc = ImageCalcType::New();
-    ImageCalc->SetImage(this->GetInput(j));
+    using HistogramType = typename ImageCalcType::HistogramType;
+    typename HistogramType::Pointer               histogram = HistogramType::New();
+    typename HistogramType::SizeType              size(1);
+    typename HistogramType::MeasurementVectorType lowerBound(1);
+    typename HistogramType::MeasurementVectorType upperBound(1);
+    size[0] = numberOfBins[j];
+    lowerBound[0] = imageMin[j];
+    upperBound[0] = imageMax[j];
+    histogram->SetMeasurementVectorSize(1);
+    histogram->Initialize(size, lowerBound, upperBound);
+    for (SizeValueType b = 0; b < numberOfBins[j]; ++b)
+    {
+      histogram->SetFrequency(b, frequencies[j][b]);
+    }
+    frequencies[j].clear();
 
+    typename ImageCalcType::Pointer ImageCalc = ImageCalcType::New();
     ImageCalc->SetQuantileLowerThreshold(m_LinearQuantileThreshold);
     ImageCalc->SetQuantileUpperThreshold(1.0 - m_LinearQuantileThreshold);
 
     std::cout << "Quantile Thresholds: [ " << m_QuantileLowerThreshold.GetElement(j) << ", "
               << m_QuantileUpperThreshold.GetElement(j) << " ]" << std::endl;
 
-    ImageCalc->SetBinaryPortionImage(this->m_BinaryPortionImage);
-    ImageCalc->Calculate();
+    ImageCalc->CalculateFromHistogram(histogram, imageMin[j], imageMax[j]);
 
     const typename InputImageType::PixelType thresholdLowerLinearRegion = ImageCalc->GetLowerIntensityThresholdValue();
     const typename InputImageType::PixelType thresholdUpperLinearRegion = ImageCalc->GetUpperIntensityThresholdValue();
@@ -103,11 +227,6 @@ MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>::Generat
     std::cout << "LowHigh Thresholds: [ " << thresholdLowerLinearRegion << ", " << thresholdLowerLinearRegion_foreground
               << ", " << thresholdUpperLinearRegion << " ]" << std::endl;
 
-    using ThresholdFilterType = BinaryThresholdImageFilter<InputImageType, IntegerImageType>;
-    typename ThresholdFilterType::Pointer threshold = ThresholdFilterType::New();
-    threshold->SetInput(this->GetInput(j));
-    threshold->SetInsideValue(this->m_InsideValue);
-    threshold->SetOutsideValue(this->m_OutsideValue);
     typename InputImageType::PixelType intensity_thresholdLowerLinearRegion;
     typename InputImageType::PixelType intensity_thresholdUpperLinearRegion;
     if (m_QuantileLowerThreshold.GetElement(j) < m_LinearQuantileThreshold)
@@ -145,57 +264,37 @@ MultiModeHistogramThresholdBinaryImageFilter<TInputImage, TOutputImage>::Generat
               << std::endl;
     std::cout << "DEBUG:RANGE:DEBUG:  [" << intensity_thresholdLowerLinearRegion << ","
               << intensity_thresholdUpperLinearRegion << "]" << std::endl;
-    threshold->SetLowerThreshold(intensity_thresholdLowerLinearRegion);
-    threshold->SetUpperThreshold(intensity_thresholdUpperLinearRegion);
-    // threshold->SetUpperThreshold( NumericTraits<typename
-    // InputImageType::PixelType>::max() );
-    threshold->Update();
-    typename IntegerImageType::Pointer thresholdImage = threshold->GetOutput();
-
-    if (j == 0)
-    {
-      accumulate = thresholdImage;
-    }
-    else
-    {
-      using IntersectMasksFilterType = MultiplyImageFilter<IntegerImageType, IntegerImageType>;
-      if (accumulate->GetLargestPossibleRegion().GetSize() != thresholdImage->GetLargestPossibleRegion().GetSize())
-      {
-        itkExceptionMacro(<< "Image data size mismatch " << accumulate->GetLargestPossibleRegion().GetSize()
-                          << " != " << thresholdImage->GetLargestPossibleRegion().GetSize() << "." << std::endl);
-      }
-      if (accumulate->GetSpacing() != thresholdImage->GetSpacing())
-      {
-        itkExceptionMacro(<< "Image data spacing mismatch " << accumulate->GetSpacing()
-                          << " != " << thresholdImage->GetSpacing() << "." << std::endl);
-      }
-      if (accumulate->GetDirection() != thresholdImage->GetDirection())
+    lowerThresholds[j] = intensity_thresholdLowerLinearRegion;
+    upperThresholds[j] = intensity_thresholdUpperLinearRegion;
+    m_LowerIntensityThresholds[j] = intensity_thresholdLowerLinearRegion;
+    m_UpperIntensityThresholds[j] = intensity_thresholdUpperLinearRegion;
+  }
+
+  // Fused pass: threshold every input and intersect the masks, as the product
+  // of the per input inside/outside values, straight into the output.
+  OutputImageType * output = this->GetOutput();
+  threader->template ParallelizeImageRegion<OutputImageDimension>(
+    output->GetRequestedRegion(),
+    [&](const OutputImageRegionType & region) {
+      std::vector<ImageRegionConstIterator<InputImageType>> inputIts;
+      for (unsigned int j = 0; j < NumInputs; ++j)
       {
-        itkExceptionMacro(<< "Image data spacing mismatch " << accumulate->GetDirection()
-                          << " != " << thresholdImage->GetDirection() << "." << std::endl);
+        inputIts.emplace_back(inputs[j], region);
       }
-      if (accumulate->GetOrigin() != thresholdImage->GetOrigin())
+      for (ImageRegionIterator<OutputImageType> outIt(output, region); !outIt.IsAtEnd(); ++outIt)
       {
-        itkExceptionMacro(<< "Image data spacing mismatch " << accumulate->GetOrigin()
-                          << " != " << thresholdImage->GetOrigin() << "." << std::endl);
+        IntegerPixelType accumulate = NumericTraits<IntegerPixelType>::OneValue();
+        for (unsigned int j = 0; j < NumInputs; ++j)
+        {
+          const InputPixelType value = inputIts[j].Get();
+          ++inputIts[j];
+          const IntegerPixelType mask =
+            (lowerThresholds[j] <= value && value <= upperThresholds[j]) ? this->m_InsideValue : this->m_OutsideValue;
+          accumulate = (j == 0) ? mask : static_cast<IntegerPixelType>(accumulate * mask);
+        }
+        outIt.Set(static_cast<OutputPixelType>(accumulate));
       }
-      typename IntersectMasksFilterType::Pointer intersect = IntersectMasksFilterType::New();
-      intersect->SetInput1(accumulate);
-      intersect->SetInput2(thresholdImage);
-      intersect->Update();
-      accumulate = intersect->GetOutput();
-    }
-  }
-
-  using outputCasterType = CastImageFilter<IntegerImageType, OutputImageType>;
-  typename outputCasterType::Pointer outputCaster = outputCasterType::New();
-  outputCaster->SetInput(accumulate);
-
-  outputCaster->GraftOutput(this->GetOutput());
-  outputCaster->Update();
-  this->GraftOutput(outputCaster->GetOutput());
-  //  typename OutputImageType::Pointer outputMaskImage =
-  // outputCaster->GetOutput();
-  //  return outputMaskImage;
+    },
+    nullptr);
 }
 } // namespace itk
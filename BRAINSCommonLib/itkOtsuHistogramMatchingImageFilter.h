@@ -41,6 +41,9 @@
 #include "BRAINSTypes.h"
 #include "vnl/vnl_matrix.h"
 
+#include <type_traits>
+#include <vector>
+
 namespace itk
 {
 /** \class OtsuHistogramMatchingImageFilter
@@ -72,6 +75,12 @@ namespace itk
  * type and that the input and output image type have the same number of
  * dimension and have scalar pixel types.
  *
+ * The piecewise linear mapping is compiled once per update: into a table
+ * indexed by pixel value for 8 and 16 bit integral pixel types, and into
+ * a sorted breakpoint array searched without branches otherwise.  Both
+ * give the same values as the original scan of the match points, which
+ * can still be selected with UseIntensityLookupOff().
+ *
  * \ingroup IntensityImageFilters Multithreaded
  *
  */
@@ -151,6 +160,12 @@ public:
   itkSetMacro(NumberOfMatchPoints, unsigned long);
   itkGetConstMacro(NumberOfMatchPoints, unsigned long);
 
+  /** Set/Get whether the mapping is compiled into a lookup structure
+   * (default) or evaluated by scanning the match points for every pixel. */
+  itkSetMacro(UseIntensityLookup, bool);
+  itkGetConstMacro(UseIntensityLookup, bool);
+  itkBooleanMacro(UseIntensityLookup);
+
   /** This filter requires all of the input to be in the buffer. */
   void
   GenerateInputRequestedRegion() override;
@@ -196,7 +211,7 @@ protected:
   AfterThreadedGenerateData() override;
 
   void
-  ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread, ThreadIdType threadId) override;
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
 
   /** Compute min, max and mean of an image. */
   void
@@ -217,6 +232,7 @@ private:
   unsigned long m_NumberOfHistogramLevels{ 256 };
   unsigned long m_NumberOfMatchPoints{ 1 };
   bool          m_ThresholdAtMeanIntensity;
+  bool          m_UseIntensityLookup{ true };
 
   InputPixelType  m_SourceIntensityThreshold;
   InputPixelType  m_ReferenceIntensityThreshold;
@@ -246,6 +262,45 @@ private:
 
   typename SpatialObjectType::Pointer m_SourceMask;
   typename SpatialObjectType::Pointer m_ReferenceMask;
+
+  /** Pixel types small enough to map through a table of every value. */
+  using UseLookupTableType =
+    std::integral_constant<bool, std::is_integral<InputPixelType>::value && sizeof(InputPixelType) <= 2>;
+
+  /** Fill the segment and breakpoint arrays from the quantile table. */
+  void
+  CompileIntensityMapping();
+
+  void
+  CompileLookupTable(std::true_type);
+  void
+  CompileLookupTable(std::false_type)
+  {}
+
+  /** Index of the segment containing srcValue: the number of source
+   * breakpoints that srcValue is not less than.  NaN maps to the last
+   * segment, as in ScanMatchPoints(). */
+  unsigned int
+  FindSegment(const double srcValue) const;
+
+  /** The original per pixel mapping, scanning the quantile table in order.
+   * Used when the mapping is not compiled, and as the reference for it. */
+  double
+  ScanMatchPoints(const double srcValue) const;
+
+  double
+  MapThroughSegment(const unsigned int segment, const double srcValue) const
+  {
+    return m_SegmentBase[segment] + (srcValue - m_SegmentOrigin[segment]) * m_SegmentSlope[segment];
+  }
+
+  std::vector<double>          m_SourceBreakpoints;
+  bool                         m_SourceBreakpointsSorted{ true };
+  std::vector<double>          m_SegmentOrigin;
+  std::vector<double>          m_SegmentBase;
+  std::vector<double>          m_SegmentSlope;
+  std::vector<OutputPixelType> m_LookupTable;
+  long long                    m_LookupTableOffset{ 0 };
 };
 } // end namespace itk
 
@@ -34,7 +34,10 @@
 #include "itkOtsuHistogramMatchingImageFilter.h"
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
+#include "itkImageScanlineConstIterator.h"
 #include "itkNumericTraits.h"
+#include <algorithm>
+#include <limits>
 #include <vector>
 
 #include "BRAINSFitUtils.h"
@@ -54,7 +57,6 @@ OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasuremen
   , m_SourceMask(nullptr)
   , m_ReferenceMask(nullptr)
 {
-  this->DynamicMultiThreadingOff(); // NEEDED FOR ITKv5 backwards compatibility
   this->SetNumberOfRequiredInputs(2);
 
   m_QuantileTable.set_size(3, m_NumberOfMatchPoints + 2);
@@ -98,6 +100,8 @@ OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasuremen
   os << m_LowerGradient << std::endl;
   os << indent << "UpperGradient: ";
   os << m_UpperGradient << std::endl;
+  os << indent << "UseIntensityLookup: ";
+  os << m_UseIntensityLookup << std::endl;
 }
 
 /*
@@ -231,6 +235,110 @@ OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasuremen
       m_UpperGradient = 0.0;
     }
   }
+
+  this->CompileIntensityMapping();
+}
+
+/**
+ * Segment j maps the source values in [ breakpoint[j-1], breakpoint[j] ),
+ * segment 0 the values below the first and the last segment the values
+ * from the last breakpoint on.
+ */
+template <typename TInputImage, typename TOutputImage, typename THistogramMeasurement>
+void
+OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasurement>::CompileIntensityMapping()
+{
+  const unsigned int numberOfBreakpoints = m_NumberOfMatchPoints + 2;
+  m_SourceBreakpoints.resize(numberOfBreakpoints);
+  for (unsigned int j = 0; j < numberOfBreakpoints; ++j)
+  {
+    m_SourceBreakpoints[j] = m_QuantileTable[0][j];
+  }
+  m_SourceBreakpointsSorted = std::is_sorted(m_SourceBreakpoints.begin(), m_SourceBreakpoints.end());
+
+  m_SegmentOrigin.resize(numberOfBreakpoints + 1);
+  m_SegmentBase.resize(numberOfBreakpoints + 1);
+  m_SegmentSlope.resize(numberOfBreakpoints + 1);
+  m_SegmentOrigin[0] = m_SourceMinValue;
+  m_SegmentBase[0] = m_ReferenceMinValue;
+  m_SegmentSlope[0] = m_LowerGradient;
+  for (unsigned int j = 1; j < numberOfBreakpoints; ++j)
+  {
+    m_SegmentOrigin[j] = m_QuantileTable[0][j - 1];
+    m_SegmentBase[j] = m_QuantileTable[1][j - 1];
+    m_SegmentSlope[j] = m_Gradients[j - 1];
+  }
+  m_SegmentOrigin[numberOfBreakpoints] = m_SourceMaxValue;
+  m_SegmentBase[numberOfBreakpoints] = m_ReferenceMaxValue;
+  m_SegmentSlope[numberOfBreakpoints] = m_UpperGradient;
+
+  m_LookupTable.clear();
+  if (m_UseIntensityLookup && m_SourceBreakpointsSorted)
+  {
+    this->CompileLookupTable(UseLookupTableType());
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename THistogramMeasurement>
+void
+OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasurement>::CompileLookupTable(std::true_type)
+{
+  const auto lowest = static_cast<long long>(std::numeric_limits<InputPixelType>::lowest());
+  const auto highest = static_cast<long long>(std::numeric_limits<InputPixelType>::max());
+  m_LookupTableOffset = lowest;
+  m_LookupTable.resize(static_cast<size_t>(highest - lowest + 1));
+  for (long long value = lowest; value <= highest; ++value)
+  {
+    m_LookupTable[static_cast<size_t>(value - lowest)] =
+      static_cast<OutputPixelType>(this->MapThroughSegment(this->FindSegment(value), static_cast<double>(value)));
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename THistogramMeasurement>
+unsigned int
+OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasurement>::FindSegment(
+  const double srcValue) const
+{
+  // Branchless upper bound, the loop count only depends on the table size.
+  // The tests are written as !(srcValue < breakpoint) so that NaN, like in
+  // the scan, passes every breakpoint.
+  const double * first = m_SourceBreakpoints.data();
+  size_t         length = m_SourceBreakpoints.size();
+  while (length > 1)
+  {
+    const size_t half = length / 2;
+    first = !(srcValue < first[half]) ? first + half : first;
+    length -= half;
+  }
+  return static_cast<unsigned int>(first - m_SourceBreakpoints.data()) + (!(srcValue < *first) ? 1U : 0U);
+}
+
+template <typename TInputImage, typename TOutputImage, typename THistogramMeasurement>
+double
+OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasurement>::ScanMatchPoints(
+  const double srcValue) const
+{
+  unsigned int j = 0;
+  for (; j < m_NumberOfMatchPoints + 2; ++j)
+  {
+    if (srcValue < m_QuantileTable[0][j])
+    {
+      break;
+    }
+  }
+
+  if (j == 0)
+  {
+    // Linear interpolate from min to point[0]
+    return m_ReferenceMinValue + (srcValue - m_SourceMinValue) * m_LowerGradient;
+  }
+  if (j == m_NumberOfMatchPoints + 2)
+  {
+    // Linear interpolate from point[m_NumberOfMatchPoints+1] to max
+    return m_ReferenceMaxValue + (srcValue - m_SourceMaxValue) * m_UpperGradient;
+  }
+  // Linear interpolate from point[j] and point[j+1].
+  return m_QuantileTable[1][j - 1] + (srcValue - m_QuantileTable[0][j - 1]) * m_Gradients[j - 1];
 }
 
 /**
@@ -268,76 +376,49 @@ OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasuremen
  */
 template <typename TInputImage, typename TOutputImage, typename THistogramMeasurement>
 void
-OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasurement>::ThreadedGenerateData(
-  const OutputImageRegionType & outputRegionForThread,
-  ThreadIdType                  threadId)
+OtsuHistogramMatchingImageFilter<TInputImage, TOutputImage, THistogramMeasurement>::DynamicThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread)
 {
-  // Get the input and output pointers;
-  InputImageConstPointer input = this->GetInput();
-  OutputImagePointer     output = this->GetOutput();
-
-  // Transform the source image and write to output.
-  using InputConstIterator = ImageRegionConstIterator<InputImageType>;
-  using OutputIterator = ImageRegionIterator<OutputImageType>;
-
-  InputConstIterator inIter(input, outputRegionForThread);
-
-  OutputIterator outIter(output, outputRegionForThread);
-
-  // support progress methods/callbacks
-  unsigned long updateVisits = 0;
-  unsigned long totalPixels = 0;
-  if (threadId == 0)
+  const InputImageType * input = this->GetInput();
+  OutputImageType *      output = this->GetOutput();
+  if (outputRegionForThread.GetNumberOfPixels() == 0)
   {
-    totalPixels = outputRegionForThread.GetNumberOfPixels();
-    updateVisits = totalPixels / 10;
-    if (updateVisits < 1)
-    {
-      updateVisits = 1;
-    }
+    return;
   }
-  for (int i = 0; !outIter.IsAtEnd(); ++inIter, ++outIter, ++i)
-  {
-    if (threadId == 0 && !(i % updateVisits))
-    {
-      this->UpdateProgress((float)i / (float)totalPixels);
-    }
-
-    const auto srcValue = static_cast<double>(inIter.Get());
 
+  // Transform the source image one scanline at a time.
+  const SizeValueType                        lineLength = outputRegionForThread.GetSize(0);
+  ImageScanlineConstIterator<InputImageType> lineIter(input, outputRegionForThread);
+  const bool useLookupTable = m_UseIntensityLookup && !m_LookupTable.empty();
+  const bool useSearch = m_UseIntensityLookup && m_SourceBreakpointsSorted;
+  while (!lineIter.IsAtEnd())
+  {
+    const InputPixelType * inLine = input->GetBufferPointer() + input->ComputeOffset(lineIter.GetIndex());
+    OutputPixelType *      outLine = output->GetBufferPointer() + output->ComputeOffset(lineIter.GetIndex());
+    if (useLookupTable)
     {
-      unsigned int j = 0;
-      for (; j < m_NumberOfMatchPoints + 2; ++j)
+      const OutputPixelType * table = m_LookupTable.data();
+      for (SizeValueType i = 0; i < lineLength; ++i)
       {
-        if (srcValue < m_QuantileTable[0][j])
-        {
-          break;
-        }
+        outLine[i] = table[static_cast<long long>(inLine[i]) - m_LookupTableOffset];
       }
-
-      double mappedValue;
-      if (j == 0)
-      {
-        // Linear interpolate from min to point[0]
-        mappedValue = m_ReferenceMinValue + (srcValue - m_SourceMinValue) * m_LowerGradient;
-      }
-      else if (j == m_NumberOfMatchPoints + 2)
+    }
+    else if (useSearch)
+    {
+      for (SizeValueType i = 0; i < lineLength; ++i)
       {
-        // Linear interpolate from point[m_NumberOfMatchPoints+1] to max
-        mappedValue = m_ReferenceMaxValue + (srcValue - m_SourceMaxValue) * m_UpperGradient;
+        const auto srcValue = static_cast<double>(inLine[i]);
+        outLine[i] = static_cast<OutputPixelType>(this->MapThroughSegment(this->FindSegment(srcValue), srcValue));
       }
-      else
+    }
+    else
+    {
+      for (SizeValueType i = 0; i < lineLength; ++i)
       {
-        // Linear interpolate from point[j] and point[j+1].
-        mappedValue = m_QuantileTable[1][j - 1] + (srcValue - m_QuantileTable[0][j - 1]) * m_Gradients[j - 1];
+        outLine[i] = static_cast<OutputPixelType>(this->ScanMatchPoints(static_cast<double>(inLine[i])));
       }
-
-      // Clamp values to the min/max of the source histogram range (the values
-      // are supposed to be aligned anyway)
-      //      mappedValue=std::max(mappedValue,(double)m_SourceMinValue);
-      //      mappedValue=std::min(mappedValue,(double)m_SourceMaxValue);
-      outIter.Set(static_cast<OutputPixelType>(mappedValue));
     }
+    lineIter.NextLine();
   }
 }
 
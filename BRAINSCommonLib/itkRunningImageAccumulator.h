@@ -0,0 +1,123 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRunningImageAccumulator_h
+#define __itkRunningImageAccumulator_h
+
+#include <itkImage.h>
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+
+namespace itk
+{
+/** \class RunningImageAccumulator
+ *
+ * \brief Voxelwise mean and variance of a stream of images that are
+ * added one at a time.
+ *
+ * Only the running state is kept (a compensated sum, and the sum of
+ * squared deviations when variance is requested), so memory does not
+ * depend on the number of images.  The sum uses Neumaier's compensated
+ * summation, and the squared deviations are updated with Welford's
+ * recurrence from the compensated running mean, so averaging hundreds of
+ * images does not lose precision to round off.  Each AddImage() is
+ * multi-threaded over the image region.
+ *
+ * All images must have the same LargestPossibleRegion as the first one,
+ * which also provides the meta information of the outputs.
+ *
+ * \sa ImageFileReducer
+ * \ingroup ITKBRAINSFilterPack
+ */
+template <typename TInputImage, typename TOutputImage = Image<float, TInputImage::ImageDimension>>
+class RunningImageAccumulator : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(RunningImageAccumulator);
+
+  /** Standard class type alias. */
+  using Self = RunningImageAccumulator;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods) */
+  itkTypeMacro(RunningImageAccumulator, Object);
+
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  using InputImageType = TInputImage;
+  using InputPixelType = typename InputImageType::PixelType;
+  using OutputImageType = TOutputImage;
+  using OutputImagePointer = typename OutputImageType::Pointer;
+  using OutputPixelType = typename OutputImageType::PixelType;
+  using RegionType = typename InputImageType::RegionType;
+  using AccumulatorImageType = Image<double, ImageDimension>;
+
+  /** Also track the sum of squared deviations needed by GetVariance().
+   * Must be set before the first image is added. */
+  itkSetMacro(ComputeVariance, bool);
+  itkGetConstMacro(ComputeVariance, bool);
+  itkBooleanMacro(ComputeVariance);
+
+  itkGetConstMacro(NumberOfAccumulatedImages, SizeValueType);
+
+  /** Fold image into the running state. */
+  void
+  AddImage(const InputImageType * image);
+
+  /** Discard the running state. */
+  void
+  Reset();
+
+  /** Voxelwise mean of the images added so far. */
+  OutputImagePointer
+  GetMean() const;
+
+  /** Voxelwise sample variance (normalized by N - 1) of the images added so
+   * far, zero while fewer than two images were added. */
+  OutputImagePointer
+  GetVariance() const;
+
+protected:
+  RunningImageAccumulator() = default;
+  ~RunningImageAccumulator() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  OutputImagePointer
+  AllocateOutput() const;
+
+  bool                                   m_ComputeVariance{ false };
+  SizeValueType                          m_NumberOfAccumulatedImages{ 0 };
+  typename AccumulatorImageType::Pointer m_Sum;
+  typename AccumulatorImageType::Pointer m_Compensation;
+  typename AccumulatorImageType::Pointer m_SquaredDeviations;
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkRunningImageAccumulator.hxx"
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRunningImageAccumulator_hxx
+#define __itkRunningImageAccumulator_hxx
+
+#include "itkRunningImageAccumulator.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageScanlineIterator.h>
+#include <itkMultiThreaderBase.h>
+
+#include <cmath>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TOutputImage>
+void
+RunningImageAccumulator<TInputImage, TOutputImage>::AddImage(const InputImageType * image)
+{
+  if (image == nullptr)
+  {
+    itkExceptionMacro(<< "Can not accumulate a null image");
+  }
+  const RegionType region = image->GetLargestPossibleRegion();
+  if (!image->GetBufferedRegion().IsInside(region))
+  {
+    itkExceptionMacro(<< "The whole image must be buffered, got buffered region " << image->GetBufferedRegion()
+                      << " for largest possible region " << region);
+  }
+
+  if (m_NumberOfAccumulatedImages == 0)
+  {
+    const auto allocateLike = [image, &region]() -> typename AccumulatorImageType::Pointer {
+      typename AccumulatorImageType::Pointer accumulator = AccumulatorImageType::New();
+      accumulator->CopyInformation(image);
+      accumulator->SetRegions(region);
+      accumulator->Allocate(true);
+      return accumulator;
+    };
+    m_Sum = allocateLike();
+    m_Compensation = allocateLike();
+    m_SquaredDeviations = m_ComputeVariance ? allocateLike() : nullptr;
+  }
+  else if (region != m_Sum->GetLargestPossibleRegion())
+  {
+    itkExceptionMacro(<< "Image region " << region << " does not match the accumulated region "
+                      << m_Sum->GetLargestPossibleRegion());
+  }
+
+  const double                 previousCount = static_cast<double>(m_NumberOfAccumulatedImages);
+  const double                 currentCount = previousCount + 1.0;
+  AccumulatorImageType * const sumImage = m_Sum.GetPointer();
+  AccumulatorImageType * const compensationImage = m_Compensation.GetPointer();
+  AccumulatorImageType * const squaredDeviationsImage = m_SquaredDeviations.GetPointer();
+
+  MultiThreaderBase::New()->template ParallelizeImageRegion<ImageDimension>(
+    region,
+    [=](const RegionType & subRegion) {
+      ImageRegionConstIterator<InputImageType>    inIt(image, subRegion);
+      ImageScanlineIterator<AccumulatorImageType> sumIt(sumImage, subRegion);
+      ImageScanlineIterator<AccumulatorImageType> compIt(compensationImage, subRegion);
+      ImageScanlineIterator<AccumulatorImageType> sqIt;
+      if (squaredDeviationsImage != nullptr)
+      {
+        sqIt = ImageScanlineIterator<AccumulatorImageType>(squaredDeviationsImage, subRegion);
+      }
+      while (!sumIt.IsAtEnd())
+      {
+        while (!sumIt.IsAtEndOfLine())
+        {
+          const double value = static_cast<double>(inIt.Get());
+          const double sum = sumIt.Get();
+          const double compensation = compIt.Get();
+
+          // Neumaier's variant of Kahan summation
+          const double newSum = sum + value;
+          const double lostLowOrder = (std::abs(sum) >= std::abs(value)) ? ((sum - newSum) + value)
+                                                                         : ((value - newSum) + sum);
+          const double newCompensation = compensation + lostLowOrder;
+          if (squaredDeviationsImage != nullptr && previousCount > 0.0)
+          {
+            const double previousMean = (sum + compensation) / previousCount;
+            const double currentMean = (newSum + newCompensation) / currentCount;
+            sqIt.Set(sqIt.Get() + (value - previousMean) * (value - currentMean));
+          }
+          sumIt.Set(newSum);
+          compIt.Set(newCompensation);
+
+          ++inIt;
+          ++sumIt;
+          ++compIt;
+          if (squaredDeviationsImage != nullptr)
+          {
+            ++sqIt;
+          }
+        }
+        sumIt.NextLine();
+        compIt.NextLine();
+        if (squaredDeviationsImage != nullptr)
+        {
+          sqIt.NextLine();
+        }
+      }
+    },
+    nullptr);
+
+  ++m_NumberOfAccumulatedImages;
+  this->Modified();
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+RunningImageAccumulator<TInputImage, TOutputImage>::Reset()
+{
+  m_NumberOfAccumulatedImages = 0;
+  m_Sum = nullptr;
+  m_Compensation = nullptr;
+  m_SquaredDeviations = nullptr;
+  this->Modified();
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename RunningImageAccumulator<TInputImage, TOutputImage>::OutputImagePointer
+RunningImageAccumulator<TInputImage, TOutputImage>::AllocateOutput() const
+{
+  if (m_NumberOfAccumulatedImages == 0)
+  {
+    itkExceptionMacro(<< "No images have been accumulated");
+  }
+  OutputImagePointer output = OutputImageType::New();
+  output->CopyInformation(m_Sum);
+  output->SetRegions(m_Sum->GetLargestPossibleRegion());
+  output->Allocate();
+  return output;
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename RunningImageAccumulator<TInputImage, TOutputImage>::OutputImagePointer
+RunningImageAccumulator<TInputImage, TOutputImage>::GetMean() const
+{
+  OutputImagePointer                 output = this->AllocateOutput();
+  const double                       invCount = 1.0 / static_cast<double>(m_NumberOfAccumulatedImages);
+  const AccumulatorImageType * const sumImage = m_Sum.GetPointer();
+  const AccumulatorImageType * const compensationImage = m_Compensation.GetPointer();
+  OutputImageType * const            outputImage = output.GetPointer();
+
+  MultiThreaderBase::New()->template ParallelizeImageRegion<ImageDimension>(
+    output->GetLargestPossibleRegion(),
+    [=](const RegionType & subRegion) {
+      ImageRegionConstIterator<AccumulatorImageType> sumIt(sumImage, subRegion);
+      ImageRegionConstIterator<AccumulatorImageType> compIt(compensationImage, subRegion);
+      ImageRegionIterator<OutputImageType>           outIt(outputImage, subRegion);
+      for (; !outIt.IsAtEnd(); ++outIt, ++sumIt, ++compIt)
+      {
+        outIt.Set(static_cast<OutputPixelType>((sumIt.Get() + compIt.Get()) * invCount));
+      }
+    },
+    nullptr);
+  return output;
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename RunningImageAccumulator<TInputImage, TOutputImage>::OutputImagePointer
+RunningImageAccumulator<TInputImage, TOutputImage>::GetVariance() const
+{
+  if (m_NumberOfAccumulatedImages > 0 && m_SquaredDeviations.IsNull())
+  {
+    itkExceptionMacro(<< "ComputeVariance must be enabled before accumulating images");
+  }
+  OutputImagePointer output = this->AllocateOutput();
+  if (m_NumberOfAccumulatedImages < 2)
+  {
+    output->FillBuffer(NumericTraits<OutputPixelType>::ZeroValue());
+    return output;
+  }
+  const double                       invDegreesOfFreedom = 1.0 / static_cast<double>(m_NumberOfAccumulatedImages - 1);
+  const AccumulatorImageType * const squaredDeviationsImage = m_SquaredDeviations.GetPointer();
+  OutputImageType * const            outputImage = output.GetPointer();
+
+  MultiThreaderBase::New()->template ParallelizeImageRegion<ImageDimension>(
+    output->GetLargestPossibleRegion(),
+    [=](const RegionType & subRegion) {
+      ImageRegionConstIterator<AccumulatorImageType> sqIt(squaredDeviationsImage, subRegion);
+      ImageRegionIterator<OutputImageType>           outIt(outputImage, subRegion);
+      for (; !outIt.IsAtEnd(); ++outIt, ++sqIt)
+      {
+        outIt.Set(static_cast<OutputPixelType>(sqIt.Get() * invDegreesOfFreedom));
+      }
+    },
+    nullptr);
+  return output;
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+RunningImageAccumulator<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "ComputeVariance: " << m_ComputeVariance << std::endl;
+  os << indent << "NumberOfAccumulatedImages: " << m_NumberOfAccumulatedImages << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,103 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkVectorImageComponentSelectionFilter_h
+#define __itkVectorImageComponentSelectionFilter_h
+
+#include <itkImageToImageFilter.h>
+
+#include <vector>
+
+namespace itk
+{
+/** \class VectorImageComponentSelectionFilter
+ *
+ * \brief Copy a subset of the components of a VectorImage, in a given
+ * order, to a VectorImage with fewer components per pixel.
+ *
+ * The output region maps one to one to the input region, so the filter
+ * streams: behind a StreamingImageFilter or a streaming writer only the
+ * requested slab of the input is read.  Each thread copies whole scanlines
+ * directly between the pixel buffers.
+ *
+ * \ingroup ITKBRAINSFilterPack
+ */
+template <typename TInputImage, typename TOutputImage = TInputImage>
+class VectorImageComponentSelectionFilter : public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(VectorImageComponentSelectionFilter);
+
+  /** Standard class type alias. */
+  using Self = VectorImageComponentSelectionFilter;
+  using Superclass = ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods) */
+  itkTypeMacro(VectorImageComponentSelectionFilter, ImageToImageFilter);
+
+  using InputImageType = TInputImage;
+  using OutputImageType = TOutputImage;
+  using OutputImageRegionType = typename OutputImageType::RegionType;
+  using ComponentIndicesType = std::vector<unsigned int>;
+
+  /** Input components copied to the output, output component i is input
+   * component ComponentIndices[i]. */
+  void
+  SetComponentIndices(const ComponentIndicesType & componentIndices)
+  {
+    if (componentIndices != m_ComponentIndices)
+    {
+      m_ComponentIndices = componentIndices;
+      this->Modified();
+    }
+  }
+
+  const ComponentIndicesType &
+  GetComponentIndices() const
+  {
+    return m_ComponentIndices;
+  }
+
+protected:
+  VectorImageComponentSelectionFilter() = default;
+  ~VectorImageComponentSelectionFilter() override = default;
+
+  void
+  GenerateOutputInformation() override;
+
+  void
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  ComponentIndicesType m_ComponentIndices;
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkVectorImageComponentSelectionFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkVectorImageComponentSelectionFilter_hxx
+#define __itkVectorImageComponentSelectionFilter_hxx
+
+#include "itkVectorImageComponentSelectionFilter.h"
+
+#include <itkImageScanlineIterator.h>
+
+namespace itk
+{
+template <typename TInputImage, typename TOutputImage>
+void
+VectorImageComponentSelectionFilter<TInputImage, TOutputImage>::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+
+  const unsigned int numberOfInputComponents = this->GetInput()->GetNumberOfComponentsPerPixel();
+  if (m_ComponentIndices.empty())
+  {
+    itkExceptionMacro(<< "No components selected");
+  }
+  for (const auto component : m_ComponentIndices)
+  {
+    if (component >= numberOfInputComponents)
+    {
+      itkExceptionMacro(<< "Component " << component << " selected, the input has " << numberOfInputComponents
+                        << " components");
+    }
+  }
+  this->GetOutput()->SetNumberOfComponentsPerPixel(m_ComponentIndices.size());
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+VectorImageComponentSelectionFilter<TInputImage, TOutputImage>::DynamicThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread)
+{
+  using InputInternalPixelType = typename InputImageType::InternalPixelType;
+  using OutputInternalPixelType = typename OutputImageType::InternalPixelType;
+
+  const InputImageType * input = this->GetInput();
+  OutputImageType *      output = this->GetOutput();
+
+  const unsigned int   numberOfInputComponents = input->GetNumberOfComponentsPerPixel();
+  const unsigned int   numberOfOutputComponents = m_ComponentIndices.size();
+  const unsigned int * components = m_ComponentIndices.data();
+  const SizeValueType  lineLength = outputRegionForThread.GetSize(0);
+
+  // The iterator only walks the scanlines, the copy goes through the
+  // buffers, which hold the components of a pixel contiguously
+  ImageScanlineIterator<OutputImageType> it(output, outputRegionForThread);
+  while (!it.IsAtEnd())
+  {
+    const InputInternalPixelType * in =
+      input->GetBufferPointer() + input->ComputeOffset(it.GetIndex()) * numberOfInputComponents;
+    OutputInternalPixelType * out =
+      output->GetBufferPointer() + output->ComputeOffset(it.GetIndex()) * numberOfOutputComponents;
+    for (SizeValueType x = 0; x < lineLength; ++x)
+    {
+      for (unsigned int c = 0; c < numberOfOutputComponents; ++c)
+      {
+        out[c] = static_cast<OutputInternalPixelType>(in[components[c]]);
+      }
+      in += numberOfInputComponents;
+      out += numberOfOutputComponents;
+    }
+    it.NextLine();
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+VectorImageComponentSelectionFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "ComponentIndices:";
+  for (const auto component : m_ComponentIndices)
+  {
+    os << " " << component;
+  }
+  os << std::endl;
+}
+} // end namespace itk
+
+#endif
@@ -0,0 +1,98 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "../src/landmarksConstellationModelIO.h"
+
+// Every value of the two models must be bit identical.
+static bool
+ModelsAreIdentical(landmarksConstellationModelIO & a, landmarksConstellationModelIO & b)
+{
+  if (a.GetSearchboxDims() != b.GetSearchboxDims() || a.GetResolutionUnits() != b.GetResolutionUnits() ||
+      a.GetNumDataSets() != b.GetNumDataSets() || a.GetNumRotationSteps() != b.GetNumRotationSteps() ||
+      a.GetRPPC_to_RPAC_angleMean() != b.GetRPPC_to_RPAC_angleMean() ||
+      a.GetRPAC_over_RPPCMean() != b.GetRPAC_over_RPPCMean() || a.GetCMtoRPMean() != b.GetCMtoRPMean() ||
+      a.GetRPtoCECMean() != b.GetRPtoCECMean() || a.GetRPtoXMean("AC") != b.GetRPtoXMean("AC") ||
+      a.GetRPtoXMean("PC") != b.GetRPtoXMean("PC") || a.GetRPtoXMean("VN4") != b.GetRPtoXMean("VN4"))
+  {
+    std::cerr << "Model scalars differ" << std::endl;
+    return false;
+  }
+  if (a.GetRadii() != b.GetRadii())
+  {
+    std::cerr << "Model landmarks differ" << std::endl;
+    return false;
+  }
+  for (const auto & radius : a.GetRadii())
+  {
+    if (a.GetHeight(radius.first) != b.GetHeight(radius.first) ||
+        a.GetTemplateMeans(radius.first) != b.GetTemplateMeans(radius.first) ||
+        a.m_VectorIndexLocations[radius.first] != b.m_VectorIndexLocations[radius.first])
+    {
+      std::cerr << "Template of " << radius.first << " differs" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int
+main(int argc, char ** argv)
+{
+  if (argc != 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " <model mdl file> <temporary directory>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string textModelName(argv[1]);
+  const std::string binaryModelName = std::string(argv[2]) + "/TestlandmarksConstellationModelIO.bmdl";
+  const std::string roundTripModelName = std::string(argv[2]) + "/TestlandmarksConstellationModelIO.mdl";
+
+  try
+  {
+    landmarksConstellationModelIO textModel;
+    textModel.ReadModelFile(textModelName);
+    textModel.WriteBinaryModelFile(binaryModelName);
+
+    landmarksConstellationModelIO binaryModel;
+    binaryModel.ReadModelFile(binaryModelName);
+    // A copy shares the mapping and materializes its templates independently.
+    landmarksConstellationModelIO binaryModelCopy = binaryModel;
+    if (!ModelsAreIdentical(textModel, binaryModel) || !ModelsAreIdentical(binaryModelCopy, textModel) ||
+        !(binaryModel == textModel))
+    {
+      std::cerr << "Binary model " << binaryModelName << " does not match " << textModelName << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    binaryModel.WriteModelFile(roundTripModelName);
+    landmarksConstellationModelIO roundTripModel;
+    roundTripModel.ReadModelFile(roundTripModelName);
+    if (!ModelsAreIdentical(textModel, roundTripModel))
+    {
+      std::cerr << "Text model " << roundTripModelName << " does not match " << textModelName << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch (itk::ExceptionObject & err)
+  {
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Binary and text models round trip identically" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -64,6 +64,28 @@
 #include "itkOrthogonalize3DRotationMatrix.h"
 #include "math.h"
 
+#include <stdexcept>
+#ifdef BRAINSConstellationModeler_USE_TBB
+#  include <tbb/parallel_for.h>
+#endif
+
+// //////////////////////////////////////////////////////////////
+// Calls work(i) for every i in [0, count).  The calls are
+// independent and run concurrently when TBB is available.
+// //////////////////////////////////////////////////////////////
+template <typename TWork>
+void
+ForEachTrainingIndex(const unsigned int count, const TWork & work)
+{
+#ifdef BRAINSConstellationModeler_USE_TBB
+  tbb::parallel_for(0U, count, work);
+#else
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    work(i);
+  }
+#endif
+}
 
 // //////////////////////////////////////////////////////////////
 // Computes the unbiased sample variance of a set of n observations
@@ -191,202 +213,240 @@ main(int argc, char * argv[])
   }
   // //////////////////////////////////////////////////////////////////////////
   const unsigned int & mDefNumDataSets = mDef.GetNumDataSets();
+
+  // Every dataset, landmark and rotation angle writes only its own template
+  // and its own entries of the *_InMSPAlignedSpace tables, so they are
+  // trained concurrently.  The model maps are not safe for concurrent
+  // lookup, so the template storage is resolved here, serially.
+  using FloatVectorType = landmarksConstellationModelIO::FloatVectorType;
+  using IndexLocationVectorType = landmarksConstellationModelIO::IndexLocationVectorType;
+  struct LandmarkTrainingSlots
+  {
+    std::string                     name;
+    SImageType::PointType           origPoint;
+    const IndexLocationVectorType * indexLocations;
+    std::vector<FloatVectorType *>  templates; // one per rotation angle
+  };
+  const unsigned int                              numRotationSteps = myModel.GetNumRotationSteps();
+  std::vector<std::vector<LandmarkTrainingSlots>> trainingSlots(mDefNumDataSets);
   for (unsigned int currentDataset = 0; currentDataset < mDefNumDataSets; ++currentDataset)
   {
-    std::cout << "====================================================================================" << std::endl;
-    std::cout << "PROCESSING:" << mDef[currentDataset].GetImageFilename() << std::endl;
-    // Since these are oriented images, the reorientation should not be
-    // necessary.
-    // //////////////////////////////////////////////////////////////////////////
-    SImageType::Pointer volOrig = itkUtil::ReadImage<SImageType>(mDef[currentDataset].GetImageFilename());
-    if (volOrig.IsNull())
+    for (auto it = mDef[currentDataset].begin(); it != mDef[currentDataset].end(); ++it)
     {
-      printf("\nCould not open image %s, aborting ...\n\n", mDef[currentDataset].GetImageFilename().c_str());
-      return EXIT_FAILURE;
+      LandmarkTrainingSlots slots;
+      slots.name = it->first;
+      slots.origPoint = it->second;
+      slots.indexLocations = &(myModel.m_VectorIndexLocations[it->first]);
+      for (unsigned int currentAngle = 0; currentAngle < numRotationSteps; ++currentAngle)
+      {
+        slots.templates.push_back(&(myModel.AccessTemplate(it->first, currentDataset, currentAngle)));
+      }
+      trainingSlots[currentDataset].push_back(slots);
     }
-    SImageType::Pointer image;
-
-    if (rescaleIntensities == true)
-    {
-      itk::StatisticsImageFilter<SImageType>::Pointer stats = itk::StatisticsImageFilter<SImageType>::New();
-      stats->SetInput(volOrig);
-      stats->Update();
-      SImageType::PixelType minPixel(stats->GetMinimum());
-      SImageType::PixelType maxPixel(stats->GetMaximum());
+  }
 
-      if (trimRescaledIntensities > 0.0)
+  try
+  {
+    ForEachTrainingIndex(mDefNumDataSets, [&](const unsigned int currentDataset) {
+      std::cout << "====================================================================================" << std::endl;
+      const std::string & datasetImageFilename = mDef[currentDataset].GetImageFilename();
+      std::cout << "PROCESSING:" << datasetImageFilename << std::endl;
+      // Since these are oriented images, the reorientation should not be
+      // necessary.
+      // //////////////////////////////////////////////////////////////////////////
+      SImageType::Pointer volOrig = itkUtil::ReadImage<SImageType>(mDef[currentDataset].GetImageFilename());
+      if (volOrig.IsNull())
       {
-        // REFACTOR: a histogram would be traditional here, but seems
-        // over-the-top;
-        // I did this because it seemed to me if I knew mean, sigma, max and
-        // min,
-        // then I know Something about extreme outliers.
-
-        double meanOrig(stats->GetMean());
-        double sigmaOrig(stats->GetSigma());
-
-        // REFACTOR:  In percentiles, 0.0005 two-tailed has worked in the past.
-        // It only makes sense to trim the upper bound since the lower bound
-        // would most likely
-        // represent a large region of air around the head.  But this is not so
-        // when using a mask.
-        // For one-tailed, an error of 0.001 corresponds to 3.29052 standard
-        // deviations of normal.
-        // For one-tailed, an error of 0.0001 corresponds to 3.8906 standard
-        // deviations of normal.
-        // For one-tailed, an error of 0.00001 corresponds to 4.4172 standard
-        // deviations of normal.
-        // Naturally, the constant should default at the command line, ...
-
-        double variationBound((maxPixel - meanOrig) / sigmaOrig);
-        double trimBound(variationBound - trimRescaledIntensities);
-        if (trimBound > 0.0)
-        {
-          maxPixel = static_cast<SImageType::PixelType>(maxPixel - trimBound * sigmaOrig);
-        }
+        throw std::runtime_error("Could not open image " + mDef[currentDataset].GetImageFilename());
       }
+      SImageType::Pointer image;
 
-      itk::IntensityWindowingImageFilter<SImageType, SImageType>::Pointer remapIntensityFilter =
-        itk::IntensityWindowingImageFilter<SImageType, SImageType>::New();
-      remapIntensityFilter->SetInput(volOrig);
-      remapIntensityFilter->SetOutputMaximum(rescaleIntensitiesOutputRange[1]);
-      remapIntensityFilter->SetOutputMinimum(rescaleIntensitiesOutputRange[0]);
-      remapIntensityFilter->SetWindowMinimum(minPixel);
-      remapIntensityFilter->SetWindowMaximum(maxPixel);
-      remapIntensityFilter->Update();
+      if (rescaleIntensities == true)
+      {
+        itk::StatisticsImageFilter<SImageType>::Pointer stats = itk::StatisticsImageFilter<SImageType>::New();
+        stats->SetInput(volOrig);
+        stats->Update();
+        SImageType::PixelType minPixel(stats->GetMinimum());
+        SImageType::PixelType maxPixel(stats->GetMaximum());
 
-      image = remapIntensityFilter->GetOutput();
-    }
-    else
-    {
-      image = volOrig;
-    }
+        if (trimRescaledIntensities > 0.0)
+        {
+          // REFACTOR: a histogram would be traditional here, but seems
+          // over-the-top;
+          // I did this because it seemed to me if I knew mean, sigma, max and
+          // min,
+          // then I know Something about extreme outliers.
+
+          double meanOrig(stats->GetMean());
+          double sigmaOrig(stats->GetSigma());
+
+          // REFACTOR:  In percentiles, 0.0005 two-tailed has worked in the past.
+          // It only makes sense to trim the upper bound since the lower bound
+          // would most likely
+          // represent a large region of air around the head.  But this is not so
+          // when using a mask.
+          // For one-tailed, an error of 0.001 corresponds to 3.29052 standard
+          // deviations of normal.
+          // For one-tailed, an error of 0.0001 corresponds to 3.8906 standard
+          // deviations of normal.
+          // For one-tailed, an error of 0.00001 corresponds to 4.4172 standard
+          // deviations of normal.
+          // Naturally, the constant should default at the command line, ...
+
+          double variationBound((maxPixel - meanOrig) / sigmaOrig);
+          double trimBound(variationBound - trimRescaledIntensities);
+          if (trimBound > 0.0)
+          {
+            maxPixel = static_cast<SImageType::PixelType>(maxPixel - trimBound * sigmaOrig);
+          }
+        }
 
-    SImageType::PointType origin;
-    origin.Fill(0);
-
-    // This section assumes that the landmarks are defined as
-    // ITK compliant physical space
-    // That are consistent with ITK images that they were collected from Dicom
-    // coordinate system
-    // No conversion is necessary
-    SImageType::PointType origRP = mDef[currentDataset].GetNamedPoint("RP");
-    SImageType::PointType origAC = mDef[currentDataset].GetNamedPoint("AC");
-    SImageType::PointType origPC = mDef[currentDataset].GetNamedPoint("PC");
-    SImageType::PointType origVN4 = mDef[currentDataset].GetNamedPoint("VN4");
-    SImageType::PointType origLE = mDef[currentDataset].GetNamedPoint("LE");
-    SImageType::PointType origRE = mDef[currentDataset].GetNamedPoint("RE");
-    SImageType::PointType origCEC;
-    origCEC.SetToMidPoint(origLE, origRE);
-
-    SImageType::PointType orig_lmk_CenterOfHeadMass = GetCenterOfHeadMass(image);
-
-    // original input volume from the training set
-    // transforms image to MSP aligned voxel lattice
-
-    double                      c_c = 0;
-
-    RigidTransformType::Pointer eyeFixed2msp_lmk_tfm = ComputeMSP(image, orig_lmk_CenterOfHeadMass, mspQualityLevel, c_c);
-    const SImageType::PixelType minPixelValue = [](SImageType::Pointer im) -> SImageType::PixelType {
-      using StatisticsFilterType = itk::StatisticsImageFilter<SImageType>;
-      StatisticsFilterType::Pointer statisticsFilter = StatisticsFilterType::New();
-      statisticsFilter->SetInput(im);
-      statisticsFilter->Update();
-      const SImageType::PixelType local_minPixelValue = statisticsFilter->GetMinimum();
-      return local_minPixelValue;
-    }(image);
-
-    SImageType::Pointer volumeMSP =
-      TransformResample<SImageType, SImageType>(image.GetPointer(),
-                                                MakeIsoTropicReferenceImage().GetPointer(),
-                                                minPixelValue,
-                                                GetInterpolatorFromString<SImageType>("Linear").GetPointer(),
-                                                eyeFixed2msp_lmk_tfm.GetPointer());
-
-
-    if (globalImagedebugLevel > 2)
-    {
-      const std::string MSP_ImagePlane(globalResultsDir + "/MSP_PLANE_" +
-                                       itksys::SystemTools::GetFilenameName(mDef[currentDataset].GetImageFilename()));
-      CreatedebugPlaneImage(volumeMSP, MSP_ImagePlane);
-    }
+        itk::IntensityWindowingImageFilter<SImageType, SImageType>::Pointer remapIntensityFilter =
+          itk::IntensityWindowingImageFilter<SImageType, SImageType>::New();
+        remapIntensityFilter->SetInput(volOrig);
+        remapIntensityFilter->SetOutputMaximum(rescaleIntensitiesOutputRange[1]);
+        remapIntensityFilter->SetOutputMinimum(rescaleIntensitiesOutputRange[0]);
+        remapIntensityFilter->SetWindowMinimum(minPixel);
+        remapIntensityFilter->SetWindowMaximum(maxPixel);
+        remapIntensityFilter->Update();
 
-    // Compute the transform from original space to the AC-PC aligned space using Reflective Correlation method
-    //    RigidTransformType::Pointer invTmsp = RigidTransformType::New();
-    //    eyeFixed2msp_lmk_tfm->GetInverse(invTmsp);
-
-    // Instead of RC method, now we compute all the ac-pc aligned transforms by estimating the plane passing through RP,
-    // AC and PC points
-    RigidTransformType::Pointer ACPC_AlignedTransform = computeTmspFromPoints(origRP, origAC, origPC, origin);
-
-    // We cannot easily compute the Inverse transform by the following to lines, we need to use versor for percise
-    // transformation
-    //    RigidTransformType::Pointer ACPC_AlignedTransform_INV = RigidTransformType::New();
-    //    ACPC_AlignedTransform_INV->GetInverse(ACPC_AlignedTransform);
-
-    // AC-PC aligned TRANSFORM
-    VersorTransformType::Pointer finalTransform = VersorTransformType::New();
-    finalTransform->SetFixedParameters(ACPC_AlignedTransform->GetFixedParameters());
-    itk::Versor<double>               versorRotation; // was commented before
-    const itk::Matrix<double, 3, 3> & NewCleanedOrthogonalized =
-      itk::Orthogonalize3DRotationMatrix(ACPC_AlignedTransform->GetMatrix());
-    versorRotation.Set(NewCleanedOrthogonalized);
-    finalTransform->SetRotation(versorRotation);
-    finalTransform->SetTranslation(ACPC_AlignedTransform->GetTranslation());
-    // inverse transform
-    VersorTransformType::Pointer  ACPC_AlignedTransform_INV = VersorTransformType::New();
-    const SImageType::PointType & centerPoint = finalTransform->GetCenter();
-    ACPC_AlignedTransform_INV->SetCenter(centerPoint);
-    ACPC_AlignedTransform_INV->SetIdentity();
-    finalTransform->GetInverse(ACPC_AlignedTransform_INV);
-    //////////////////////////////////////////////////////////////////
-
-    // Transform points based on the new transform
-    cm_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(orig_lmk_CenterOfHeadMass);
-    rp_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origRP);
-    ac_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origAC);
-    pc_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origPC);
-    vn4_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origVN4);
-    cec_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origCEC);
-
-    if (globalImagedebugLevel > 3)
-    {
-      const SImageType::PointType finalRP = ACPC_AlignedTransform_INV->TransformPoint(origRP);
-      const SImageType::PointType finalAC = ACPC_AlignedTransform_INV->TransformPoint(origAC);
-      const SImageType::PointType finalPC = ACPC_AlignedTransform_INV->TransformPoint(origPC);
-      const SImageType::PointType finalVN4 = ACPC_AlignedTransform_INV->TransformPoint(origVN4);
+        image = remapIntensityFilter->GetOutput();
+      }
+      else
+      {
+        image = volOrig;
+      }
 
-      SImageType::Pointer volumeACPC_Aligned =
+      SImageType::PointType origin;
+      origin.Fill(0);
+
+      // This section assumes that the landmarks are defined as
+      // ITK compliant physical space
+      // That are consistent with ITK images that they were collected from Dicom
+      // coordinate system
+      // No conversion is necessary
+      SImageType::PointType origRP = mDef[currentDataset].GetNamedPoint("RP");
+      SImageType::PointType origAC = mDef[currentDataset].GetNamedPoint("AC");
+      SImageType::PointType origPC = mDef[currentDataset].GetNamedPoint("PC");
+      SImageType::PointType origVN4 = mDef[currentDataset].GetNamedPoint("VN4");
+      SImageType::PointType origLE = mDef[currentDataset].GetNamedPoint("LE");
+      SImageType::PointType origRE = mDef[currentDataset].GetNamedPoint("RE");
+      SImageType::PointType origCEC;
+      origCEC.SetToMidPoint(origLE, origRE);
+
+      SImageType::PointType orig_lmk_CenterOfHeadMass = GetCenterOfHeadMass(image);
+
+      // original input volume from the training set
+      // transforms image to MSP aligned voxel lattice
+
+      double                      c_c = 0;
+
+      RigidTransformType::Pointer eyeFixed2msp_lmk_tfm =
+        ComputeMSP(image, orig_lmk_CenterOfHeadMass, mspQualityLevel, c_c);
+      const SImageType::PixelType minPixelValue = [](SImageType::Pointer im) -> SImageType::PixelType {
+        using StatisticsFilterType = itk::StatisticsImageFilter<SImageType>;
+        StatisticsFilterType::Pointer statisticsFilter = StatisticsFilterType::New();
+        statisticsFilter->SetInput(im);
+        statisticsFilter->Update();
+        const SImageType::PixelType local_minPixelValue = statisticsFilter->GetMinimum();
+        return local_minPixelValue;
+      }(image);
+
+      SImageType::Pointer volumeMSP =
         TransformResample<SImageType, SImageType>(image.GetPointer(),
-                                                  image.GetPointer(),
-                                                  BackgroundFillValue,
+                                                  MakeIsoTropicReferenceImage().GetPointer(),
+                                                  minPixelValue,
                                                   GetInterpolatorFromString<SImageType>("Linear").GetPointer(),
-                                                  ACPC_AlignedTransform.GetPointer());
-
-      itkUtil::WriteImage<SImageType>(volumeACPC_Aligned,
-                                      resultsDir + "/ACPC_Aligned_" +
-                                        itksys::SystemTools::GetFilenameName(mDef[currentDataset].GetImageFilename()));
-      MakeLabelImage(volumeACPC_Aligned,
-                     finalRP,
-                     finalAC,
-                     finalPC,
-                     finalVN4,
-                     resultsDir + "/Mask_Resampled_" +
-                       itksys::SystemTools::GetFilenameName(mDef[currentDataset].GetImageFilename()));
-    }
+                                                  eyeFixed2msp_lmk_tfm.GetPointer());
 
-    // Build template for each landmark
-    for (auto it = mDef[currentDataset].begin(); it != mDef[currentDataset].end(); ++it)
-    {
-      std::cout << "Training template for " << it->first << std::endl;
-      const SImageType::PointType origPoint = it->second;
-      const SImageType::PointType transformedPoint = ACPC_AlignedTransform_INV->TransformPoint(origPoint);
-      /* PRINT FOR TEST /////////////////////////////////////////////
-          std::cout << "original point: " << it->second << std::endl;
-          std::cout << "transformed point: " << transformedPoint << std::endl;
-      /////////////////////////////////////////////////////////////*/
-      for (unsigned int currentAngle = 0; currentAngle < myModel.GetNumRotationSteps(); currentAngle++)
+
+      if (globalImagedebugLevel > 2)
+      {
+        const std::string MSP_ImagePlane(globalResultsDir + "/MSP_PLANE_" +
+                                         itksys::SystemTools::GetFilenameName(mDef[currentDataset].GetImageFilename()));
+        CreatedebugPlaneImage(volumeMSP, MSP_ImagePlane);
+      }
+
+      // Compute the transform from original space to the AC-PC aligned space using Reflective Correlation method
+      //    RigidTransformType::Pointer invTmsp = RigidTransformType::New();
+      //    eyeFixed2msp_lmk_tfm->GetInverse(invTmsp);
+
+      // Instead of RC method, now we compute all the ac-pc aligned transforms by estimating the plane passing through
+      // RP, AC and PC points
+      RigidTransformType::Pointer ACPC_AlignedTransform = computeTmspFromPoints(origRP, origAC, origPC, origin);
+
+      // We cannot easily compute the Inverse transform by the following to lines, we need to use versor for percise
+      // transformation
+      //    RigidTransformType::Pointer ACPC_AlignedTransform_INV = RigidTransformType::New();
+      //    ACPC_AlignedTransform_INV->GetInverse(ACPC_AlignedTransform);
+
+      // AC-PC aligned TRANSFORM
+      VersorTransformType::Pointer finalTransform = VersorTransformType::New();
+      finalTransform->SetFixedParameters(ACPC_AlignedTransform->GetFixedParameters());
+      itk::Versor<double>               versorRotation; // was commented before
+      const itk::Matrix<double, 3, 3> & NewCleanedOrthogonalized =
+        itk::Orthogonalize3DRotationMatrix(ACPC_AlignedTransform->GetMatrix());
+      versorRotation.Set(NewCleanedOrthogonalized);
+      finalTransform->SetRotation(versorRotation);
+      finalTransform->SetTranslation(ACPC_AlignedTransform->GetTranslation());
+      // inverse transform
+      VersorTransformType::Pointer  ACPC_AlignedTransform_INV = VersorTransformType::New();
+      const SImageType::PointType & centerPoint = finalTransform->GetCenter();
+      ACPC_AlignedTransform_INV->SetCenter(centerPoint);
+      ACPC_AlignedTransform_INV->SetIdentity();
+      finalTransform->GetInverse(ACPC_AlignedTransform_INV);
+      //////////////////////////////////////////////////////////////////
+
+      // Transform points based on the new transform
+      cm_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(orig_lmk_CenterOfHeadMass);
+      rp_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origRP);
+      ac_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origAC);
+      pc_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origPC);
+      vn4_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origVN4);
+      cec_InMSPAlignedSpace[currentDataset] = ACPC_AlignedTransform_INV->TransformPoint(origCEC);
+
+      if (globalImagedebugLevel > 3)
       {
+        const SImageType::PointType finalRP = ACPC_AlignedTransform_INV->TransformPoint(origRP);
+        const SImageType::PointType finalAC = ACPC_AlignedTransform_INV->TransformPoint(origAC);
+        const SImageType::PointType finalPC = ACPC_AlignedTransform_INV->TransformPoint(origPC);
+        const SImageType::PointType finalVN4 = ACPC_AlignedTransform_INV->TransformPoint(origVN4);
+
+        SImageType::Pointer volumeACPC_Aligned =
+          TransformResample<SImageType, SImageType>(image.GetPointer(),
+                                                    image.GetPointer(),
+                                                    BackgroundFillValue,
+                                                    GetInterpolatorFromString<SImageType>("Linear").GetPointer(),
+                                                    ACPC_AlignedTransform.GetPointer());
+
+        itkUtil::WriteImage<SImageType>(volumeACPC_Aligned,
+                                        resultsDir + "/ACPC_Aligned_" +
+                                          itksys::SystemTools::GetFilenameName(datasetImageFilename));
+        MakeLabelImage(volumeACPC_Aligned,
+                       finalRP,
+                       finalAC,
+                       finalPC,
+                       finalVN4,
+                       resultsDir + "/Mask_Resampled_" +
+                         itksys::SystemTools::GetFilenameName(mDef[currentDataset].GetImageFilename()));
+      }
+
+      // Build template for each landmark at each rotation angle
+      const std::vector<LandmarkTrainingSlots> & datasetSlots = trainingSlots[currentDataset];
+      const unsigned int numLandmarkAngles = static_cast<unsigned int>(datasetSlots.size()) * numRotationSteps;
+      ForEachTrainingIndex(numLandmarkAngles, [&](const unsigned int landmarkAngle) {
+        const LandmarkTrainingSlots & slots = datasetSlots[landmarkAngle / numRotationSteps];
+        const unsigned int            currentAngle = landmarkAngle % numRotationSteps;
+        if (currentAngle == 0)
+        {
+          std::cout << "Training template for " << slots.name << std::endl;
+        }
+        const SImageType::PointType origPoint = slots.origPoint;
+        const SImageType::PointType transformedPoint = ACPC_AlignedTransform_INV->TransformPoint(origPoint);
+        /* PRINT FOR TEST /////////////////////////////////////////////
+            std::cout << "original point: " << origPoint << std::endl;
+            std::cout << "transformed point: " << transformedPoint << std::endl;
+        /////////////////////////////////////////////////////////////*/
         // //////  create a rotation about the center with respect to the
         // current test rotation angle
         const float degree_current_angle =
@@ -402,9 +462,9 @@ main(int argc, char * argv[])
         if (globalImagedebugLevel > 5)
         {
           std::stringstream s("");
-          s << "image_" << it->first << "_TestRotated_" << current_angle << "_";
-          const std::string rotatedName = resultsDir + "/" + s.str().c_str() +
-                                          itksys::SystemTools::GetFilenameName(mDef[currentDataset].GetImageFilename());
+          s << "image_" << slots.name << "_TestRotated_" << current_angle << "_";
+          const std::string rotatedName =
+            resultsDir + "/" + s.str().c_str() + itksys::SystemTools::GetFilenameName(datasetImageFilename);
           std::cout << "Writing file: " << rotatedName << std::endl;
           itkUtil::WriteImage<SImageType>(image_TestRotated, rotatedName);
         }
@@ -416,21 +476,23 @@ main(int argc, char * argv[])
         LinearInterpolatorType::Pointer imInterp = LinearInterpolatorType::New();
         imInterp->SetInputImage(image_TestRotated);
         // Resize the model internal vector.
-        myModel.AccessTemplate(it->first, currentDataset, currentAngle)
-          .resize(myModel.m_VectorIndexLocations[it->first].size());
-        extractArray(imInterp,
-                     transformedPoint,
-                     myModel.m_VectorIndexLocations[it->first],
-                     myModel.AccessTemplate(it->first, currentDataset, currentAngle));
-        removeVectorMean(myModel.AccessTemplate(it->first, currentDataset, currentAngle));
-        normalizeVector(myModel.AccessTemplate(it->first, currentDataset, currentAngle));
-      }
-    }
+        FloatVectorType & currentTemplate = *(slots.templates[currentAngle]);
+        currentTemplate.resize(slots.indexLocations->size());
+        extractArray(imInterp, transformedPoint, *(slots.indexLocations), currentTemplate);
+        removeVectorMean(currentTemplate);
+        normalizeVector(currentTemplate);
+      });
+    });
+  }
+  catch (const std::exception & e)
+  {
+    std::cerr << "\n" << e.what() << ", aborting ...\n" << std::endl;
+    return EXIT_FAILURE;
+  }
 
-    if (saveOptimizedLandmarks)
-    {
-      MSPOptFile.close();
-    }
+  if (saveOptimizedLandmarks)
+  {
+    MSPOptFile.close();
   }
 
   /* PRINT FOR TEST ////////////////////////////////////////////
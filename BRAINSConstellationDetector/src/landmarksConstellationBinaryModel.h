@@ -0,0 +1,246 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/**
+ * On disk layout of the binary constellation model (.bmdl) and a read only
+ * file mapping used to load it.
+ *
+ *   BinaryModelHeader                        at offset 0
+ *   BinaryModelLandmarkEntry[numLandmarks]   at header.landmarkTableOffset
+ *   uint64 angleOffsets[numRotationSteps]    at entry.angleOffsetTableOffset
+ *   float  mean[valuesPerAngle]              at angleOffsets[angle]
+ *
+ * All sections start on a BinaryModelAlignment boundary.  Values are stored
+ * in the byte order of the writer, which is recorded by byteOrderMark.
+ */
+#ifndef landmarksConstellationBinaryModel_h
+#define landmarksConstellationBinaryModel_h
+
+#include "itkMacro.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+constexpr std::uint32_t BinaryModelFormatVersion = 1;
+constexpr std::uint32_t BinaryModelByteOrderMark = 0x01020304;
+constexpr std::uint64_t BinaryModelAlignment = 16;
+
+inline const char *
+BinaryModelMagic()
+{
+  return "BCDMODEL";
+}
+
+struct BinaryModelHeader
+{
+  char          magic[8];
+  std::uint32_t formatVersion;
+  std::uint32_t byteOrderMark;
+  char          bcdVersion[32];
+  std::uint32_t searchboxDims;
+  float         resolutionUnits;
+  std::uint32_t numDataSets;
+  std::uint32_t numRotationSteps;
+  std::uint32_t numLandmarks;
+  float         RPPC_to_RPAC_angleMean;
+  float         RPAC_over_RPPCMean;
+  std::uint32_t reserved;
+  double        RPtoPCMean[3];
+  double        CMtoRPMean[3];
+  double        RPtoVN4Mean[3];
+  double        RPtoCECMean[3];
+  double        RPtoACMean[3];
+  std::uint64_t landmarkTableOffset;
+};
+static_assert(sizeof(BinaryModelHeader) == 208, "BinaryModelHeader must not contain padding");
+
+struct BinaryModelLandmarkEntry
+{
+  char          name[48];
+  double        radius;
+  double        height;
+  std::uint64_t valuesPerAngle;
+  std::uint64_t angleOffsetTableOffset;
+};
+static_assert(sizeof(BinaryModelLandmarkEntry) == 80, "BinaryModelLandmarkEntry must not contain padding");
+
+inline std::uint64_t
+AlignBinaryModelOffset(const std::uint64_t offset)
+{
+  return (offset + BinaryModelAlignment - 1) / BinaryModelAlignment * BinaryModelAlignment;
+}
+
+/** Reverse the byte order of a value read from a model written on a machine of the other endianness. */
+template <typename T>
+inline void
+SwapBinaryModelValue(T & value)
+{
+  char * bytes = reinterpret_cast<char *>(&value);
+  std::reverse(bytes, bytes + sizeof(T));
+}
+
+inline void
+SwapBinaryModelHeader(BinaryModelHeader & header)
+{
+  SwapBinaryModelValue(header.formatVersion);
+  SwapBinaryModelValue(header.byteOrderMark);
+  SwapBinaryModelValue(header.searchboxDims);
+  SwapBinaryModelValue(header.resolutionUnits);
+  SwapBinaryModelValue(header.numDataSets);
+  SwapBinaryModelValue(header.numRotationSteps);
+  SwapBinaryModelValue(header.numLandmarks);
+  SwapBinaryModelValue(header.RPPC_to_RPAC_angleMean);
+  SwapBinaryModelValue(header.RPAC_over_RPPCMean);
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    SwapBinaryModelValue(header.RPtoPCMean[i]);
+    SwapBinaryModelValue(header.CMtoRPMean[i]);
+    SwapBinaryModelValue(header.RPtoVN4Mean[i]);
+    SwapBinaryModelValue(header.RPtoCECMean[i]);
+    SwapBinaryModelValue(header.RPtoACMean[i]);
+  }
+  SwapBinaryModelValue(header.landmarkTableOffset);
+}
+
+inline void
+SwapBinaryModelLandmarkEntry(BinaryModelLandmarkEntry & entry)
+{
+  SwapBinaryModelValue(entry.radius);
+  SwapBinaryModelValue(entry.height);
+  SwapBinaryModelValue(entry.valuesPerAngle);
+  SwapBinaryModelValue(entry.angleOffsetTableOffset);
+}
+
+/** True when filename starts with the binary model magic. */
+inline bool
+IsBinaryModelFile(const std::string & filename)
+{
+  std::ifstream input(filename.c_str(), std::ios::binary);
+  char          magic[sizeof(BinaryModelHeader::magic)] = { 0 };
+  input.read(magic, sizeof(magic));
+  return input.good() && std::memcmp(magic, BinaryModelMagic(), sizeof(magic)) == 0;
+}
+
+/** \class landmarksConstellationMappedFile
+ * \brief Read only view of a whole file.
+ *
+ * The file is memory mapped where mmap is available, so pages of the model
+ * are only read from disk when a template is materialized.  Elsewhere the
+ * file is read into memory once.
+ */
+class landmarksConstellationMappedFile
+{
+public:
+  explicit landmarksConstellationMappedFile(const std::string & filename)
+  {
+#if defined(_WIN32)
+    std::ifstream input(filename.c_str(), std::ios::binary | std::ios::ate);
+    if (!input.is_open())
+    {
+      itkGenericExceptionMacro(<< "Can't read " << filename);
+    }
+    m_Buffer.resize(static_cast<std::size_t>(input.tellg()));
+    input.seekg(0);
+    input.read(m_Buffer.data(), m_Buffer.size());
+    if (!input.good())
+    {
+      itkGenericExceptionMacro(<< "Can't read " << filename);
+    }
+#else
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+      itkGenericExceptionMacro(<< "Can't read " << filename);
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+      close(fd);
+      itkGenericExceptionMacro(<< "Can't stat " << filename);
+    }
+    m_Size = static_cast<std::size_t>(fileStat.st_size);
+    if (m_Size > 0)
+    {
+      void * address = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address == MAP_FAILED)
+      {
+        close(fd);
+        itkGenericExceptionMacro(<< "Can't map " << filename);
+      }
+      m_Address = address;
+    }
+    close(fd);
+#endif
+  }
+
+  ~landmarksConstellationMappedFile()
+  {
+#if !defined(_WIN32)
+    if (m_Address != nullptr)
+    {
+      munmap(m_Address, m_Size);
+    }
+#endif
+  }
+
+  landmarksConstellationMappedFile(const landmarksConstellationMappedFile &) = delete;
+  landmarksConstellationMappedFile &
+  operator=(const landmarksConstellationMappedFile &) = delete;
+
+  const char *
+  GetData() const
+  {
+#if defined(_WIN32)
+    return m_Buffer.data();
+#else
+    return static_cast<const char *>(m_Address);
+#endif
+  }
+
+  std::size_t
+  GetSize() const
+  {
+#if defined(_WIN32)
+    return m_Buffer.size();
+#else
+    return m_Size;
+#endif
+  }
+
+private:
+#if defined(_WIN32)
+  std::vector<char> m_Buffer;
+#else
+  void *      m_Address{ nullptr };
+  std::size_t m_Size{ 0 };
+#endif
+};
+
+#endif // landmarksConstellationBinaryModel_h
@@ -0,0 +1,62 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Convert a template model between the text header .mdl format and the
+// memory mappable binary model format.
+//
+// For use:
+//             .../landmarksConstellationModelConvert --inputTemplateModel T1.mdl
+//                 --outputTemplateModel T1.bmdl --outputFormat binary
+
+#include "landmarksConstellationModelIO.h"
+#include "landmarksConstellationModelConvertCLP.h"
+#include <BRAINSCommonLib.h>
+
+int
+main(int argc, char * argv[])
+{
+  PARSE_ARGS;
+  BRAINSRegisterAlternateIO();
+
+  if (inputTemplateModel.empty() || outputTemplateModel.empty())
+  {
+    std::cerr << "Both --inputTemplateModel and --outputTemplateModel are required" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    landmarksConstellationModelIO model;
+    model.ReadModelFile(inputTemplateModel);
+    if (outputFormat == "text")
+    {
+      model.WriteModelFile(outputTemplateModel);
+    }
+    else
+    {
+      model.WriteBinaryModelFile(outputTemplateModel);
+    }
+  }
+  catch (itk::ExceptionObject & err)
+  {
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -28,6 +28,7 @@
 #include "landmarksConstellationCommon.h"
 #include "landmarksConstellationTrainingDefinitionIO.h"
 #include "landmarksConstellationModelBase.h"
+#include "landmarksConstellationBinaryModel.h"
 
 #include "itkByteSwapper.h"
 #include "itkIO.h"
@@ -36,8 +37,10 @@
 #include <fstream>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <map>
+#include <memory>
 
 #include "BRAINSConstellationDetectorVersion.h"
 
@@ -261,9 +264,15 @@ public:
     return this->m_TemplateMeans[name];
   }
 
+  // Means read from a binary model are copied out of the mapped file on
+  // first access.
   const Float2DVectorType &
   GetTemplateMeans(const std::string & name)
   {
+    if (this->m_PendingTemplateMeans.find(name) != this->m_PendingTemplateMeans.end())
+    {
+      this->MaterializeTemplateMeans(name);
+    }
     return this->m_TemplateMeans[name];
   }
 
@@ -315,9 +324,11 @@ public:
 #endif
       for (it2 = this->m_TemplateMeansComputed.begin(); it2 != this->m_TemplateMeansComputed.end(); ++it2)
       {
-        ComputeAllMeans(this->m_TemplateMeans[it2->first], this->m_Templates[it2->first]);
-        this->Write(output, this->m_TemplateMeans[it2->first]);
-        this->WritedebugMeanImages(it2->first);
+        this->Write(output, this->GetModelTemplateMeans(it2->first));
+        if (this->m_Templates.find(it2->first) != this->m_Templates.end())
+        {
+          this->WritedebugMeanImages(it2->first);
+        }
       }
 
 #ifdef __USE_OFFSET_DEBUGGING_CODE__
@@ -393,6 +404,11 @@ public:
     //
     //
     // //////////////////////////////////////////////////////////////////////////
+    if (IsBinaryModelFile(filename))
+    {
+      this->ReadBinaryModelFile(filename);
+      return;
+    }
 
     std::ifstream input(filename.c_str()); // open setup file for reading
 
@@ -461,6 +477,8 @@ public:
 
       // initalize the size of m_VectorIndexLocations and m_TemplateMeans
       InitializeModel(false);
+      this->m_PendingTemplateMeans.clear();
+      this->m_MappedModel.reset();
 
 #ifdef __USE_OFFSET_DEBUGGING_CODE__
       this->debugOffset(&input, "before vectors", -1);
@@ -512,6 +530,241 @@ public:
     input.close();
   }
 
+  /**
+   * Write the model as a versioned binary container (see
+   * landmarksConstellationBinaryModel.h).  The template means are stored
+   * per landmark and angle behind an offset table, so a reader can map the
+   * file and copy out only the templates it uses.
+   */
+  void
+  WriteBinaryModelFile(const std::string & filename)
+  {
+    std::vector<std::string> names;
+    for (const auto & computed : this->m_TemplateMeansComputed)
+    {
+      if (computed.first.size() >= sizeof(BinaryModelLandmarkEntry::name))
+      {
+        itkGenericExceptionMacro(<< "Landmark name " << computed.first << " is too long for a binary model");
+      }
+      names.push_back(computed.first);
+    }
+    const std::uint64_t numAngles = this->GetNumRotationSteps();
+
+    BinaryModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BinaryModelMagic(), sizeof(header.magic));
+    header.formatVersion = BinaryModelFormatVersion;
+    header.byteOrderMark = BinaryModelByteOrderMark;
+    std::strncpy(header.bcdVersion, BCDVersionString, sizeof(header.bcdVersion) - 1);
+    header.searchboxDims = this->GetSearchboxDims();
+    header.resolutionUnits = this->GetResolutionUnits();
+    header.numDataSets = this->GetNumDataSets();
+    header.numRotationSteps = this->GetNumRotationSteps();
+    header.numLandmarks = static_cast<std::uint32_t>(names.size());
+    header.RPPC_to_RPAC_angleMean = this->m_RPPC_to_RPAC_angleMean;
+    header.RPAC_over_RPPCMean = this->m_RPAC_over_RPPCMean;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      header.RPtoPCMean[i] = this->m_RPtoXMean["PC"][i];
+      header.CMtoRPMean[i] = this->m_CMtoRPMean[i];
+      header.RPtoVN4Mean[i] = this->m_RPtoXMean["VN4"][i];
+      header.RPtoCECMean[i] = this->m_RPtoCECMean[i];
+      header.RPtoACMean[i] = this->m_RPtoXMean["AC"][i];
+    }
+    header.landmarkTableOffset = AlignBinaryModelOffset(sizeof(BinaryModelHeader));
+
+    // Lay out the offset tables after the landmark table, then the mean data.
+    std::vector<BinaryModelLandmarkEntry>   entries(names.size());
+    std::vector<std::vector<std::uint64_t>> angleOffsets(names.size());
+    std::uint64_t                           offset =
+      AlignBinaryModelOffset(header.landmarkTableOffset + names.size() * sizeof(BinaryModelLandmarkEntry));
+    for (size_t l = 0; l < names.size(); ++l)
+    {
+      std::memset(&entries[l], 0, sizeof(BinaryModelLandmarkEntry));
+      std::strncpy(entries[l].name, names[l].c_str(), sizeof(entries[l].name) - 1);
+      entries[l].radius = this->GetRadius(names[l]);
+      entries[l].height = this->GetHeight(names[l]);
+      entries[l].angleOffsetTableOffset = offset;
+      offset = AlignBinaryModelOffset(offset + numAngles * sizeof(std::uint64_t));
+    }
+    for (size_t l = 0; l < names.size(); ++l)
+    {
+      const Float2DVectorType & means = this->GetModelTemplateMeans(names[l]);
+      if (means.size() != numAngles)
+      {
+        itkGenericExceptionMacro(<< "Template means for " << names[l] << " have " << means.size()
+                                 << " angles, expected " << numAngles);
+      }
+      entries[l].valuesPerAngle = numAngles > 0 ? means[0].size() : 0;
+      for (const auto & angleMeans : means)
+      {
+        if (angleMeans.size() != entries[l].valuesPerAngle)
+        {
+          itkGenericExceptionMacro(<< "Template means for " << names[l] << " differ in size between angles");
+        }
+        angleOffsets[l].push_back(offset);
+        offset = AlignBinaryModelOffset(offset + angleMeans.size() * sizeof(float));
+      }
+    }
+
+    std::ofstream output(filename.c_str(), std::ios::binary);
+    if (!output.is_open())
+    {
+      itkGenericExceptionMacro(<< "Can't write " << filename);
+    }
+    const char padding[BinaryModelAlignment] = { 0 };
+    auto       padTo = [&output, &padding](const std::uint64_t position) {
+      const std::uint64_t current = static_cast<std::uint64_t>(output.tellp());
+      output.write(padding, static_cast<std::streamsize>(position - current));
+    };
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    padTo(header.landmarkTableOffset);
+    output.write(reinterpret_cast<const char *>(entries.data()),
+                 static_cast<std::streamsize>(entries.size() * sizeof(BinaryModelLandmarkEntry)));
+    for (size_t l = 0; l < names.size(); ++l)
+    {
+      padTo(entries[l].angleOffsetTableOffset);
+      output.write(reinterpret_cast<const char *>(angleOffsets[l].data()),
+                   static_cast<std::streamsize>(angleOffsets[l].size() * sizeof(std::uint64_t)));
+    }
+    for (size_t l = 0; l < names.size(); ++l)
+    {
+      const Float2DVectorType & means = this->GetModelTemplateMeans(names[l]);
+      for (size_t a = 0; a < means.size(); ++a)
+      {
+        padTo(angleOffsets[l][a]);
+        output.write(reinterpret_cast<const char *>(means[a].data()),
+                     static_cast<std::streamsize>(means[a].size() * sizeof(float)));
+      }
+    }
+    if (!output.good())
+    {
+      itkGenericExceptionMacro(<< "Write failed for " << filename);
+    }
+    output.close();
+  }
+
+  /**
+   * Read a model written by WriteBinaryModelFile.  Only the header and the
+   * offset tables are parsed here; the file stays mapped and the template
+   * means of a landmark are materialized by its first GetTemplateMeans().
+   */
+  void
+  ReadBinaryModelFile(const std::string & filename)
+  {
+    std::shared_ptr<const landmarksConstellationMappedFile> mapped =
+      std::make_shared<const landmarksConstellationMappedFile>(filename);
+    const char *      data = mapped->GetData();
+    const std::size_t size = mapped->GetSize();
+
+    BinaryModelHeader header;
+    if (size < sizeof(header))
+    {
+      itkGenericExceptionMacro(<< filename << " is too short for a binary model");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, BinaryModelMagic(), sizeof(header.magic)) != 0)
+    {
+      itkGenericExceptionMacro(<< filename << " is not a binary model");
+    }
+    this->m_Swapped = header.byteOrderMark != BinaryModelByteOrderMark;
+    if (this->m_Swapped)
+    {
+      SwapBinaryModelHeader(header);
+      if (header.byteOrderMark != BinaryModelByteOrderMark)
+      {
+        itkGenericExceptionMacro(<< filename << " has an invalid byte order mark");
+      }
+    }
+    if (header.formatVersion != BinaryModelFormatVersion)
+    {
+      itkGenericExceptionMacro(<< "Unsupported binary model format version " << header.formatVersion << " in "
+                               << filename);
+    }
+    header.bcdVersion[sizeof(header.bcdVersion) - 1] = '\0';
+    std::cout << "Input model file version: " << header.bcdVersion << std::endl;
+    if (std::string(header.bcdVersion).compare(BCDVersionString) != 0)
+    {
+      itkGenericExceptionMacro(<< "Input model file is outdated.\n"
+                               << "Input model file version: " << header.bcdVersion
+                               << ", Required version: " << BCDVersionString << std::endl);
+    }
+
+    this->m_SearchboxDims = header.searchboxDims;
+    this->m_ResolutionUnits = header.resolutionUnits;
+    this->m_NumDataSets = header.numDataSets;
+    this->m_NumRotationSteps = header.numRotationSteps;
+    this->m_RPPC_to_RPAC_angleMean = header.RPPC_to_RPAC_angleMean;
+    this->m_RPAC_over_RPPCMean = header.RPAC_over_RPPCMean;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      this->m_RPtoXMean["PC"][i] = header.RPtoPCMean[i];
+      this->m_CMtoRPMean[i] = header.CMtoRPMean[i];
+      this->m_RPtoXMean["VN4"][i] = header.RPtoVN4Mean[i];
+      this->m_RPtoCECMean[i] = header.RPtoCECMean[i];
+      this->m_RPtoXMean["AC"][i] = header.RPtoACMean[i];
+    }
+
+    std::cout << "NumberOfDataSets: " << this->m_NumDataSets << std::endl;
+    std::cout << "SearchBoxDims: " << this->m_SearchboxDims << std::endl;
+    std::cout << "ResolutionUnits: " << this->m_ResolutionUnits << std::endl;
+    std::cout << "NumberOfRotationSteps: " << this->m_NumRotationSteps << std::endl;
+
+    const std::uint64_t numAngles = header.numRotationSteps;
+    if (header.landmarkTableOffset > size ||
+        header.numLandmarks > (size - header.landmarkTableOffset) / sizeof(BinaryModelLandmarkEntry))
+    {
+      itkGenericExceptionMacro(<< filename << " is truncated in the landmark table");
+    }
+    this->m_PendingTemplateMeans.clear();
+    for (std::uint32_t l = 0; l < header.numLandmarks; ++l)
+    {
+      BinaryModelLandmarkEntry entry;
+      std::memcpy(&entry, data + header.landmarkTableOffset + l * sizeof(BinaryModelLandmarkEntry), sizeof(entry));
+      if (this->m_Swapped)
+      {
+        SwapBinaryModelLandmarkEntry(entry);
+      }
+      entry.name[sizeof(entry.name) - 1] = '\0';
+      const std::string name(entry.name);
+
+      this->m_Radius[name] = static_cast<float>(entry.radius);
+      this->m_Height[name] = static_cast<float>(entry.height);
+      this->m_TemplateMeansComputed[name] = true;
+      this->m_TemplateMeans.erase(name);
+      this->m_VectorIndexLocations[name].clear();
+      defineTemplateIndexLocations(this->GetRadius(name), this->GetHeight(name), this->m_VectorIndexLocations[name]);
+      if (entry.valuesPerAngle != this->m_VectorIndexLocations[name].size())
+      {
+        itkGenericExceptionMacro(<< "Template " << name << " in " << filename << " has " << entry.valuesPerAngle
+                                 << " values, expected " << this->m_VectorIndexLocations[name].size());
+      }
+
+      const std::uint64_t valueBytes = entry.valuesPerAngle * sizeof(float);
+      if (entry.angleOffsetTableOffset > size ||
+          numAngles > (size - entry.angleOffsetTableOffset) / sizeof(std::uint64_t))
+      {
+        itkGenericExceptionMacro(<< filename << " is truncated in the offset table of " << name);
+      }
+      PendingTemplateMeans & pending = this->m_PendingTemplateMeans[name];
+      pending.valuesPerAngle = entry.valuesPerAngle;
+      pending.angleOffsets.resize(numAngles);
+      std::memcpy(pending.angleOffsets.data(), data + entry.angleOffsetTableOffset, numAngles * sizeof(std::uint64_t));
+      for (auto & angleOffset : pending.angleOffsets)
+      {
+        if (this->m_Swapped)
+        {
+          SwapBinaryModelValue(angleOffset);
+        }
+        if (angleOffset > size || valueBytes > size - angleOffset)
+        {
+          itkGenericExceptionMacro(<< filename << " is truncated in the template means of " << name);
+        }
+      }
+    }
+    this->m_MappedModel = mapped;
+  }
+
   class debugImageDescriptor
   {
   public:
@@ -704,7 +957,7 @@ public:
     {
       if ((NE(this->GetRadius(it2->first), other.GetRadius(it2->first))) ||
           (NE(this->GetHeight(it2->first), other.GetHeight(it2->first))) ||
-          (NE(it2->first + " template mean", this->m_TemplateMeans[it2->first], other.m_TemplateMeans[it2->first])))
+          (NE(it2->first + " template mean", this->GetTemplateMeans(it2->first), other.GetTemplateMeans(it2->first))))
       {
         return false;
       }
@@ -729,6 +982,52 @@ public:
 private:
   bool m_Swapped;
 
+  // Location of the not yet materialized means of one landmark in m_MappedModel.
+  struct PendingTemplateMeans
+  {
+    std::uint64_t              valuesPerAngle{ 0 };
+    std::vector<std::uint64_t> angleOffsets;
+  };
+
+  void
+  MaterializeTemplateMeans(const std::string & name)
+  {
+    const PendingTemplateMeans & pending = this->m_PendingTemplateMeans[name];
+    Float2DVectorType &          means = this->m_TemplateMeans[name];
+    means.resize(pending.angleOffsets.size());
+    for (size_t a = 0; a < means.size(); ++a)
+    {
+      means[a].resize(pending.valuesPerAngle);
+      std::memcpy(
+        means[a].data(), this->m_MappedModel->GetData() + pending.angleOffsets[a], means[a].size() * sizeof(float));
+      if (this->m_Swapped)
+      {
+        for (auto & value : means[a])
+        {
+          SwapBinaryModelValue(value);
+        }
+      }
+    }
+    this->m_PendingTemplateMeans.erase(name);
+    if (this->m_PendingTemplateMeans.empty())
+    {
+      this->m_MappedModel.reset();
+    }
+  }
+
+  // The means to store for a landmark: recomputed from the training
+  // templates when building a model, otherwise the means that were read.
+  const Float2DVectorType &
+  GetModelTemplateMeans(const std::string & name)
+  {
+    if (this->m_Templates.find(name) != this->m_Templates.end())
+    {
+      ComputeAllMeans(this->m_TemplateMeans[name], this->m_Templates[name]);
+      return this->m_TemplateMeans[name];
+    }
+    return this->GetTemplateMeans(name);
+  }
+
   template <typename T>
   void
   Write(std::ofstream & f, T var)
@@ -821,6 +1120,10 @@ private:
   SImageType::PointType::VectorType m_CMtoRPMean;
   float                             m_RPPC_to_RPAC_angleMean;
   float                             m_RPAC_over_RPPCMean;
+
+  // Copies of a model share the mapping of its binary model file.
+  std::shared_ptr<const landmarksConstellationMappedFile> m_MappedModel;
+  std::map<std::string, PendingTemplateMeans>             m_PendingTemplateMeans;
 };
 
 #endif // landmarksConstellationModelIO_h
@@ -18,10 +18,10 @@
  *=========================================================================*/
 #include "BRAINSCreateLabelMapFromProbabilityMapsCLP.h"
 #include "BRAINSComputeLabels.h"
+#include "BRAINSProbabilityMapArgMax.h"
 #include "BRAINSCommonLib.h"
 #include "itkIO.h"
 #include "itkImage.h"
-#include "itkImageFileReader.h"
 int
 main(int argc, char * argv[])
 {
@@ -31,7 +31,6 @@ main(int argc, char * argv[])
   using ProbabilityImageType = itk::Image<float, 3>;
   using FloatingPointPrecision = double;
 
-  using ProbabilityImageVectorType = std::vector<ProbabilityImageType::Pointer>;
   using BoolVectorType = std::vector<bool>;
   using UnsignedIntVectorType = vnl_vector<unsigned int>;
 
@@ -41,29 +40,11 @@ main(int argc, char * argv[])
     return 1;
   }
 
-  ProbabilityImageVectorType Posteriors;
-  for (auto & i : inputProbabilityVolume)
+  if (priorLabelCodes.size() != inputProbabilityVolume.size())
   {
-    using ImageReaderType = itk::ImageFileReader<ProbabilityImageType>;
-    ImageReaderType::Pointer reader = ImageReaderType::New();
-    reader->SetFileName(i);
-    ProbabilityImageType::Pointer current;
-    try
-    {
-      reader->Update();
-      current = reader->GetOutput();
-    }
-    catch (itk::ExceptionObject & err)
-    {
-      std::cerr << err << " " << __FILE__ << " " << __LINE__ << std::endl;
-      return 1;
-    }
-    Posteriors.push_back(current);
-  }
-
-  if (priorLabelCodes.empty())
-  {
-    std::cerr << "Missing prior label codes" << std::endl;
+    std::cerr << "Expected " << inputProbabilityVolume.size() << " prior label codes, got " << priorLabelCodes.size()
+              << std::endl;
+    return 1;
   }
 
   UnsignedIntVectorType priorLabels;
@@ -73,9 +54,11 @@ main(int argc, char * argv[])
     priorLabels[i] = priorLabelCodes[i];
   }
 
-  if (foregroundPriors.empty())
+  if (foregroundPriors.size() != inputProbabilityVolume.size())
   {
-    std::cerr << "Missing prior label codes" << std::endl;
+    std::cerr << "Expected " << inputProbabilityVolume.size() << " foreground priors, got "
+              << foregroundPriors.size() << std::endl;
+    return 1;
   }
 
   BoolVectorType priorIsForeground;
@@ -84,41 +67,28 @@ main(int argc, char * argv[])
     priorIsForeground.push_back(foregroundPrior);
   }
 
-  ByteImageType::Pointer nonAirVolume;
-  if (nonAirRegionMask.empty())
-  {
-    nonAirVolume = ByteImageType::New();
-    ByteImageType::RegionType region = Posteriors[0]->GetLargestPossibleRegion();
-    nonAirVolume->CopyInformation(Posteriors[0]);
-    nonAirVolume->SetRegions(region);
-    nonAirVolume->Allocate();
-    ByteImageType::PixelType one = 1;
-    nonAirVolume->FillBuffer(one);
-  }
-  else
-  {
-    using ImageReaderType = itk::ImageFileReader<ByteImageType>;
-    ImageReaderType::Pointer reader = ImageReaderType::New();
-    reader->SetFileName(nonAirRegionMask);
-    try
-    {
-      reader->Update();
-      nonAirVolume = reader->GetOutput();
-    }
-    catch (itk::ExceptionObject & err)
-    {
-      std::cerr << err << " " << __FILE__ << " " << __LINE__ << std::endl;
-      return 1;
-    }
-  }
-
+  // Maximum a posteriori labels, as ComputeLabels assigns them, with the
+  // posteriors and the non air mask streamed slab by slab
   ByteImageType::Pointer dirtyLabels;
   ByteImageType::Pointer cleanLabels;
-
   try
   {
-    ComputeLabels<ProbabilityImageType, ByteImageType, FloatingPointPrecision>(
-      Posteriors, priorIsForeground, priorLabels, nonAirVolume, dirtyLabels, cleanLabels, inclusionThreshold, 0);
+    std::cout << "\nComputing labels..." << std::endl;
+    ProbabilityMapArgMaxStreamer<ProbabilityImageType> argMax(inputProbabilityVolume, nonAirRegionMask);
+    dirtyLabels = argMax.AllocateImage<ByteImageType>();
+    ByteImageType::Pointer foregroundMask = argMax.AllocateImage<ByteImageType>();
+
+    ByteImageType::PixelType * dirtyBuffer = dirtyLabels->GetBufferPointer();
+    ByteImageType::PixelType * foregroundBuffer = foregroundMask->GetBufferPointer();
+    argMax.Run([&](const itk::OffsetValueType offset, const unsigned int classIndex, const float maximum) {
+      unsigned int label;
+      bool         fgflag;
+      LabelFromMaximumPosterior<FloatingPointPrecision>(
+        maximum, classIndex, priorIsForeground, priorLabels, inclusionThreshold, label, fgflag);
+      dirtyBuffer[offset] = label;
+      foregroundBuffer[offset] = fgflag;
+    });
+    cleanLabels = ExtractSingleLargestRegionFromMask(foregroundMask, 0, 0, 0, dirtyLabels);
   }
   catch (itk::ExceptionObject & err)
   {
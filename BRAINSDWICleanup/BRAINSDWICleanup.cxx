@@ -16,39 +16,28 @@
  *  limitations under the License.
  *
  *=========================================================================*/
-#include "itkImageRegionConstIterator.h"
-#include "itkImageRegionIterator.h"
 #include "itkVectorImage.h"
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
+#include "itkStreamingImageFilter.h"
+#include "itkVectorImageComponentSelectionFilter.h"
 #include "DWIMetaDataDictionaryValidator.h"
 #include "BRAINSDWICleanupCLP.h"
+#include <algorithm>
 #include <list>
 #include <vector>
-#include <list>
 
 using PixelType = signed short;
 using NrrdImageType = itk::VectorImage<PixelType, 3>;
 using SingleComponentImageType = itk::Image<PixelType, 3>;
 using ReaderType = itk::ImageFileReader<NrrdImageType, itk::DefaultConvertPixelTraits<PixelType>>;
 
+using SelectionFilterType = itk::VectorImageComponentSelectionFilter<NrrdImageType>;
+using StreamerType = itk::StreamingImageFilter<NrrdImageType, NrrdImageType>;
 using WriterType = itk::ImageFileWriter<NrrdImageType>;
 
 using GradStringVector = std::vector<std::string>;
 
-template <typename TImage>
-TImage *
-AllocVecImage(const itk::ImageBase<TImage::ImageDimension> * templateImage, unsigned long vecSize)
-{
-  typename TImage::Pointer p1 = TImage::New();
-  p1->CopyInformation(templateImage);
-  p1->SetRegions(templateImage->GetLargestPossibleRegion());
-  p1->SetNumberOfComponentsPerPixel(vecSize);
-  p1->Allocate();
-  p1.GetPointer()->Register();
-  return p1.GetPointer();
-}
-
 class inBadList
 {
 public:
@@ -92,21 +81,22 @@ main(int argc, char * argv[])
     std::cerr << "Missing output NRRD file name" << std::endl;
     return 1;
   }
+  // Only the header is read here, the voxels are read slab by slab below
   ReaderType::Pointer imageReader = ReaderType::New();
   imageReader->SetFileName(inputVolume);
   try
   {
-    imageReader->Update();
+    imageReader->UpdateOutputInformation();
   }
   catch (itk::ExceptionObject & ex)
   {
     std::cout << ex << std::endl;
     throw;
   }
-  std::cout << "Read Input Image..." << std::endl;
-  NrrdImageType::Pointer inImage = imageReader->GetOutput();
+  std::cout << "Read Input Image Information..." << std::endl;
+  const itk::MetaDataDictionary inputMetaDataDictionary = imageReader->GetOutput()->GetMetaDataDictionary();
 
-  unsigned int numInputGradients = inImage->GetNumberOfComponentsPerPixel();
+  unsigned int numInputGradients = imageReader->GetOutput()->GetNumberOfComponentsPerPixel();
   unsigned int newGradientCount = numInputGradients - badGradients.size();
 
   //
@@ -128,27 +118,38 @@ main(int argc, char * argv[])
     return 1;
   }
 
-  // create output volume
-  NrrdImageType::Pointer outImage = AllocVecImage<NrrdImageType>(inImage, newGradientCount);
-
-  // copy input vector pixels to output, skipping the bad gradients.
-  itk::ImageRegionConstIterator<NrrdImageType> inIt(inImage, inImage->GetLargestPossibleRegion());
-  itk::ImageRegionIterator<NrrdImageType>      outIt(outImage, outImage->GetLargestPossibleRegion());
-  for (; !inIt.IsAtEnd(); ++inIt, ++outIt)
+  // Copy the kept components slab by slab, each slab multi-threaded.  When
+  // the input encoding can be streamed (raw NRRD) only the output and one
+  // input slab of about maxBytesPerSlab are resident; compressed inputs are
+  // read whole with the first slab.
+  constexpr itk::SizeValueType maxBytesPerSlab = 256UL * 1024UL * 1024UL;
+  const itk::SizeValueType     inputBytes =
+    imageReader->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels() * numInputGradients * sizeof(PixelType);
+  const itk::SizeValueType     numberOfSlabs =
+    std::max<itk::SizeValueType>(1, (inputBytes + maxBytesPerSlab - 1) / maxBytesPerSlab);
+
+  SelectionFilterType::Pointer selector = SelectionFilterType::New();
+  selector->SetInput(imageReader->GetOutput());
+  selector->SetComponentIndices(SelectionFilterType::ComponentIndicesType(keepIndices.begin(), keepIndices.end()));
+
+  StreamerType::Pointer streamer = StreamerType::New();
+  streamer->SetInput(selector->GetOutput());
+  streamer->SetNumberOfStreamDivisions(static_cast<unsigned int>(numberOfSlabs));
+  try
   {
-    NrrdImageType::PixelType inPix = inIt.Get();
-    NrrdImageType::PixelType outpix(newGradientCount);
-    auto                     keepIt = keepIndices.begin();
-    for (unsigned int i = 0; i < newGradientCount; ++i, ++keepIt)
-    {
-      outpix[i] = inPix[*(keepIt)];
-    }
-    outIt.Set(outpix);
+    streamer->Update();
+  }
+  catch (itk::ExceptionObject & ex)
+  {
+    std::cout << ex << std::endl;
+    return 1;
   }
+  NrrdImageType::Pointer outImage = streamer->GetOutput();
+  outImage->DisconnectPipeline();
 
   // deal with gradients in meta data
   DWIMetaDataDictionaryValidator nrrdMetaDataValidator;
-  nrrdMetaDataValidator.SetMetaDataDictionary(inImage->GetMetaDataDictionary());
+  nrrdMetaDataValidator.SetMetaDataDictionary(inputMetaDataDictionary);
 
   // Get gradient table and update the gradient vectors based on keepIndices
   DWIMetaDataDictionaryValidator::GradientTableType inputGradTable = nrrdMetaDataValidator.GetGradientTable();
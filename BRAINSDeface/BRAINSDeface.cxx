@@ -6,6 +6,7 @@
 //
 #include <iostream>
 #include <list>
+#include <mutex>
 #include <itkSmoothingRecursiveGaussianImageFilter.h>
 
 #include <BRAINSDefaceCLP.h>
@@ -20,6 +21,9 @@
 #include "itkConstantPadImageFilter.h"
 #include "BRAINSCommonLib.h"
 #include "itkUnaryGeneratorImageFilter.h"
+#include "itkExtractImageFilter.h"
+#include "itkImageScanlineIterator.h"
+#include "itkMultiThreaderBase.h"
 
 
 /*
@@ -333,83 +337,183 @@ main(int argc, char * argv[])
     }
     passiveVolume.clear();
 
+    const bool use_zeros_face = (defaceMode == "zero");
     for (auto & curr_img : img_list)
     {
-      // pre-compute different levels of gaussian blur
-      InternalImageType::Pointer                                      blurredImages[numSigmas];
-      itk::LinearInterpolateImageFunction<InternalImageType>::Pointer blurredImageInterpolators[numSigmas];
-      using BlurFilter = itk::SmoothingRecursiveGaussianImageFilter<FadeMapType, FadeMapType>;
-      for (size_t i = 0; i < numSigmas; ++i)
-      {
-        BlurFilter::Pointer blur = BlurFilter::New();
-        blur->SetInput(curr_img);
-        blur->SetSigma(sigmas[i]);
-        blur->Update();
-        blurredImages[i] = blur->GetOutput();
-        blurredImageInterpolators[i] = itk::LinearInterpolateImageFunction<InternalImageType>::New();
-        blurredImageInterpolators[i]->SetInputImage(blurredImages[i]);
-        if (debugLevel >= 5)
-        {
-          itkUtil::WriteImage<InternalImageType>(blur->GetOutput(),
-                                                 outputDirectory + "/blur_img_" + std::to_string(i) + ".nii.gz");
-        }
-      }
-
-      const bool                                           use_zeros_face = (defaceMode == "zero");
-      InternalImageType::PointType                         imgpnt;
-      itk::ImageRegionIteratorWithIndex<InternalImageType> iit(curr_img, curr_img->GetLargestPossibleRegion());
-      while (!iit.IsAtEnd())
-      {
-        const auto & curr_index{ iit.GetIndex() };
-        curr_img->TransformIndexToPhysicalPoint<double>(curr_index, imgpnt);
-        if (maskInterpolator->IsInsideBuffer(imgpnt) && distanceMapInterpolator->IsInsideBuffer(imgpnt))
-        {
-          const MaskImageType::PixelType mask_value = maskInterpolator->Evaluate(imgpnt);
-          if (mask_value == valid_inside_pixel)
+      // Per voxel blur level: a sigma index, or one of the codes below
+      using BlurLevelImageType = itk::Image<signed char, 3>;
+      constexpr BlurLevelImageType::PixelType keep_level = -1;
+      constexpr BlurLevelImageType::PixelType zero_level = -2;
+
+      const InternalImageType::RegionType imgRegion = curr_img->GetLargestPossibleRegion();
+      BlurLevelImageType::Pointer         blurLevels = BlurLevelImageType::New();
+      blurLevels->CopyInformation(curr_img);
+      blurLevels->SetRegions(imgRegion);
+      blurLevels->Allocate();
+
+      // Classify every voxel in index space.  Each scanline is mapped once into the continuous
+      // index space of the mask (the padded distance map shares that index space), then stepped.
+      // The bounding box of the voxels that need blurring is gathered at the same time.
+      InternalImageType::IndexType blurLower;
+      blurLower.Fill(itk::NumericTraits<itk::IndexValueType>::max());
+      InternalImageType::IndexType blurUpper;
+      blurUpper.Fill(itk::NumericTraits<itk::IndexValueType>::NonpositiveMin());
+      int        maxSigmaIndex = -1;
+      std::mutex blurBoundsMutex;
+
+      using ContinuousIndexType = itk::ContinuousIndex<double, 3>;
+      itk::MultiThreaderBase::New()->ParallelizeImageRegion<3>(
+        imgRegion,
+        [&](const InternalImageType::RegionType & chunk) {
+          InternalImageType::IndexType localLower = blurLower;
+          InternalImageType::IndexType localUpper = blurUpper;
+          int                          localMaxSigmaIndex = -1;
+
+          itk::ImageScanlineIterator<BlurLevelImageType> lit(blurLevels, chunk);
+          while (!lit.IsAtEnd())
           {
-            // Pass
-          }
-          else if (mask_value == face_rm || mask_value == auto_roi_background || mask_value == eye_boxes_code)
-          {
-            const InternalImageType::PixelType distanceValue = distanceMapInterpolator->Evaluate(imgpnt);
-            // determine the correct blur value
-            int              sigmaIndex = 0;
-            constexpr double sigma_distance_ratio = 1.0; // Factor of sigma smoothing to distance ratio
-            for (size_t i = 0; i < numSigmas; ++i)
+            InternalImageType::IndexType lineIndex = lit.GetIndex();
+            InternalImageType::PointType linePnt;
+            ContinuousIndexType          maskCIndex;
+            ContinuousIndexType          nextMaskCIndex;
+            curr_img->TransformIndexToPhysicalPoint<double>(lineIndex, linePnt);
+            mask_labels->TransformPhysicalPointToContinuousIndex(linePnt, maskCIndex);
+            ++lineIndex[0];
+            curr_img->TransformIndexToPhysicalPoint<double>(lineIndex, linePnt);
+            mask_labels->TransformPhysicalPointToContinuousIndex(linePnt, nextMaskCIndex);
+            const auto maskCIndexStep = nextMaskCIndex - maskCIndex;
+
+            while (!lit.IsAtEndOfLine())
             {
-              if (sigmas[i] * sigma_distance_ratio < distanceValue)
+              BlurLevelImageType::PixelType level = zero_level;
+              if (maskInterpolator->IsInsideBuffer(maskCIndex) && distanceMapInterpolator->IsInsideBuffer(maskCIndex))
               {
-                sigmaIndex = i;
+                const MaskImageType::PixelType mask_value = maskInterpolator->EvaluateAtContinuousIndex(maskCIndex);
+                if (mask_value == valid_inside_pixel)
+                {
+                  level = keep_level;
+                }
+                else if (!use_zeros_face &&
+                         (mask_value == face_rm || mask_value == auto_roi_background || mask_value == eye_boxes_code))
+                {
+                  const InternalImageType::PixelType distanceValue =
+                    distanceMapInterpolator->EvaluateAtContinuousIndex(maskCIndex);
+                  // determine the correct blur value
+                  int              sigmaIndex = 0;
+                  constexpr double sigma_distance_ratio = 1.0; // Factor of sigma smoothing to distance ratio
+                  for (size_t i = 0; i < numSigmas; ++i)
+                  {
+                    if (sigmas[i] * sigma_distance_ratio < distanceValue)
+                    {
+                      sigmaIndex = i;
+                    }
+                  }
+                  level = static_cast<BlurLevelImageType::PixelType>(sigmaIndex);
+                  localMaxSigmaIndex = std::max(localMaxSigmaIndex, sigmaIndex);
+                  const auto & curr_index = lit.GetIndex();
+                  for (size_t d = 0; d < 3; ++d)
+                  {
+                    localLower[d] = std::min(localLower[d], curr_index[d]);
+                    localUpper[d] = std::max(localUpper[d], curr_index[d]);
+                  }
+                }
               }
+              lit.Set(level);
+              maskCIndex += maskCIndexStep;
+              ++lit;
             }
-            if (blurredImageInterpolators[sigmaIndex]->IsInsideBuffer(imgpnt))
-            {
-              const InternalImageType::PixelType blurredValue{
-                use_zeros_face
-                  ? 0.0F
-                  : static_cast<InternalImageType::PixelType>(blurredImageInterpolators[sigmaIndex]->Evaluate(imgpnt))
-              };
-              iit.Set(blurredValue);
-              // iit.Set(sigmas[sigmaIndex]* 100);
-            }
-            else
-            {
-              iit.Set(0);
-            }
+            lit.NextLine();
           }
-          else
+
+          std::lock_guard<std::mutex> lock(blurBoundsMutex);
+          maxSigmaIndex = std::max(maxSigmaIndex, localMaxSigmaIndex);
+          for (size_t d = 0; d < 3; ++d)
           {
-            iit.Set(0);
+            blurLower[d] = std::min(blurLower[d], localLower[d]);
+            blurUpper[d] = std::max(blurUpper[d], localUpper[d]);
           }
+        },
+        nullptr);
+
+      if (maxSigmaIndex >= 0)
+      {
+        // Crop to the face region plus the support of the widest kernel used, so that
+        // the blur stack is only built where it is sampled.
+        constexpr double                     kernel_support_in_sigmas = 3.0;
+        const InternalImageType::SpacingType spacing = curr_img->GetSpacing();
+        InternalImageType::RegionType        cropRegion;
+        for (size_t d = 0; d < 3; ++d)
+        {
+          const auto margin =
+            static_cast<itk::IndexValueType>(std::ceil(kernel_support_in_sigmas * sigmas[maxSigmaIndex] / spacing[d]));
+          cropRegion.SetIndex(d, blurLower[d] - margin);
+          cropRegion.SetSize(d, static_cast<itk::SizeValueType>(blurUpper[d] - blurLower[d] + 1 + 2 * margin));
         }
-        else
+        cropRegion.Crop(imgRegion);
+
+        using ExtractFilterType = itk::ExtractImageFilter<InternalImageType, InternalImageType>;
+        ExtractFilterType::Pointer extract = ExtractFilterType::New();
+        extract->SetInput(curr_img);
+        extract->SetExtractionRegion(cropRegion);
+        extract->SetDirectionCollapseToSubmatrix();
+        extract->Update();
+        InternalImageType::Pointer blurredImage = extract->GetOutput();
+        blurredImage->DisconnectPipeline();
+
+        // Build the stack incrementally, each level blurs the previous one by the
+        // difference in variance, and only the current level is kept alive.
+        using BlurFilter = itk::SmoothingRecursiveGaussianImageFilter<FadeMapType, FadeMapType>;
+        double previousSigma = 0.0;
+        for (int i = 0; i <= maxSigmaIndex; ++i)
         {
-          iit.Set(0);
+          BlurFilter::Pointer blur = BlurFilter::New();
+          blur->SetInput(blurredImage);
+          blur->SetSigma(std::sqrt(sigmas[i] * sigmas[i] - previousSigma * previousSigma));
+          blur->Update();
+          blurredImage = blur->GetOutput();
+          blurredImage->DisconnectPipeline();
+          previousSigma = sigmas[i];
+          if (debugLevel >= 5)
+          {
+            itkUtil::WriteImage<InternalImageType>(blurredImage,
+                                                   outputDirectory + "/blur_img_" + std::to_string(i) + ".nii.gz");
+          }
+
+          const auto currentLevel = static_cast<BlurLevelImageType::PixelType>(i);
+          itk::MultiThreaderBase::New()->ParallelizeImageRegion<3>(
+            cropRegion,
+            [&](const InternalImageType::RegionType & chunk) {
+              itk::ImageRegionConstIterator<BlurLevelImageType> lit(blurLevels, chunk);
+              itk::ImageRegionConstIterator<InternalImageType>  bit(blurredImage, chunk);
+              itk::ImageRegionIterator<InternalImageType>       iit(curr_img, chunk);
+              for (; !iit.IsAtEnd(); ++iit, ++bit, ++lit)
+              {
+                if (lit.Get() == currentLevel)
+                {
+                  iit.Set(bit.Get());
+                }
+              }
+            },
+            nullptr);
         }
-        ++iit;
       }
-    }
 
+      // Blank out everything that is neither kept nor blurred
+      itk::MultiThreaderBase::New()->ParallelizeImageRegion<3>(
+        imgRegion,
+        [&](const InternalImageType::RegionType & chunk) {
+          itk::ImageRegionConstIterator<BlurLevelImageType> lit(blurLevels, chunk);
+          itk::ImageRegionIterator<InternalImageType>       iit(curr_img, chunk);
+          for (; !iit.IsAtEnd(); ++iit, ++lit)
+          {
+            if (lit.Get() == zero_level)
+            {
+              iit.Set(0);
+            }
+          }
+        },
+        nullptr);
+    }
 
 
     // STEP 3 Generate intensity normalized images from the clippings.
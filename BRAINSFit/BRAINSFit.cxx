@@ -496,6 +496,7 @@ main(int argc, char * argv[])
     myHelper->SetInitializeRegistrationByCurrentGenericTransform(initializeRegistrationByCurrentGenericTransform);
     myHelper->SetMaximumNumberOfEvaluations(maximumNumberOfEvaluations);
     myHelper->SetMaximumNumberOfCorrections(maximumNumberOfCorrections);
+    myHelper->SetDeterministicBSplineMetric(!fastBSplineMetricGradient);
     myHelper->SetWriteOutputTransformInFloat(writeOutputTransformInFloat);
 
     // HACK: create a flag for normalization
@@ -411,10 +411,8 @@ main(int argc, char * argv[])
       { // HACK:  Need to make handeling of transforms more elegant as is done
         // in BRAINSFitHelper.
         using ConverterType = itk::TransformToDisplacementFieldFilter<DisplacementFieldType, double>;
-        ConverterType::Pointer myConverter = ConverterType::New();
-        myConverter->SetTransform(genericTransform);
-        myConverter->SetReferenceImage(TransformedImage);
-        myConverter->SetUseReferenceImage(true);
+        ConverterType::Pointer myConverter =
+          MakeTransformToDisplacementFieldFilter<DisplacementFieldType, double>(TransformedImage, genericTransform);
         myConverter->Update();
         DisplacementField = myConverter->GetOutput();
       }
@@ -22,12 +22,12 @@
 #include "itkImageFileReader.h"
 #include "itkBSplineDeformableTransform.h"
 #include "itkIO.h"
-#include "itkImageRegionIterator.h"
 #include "GenericTransformImage.h"
 #include "itkTranslationTransform.h"
 #include "itkCompositeTransform.h"
 #include "itkDisplacementFieldTransform.h"
 #include "itkComposeDisplacementFieldsImageFilter.h"
+#include "TransformToDisplacementField.h"
 
 //
 // transform ranking,
@@ -271,36 +271,30 @@ DoConversion(int argc, char * argv[])
     CHECK_PARAMETER_IS_SET(referenceVolume, "Missing referenceVolume needed for Displacement Field output");
     CHECK_PARAMETER_IS_SET(displacementVolume, "Missing displacementVolume needed for Displacement Field output");
 
+    // Only the grid of the reference volume is needed, so avoid loading its voxels.
     using ReferenceImageType = itk::Image<short, 3>;
-    ReferenceImageType::Pointer referenceImage = itkUtil::ReadImage<ReferenceImageType>(referenceVolume);
-    if (referenceImage.IsNull())
+    using ReferenceReaderType = itk::ImageFileReader<ReferenceImageType>;
+    ReferenceReaderType::Pointer referenceReader = ReferenceReaderType::New();
+    referenceReader->SetFileName(referenceVolume);
+    try
     {
-      std::cerr << "Can't read Reference Volume " << referenceVolume << std::endl;
-      return EXIT_FAILURE;
+      referenceReader->UpdateOutputInformation();
     }
-    // Allocate Displacement Field
-    using VectorType = itk::Vector<float, 3>;
-    using DisplacementFieldType = itk::Image<VectorType, 3>;
-    DisplacementFieldType::Pointer displacementField =
-      itkUtil::AllocateImageFromExample<ReferenceImageType, DisplacementFieldType>(referenceImage);
-
-    using DisplacementIteratorType = itk::ImageRegionIterator<DisplacementFieldType>;
-    for (DisplacementIteratorType it(displacementField, displacementField->GetLargestPossibleRegion()); !it.IsAtEnd();
-         ++it)
+    catch (itk::ExceptionObject & excp)
     {
-      DisplacementFieldType::IndexType dispIndex = it.GetIndex();
-      DisplacementFieldType::PointType fixedPoint;
-
-      DisplacementFieldType::PointType movingPoint;
-      displacementField->TransformIndexToPhysicalPoint(dispIndex, fixedPoint);
-      movingPoint = inputXfrm->TransformPoint(fixedPoint);
-      VectorType displacement = movingPoint - fixedPoint;
-      it.Set(displacement);
+      std::cerr << "Can't read Reference Volume " << referenceVolume << ": " << excp.GetDescription() << std::endl;
+      return EXIT_FAILURE;
     }
 
+    // Linear runs of the transform are flattened, the field is evaluated
+    // in parallel, and with noCompression streamed to disk in slabs when
+    // the output format allows it.
+    using VectorType = itk::Vector<float, 3>;
+    using DisplacementFieldType = itk::Image<VectorType, 3>;
     try
     {
-      itkUtil::WriteImage<DisplacementFieldType>(displacementField, displacementVolume);
+      WriteTransformAsDisplacementField<DisplacementFieldType, TScalarType>(
+        referenceReader->GetOutput(), inputXfrm.GetPointer(), displacementVolume, !noCompression);
     }
     catch (...)
     {
@@ -0,0 +1,232 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "castconverthelpers.h"
+
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMetaDataObject.h"
+
+#include <itksys/SystemTools.hxx>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+// Write a synthetic DICOM series whose file names run against the slice
+// positions and read it back as castconvert does.  ImageSeriesReader must give
+// the slice order, geometry and voxels of the synthetic volume, and
+// ReadDicomSeriesInParallel those of ImageSeriesReader.
+//
+//   ReadDicomSeriesInParallelTest outputDirectory
+
+using PixelType = short;
+using ImageType = itk::Image<PixelType, 3>;
+using SliceType = itk::Image<PixelType, 2>;
+
+static constexpr unsigned int NumberOfSlices = 7;
+
+static PixelType
+SyntheticValue(const ImageType::IndexType & index)
+{
+  return static_cast<PixelType>(index[0] + 3 * index[1] + 100 * index[2] - 200);
+}
+
+static ImageType::Pointer
+MakeVolume()
+{
+  ImageType::SizeType size;
+  size[0] = 24;
+  size[1] = 18;
+  size[2] = NumberOfSlices;
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.75;
+  spacing[1] = 1.25;
+  spacing[2] = 2.5;
+  ImageType::PointType origin;
+  origin[0] = -12.5;
+  origin[1] = 30.0;
+  origin[2] = 4.0;
+
+  ImageType::Pointer volume = ImageType::New();
+  volume->SetRegions(size);
+  volume->SetSpacing(spacing);
+  volume->SetOrigin(origin);
+  volume->Allocate();
+  itk::ImageRegionIteratorWithIndex<ImageType> it(volume, volume->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    it.Set(SyntheticValue(it.GetIndex()));
+  }
+  return volume;
+}
+
+// Slice k goes to file NumberOfSlices - 1 - k, so the file names sort in the
+// opposite order of the positions
+static void
+WriteSeries(const ImageType * volume, const std::string & directory)
+{
+  const ImageType::SizeType size = volume->GetLargestPossibleRegion().GetSize();
+  for (unsigned int k = 0; k < NumberOfSlices; k++)
+  {
+    SliceType::SizeType sliceSize;
+    sliceSize[0] = size[0];
+    sliceSize[1] = size[1];
+    SliceType::SpacingType sliceSpacing;
+    sliceSpacing[0] = volume->GetSpacing()[0];
+    sliceSpacing[1] = volume->GetSpacing()[1];
+    SliceType::Pointer slice = SliceType::New();
+    slice->SetRegions(sliceSize);
+    slice->SetSpacing(sliceSpacing);
+    slice->Allocate();
+    std::copy(volume->GetBufferPointer() + k * size[0] * size[1],
+              volume->GetBufferPointer() + (k + 1) * size[0] * size[1],
+              slice->GetBufferPointer());
+
+    ImageType::IndexType firstVoxel;
+    firstVoxel[0] = 0;
+    firstVoxel[1] = 0;
+    firstVoxel[2] = k;
+    ImageType::PointType position;
+    volume->TransformIndexToPhysicalPoint(firstVoxel, position);
+    std::ostringstream positionString;
+    positionString << position[0] << "\\" << position[1] << "\\" << position[2];
+    std::ostringstream instanceNumber;
+    instanceNumber << k + 1;
+    const std::string instanceUID = "1.2.826.0.1.3680043.2.1125.1.4." + instanceNumber.str();
+
+    itk::GDCMImageIO::Pointer dicomIO = itk::GDCMImageIO::New();
+    dicomIO->KeepOriginalUIDOn();
+    itk::MetaDataDictionary & dictionary = dicomIO->GetMetaDataDictionary();
+    itk::EncapsulateMetaData<std::string>(dictionary, "0008|0060", "MR");
+    itk::EncapsulateMetaData<std::string>(dictionary, "0020|000d", "1.2.826.0.1.3680043.2.1125.1.1");
+    itk::EncapsulateMetaData<std::string>(dictionary, "0020|000e", "1.2.826.0.1.3680043.2.1125.1.2");
+    itk::EncapsulateMetaData<std::string>(dictionary, "0020|0052", "1.2.826.0.1.3680043.2.1125.1.3");
+    itk::EncapsulateMetaData<std::string>(dictionary, "0008|0018", instanceUID);
+    itk::EncapsulateMetaData<std::string>(dictionary, "0020|0037", "1\\0\\0\\0\\1\\0");
+    itk::EncapsulateMetaData<std::string>(dictionary, "0020|0032", positionString.str());
+    itk::EncapsulateMetaData<std::string>(dictionary, "0020|0013", instanceNumber.str());
+
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "/slice%02u.dcm", NumberOfSlices - 1 - k);
+    using SliceWriterType = itk::ImageFileWriter<SliceType>;
+    SliceWriterType::Pointer writer = SliceWriterType::New();
+    writer->SetImageIO(dicomIO);
+    writer->SetInput(slice);
+    writer->SetFileName(directory + fileName);
+    writer->Update();
+  }
+}
+
+// Geometry within the precision DICOM stores positions with, voxels exactly
+static bool
+SameImage(const ImageType * expected, const ImageType * actual, const char * name)
+{
+  const ImageType::RegionType region = expected->GetLargestPossibleRegion();
+  if (actual->GetLargestPossibleRegion().GetSize() != region.GetSize())
+  {
+    std::cerr << name << ": size " << actual->GetLargestPossibleRegion().GetSize() << ", expected "
+              << region.GetSize() << std::endl;
+    return false;
+  }
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    if (std::abs(actual->GetSpacing()[i] - expected->GetSpacing()[i]) > 1e-4 ||
+        std::abs(actual->GetOrigin()[i] - expected->GetOrigin()[i]) > 1e-4)
+    {
+      std::cerr << name << ": spacing " << actual->GetSpacing() << " origin " << actual->GetOrigin()
+                << ", expected " << expected->GetSpacing() << " " << expected->GetOrigin() << std::endl;
+      return false;
+    }
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      if (std::abs(actual->GetDirection()[i][j] - expected->GetDirection()[i][j]) > 1e-6)
+      {
+        std::cerr << name << ": direction " << actual->GetDirection() << ", expected " << expected->GetDirection()
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+  itk::ImageRegionConstIteratorWithIndex<ImageType> expectedIt(expected, region);
+  itk::ImageRegionConstIteratorWithIndex<ImageType> actualIt(actual, actual->GetLargestPossibleRegion());
+  for (; !expectedIt.IsAtEnd(); ++expectedIt, ++actualIt)
+  {
+    if (actualIt.Get() != expectedIt.Get())
+    {
+      std::cerr << name << ": voxel " << actualIt.GetIndex() << " is " << actualIt.Get() << ", expected "
+                << expectedIt.Get() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int
+main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " outputDirectory" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string directory = argv[1];
+  itksys::SystemTools::RemoveADirectory(directory);
+  itksys::SystemTools::MakeDirectory(directory);
+
+  const ImageType::Pointer volume = MakeVolume();
+  try
+  {
+    WriteSeries(volume, directory);
+
+    // As ReadDicomSeriesCastWriteImage sets up the reader
+    itk::GDCMSeriesFileNames::Pointer nameGenerator = itk::GDCMSeriesFileNames::New();
+    nameGenerator->SetInputDirectory(directory.c_str());
+    const std::vector<std::string> fileNames = nameGenerator->GetInputFileNames();
+    if (fileNames.size() != NumberOfSlices)
+    {
+      std::cerr << "Found " << fileNames.size() << " files in the series, expected " << NumberOfSlices << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    using SeriesReaderType = itk::ImageSeriesReader<ImageType>;
+    SeriesReaderType::Pointer seriesReader = SeriesReaderType::New();
+    seriesReader->SetFileNames(fileNames);
+    seriesReader->SetImageIO(itk::GDCMImageIO::New());
+    seriesReader->UpdateOutputInformation();
+    const ImageType::Pointer parallel = ReadDicomSeriesInParallel<ImageType>(seriesReader, fileNames);
+
+    SeriesReaderType::Pointer referenceReader = SeriesReaderType::New();
+    referenceReader->SetFileNames(fileNames);
+    referenceReader->SetImageIO(itk::GDCMImageIO::New());
+    referenceReader->Update();
+
+    if (!SameImage(volume, referenceReader->GetOutput(), "ImageSeriesReader") ||
+        !SameImage(referenceReader->GetOutput(), parallel, "ReadDicomSeriesInParallel"))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+  catch (itk::ExceptionObject & err)
+  {
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
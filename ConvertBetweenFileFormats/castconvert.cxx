@@ -41,6 +41,8 @@
  * of course be a component type supported by the file format.
  * Output images can be in all file formats ITK supports and for which
  * the ImageFileReader works, so no dicom output is currently supported.
+ * Outputs are compressed where the format allows it; with --noCompression
+ * they are written uncompressed, in pieces if the format can stream.
  *
  * authors:       Marius Staring and Stefan Klein
  *
@@ -51,6 +53,7 @@
  */
 
 #include <iostream>
+#include <vector>
 #include "itkImageFileReader.h"
 
 /** DICOM headers. */
@@ -67,21 +70,24 @@ FileConverterScalar(const std::string & inputPixelComponentType,
                     const std::string & outputPixelComponentType,
                     const std::string & inputFileName,
                     const std::string & outputFileName,
-                    int                 inputDimension);
+                    int                 inputDimension,
+                    bool                useCompression);
 
 extern int
 DicomFileConverterScalar(const std::string & inputPixelComponentType,
                          const std::string & outputPixelComponentType,
                          const std::string & inputFileName,
                          const std::string & outputFileName,
-                         int                 inputDimension);
+                         int                 inputDimension,
+                         bool                useCompression);
 
 extern int
 DicomFileConverterScalarA(const std::string & inputPixelComponentType,
                           const std::string & outputPixelComponentType,
                           const std::string & inputFileName,
                           const std::string & outputFileName,
-                          int                 inputDimension);
+                          int                 inputDimension,
+                          bool                useCompression);
 
 // -------------------------------------------------------------------------------------
 #include "itkGE4ImageIOFactory.h"
@@ -102,11 +108,27 @@ main(int argc, char * argv[])
      * Check arguments.
      * *******************************************************************
      */
-    if (argc < 3 || (strcmp(argv[1], "--help") == 0))
+    /** --noCompression may appear anywhere, the other arguments are positional. */
+    std::vector<std::string> arguments;
+    bool                     useCompression = true;
+    for (int i = 1; i < argc; i++)
+    {
+      if (strcmp(argv[i], "--noCompression") == 0)
+      {
+        useCompression = false;
+      }
+      else
+      {
+        arguments.push_back(argv[i]);
+      }
+    }
+    if (arguments.size() < 2 || arguments[0] == "--help")
     {
       std::cout << "Usage:" << std::endl;
-      std::cout << "\tcastconvert inputfilename outputfilename [outputPixelComponentType]" << std::endl;
-      std::cout << "\tcastconvert dicomDirectory outputfilename [outputPixelComponentType]" << std::endl;
+      std::cout << "\tcastconvert inputfilename outputfilename [outputPixelComponentType] [--noCompression]"
+                << std::endl;
+      std::cout << "\tcastconvert dicomDirectory outputfilename [outputPixelComponentType] [--noCompression]"
+                << std::endl;
       std::cout << "\twhere outputPixelComponentType is one of:" << std::endl;
       std::cout << "\t\t- unsigned_char" << std::endl;
       std::cout << "\t\t- char" << std::endl;
@@ -120,16 +142,20 @@ main(int argc, char * argv[])
       std::cout << "\t\t- double" << std::endl;
       std::cout << "\tprovided that the outputPixelComponentType is supported by the output file format." << std::endl;
       std::cout << "\tBy default the outputPixelComponentType is set to the inputPixelComponentType." << std::endl;
+      std::cout << "\tThe output is compressed when the file format supports it, unless --noCompression is given."
+                << std::endl;
+      std::cout << "\tLarge uncompressed outputs are written in bounded-memory pieces when the format can stream."
+                << std::endl;
       return EXIT_FAILURE;
     }
 
     /**  Get  the  inputs. */
-    std::string input = argv[1];
-    std::string outputFileName = argv[2];
+    std::string input = arguments[0];
+    std::string outputFileName = arguments[1];
     std::string outputPixelComponentType = "";
-    if (argc >= 4)
+    if (arguments.size() >= 3)
     {
-      outputPixelComponentType = argv[3];
+      outputPixelComponentType = arguments[2];
     }
 
     /** Make sure last character of input != "/".
@@ -300,8 +326,12 @@ main(int argc, char * argv[])
          */
         if (pixelType == "scalar" && numberOfComponents == 1)
         {
-          const int ret_value = FileConverterScalar(
-            inputPixelComponentType, outputPixelComponentType, inputFileName, outputFileName, inputDimension);
+          const int ret_value = FileConverterScalar(inputPixelComponentType,
+                                                    outputPixelComponentType,
+                                                    inputFileName,
+                                                    outputFileName,
+                                                    inputDimension,
+                                                    useCompression);
           if (ret_value != 0)
           {
             return ret_value;
@@ -328,10 +358,18 @@ main(int argc, char * argv[])
         if (pixelType == "scalar" && numberOfComponents == 1)
         {
           const int ret_value =
-            DicomFileConverterScalar(
-              inputPixelComponentType, outputPixelComponentType, inputDirectoryName, outputFileName, inputDimension) ||
-            DicomFileConverterScalarA(
-              inputPixelComponentType, outputPixelComponentType, inputDirectoryName, outputFileName, inputDimension);
+            DicomFileConverterScalar(inputPixelComponentType,
+                                     outputPixelComponentType,
+                                     inputDirectoryName,
+                                     outputFileName,
+                                     inputDimension,
+                                     useCompression) ||
+            DicomFileConverterScalarA(inputPixelComponentType,
+                                      outputPixelComponentType,
+                                      inputDirectoryName,
+                                      outputFileName,
+                                      inputDimension,
+                                      useCompression);
           if (ret_value != 0)
           {
             return ret_value;
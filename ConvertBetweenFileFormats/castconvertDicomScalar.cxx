@@ -24,7 +24,8 @@ DicomFileConverterScalar(const std::string & inputPixelComponentType,
                          const std::string & outputPixelComponentType,
                          const std::string & inputDirectoryName,
                          const std::string & outputFileName,
-                         int                 inputDimension)
+                         int                 inputDimension,
+                         bool                useCompression)
 {
   /** Support for 3D images. */
   if (inputDimension == 3)
@@ -23,58 +23,73 @@ FileConverterScalar2D(const std::string & inputPixelComponentType,
                       const std::string & outputPixelComponentType,
                       const std::string & inputFileName,
                       const std::string & outputFileName,
-                      int                 inputDimension);
+                      int                 inputDimension,
+                      bool                useCompression);
 
 extern int
 FileConverterScalar3D(const std::string & inputPixelComponentType,
                       const std::string & outputPixelComponentType,
                       const std::string & inputFileName,
                       const std::string & outputFileName,
-                      int                 inputDimension);
+                      int                 inputDimension,
+                      bool                useCompression);
 
 extern int
 FileConverterScalar2DA(const std::string & inputPixelComponentType,
                        const std::string & outputPixelComponentType,
                        const std::string & inputFileName,
                        const std::string & outputFileName,
-                       int                 inputDimension);
+                       int                 inputDimension,
+                       bool                useCompression);
 
 extern int
 FileConverterScalar3DA(const std::string & inputPixelComponentType,
                        const std::string & outputPixelComponentType,
                        const std::string & inputFileName,
                        const std::string & outputFileName,
-                       int                 inputDimension);
+                       int                 inputDimension,
+                       bool                useCompression);
 
 extern int
 FileConverterScalar4D(const std::string & inputPixelComponentType,
                       const std::string & outputPixelComponentType,
                       const std::string & inputFileName,
                       const std::string & outputFileName,
-                      int                 inputDimension);
+                      int                 inputDimension,
+                      bool                useCompression);
 
 extern int
 FileConverterScalar4DA(const std::string & inputPixelComponentType,
                        const std::string & outputPixelComponentType,
                        const std::string & inputFileName,
                        const std::string & outputFileName,
-                       int                 inputDimension);
+                       int                 inputDimension,
+                       bool                useCompression);
 
 int
 FileConverterScalar(const std::string & inputPixelComponentType,
                     const std::string & outputPixelComponentType,
                     const std::string & inputFileName,
                     const std::string & outputFileName,
-                    int                 inputDimension)
+                    int                 inputDimension,
+                    bool                useCompression)
 {
   /** Support for 2D images. */
   if (inputDimension == 2)
   {
     const int ret_value =
-      FileConverterScalar2D(
-        inputPixelComponentType, outputPixelComponentType, inputFileName, outputFileName, inputDimension) ||
-      FileConverterScalar2DA(
-        inputPixelComponentType, outputPixelComponentType, inputFileName, outputFileName, inputDimension);
+      FileConverterScalar2D(inputPixelComponentType,
+                            outputPixelComponentType,
+                            inputFileName,
+                            outputFileName,
+                            inputDimension,
+                            useCompression) ||
+      FileConverterScalar2DA(inputPixelComponentType,
+                             outputPixelComponentType,
+                             inputFileName,
+                             outputFileName,
+                             inputDimension,
+                             useCompression);
     if (ret_value != 0)
     {
       return ret_value;
@@ -83,10 +98,18 @@ FileConverterScalar(const std::string & inputPixelComponentType,
   else if (inputDimension == 3)
   {
     const int ret_value =
-      FileConverterScalar3D(
-        inputPixelComponentType, outputPixelComponentType, inputFileName, outputFileName, inputDimension) ||
-      FileConverterScalar3DA(
-        inputPixelComponentType, outputPixelComponentType, inputFileName, outputFileName, inputDimension);
+      FileConverterScalar3D(inputPixelComponentType,
+                            outputPixelComponentType,
+                            inputFileName,
+                            outputFileName,
+                            inputDimension,
+                            useCompression) ||
+      FileConverterScalar3DA(inputPixelComponentType,
+                             outputPixelComponentType,
+                             inputFileName,
+                             outputFileName,
+                             inputDimension,
+                             useCompression);
     if (ret_value != 0)
     {
       return ret_value;
@@ -95,10 +118,18 @@ FileConverterScalar(const std::string & inputPixelComponentType,
   else if (inputDimension == 4)
   {
     const int ret_value =
-      FileConverterScalar4D(
-        inputPixelComponentType, outputPixelComponentType, inputFileName, outputFileName, inputDimension) ||
-      FileConverterScalar4DA(
-        inputPixelComponentType, outputPixelComponentType, inputFileName, outputFileName, inputDimension);
+      FileConverterScalar4D(inputPixelComponentType,
+                            outputPixelComponentType,
+                            inputFileName,
+                            outputFileName,
+                            inputDimension,
+                            useCompression) ||
+      FileConverterScalar4DA(inputPixelComponentType,
+                             outputPixelComponentType,
+                             inputFileName,
+                             outputFileName,
+                             inputDimension,
+                             useCompression);
     if (ret_value != 0)
     {
       return ret_value;
@@ -23,7 +23,8 @@ FileConverterScalar2D(const std::string & inputPixelComponentType,
                       const std::string & outputPixelComponentType,
                       const std::string & inputFileName,
                       const std::string & outputFileName,
-                      int                 inputDimension)
+                      int                 inputDimension,
+                      bool                useCompression)
 {
   enum
   {
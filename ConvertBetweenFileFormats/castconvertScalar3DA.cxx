@@ -23,7 +23,8 @@ FileConverterScalar3DA(const std::string & inputPixelComponentType,
                        const std::string & outputPixelComponentType,
                        const std::string & inputFileName,
                        const std::string & outputFileName,
-                       int                 inputDimension)
+                       int                 inputDimension,
+                       bool                useCompression)
 {
   enum
   {
@@ -33,6 +33,10 @@
 #include "itkImageSeriesReader.h"
 #include "itkImageFileWriter.h"
 #include "itkImageRegionConstIterator.h"
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <mutex>
 
 /** DICOM headers. */
 #include "itkGDCMImageIO.h"
@@ -61,30 +65,24 @@ PrintInfo(ReaderType reader, WriterType writer)
 {
   /** Typedef's. */
   using ImageIOBaseType = itk::ImageIOBase;
-  using ImageIORegionType = itk::ImageIORegion;
-  using SizeType = typename ImageIORegionType::SizeType;
 
   /** Get IOBase of the reader and extract information. */
   ImageIOBaseType::Pointer imageIOBaseIn = reader->GetModifiableImageIO();
-  ImageIORegionType        iORegionIn = imageIOBaseIn->GetIORegion();
 
   const char * fileNameIn = imageIOBaseIn->GetFileName();
   std::string  pixelTypeIn = imageIOBaseIn->GetPixelTypeAsString(imageIOBaseIn->GetPixelType());
   unsigned int nocIn = imageIOBaseIn->GetNumberOfComponents();
   std::string  componentTypeIn = imageIOBaseIn->GetComponentTypeAsString(imageIOBaseIn->GetComponentType());
   unsigned int dimensionIn = imageIOBaseIn->GetNumberOfDimensions();
-  SizeType     sizeIn = iORegionIn.GetSize();
 
   /**  Get  IOBase of  the  writer and extract information.  */
   ImageIOBaseType::Pointer imageIOBaseOut = writer->GetModifiableImageIO();
-  ImageIORegionType        iORegionOut = imageIOBaseOut->GetIORegion();
 
   const char * fileNameOut = imageIOBaseOut->GetFileName();
   std::string  pixelTypeOut = imageIOBaseOut->GetPixelTypeAsString(imageIOBaseOut->GetPixelType());
   unsigned int nocOut = imageIOBaseOut->GetNumberOfComponents();
   std::string  componentTypeOut = imageIOBaseOut->GetComponentTypeAsString(imageIOBaseOut->GetComponentType());
   unsigned int dimensionOut = imageIOBaseOut->GetNumberOfDimensions();
-  SizeType     sizeOut = iORegionOut.GetSize();
 
   /** Print information. */
   std::cout << "Information about the input image \"" << fileNameIn << "\":" << std::endl;
@@ -95,7 +93,7 @@ PrintInfo(ReaderType reader, WriterType writer)
   std::cout << "\tsize:\t\t\t";
   for (unsigned int i = 0; i < dimensionIn; i++)
   {
-    std::cout << sizeIn[i] << " ";
+    std::cout << imageIOBaseIn->GetDimensions(i) << " ";
   }
   std::cout << std::endl;
 
@@ -109,18 +107,100 @@ PrintInfo(ReaderType reader, WriterType writer)
   std::cout << "\tsize:\t\t\t";
   for (unsigned int i = 0; i < dimensionOut; i++)
   {
-    std::cout << sizeOut[i] << " ";
+    std::cout << imageIOBaseOut->GetDimensions(i) << " ";
   }
   std::cout << std::endl;
 } // end PrintInfo
 
+/** Number of pieces the caster and writer process the image in, such that
+ * a piece of the input plus its cast copy take about maxBytesPerStream.  The
+ * writer reduces this to what the output ImageIO can stream, a single piece
+ * for compressed output and for formats that can not be written in parts;
+ * the reader reads only the requested piece when the input ImageIO can
+ * stream, and the whole image on the first request otherwise.
+ */
+template <typename InputImageType, typename OutputImageType>
+unsigned int
+ComputeNumberOfStreamDivisions(const InputImageType *   image,
+                               const itk::SizeValueType maxBytesPerStream = 256UL * 1024UL * 1024UL)
+{
+  const itk::SizeValueType bytes =
+    image->GetLargestPossibleRegion().GetNumberOfPixels() *
+    (sizeof(typename InputImageType::PixelType) + sizeof(typename OutputImageType::PixelType));
+  const itk::SizeValueType slices = image->GetLargestPossibleRegion().GetSize(InputImageType::ImageDimension - 1);
+  return static_cast<unsigned int>(
+    std::max<itk::SizeValueType>(1, std::min(slices, (bytes + maxBytesPerStream - 1) / maxBytesPerStream)));
+}
+
+/** Read a DICOM series, decoding the slices in parallel, each with its own
+ * GDCMImageIO.  The geometry comes from seriesReader, whose output
+ * information must be up to date; reading it also initializes the GDCM
+ * dictionaries on this thread before the slice readers use them.  A single
+ * (possibly multi-frame) file is read by seriesReader itself.
+ */
+template <typename InputImageType>
+typename InputImageType::Pointer
+ReadDicomSeriesInParallel(itk::ImageSeriesReader<InputImageType> * seriesReader,
+                          const std::vector<std::string> &        fileNames)
+{
+  if (fileNames.size() < 2)
+  {
+    seriesReader->Update();
+    return seriesReader->GetOutput();
+  }
+
+  typename InputImageType::Pointer volume = InputImageType::New();
+  volume->CopyInformation(seriesReader->GetOutput());
+  volume->SetRegions(seriesReader->GetOutput()->GetLargestPossibleRegion());
+  volume->Allocate();
+
+  const typename InputImageType::RegionType region = volume->GetLargestPossibleRegion();
+  const itk::SizeValueType                  sliceSize =
+    region.GetNumberOfPixels() / region.GetSize(InputImageType::ImageDimension - 1);
+
+  std::mutex  errorMutex;
+  std::string errorMessage;
+  itk::MultiThreaderBase::New()->ParallelizeArray(
+    0,
+    fileNames.size(),
+    [&](const itk::SizeValueType slice) {
+      using SliceReaderType = itk::ImageFileReader<InputImageType>;
+      typename SliceReaderType::Pointer sliceReader = SliceReaderType::New();
+      sliceReader->SetImageIO(itk::GDCMImageIO::New());
+      sliceReader->SetFileName(fileNames[slice]);
+      try
+      {
+        sliceReader->Update();
+        const InputImageType * sliceImage = sliceReader->GetOutput();
+        if (sliceImage->GetBufferedRegion().GetNumberOfPixels() != sliceSize)
+        {
+          itkGenericExceptionMacro(<< fileNames[slice] << " does not have the size of the first slice");
+        }
+        std::copy(sliceImage->GetBufferPointer(),
+                  sliceImage->GetBufferPointer() + sliceSize,
+                  volume->GetBufferPointer() + slice * sliceSize);
+      }
+      catch (itk::ExceptionObject & e)
+      {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        errorMessage = e.GetDescription();
+      }
+    },
+    nullptr);
+  if (!errorMessage.empty())
+  {
+    itkGenericExceptionMacro(<< errorMessage);
+  }
+  return volume;
+}
+
 /** The function that reads the input dicom image and writes the output image.
  * This function is templated over the image types. In the main function
  * we have to make sure to call the right instantiation.
  */
 template <typename InputImageType, typename OutputImageType>
 void
-ReadDicomSeriesCastWriteImage(std::string inputDirectoryName, std::string outputFileName)
+ReadDicomSeriesCastWriteImage(std::string inputDirectoryName, std::string outputFileName, bool useCompression)
 {
   /** Typedef the correct reader, caster and writer. */
   using SeriesReaderType = typename itk::ImageSeriesReader<InputImageType>;
@@ -140,10 +220,14 @@ ReadDicomSeriesCastWriteImage(std::string inputDirectoryName, std::string output
   nameGenerator->SetInputDirectory(inputDirectoryName.c_str());
   FileNamesContainerType fileNames = nameGenerator->GetInputFileNames();
 
-  /** Create and setup the seriesReader. */
+  /** Create and setup the seriesReader, it provides the volume geometry. */
   typename SeriesReaderType::Pointer seriesReader = SeriesReaderType::New();
   seriesReader->SetFileNames(fileNames);
   seriesReader->SetImageIO(dicomIO);
+  seriesReader->UpdateOutputInformation();
+
+  /** Decode the slices in parallel. */
+  typename InputImageType::Pointer volume = ReadDicomSeriesInParallel<InputImageType>(seriesReader, fileNames);
 
   /** Create and setup caster and writer. */
   // typename RescaleFilterType::Pointer caster = RescaleFilterType::New();
@@ -154,9 +238,10 @@ ReadDicomSeriesCastWriteImage(std::string inputDirectoryName, std::string output
   writer->SetFileName(outputFileName.c_str());
 
   /** Connect the pipeline. */
-  caster->SetInput(seriesReader->GetOutput());
+  caster->SetInput(volume);
   writer->SetInput(caster->GetOutput());
-  writer->UseCompressionOn();
+  writer->SetUseCompression(useCompression);
+  writer->SetNumberOfStreamDivisions(ComputeNumberOfStreamDivisions<InputImageType, OutputImageType>(volume));
 
   // Handle .vti files as well.
 #ifdef VTK_FOUND
@@ -194,7 +279,7 @@ ReadDicomSeriesCastWriteImage(std::string inputDirectoryName, std::string output
  */
 template <typename InputImageType, typename OutputImageType>
 void
-ReadCastWriteImage(std::string inputFileName, std::string outputFileName)
+ReadCastWriteImage(std::string inputFileName, std::string outputFileName, bool useCompression)
 {
   /**  Typedef the correct reader, caster and writer. */
   using ImageReaderType = typename itk::ImageFileReader<InputImageType>;
@@ -259,9 +344,12 @@ ReadCastWriteImage(std::string inputFileName, std::string outputFileName)
   }
 #endif
 
-  writer->UseCompressionOn();
+  writer->SetUseCompression(useCompression);
   writer->SetFileName(outputFileName.c_str());
   writer->SetInput(caster->GetOutput());
+  caster->UpdateOutputInformation();
+  writer->SetNumberOfStreamDivisions(
+    ComputeNumberOfStreamDivisions<InputImageType, OutputImageType>(caster->GetInput()));
   writer->Update();
 
   if (inputFileName.rfind(".vti") != (inputFileName.size() - 4))
@@ -293,17 +381,21 @@ ReadCastWriteImage(std::string inputFileName, std::string outputFileName)
 
 template <typename TInputPixelType, typename TOutputPixelType>
 int
-ReadVTICastWriteImage(std::string inputFileName, std::string outputFileName, TInputPixelType, TOutputPixelType)
+ReadVTICastWriteImage(std::string inputFileName,
+                      std::string outputFileName,
+                      bool        useCompression,
+                      TInputPixelType,
+                      TOutputPixelType)
 {
   using InputImageType = itk::Image<TInputPixelType, 3>;
   using OutputImageType = itk::Image<TOutputPixelType, 3>;
-  ReadCastWriteImage<InputImageType, OutputImageType>(inputFileName, outputFileName);
+  ReadCastWriteImage<InputImageType, OutputImageType>(inputFileName, outputFileName, useCompression);
   return 1;
 }
 
 template <typename TOutputPixelType>
 int
-ReadVTICastWriteImage(std::string inputFileName, std::string outputFileName, int dimension)
+ReadVTICastWriteImage(std::string inputFileName, std::string outputFileName, int dimension, bool useCompression)
 {
   int retval = 0;
 
@@ -317,7 +409,8 @@ ReadVTICastWriteImage(std::string inputFileName, std::string outputFileName, int
 
     switch (image->GetScalarType())
     {
-      vtkitkTemplateMacro(retval = ReadVTICastWriteImage(inputFileName, outputFileName, static_cast<VTK_TT>(0), op));
+      vtkitkTemplateMacro(
+        retval = ReadVTICastWriteImage(inputFileName, outputFileName, useCompression, static_cast<VTK_TT>(0), op));
 
       default:
       {
@@ -333,7 +426,7 @@ ReadVTICastWriteImage(std::string inputFileName, std::string outputFileName, int
 #else
 template <typename TOuptutPixelType>
 int
-ReadVTICastWriteImage(std::string, std::string, int)
+ReadVTICastWriteImage(std::string, std::string, int, bool)
 {
   return 0;
 }
@@ -351,7 +444,8 @@ ReadVTICastWriteImage(std::string, std::string, int)
   {                                                                                                                    \
     using InputImageType = itk::Image<typeIn, 3>;                                                                      \
     using OutputImageType = itk::Image<typeOut, 3>;                                                                    \
-    ReadDicomSeriesCastWriteImage<InputImageType, OutputImageType>(inputDirectoryName, outputFileName);                \
+    ReadDicomSeriesCastWriteImage<InputImageType, OutputImageType>(                                                    \
+      inputDirectoryName, outputFileName, useCompression);                                                             \
   }
 
 /** callCorrectReadWriterMacro:
@@ -361,11 +455,11 @@ ReadVTICastWriteImage(std::string, std::string, int)
 #define callCorrectReadWriterMacro(typeIn, typeOut, dim)                                                               \
   if (inputPixelComponentType == #typeIn && outputPixelComponentType == #typeOut && inputDimension == dim)             \
   {                                                                                                                    \
-    if (!ReadVTICastWriteImage<typeOut>(inputFileName, outputFileName, dim))                                           \
+    if (!ReadVTICastWriteImage<typeOut>(inputFileName, outputFileName, dim, useCompression))                           \
     {                                                                                                                  \
       using InputImageType = itk::Image<typeIn, dim>;                                                                  \
       using OutputImageType = itk::Image<typeOut, dim>;                                                                \
-      ReadCastWriteImage<InputImageType, OutputImageType>(inputFileName, outputFileName);                              \
+      ReadCastWriteImage<InputImageType, OutputImageType>(inputFileName, outputFileName, useCompression);              \
     }                                                                                                                  \
   }
 
@@ -81,6 +81,7 @@ main(int argc, char * argv[])
   dWIConvert.setAllowLossyConversion(allowLossyConversion);
   dWIConvert.setUseIdentityMeasurementFrame(useIdentityMeaseurementFrame);
   dWIConvert.setUseBMatrixGradientDirections(useBMatrixGradientDirections);
+  dWIConvert.setUseCompression(useCompression);
 
   if (!outputNiftiFile.empty())
   {
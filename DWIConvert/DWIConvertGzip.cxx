@@ -0,0 +1,151 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "DWIConvertGzip.h"
+
+#include "itkMacro.h"
+#include "itkMultiThreaderBase.h"
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+/** Deflate one chunk into a complete gzip member. */
+std::string
+DeflateGzipMember(const char * data, const size_t length)
+{
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  // 15 + 16: largest window, gzip header and trailer instead of zlib ones.
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    itkGenericExceptionMacro(<< "Can't initialize gzip compression");
+  }
+  std::string member(deflateBound(&stream, static_cast<uLong>(length)) + 32, '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  stream.avail_in = static_cast<uInt>(length);
+  stream.next_out = reinterpret_cast<Bytef *>(&member[0]);
+  stream.avail_out = static_cast<uInt>(member.size());
+  const int status = deflate(&stream, Z_FINISH);
+  member.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (status != Z_STREAM_END)
+  {
+    itkGenericExceptionMacro(<< "gzip compression of a " << length << " byte chunk failed");
+  }
+  return member;
+}
+
+/** Number of chunks compressed together, enough to keep every thread busy. */
+size_t
+ChunksPerBatch()
+{
+  return 2 * std::max<size_t>(1, itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
+}
+
+/** Compress data into consecutive members in parallel and write them in order. */
+void
+WriteGzipBatch(std::ostream & out, const char * data, const size_t length, const size_t chunkSize)
+{
+  const size_t             numberOfChunks = (length + chunkSize - 1) / chunkSize;
+  std::vector<std::string> members(numberOfChunks);
+  itk::MultiThreaderBase::New()->ParallelizeArray(
+    0,
+    numberOfChunks,
+    [&](const itk::SizeValueType chunk) {
+      const size_t begin = chunk * chunkSize;
+      members[chunk] = DeflateGzipMember(data + begin, std::min(chunkSize, length - begin));
+    },
+    nullptr);
+  for (const auto & member : members)
+  {
+    out.write(member.data(), member.size());
+  }
+}
+} // namespace
+
+void
+WriteParallelGzip(std::ostream & out, const char * data, const size_t length, const size_t chunkSize)
+{
+  if (chunkSize == 0)
+  {
+    itkGenericExceptionMacro(<< "gzip chunk size must be positive");
+  }
+  if (length == 0)
+  {
+    // An empty stream is still one (empty) member.
+    const std::string member = DeflateGzipMember(data, 0);
+    out.write(member.data(), member.size());
+    return;
+  }
+  const size_t batchSize = ChunksPerBatch() * chunkSize;
+  for (size_t begin = 0; begin < length; begin += batchSize)
+  {
+    WriteGzipBatch(out, data + begin, std::min(batchSize, length - begin), chunkSize);
+  }
+  if (!out.good())
+  {
+    itkGenericExceptionMacro(<< "Failed writing the gzip stream");
+  }
+}
+
+void
+GzipFileInParallel(const std::string & inputFileName, const std::string & outputFileName, const size_t chunkSize)
+{
+  if (chunkSize == 0)
+  {
+    itkGenericExceptionMacro(<< "gzip chunk size must be positive");
+  }
+  std::ifstream input(inputFileName.c_str(), std::ios::in | std::ios::binary);
+  if (!input.is_open())
+  {
+    itkGenericExceptionMacro(<< "Can't read " << inputFileName);
+  }
+  std::ofstream output(outputFileName.c_str(), std::ios::out | std::ios::binary);
+  if (!output.is_open())
+  {
+    itkGenericExceptionMacro(<< "Can't write " << outputFileName);
+  }
+
+  std::vector<char> batch(ChunksPerBatch() * chunkSize);
+  bool              wroteAnything = false;
+  while (input)
+  {
+    input.read(batch.data(), batch.size());
+    const size_t length = static_cast<size_t>(input.gcount());
+    if (length == 0)
+    {
+      break;
+    }
+    WriteGzipBatch(output, batch.data(), length, chunkSize);
+    wroteAnything = true;
+  }
+  if (!wroteAnything)
+  {
+    WriteParallelGzip(output, batch.data(), 0, chunkSize);
+  }
+  if (input.bad() || !output.good())
+  {
+    itkGenericExceptionMacro(<< "Failed compressing " << inputFileName << " to " << outputFileName);
+  }
+}
@@ -0,0 +1,52 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/*
+ * Parallel gzip compression for the DWIConvert writers.
+ *
+ * The payload is split into chunks of at most chunkSize bytes and each
+ * chunk is deflated on its own thread into a complete gzip member.  The
+ * members are written in order, which makes a valid multi-member gzip
+ * stream (RFC 1952, section 2.2) that zlib's gzread, Teem/NrrdIO and the
+ * ITK NIfTI reader decompress as one stream.
+ */
+#ifndef DWIConvertGzip_h
+#define DWIConvertGzip_h
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+/** Uncompressed size of each gzip member unless told otherwise. */
+constexpr size_t DWIConvertGzipChunkSize = 4UL * 1024UL * 1024UL;
+
+/** Write length bytes of data to out as a multi-member gzip stream. */
+void
+WriteParallelGzip(std::ostream & out,
+                  const char *   data,
+                  size_t         length,
+                  size_t         chunkSize = DWIConvertGzipChunkSize);
+
+/** Compress the file inputFileName into outputFileName with
+ *  WriteParallelGzip, reading only a few chunks per thread at a time. */
+void
+GzipFileInParallel(const std::string & inputFileName,
+                   const std::string & outputFileName,
+                   size_t              chunkSize = DWIConvertGzipChunkSize);
+
+#endif // DWIConvertGzip_h
@@ -182,7 +182,7 @@ DWIConvert::write(const std::string & outputVolume)
                                                                     m_useIdentityMeasurementFrame,
                                                                     m_smallGradientThreshold,
                                                                     getInputFileType());
-    m_converter->ManualWriteNRRDFile(outputVolumeHeaderName, commentSection);
+    m_converter->ManualWriteNRRDFile(outputVolumeHeaderName, commentSection, m_useCompression);
   }
   else
   {
@@ -463,6 +463,18 @@ DWIConvert::setUseBMatrixGradientDirections(bool useBMatrixGradientDirections)
   m_useBMatrixGradientDirections = useBMatrixGradientDirections;
 }
 
+bool
+DWIConvert::isUseCompression() const
+{
+  return m_useCompression;
+}
+
+void
+DWIConvert::setUseCompression(bool useCompression)
+{
+  m_useCompression = useCompression;
+}
+
 const std::string &
 DWIConvert::getOutputVolume() const
 {
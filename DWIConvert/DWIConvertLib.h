@@ -113,6 +113,12 @@ public:
   void
   setUseBMatrixGradientDirections(bool useBMatrixGradientDirections);
 
+  bool
+  isUseCompression() const;
+
+  void
+  setUseCompression(bool useCompression);
+
   const std::string &
   getOutputVolume() const;
 
@@ -158,6 +164,7 @@ private:
   bool m_allowLossyConversion{ false };         // defualt: false
   bool m_useIdentityMeasurementFrame{ false };  // default: false
   bool m_useBMatrixGradientDirections{ false }; // default: false
+  bool m_useCompression{ false };               // default: false
 
   std::string m_outputVolume;
   std::string m_outputDirectory; // default: "."
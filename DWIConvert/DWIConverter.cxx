@@ -6,6 +6,7 @@
 
 
 #include "DWIConverter.h"
+#include "DWIConvertGzip.h"
 #include "itkFlipImageFilter.h"
 DWIConverter::DWIConverter(FileNamesContainer inputFileNames)
   : m_InputFileNames(std::move(inputFileNames))
@@ -375,7 +376,9 @@ DWIConverter::MakeFileComment(const std::string & version,
 }
 
 void
-DWIConverter::ManualWriteNRRDFile(const std::string & outputVolumeHeaderName, const std::string commentstring) const
+DWIConverter::ManualWriteNRRDFile(const std::string & outputVolumeHeaderName,
+                                  const std::string   commentstring,
+                                  const bool          useCompression) const
 {
   const size_t extensionPos = outputVolumeHeaderName.find(".nhdr");
   const bool   nrrdSingleFileFormat = (extensionPos != std::string::npos) ? false : true;
@@ -384,7 +387,7 @@ DWIConverter::ManualWriteNRRDFile(const std::string & outputVolumeHeaderName, co
   if (extensionPos != std::string::npos)
   {
     outputVolumeDataName = outputVolumeHeaderName.substr(0, extensionPos);
-    outputVolumeDataName += ".raw";
+    outputVolumeDataName += useCompression ? ".raw.gz" : ".raw";
   }
 
   itk::NumberToString<double> DoubleConvert;
@@ -423,7 +426,7 @@ DWIConverter::ManualWriteNRRDFile(const std::string & outputVolumeHeaderName, co
   header << "kinds: space space space list" << std::endl;
 
   header << "endian: little" << std::endl;
-  header << "encoding: raw" << std::endl;
+  header << "encoding: " << (useCompression ? "gzip" : "raw") << std::endl;
   header << R"(space units: "mm" "mm" "mm")" << std::endl;
 
   const DWIConverter::Volume3DUnwrappedType::PointType ImageOrigin = this->GetOrigin();
@@ -475,10 +478,22 @@ DWIConverter::ManualWriteNRRDFile(const std::string & outputVolumeHeaderName, co
   // write data in the same file is .nrrd was chosen
   header << std::endl;
   ;
-  if (nrrdSingleFileFormat)
+  const unsigned long nVoxels = this->GetDiffusionVolume()->GetBufferedRegion().GetNumberOfPixels();
+  const char *        payload = reinterpret_cast<const char *>(this->GetDiffusionVolume()->GetBufferPointer());
+  if (useCompression)
   {
-    unsigned long nVoxels = this->GetDiffusionVolume()->GetBufferedRegion().GetNumberOfPixels();
-    header.write(reinterpret_cast<char *>(this->GetDiffusionVolume()->GetBufferPointer()), nVoxels * sizeof(short));
+    std::ofstream  dataFile;
+    std::ostream * data = &header;
+    if (!nrrdSingleFileFormat)
+    {
+      dataFile.open(outputVolumeDataName.c_str(), std::ios_base::out | std::ios_base::binary);
+      data = &dataFile;
+    }
+    WriteParallelGzip(*data, payload, nVoxels * sizeof(short));
+  }
+  else if (nrrdSingleFileFormat)
+  {
+    header.write(payload, nVoxels * sizeof(short));
   }
   else
   {
@@ -657,17 +672,36 @@ DWIConverter::WriteFSLFormattedFileSet(const std::string &   outputVolumeHeaderN
     itk::EncapsulateMetaData<std::string>(thisDic, "qform_code_name", "NIFTI_XFORM_SCANNER_ANAT");
     itk::EncapsulateMetaData<std::string>(thisDic, "sform_code_name", "NIFTI_XFORM_SCANNER_ANAT");
   }
+  // The NIfTI writer deflates on one core, so for .nii.gz write an
+  // uncompressed .nii and compress that in parallel chunks.
+  const std::string gzipExtension(".gz");
+  const bool        compressInParallel =
+    outputVolumeHeaderName.size() > gzipExtension.size() &&
+    outputVolumeHeaderName.compare(
+      outputVolumeHeaderName.size() - gzipExtension.size(), gzipExtension.size(), gzipExtension) == 0;
+  const std::string imageFileName =
+    compressInParallel ? outputVolumeHeaderName + ".uncompressed.nii" : outputVolumeHeaderName;
+
   itk::ImageFileWriter<Volume4DType>::Pointer imgWriter = itk::ImageFileWriter<Volume4DType>::New();
   imgWriter->SetInput(img4D);
-  imgWriter->SetFileName(outputVolumeHeaderName.c_str());
+  imgWriter->SetFileName(imageFileName.c_str());
   try
   {
     imgWriter->Update();
+    if (compressInParallel)
+    {
+      GzipFileInParallel(imageFileName, outputVolumeHeaderName);
+      itksys::SystemTools::RemoveFile(imageFileName);
+    }
   }
   catch (itk::ExceptionObject & excp)
   {
     std::cerr << "Exception thrown while writing " << outputVolumeHeaderName << std::endl;
     std::cerr << excp << std::endl;
+    if (compressInParallel)
+    {
+      itksys::SystemTools::RemoveFile(imageFileName);
+    }
     throw;
   }
   // FSL output of gradients & BValues
@@ -199,8 +199,12 @@ public:
                   double              smallGradientThreshold,
                   const std::string   inputFileType) const;
 
+  /** Write the DWI as NRRD.  With useCompression the payload is gzip
+   *  compressed in parallel chunks (see DWIConvertGzip.h). */
   void
-  ManualWriteNRRDFile(const std::string & outputVolumeHeaderName, const std::string commentstring) const;
+  ManualWriteNRRDFile(const std::string & outputVolumeHeaderName,
+                      const std::string   commentstring,
+                      const bool          useCompression = false) const;
   Volume4DType::Pointer
   ThreeDToFourDImage(Volume3DUnwrappedType::Pointer img) const;
 
@@ -209,6 +213,7 @@ public:
 
   /** the DICOM datasets are read as 3D volumes, but they need to be
    *  written as 4D volumes for image types other than NRRD.
+   *  A .nii.gz volume is compressed in parallel chunks.
    */
   void
   WriteFSLFormattedFileSet(const std::string &   outputVolumeHeaderName,
@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "DWIConvertGzip.h"
+
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itk_zlib.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compress a short volume in many small chunks and check that zlib, the
+// NRRD reader and the NIfTI reader all see the original voxels.
+//
+//   DWIConvertGzipTest <temporaryDirectory>
+namespace
+{
+using ImageType = itk::Image<short, 4>;
+
+bool
+SameVoxels(const ImageType * image, const std::vector<short> & expected)
+{
+  size_t n = 0;
+  for (itk::ImageRegionConstIterator<ImageType> it(image, image->GetBufferedRegion()); !it.IsAtEnd(); ++it, ++n)
+  {
+    if (n >= expected.size() || it.Get() != expected[n])
+    {
+      return false;
+    }
+  }
+  return n == expected.size();
+}
+} // namespace
+
+int
+main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <temporaryDirectory>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string tempDir(argv[1]);
+
+  // An odd chunk size puts member boundaries in the middle of voxels.
+  constexpr size_t chunkSize = 4099;
+  const unsigned   sizes[4] = { 23, 19, 11, 7 };
+  const size_t     numberOfVoxels = sizes[0] * sizes[1] * sizes[2] * sizes[3];
+
+  std::vector<short> voxels(numberOfVoxels);
+  unsigned int       state = 12345;
+  for (size_t n = 0; n < numberOfVoxels; ++n)
+  {
+    state = state * 1103515245U + 12345U;
+    voxels[n] = static_cast<short>((n % 97) * 13 + ((state >> 16) % 7) - 3);
+  }
+  const char * payload = reinterpret_cast<const char *>(voxels.data());
+  const size_t payloadBytes = numberOfVoxels * sizeof(short);
+
+  int status = EXIT_SUCCESS;
+
+  // zlib reads all members as one stream
+  const std::string rawGzName = tempDir + "/DWIConvertGzipTest.raw.gz";
+  {
+    std::ofstream out(rawGzName.c_str(), std::ios::out | std::ios::binary);
+    WriteParallelGzip(out, payload, payloadBytes, chunkSize);
+  }
+  {
+    std::vector<char> decompressed(payloadBytes + 1);
+    gzFile            in = gzopen(rawGzName.c_str(), "rb");
+    const int         read = gzread(in, decompressed.data(), static_cast<unsigned>(decompressed.size()));
+    gzclose(in);
+    if (read != static_cast<int>(payloadBytes) || !std::equal(payload, payload + payloadBytes, decompressed.data()))
+    {
+      std::cerr << "gzread returned " << read << " bytes that differ from the " << payloadBytes << " written"
+                << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+
+  // NRRD with an attached gzip payload, read through NrrdIO
+  const std::string nrrdName = tempDir + "/DWIConvertGzipTest.nrrd";
+  {
+    std::ofstream out(nrrdName.c_str(), std::ios::out | std::ios::binary);
+    out << "NRRD0005" << std::endl
+        << "type: short" << std::endl
+        << "dimension: 4" << std::endl
+        << "sizes: " << sizes[0] << " " << sizes[1] << " " << sizes[2] << " " << sizes[3] << std::endl
+        << "endian: little" << std::endl
+        << "encoding: gzip" << std::endl
+        << std::endl;
+    WriteParallelGzip(out, payload, payloadBytes, chunkSize);
+  }
+  try
+  {
+    using ReaderType = itk::ImageFileReader<ImageType>;
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName(nrrdName);
+    reader->Update();
+    if (!SameVoxels(reader->GetOutput(), voxels))
+    {
+      std::cerr << nrrdName << " does not hold the written voxels" << std::endl;
+      status = EXIT_FAILURE;
+    }
+
+    // NIfTI compressed after the fact, as WriteFSLFormattedFileSet does
+    const std::string niftiName = tempDir + "/DWIConvertGzipTest.nii";
+    using WriterType = itk::ImageFileWriter<ImageType>;
+    WriterType::Pointer writer = WriterType::New();
+    writer->SetInput(reader->GetOutput());
+    writer->SetFileName(niftiName);
+    writer->Update();
+    GzipFileInParallel(niftiName, niftiName + ".gz", chunkSize);
+
+    ReaderType::Pointer niftiReader = ReaderType::New();
+    niftiReader->SetFileName(niftiName + ".gz");
+    niftiReader->Update();
+    if (!SameVoxels(niftiReader->GetOutput(), voxels))
+    {
+      std::cerr << niftiName << ".gz does not hold the written voxels" << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+  catch (itk::ExceptionObject & e)
+  {
+    std::cerr << e << std::endl;
+    status = EXIT_FAILURE;
+  }
+  return status;
+}
@@ -0,0 +1,247 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkComputeDiffusionTensorImageFilter.h"
+#include "algo.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// Compare the threaded ComputeDiffusionTensorImageFilter with the per voxel
+// My_lsf and Matrix_Inverse fit it replaces, on a synthetic acquisition with
+// 12 directions and 2 b-value steps.  One work unit and eight must give the
+// same tensors.
+
+using FilterType = itk::ComputeDiffusionTensorImageFilter;
+using InputImageType = FilterType::InputImageType;
+using OutputImageType = FilterType::OutputImageType;
+
+static constexpr int NumberOfDirections = 12;
+static constexpr int NumberOfBSteps = 2;
+static constexpr int BackgroundThreshold = 50;
+
+// Rows (gx^2, 2 gx gy, 2 gx gz, gy^2, 2 gy gz, gz^2) of unit directions
+static TMatrix
+MakeDiffusionDirections()
+{
+  TMatrix                          directions(NumberOfDirections, 6);
+  std::mt19937                     generator(NumberOfDirections);
+  std::normal_distribution<double> component(0.0, 1.0);
+  for (int d = 0; d < NumberOfDirections; d++)
+  {
+    double       g[3] = { component(generator), component(generator), component(generator) };
+    const double norm = std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+    for (double & gi : g)
+    {
+      gi /= norm;
+    }
+    directions(d, 0) = g[0] * g[0];
+    directions(d, 1) = 2 * g[0] * g[1];
+    directions(d, 2) = 2 * g[0] * g[2];
+    directions(d, 3) = g[1] * g[1];
+    directions(d, 4) = 2 * g[1] * g[2];
+    directions(d, 5) = g[2] * g[2];
+  }
+  return directions;
+}
+
+// S = S0 exp(-b (directions * D)) with noise, a background below the
+// threshold and a few dropped out (zero) signals
+static InputImageType::Pointer
+MakeDiffusionImage(const unsigned int size, const TMatrix & directions, const TVector & bValues)
+{
+  InputImageType::SizeType imageSize;
+  imageSize.Fill(size);
+  imageSize[3] = 1 + NumberOfDirections * NumberOfBSteps;
+  InputImageType::Pointer image = InputImageType::New();
+  image->SetRegions(imageSize);
+  image->Allocate();
+
+  std::mt19937                           generator(size);
+  std::uniform_real_distribution<double> diffusivity(2e-4, 1.5e-3);
+  std::uniform_real_distribution<double> offDiagonal(-2e-4, 2e-4);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::normal_distribution<double>       noise(0.0, 5.0);
+
+  InputImageType::IndexType index;
+  for (index[2] = 0; index[2] < static_cast<long>(size); index[2]++)
+  {
+    for (index[1] = 0; index[1] < static_cast<long>(size); index[1]++)
+    {
+      for (index[0] = 0; index[0] < static_cast<long>(size); index[0]++)
+      {
+        const bool background = uniform(generator) < 0.2;
+        TVector    tensor(6);
+        tensor(0) = diffusivity(generator);
+        tensor(1) = offDiagonal(generator);
+        tensor(2) = offDiagonal(generator);
+        tensor(3) = diffusivity(generator);
+        tensor(4) = offDiagonal(generator);
+        tensor(5) = diffusivity(generator);
+        const TVector adc = directions * tensor;
+        const double  b0 = background ? 20.0 + noise(generator) : 1000.0 + 20.0 * noise(generator);
+
+        index[3] = 0;
+        image->SetPixel(index, static_cast<InputImageType::PixelType>(std::lround(b0)));
+        for (int d = 0; d < NumberOfDirections; d++)
+        {
+          for (int s = 0; s < NumberOfBSteps; s++)
+          {
+            index[3] = 1 + d * NumberOfBSteps + s;
+            double signal = b0 * std::exp(-bValues(s + 1) * adc(d)) + noise(generator);
+            if (uniform(generator) < 0.002)
+            {
+              signal = 0.0;
+            }
+            image->SetPixel(index, static_cast<InputImageType::PixelType>(std::lround(std::max(signal, 0.0))));
+          }
+        }
+      }
+    }
+  }
+  return image;
+}
+
+// ComputeDiffusionTensorImageFilter::Update() before it was threaded
+static OutputImageType::Pointer
+ReferenceTensors(const InputImageType * image, const TMatrix & directions, const TVector & bValues)
+{
+  const InputImageType::SizeType inputSize = image->GetLargestPossibleRegion().GetSize();
+  OutputImageType::SizeType      size;
+  for (int i = 0; i < 3; i++)
+  {
+    size[i] = inputSize[i];
+  }
+  OutputImageType::Pointer output = OutputImageType::New();
+  output->SetRegions(size);
+  output->Allocate();
+
+  const TMatrix mMatrix = Matrix_Inverse(directions);
+
+  itk::ImageRegionIterator<OutputImageType> outIt(output, output->GetLargestPossibleRegion());
+  for (; !outIt.IsAtEnd(); ++outIt)
+  {
+    InputImageType::IndexType index;
+    for (int i = 0; i < 3; i++)
+    {
+      index[i] = outIt.GetIndex()[i];
+    }
+    index[3] = 0;
+    const auto ADC0 = static_cast<float>(image->GetPixel(index));
+
+    OutputImageType::PixelType currentVoxel;
+    currentVoxel.Fill(0);
+    if (ADC0 > BackgroundThreshold)
+    {
+      TVector ADCm(NumberOfDirections);
+      TVector Ln_ADCs(NumberOfBSteps + 1);
+      Ln_ADCs(0) = 0;
+      bool ErrFlg = false;
+      for (int direction = 0; direction < NumberOfDirections && !ErrFlg; direction++)
+      {
+        for (int step = 0; step < NumberOfBSteps; step++)
+        {
+          index[3] = 1 + direction * NumberOfBSteps + step;
+          const auto tempflt = static_cast<float>(image->GetPixel(index));
+          if (tempflt == 0)
+          {
+            ErrFlg = true;
+            break;
+          }
+          Ln_ADCs(step + 1) = std::log(tempflt / ADC0);
+        }
+        ADCm(direction) = -1 * My_lsf(bValues, Ln_ADCs);
+      }
+      if (!ErrFlg)
+      {
+        currentVoxel.SetVnlVector(mMatrix * ADCm);
+      }
+    }
+    outIt.Set(currentVoxel);
+  }
+  return output;
+}
+
+static OutputImageType::Pointer
+RunFilter(const InputImageType * image,
+          const TMatrix &        directions,
+          const TVector &        bValues,
+          const int              numberOfWorkUnits)
+{
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(image);
+  filter->SetNumberOfDirections(NumberOfDirections);
+  filter->SetNumberOfBSteps(NumberOfBSteps);
+  filter->SetDiffusionDirections(directions);
+  filter->SetBValues(bValues);
+  filter->SetBackgroundThreshold(BackgroundThreshold);
+  filter->SetNumberOfWorkUnits(numberOfWorkUnits);
+  filter->Update();
+  return filter->GetOutput();
+}
+
+int
+main(int, char *[])
+{
+  constexpr unsigned int size = 20;
+
+  const TMatrix directions = MakeDiffusionDirections();
+  TVector       bValues(NumberOfBSteps + 1);
+  bValues(0) = 0.0;
+  bValues(1) = 500.0;
+  bValues(2) = 1000.0;
+  const InputImageType::Pointer image = MakeDiffusionImage(size, directions, bValues);
+
+  const OutputImageType::Pointer reference = ReferenceTensors(image, directions, bValues);
+  const OutputImageType::Pointer serial = RunFilter(image, directions, bValues, 1);
+  const OutputImageType::Pointer threaded = RunFilter(image, directions, bValues, 8);
+
+  // The reference fits in single precision, compare relative to the largest
+  // tensor element
+  double                                         range = 0.0;
+  double                                         difference = 0.0;
+  bool                                           sameZeros = true;
+  bool                                           identical = true;
+  itk::ImageRegionConstIterator<OutputImageType> rIt(reference, reference->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<OutputImageType> sIt(serial, serial->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<OutputImageType> tIt(threaded, threaded->GetLargestPossibleRegion());
+  for (; !rIt.IsAtEnd(); ++rIt, ++sIt, ++tIt)
+  {
+    identical &= sIt.Get() == tIt.Get();
+    sameZeros &= (rIt.Get().GetNorm() == 0) == (tIt.Get().GetNorm() == 0);
+    for (unsigned int e = 0; e < 6; e++)
+    {
+      range = std::max(range, static_cast<double>(std::abs(rIt.Get()[e])));
+      difference = std::max(difference, static_cast<double>(std::abs(rIt.Get()[e] - tIt.Get()[e])));
+    }
+  }
+
+  if (!identical || !sameZeros || difference > 1e-4 * range)
+  {
+    std::cerr << "ComputeDiffusionTensorImageFilter differs from the per voxel fit, max difference " << difference
+              << " of " << range << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
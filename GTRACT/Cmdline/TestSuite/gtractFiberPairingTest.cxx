@@ -0,0 +1,120 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "gtractFiberPairing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Pair a synthetic tractogram through the k-d tree and require the same
+// pairings, and distances, as the exhaustive scan compareTractInclusion used
+// before.
+
+// Smooth random fibers through a 200 mm cube, the standard set is the test
+// set jittered and in a different order.
+static void
+MakeSyntheticTractograms(const unsigned int numberOfFibers,
+                         const unsigned int numberOfPoints,
+                         FiberSet &         testFibers,
+                         FiberSet &         standardFibers)
+{
+  std::mt19937                           generator(numberOfFibers);
+  std::uniform_real_distribution<double> position(-100.0, 100.0);
+  std::normal_distribution<double>       direction(0.0, 1.0);
+  std::normal_distribution<double>       jitter(0.0, 0.5);
+
+  std::vector<std::vector<double>> fibers(numberOfFibers, std::vector<double>(3 * numberOfPoints));
+  for (auto & fiber : fibers)
+  {
+    double point[3] = { position(generator), position(generator), position(generator) };
+    double heading[3] = { direction(generator), direction(generator), direction(generator) };
+    for (unsigned int i = 0; i < numberOfPoints; ++i)
+    {
+      const double norm = std::sqrt(heading[0] * heading[0] + heading[1] * heading[1] + heading[2] * heading[2]);
+      for (unsigned int p = 0; p < 3; ++p)
+      {
+        fiber[3 * i + p] = point[p];
+        point[p] += 2.0 * heading[p] / norm;
+        heading[p] += 0.2 * direction(generator);
+      }
+    }
+  }
+  std::vector<unsigned int> shuffled(numberOfFibers);
+  for (unsigned int f = 0; f < numberOfFibers; ++f)
+  {
+    testFibers.AddFiber(f, fibers[f].data());
+    shuffled[f] = f;
+  }
+  std::shuffle(shuffled.begin(), shuffled.end(), generator);
+  for (unsigned int f = 0; f < numberOfFibers; ++f)
+  {
+    std::vector<double> jittered = fibers[shuffled[f]];
+    for (auto & coordinate : jittered)
+    {
+      coordinate += jitter(generator);
+    }
+    standardFibers.AddFiber(f, jittered.data());
+  }
+}
+
+static FiberPairing
+ExhaustiveClosest(const double * testFiber, const FiberSet & standardFibers)
+{
+  FiberPairing best;
+  for (size_t k = 0; k < standardFibers.GetNumberOfFibers(); ++k)
+  {
+    const double distance = MeanCorrespondingPointDistance(
+      testFiber, standardFibers.Point(k), standardFibers.GetNumberOfPoints(), std::numeric_limits<double>::max());
+    if (distance < best.distance)
+    {
+      best.distance = distance;
+      best.standardCellId = standardFibers.GetCellId(k);
+    }
+  }
+  return best;
+}
+
+int
+main(int, char *[])
+{
+  constexpr unsigned int numberOfFibers = 500;
+  constexpr unsigned int numberOfPoints = 20;
+  FiberSet               testFibers(numberOfPoints);
+  FiberSet               standardFibers(numberOfPoints);
+  MakeSyntheticTractograms(numberOfFibers, numberOfPoints, testFibers, standardFibers);
+
+  const std::vector<FiberPairing> indexed = PairFibers(testFibers, standardFibers);
+  unsigned int                    differences = 0;
+  for (size_t j = 0; j < testFibers.GetNumberOfFibers(); ++j)
+  {
+    const FiberPairing exhaustive = ExhaustiveClosest(testFibers.Point(j), standardFibers);
+    differences += exhaustive.standardCellId != indexed[j].standardCellId || exhaustive.distance != indexed[j].distance;
+  }
+  if (differences != 0)
+  {
+    std::cerr << differences << " indexed fiber pairings differ from the exhaustive scan" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
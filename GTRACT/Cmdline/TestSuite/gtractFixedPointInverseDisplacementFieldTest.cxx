@@ -0,0 +1,158 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkGtractFixedPointInverseDisplacementFieldImageFilter.h"
+
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// Invert a smooth synthetic displacement field with the fixed point filter,
+// check the composition with the analytic forward field away from the
+// border, and that 1 and 8 work units give the same inverse.
+
+using VectorType = itk::Vector<float, 3>;
+using DisplacementFieldType = itk::Image<VectorType, 3>;
+using PointType = DisplacementFieldType::PointType;
+
+static constexpr double Amplitude = 2.0;
+
+// Voxels closer to the border are not checked
+static constexpr unsigned int Border = 4;
+
+// v(p) = A (sin(2 pi y / L), sin(2 pi z / L), sin(2 pi x / L)), the norm of
+// its Jacobian stays below one so the inverse exists
+static VectorType
+ForwardDisplacement(const PointType & p, const double wavelength)
+{
+  const double k = 2.0 * itk::Math::pi / wavelength;
+  VectorType   v;
+  v[0] = Amplitude * std::sin(k * p[1]);
+  v[1] = Amplitude * std::sin(k * p[2]);
+  v[2] = Amplitude * std::sin(k * p[0]);
+  return v;
+}
+
+static DisplacementFieldType::Pointer
+MakeField(const unsigned int size)
+{
+  DisplacementFieldType::SizeType imageSize;
+  imageSize.Fill(size);
+  DisplacementFieldType::Pointer field = DisplacementFieldType::New();
+  field->SetRegions(imageSize);
+  field->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<DisplacementFieldType> it(field, field->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    PointType p;
+    field->TransformIndexToPhysicalPoint(it.GetIndex(), p);
+    it.Set(ForwardDisplacement(p, size));
+  }
+  return field;
+}
+
+// Largest |u(x) + v(x + u(x))| with the analytic v, away from the border
+// where x + u(x) may leave the field
+static double
+MaximumCompositionError(const DisplacementFieldType * inverse, const unsigned int size)
+{
+  double                                                        maximum = 0.0;
+  itk::ImageRegionConstIteratorWithIndex<DisplacementFieldType> it(inverse, inverse->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    bool interior = true;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      interior &= it.GetIndex()[i] >= Border && it.GetIndex()[i] + Border < size;
+    }
+    if (!interior)
+    {
+      continue;
+    }
+    PointType x;
+    inverse->TransformIndexToPhysicalPoint(it.GetIndex(), x);
+    const VectorType u = it.Get();
+    PointType        y;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      y[i] = x[i] + u[i];
+    }
+    maximum = std::max(maximum, static_cast<double>((u + ForwardDisplacement(y, size)).GetNorm()));
+  }
+  return maximum;
+}
+
+template <typename TFilter>
+static void
+SetOutputGrid(TFilter * filter, const DisplacementFieldType * field)
+{
+  filter->SetInput(field);
+  filter->SetSize(field->GetLargestPossibleRegion().GetSize());
+  filter->SetOutputSpacing(field->GetSpacing());
+  filter->SetOutputOrigin(field->GetOrigin());
+}
+
+int
+main(int, char *[])
+{
+  constexpr unsigned int size = 32;
+
+  const DisplacementFieldType::Pointer field = MakeField(size);
+
+  using FixedPointFilterType =
+    itk::GtractFixedPointInverseDisplacementFieldImageFilter<DisplacementFieldType, DisplacementFieldType>;
+  DisplacementFieldType::Pointer inverses[2];
+  const int                      workUnits[2] = { 1, 8 };
+  for (unsigned int k = 0; k < 2; k++)
+  {
+    FixedPointFilterType::Pointer filter = FixedPointFilterType::New();
+    SetOutputGrid(filter.GetPointer(), field);
+    filter->SetTolerance(1e-3);
+    filter->SetNumberOfWorkUnits(workUnits[k]);
+    filter->Update();
+    inverses[k] = filter->GetOutput();
+  }
+
+  bool                                                          identical = true;
+  itk::ImageRegionConstIteratorWithIndex<DisplacementFieldType> aIt(inverses[0], field->GetLargestPossibleRegion());
+  itk::ImageRegionConstIteratorWithIndex<DisplacementFieldType> bIt(inverses[1], field->GetLargestPossibleRegion());
+  for (; !aIt.IsAtEnd(); ++aIt, ++bIt)
+  {
+    identical &= aIt.Get() == bIt.Get();
+  }
+  if (!identical)
+  {
+    std::cerr << "Fixed point inverse differs between 1 and 8 work units" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Linear interpolation of the sampled field bounds the accuracy
+  const double fixedPointError = MaximumCompositionError(inverses[1], size);
+  if (fixedPointError > 0.02)
+  {
+    std::cerr << "Fixed point inverse composition error " << fixedPointError << " mm exceeds 0.02 mm" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gtractIndexedMinHeap.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+
+// Drive IndexedMinHeap with random inserts, decrease-keys, increase-keys and
+// pops, and check every step against an ordered set of (key, id) pairs: the
+// top is a smallest key, a pushed id is queued once with its last key, and
+// the pops come out in ascending key order.
+
+using HeapType = IndexedMinHeap<double>;
+using ReferenceType = std::set<std::pair<double, HeapType::IdType>>;
+
+static constexpr HeapType::IdType NumberOfIds = 500;
+
+static bool
+SameState(const HeapType & heap, const ReferenceType & reference, const std::map<HeapType::IdType, double> & keys)
+{
+  if (heap.size() != reference.size() || heap.empty() != reference.empty())
+  {
+    std::cerr << "Heap holds " << heap.size() << " nodes, expected " << reference.size() << std::endl;
+    return false;
+  }
+  if (!reference.empty() && heap.top() != reference.begin()->first)
+  {
+    std::cerr << "Heap top " << heap.top() << ", expected " << reference.begin()->first << std::endl;
+    return false;
+  }
+  for (HeapType::IdType id = 0; id < NumberOfIds; id++)
+  {
+    if (heap.contains(id) != (keys.count(id) != 0))
+    {
+      std::cerr << "Id " << id << " queued state is wrong" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+static void
+Push(HeapType &                           heap,
+     ReferenceType &                      reference,
+     std::map<HeapType::IdType, double> & keys,
+     const HeapType::IdType               id,
+     const double                         key)
+{
+  const auto queued = keys.find(id);
+  if (queued != keys.end())
+  {
+    reference.erase(std::make_pair(queued->second, id));
+  }
+  keys[id] = key;
+  reference.emplace(key, id);
+  heap.push(id, key);
+}
+
+int
+main(int, char *[])
+{
+  std::mt19937                                    generator(7);
+  std::uniform_int_distribution<HeapType::IdType> anyId(0, NumberOfIds - 1);
+  std::uniform_real_distribution<double>          anyKey(0.0, 1000.0);
+  std::uniform_int_distribution<int>              anyOperation(0, 9);
+
+  HeapType heap;
+  heap.Initialize(NumberOfIds);
+  ReferenceType                      reference;
+  std::map<HeapType::IdType, double> keys;
+
+  for (unsigned int step = 0; step < 20000; step++)
+  {
+    const int operation = anyOperation(generator);
+    if (operation < 4 || keys.empty())
+    {
+      Push(heap, reference, keys, anyId(generator), anyKey(generator));
+    }
+    else if (operation < 8)
+    {
+      // Decrease (or, one time in four, increase) the key of a queued id
+      auto queued = keys.begin();
+      std::advance(queued, std::uniform_int_distribution<std::size_t>(0, keys.size() - 1)(generator));
+      const double key = (operation < 7) ? queued->second * 0.5 : queued->second + anyKey(generator);
+      Push(heap, reference, keys, queued->first, key);
+    }
+    else
+    {
+      keys.erase(reference.begin()->second);
+      reference.erase(reference.begin());
+      heap.pop();
+    }
+    if (!SameState(heap, reference, keys))
+    {
+      std::cerr << "after step " << step << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Drain in ascending key order
+  double previous = -1.0;
+  while (!heap.empty())
+  {
+    if (heap.top() < previous)
+    {
+      std::cerr << "Popped " << heap.top() << " after " << previous << std::endl;
+      return EXIT_FAILURE;
+    }
+    previous = heap.top();
+    keys.erase(reference.begin()->second);
+    reference.erase(reference.begin());
+    heap.pop();
+    if (!SameState(heap, reference, keys))
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // clear() forgets every queued id
+  for (HeapType::IdType id = 0; id < NumberOfIds; id += 3)
+  {
+    heap.push(id, anyKey(generator));
+  }
+  heap.clear();
+  keys.clear();
+  reference.clear();
+  if (!SameState(heap, reference, keys))
+  {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
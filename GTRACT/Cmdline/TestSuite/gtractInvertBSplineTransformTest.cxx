@@ -0,0 +1,129 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkInvertBSplineFilter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Invert a random smooth B-Spline transform with InvertBSplineFilter and
+// check |Tinv(T(p)) - p| at random points that are not samples of the fit.
+
+using FilterType = itk::InvertBSplineFilter;
+using BSplineTransformType = FilterType::BsplineTransformType;
+using PointType = FilterType::PointType;
+using ImageType = FilterType::ImageType;
+
+static constexpr unsigned int ImageSize = 40;
+
+// Landmark subdivisions along each axis
+static constexpr int LandmarkDensity = 40;
+
+static BSplineTransformType::Pointer
+MakeForwardTransform(const ImageType * image)
+{
+  BSplineTransformType::PhysicalDimensionsType dimensions;
+  BSplineTransformType::MeshSizeType           meshSize;
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    dimensions[i] = image->GetSpacing()[i] * (ImageSize - 1);
+    meshSize[i] = 5;
+  }
+  BSplineTransformType::Pointer transform = BSplineTransformType::New();
+  transform->SetTransformDomainOrigin(image->GetOrigin());
+  transform->SetTransformDomainPhysicalDimensions(dimensions);
+  transform->SetTransformDomainMeshSize(meshSize);
+  transform->SetTransformDomainDirection(image->GetDirection());
+
+  // Coefficients up to 1.5 mm over 8 mm control point spacing keep the
+  // transform invertible
+  std::mt19937                           generator(ImageSize);
+  std::uniform_real_distribution<double> coefficient(-1.5, 1.5);
+  BSplineTransformType::ParametersType   parameters(transform->GetNumberOfParameters());
+  for (unsigned int k = 0; k < parameters.size(); k++)
+  {
+    parameters[k] = coefficient(generator);
+  }
+  transform->SetParametersByValue(parameters);
+  return transform;
+}
+
+// Mean and maximum |Tinv(T(p)) - p| over points away from the border
+static void
+InverseConsistencyError(const BSplineTransformType *   forward,
+                        const BSplineTransformType *   inverse,
+                        const std::vector<PointType> & points,
+                        double &                       mean,
+                        double &                       maximum)
+{
+  mean = 0.0;
+  maximum = 0.0;
+  for (const auto & p : points)
+  {
+    const double error = (inverse->TransformPoint(forward->TransformPoint(p)) - p).GetNorm();
+    mean += error;
+    maximum = std::max(maximum, error);
+  }
+  mean /= points.size();
+}
+
+int
+main(int, char *[])
+{
+  ImageType::SizeType size;
+  size.Fill(ImageSize);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+  image->FillBuffer(0);
+
+  const BSplineTransformType::Pointer forward = MakeForwardTransform(image);
+
+  std::mt19937                           generator(1);
+  std::uniform_real_distribution<double> coordinate(4.0, ImageSize - 5.0);
+  std::vector<PointType>                 testPoints(2000);
+  for (auto & p : testPoints)
+  {
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      p[i] = coordinate(generator);
+    }
+  }
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(forward);
+  filter->SetExampleImage(image);
+  filter->SetXgridSize(LandmarkDensity);
+  filter->SetYgridSize(LandmarkDensity);
+  filter->SetZgridSize(LandmarkDensity);
+  filter->Update();
+  double fitMean;
+  double fitMaximum;
+  InverseConsistencyError(forward.GetPointer(), filter->GetOutput(), testPoints, fitMean, fitMaximum);
+
+  if (fitMean > 0.03 || fitMaximum > 0.15 || filter->GetMaximumInverseConsistencyError() > 0.15)
+  {
+    std::cerr << "B-Spline inverse is not accurate enough: mean " << fitMean << " mm, maximum " << fitMaximum
+              << " mm, maximum on the samples " << filter->GetMaximumInverseConsistencyError() << " mm" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,251 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "gtractSymmetricEigen3x3.h"
+
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
+#include <vnl/vnl_matrix.h>
+#include <vnl/vnl_vector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+
+// Compare the closed form eigen analysis of gtractSymmetricEigen3x3.h with
+// vnl_symmetric_eigensystem on random tensors, diagonal tensors, the zero
+// tensor, rotated tensors with repeated eigenvalues and rotated tensors with
+// nearly repeated ones.  Eigenvalues must agree, every eigenvector returned
+// must be a unit vector of the eigenspace, and for well separated eigenvalues
+// it must be the vnl one up to sign.
+
+// Eigenvalues closer than this, relative to the largest entry, are treated
+// as an eigenspace of dimension two or more
+static constexpr double SeparationTolerance = 1e-3;
+
+struct EigenValueCase
+{
+  const char * name;
+  double       eigenValues[3];
+};
+
+// Tensors diag(eigenValues)
+static const EigenValueCase DiagonalCases[] = {
+  { "diagonal", { 3.0, 1.0, 2.0 } },
+  { "diagonal double root", { 2.0, 2.0, 5.0 } },
+  { "diagonal double top root", { -1.0, 4.0, 4.0 } },
+  { "diagonal triple root", { 7.0, 7.0, 7.0 } },
+  { "zero", { 0.0, 0.0, 0.0 } },
+};
+
+// Tensors R diag(eigenValues) R^T for a few rotations R
+static const EigenValueCase RotatedCases[] = {
+  { "rotated double root", { 1.0, 1.0, 3.0 } },
+  { "rotated double top root", { 2.0, 5.0, 5.0 } },
+  { "rotated triple root", { 4.0, 4.0, 4.0 } },
+  { "nearly double root", { 1.0, 1.0 + 1e-7, 2.0 } },
+  { "nearly double top root", { 1.0, 2.0, 2.0 + 1e-9 } },
+  { "nearly triple root", { 1.0, 1.0, 1.0 + 1e-12 } },
+  { "prolate diffusion tensor", { 1e-3, 0.7e-3, 0.7e-3 } },
+};
+
+static vnl_matrix<double>
+TensorToMatrix(const double tensor[6])
+{
+  vnl_matrix<double> matrix(3, 3);
+  matrix(0, 0) = tensor[0];
+  matrix(0, 1) = matrix(1, 0) = tensor[1];
+  matrix(0, 2) = matrix(2, 0) = tensor[2];
+  matrix(1, 1) = tensor[3];
+  matrix(1, 2) = matrix(2, 1) = tensor[4];
+  matrix(2, 2) = tensor[5];
+  return matrix;
+}
+
+// R diag(d) R^T with R the rotation by angle about axis
+static void
+RotatedTensor(const double d[3], const double axis[3], const double angle, double tensor[6])
+{
+  const double norm = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+  const double u[3] = { axis[0] / norm, axis[1] / norm, axis[2] / norm };
+  const double c = std::cos(angle);
+  const double s = std::sin(angle);
+  double       rotation[3][3];
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      rotation[i][j] = (1.0 - c) * u[i] * u[j] + ((i == j) ? c : 0.0);
+    }
+  }
+  rotation[0][1] -= s * u[2];
+  rotation[0][2] += s * u[1];
+  rotation[1][0] += s * u[2];
+  rotation[1][2] -= s * u[0];
+  rotation[2][0] -= s * u[1];
+  rotation[2][1] += s * u[0];
+
+  double full[3][3];
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      full[i][j] = 0.0;
+      for (unsigned int k = 0; k < 3; k++)
+      {
+        full[i][j] += rotation[i][k] * d[k] * rotation[j][k];
+      }
+    }
+  }
+  tensor[0] = full[0][0];
+  tensor[1] = 0.5 * (full[0][1] + full[1][0]);
+  tensor[2] = 0.5 * (full[0][2] + full[2][0]);
+  tensor[3] = full[1][1];
+  tensor[4] = 0.5 * (full[1][2] + full[2][1]);
+  tensor[5] = full[2][2];
+}
+
+// Unit length and |A v - lambda v| small
+static bool
+IsUnitEigenVector(const vnl_matrix<double> & matrix, const double eigenValue, const double v[3], const double scale)
+{
+  vnl_vector<double> vector(3);
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    vector[i] = v[i];
+  }
+  const double residual = (matrix * vector - eigenValue * vector).magnitude();
+  return std::abs(vector.magnitude() - 1.0) <= 1e-12 && residual <= 1e-7 * scale;
+}
+
+static bool
+CheckTensor(const double tensor[6], const char * name)
+{
+  const vnl_matrix<double>                matrix = TensorToMatrix(tensor);
+  const vnl_symmetric_eigensystem<double> reference(matrix);
+  const double                            scale = matrix.absolute_value_max();
+
+  // At a repeated root the trigonometric solution keeps about half of the
+  // digits, the acos of r near +-1 amplifies its round off.
+  double eigenValues[3];
+  SymmetricEigenValues3x3(tensor, eigenValues);
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    if (std::abs(eigenValues[i] - reference.get_eigenvalue(i)) > 1e-7 * scale)
+    {
+      std::cerr << name << ": eigenvalue " << i << " is " << eigenValues[i] << ", vnl gives "
+                << reference.get_eigenvalue(i) << std::endl;
+      return false;
+    }
+  }
+
+  const bool diagonal = tensor[1] == 0.0 && tensor[2] == 0.0 && tensor[4] == 0.0;
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    double gap = std::numeric_limits<double>::max();
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      if (j != i)
+      {
+        gap = std::min(gap, std::abs(reference.get_eigenvalue(i) - reference.get_eigenvalue(j)));
+      }
+    }
+
+    double     eigenVector[3] = { 0.0, 0.0, 0.0 };
+    const bool simple = SymmetricEigenVector3x3(tensor, eigenValues[i], eigenVector);
+    if (simple && !IsUnitEigenVector(matrix, eigenValues[i], eigenVector, scale))
+    {
+      std::cerr << name << ": eigenvector " << i << " (" << eigenVector[0] << ", " << eigenVector[1] << ", "
+                << eigenVector[2] << ") is not a unit eigenvector" << std::endl;
+      return false;
+    }
+    if (gap > SeparationTolerance * scale)
+    {
+      const vnl_vector<double> expected = reference.get_eigenvector(i);
+      const double dot = eigenVector[0] * expected[0] + eigenVector[1] * expected[1] + eigenVector[2] * expected[2];
+      if (!simple || std::abs(dot) < 1.0 - 1e-9)
+      {
+        std::cerr << name << ": eigenvector " << i << " differs from vnl " << expected << std::endl;
+        return false;
+      }
+    }
+    else if (diagonal && gap == 0.0 && simple)
+    {
+      std::cerr << name << ": repeated eigenvalue " << eigenValues[i] << " reported as simple" << std::endl;
+      return false;
+    }
+  }
+
+  double principal[3];
+  PrincipalEigenVector3x3(tensor, principal);
+  if (scale == 0.0)
+  {
+    if (principal[0] != 0.0 || principal[1] != 0.0 || principal[2] != 1.0)
+    {
+      std::cerr << name << ": principal eigenvector of the zero tensor is not the z axis" << std::endl;
+      return false;
+    }
+  }
+  else if (!IsUnitEigenVector(matrix, eigenValues[2], principal, scale))
+  {
+    std::cerr << name << ": principal eigenvector (" << principal[0] << ", " << principal[1] << ", " << principal[2]
+              << ") is not a unit eigenvector of the largest eigenvalue" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int
+main(int, char *[])
+{
+  bool passed = true;
+
+  std::mt19937                           generator(11);
+  std::uniform_real_distribution<double> entry(-1.0, 1.0);
+  for (unsigned int n = 0; n < 200; n++)
+  {
+    // Diffusion tensors are of the order of 1e-3 mm^2/s
+    double tensor[6];
+    for (double & t : tensor)
+    {
+      t = 1e-3 * entry(generator);
+    }
+    passed = CheckTensor(tensor, "random") && passed;
+  }
+
+  for (const auto & diagonalCase : DiagonalCases)
+  {
+    const double * d = diagonalCase.eigenValues;
+    const double   tensor[6] = { d[0], 0.0, 0.0, d[1], 0.0, d[2] };
+    passed = CheckTensor(tensor, diagonalCase.name) && passed;
+  }
+
+  const double axes[2][3] = { { 1.0, 2.0, 3.0 }, { -0.3, 0.1, 1.0 } };
+  for (const auto & axis : axes)
+  {
+    for (const auto & rotatedCase : RotatedCases)
+    {
+      double tensor[6];
+      RotatedTensor(rotatedCase.eigenValues, axis, 0.7, tensor);
+      passed = CheckTensor(tensor, rotatedCase.name) && passed;
+    }
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,269 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkTensorToAnisotropyImageFilter.h"
+#include "gtractDiffusionTensor3D.h"
+#include "algo.h"
+
+#include "itkConstNeighborhoodIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkNeighborhoodAlgorithm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+// Compare the threaded TensorToAnisotropyImageFilter with the serial
+// computations it replaces: the gtractDiffusionTensor3D measures with ITK's
+// eigen analysis, and the CI / LI of algo.h over the in plane neighborhood.
+// One work unit and eight must give the same image.
+
+using TensorImageType = itk::Image<itk::gtractDiffusionTensor3D<double>, 3>;
+using VectorImageType = itk::Image<itk::Vector<float, 6>, 3>;
+using AnisotropyImageType = itk::Image<float, 3>;
+
+// Random positive definite tensors with eigenvalues typical of brain tissue,
+// about a tenth of the voxels zero as in the background.
+static void
+MakeTensorImages(const unsigned int size, TensorImageType::Pointer & tensors, VectorImageType::Pointer & vectors)
+{
+  TensorImageType::SizeType imageSize;
+  imageSize.Fill(size);
+  tensors = TensorImageType::New();
+  tensors->SetRegions(imageSize);
+  tensors->Allocate();
+  vectors = VectorImageType::New();
+  vectors->SetRegions(imageSize);
+  vectors->Allocate();
+
+  std::mt19937                           generator(size);
+  std::uniform_real_distribution<double> eigenValue(1e-4, 2e-3);
+  std::normal_distribution<double>       direction(0.0, 1.0);
+  std::uniform_real_distribution<double> background(0.0, 1.0);
+
+  itk::ImageRegionIterator<TensorImageType> tIt(tensors, tensors->GetLargestPossibleRegion());
+  itk::ImageRegionIterator<VectorImageType> vIt(vectors, vectors->GetLargestPossibleRegion());
+  for (; !tIt.IsAtEnd(); ++tIt, ++vIt)
+  {
+    itk::Vector<float, 6> v;
+    v.Fill(0.0f);
+    if (background(generator) > 0.1)
+    {
+      // D = sum_k l_k u_k u_k^T with random, not orthogonal, directions is
+      // still symmetric positive definite
+      double d[6] = { 0, 0, 0, 0, 0, 0 };
+      for (unsigned int k = 0; k < 3; k++)
+      {
+        double       u[3] = { direction(generator), direction(generator), direction(generator) };
+        const double norm = std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+        const double l = eigenValue(generator) / (norm * norm);
+        d[0] += l * u[0] * u[0];
+        d[1] += l * u[0] * u[1];
+        d[2] += l * u[0] * u[2];
+        d[3] += l * u[1] * u[1];
+        d[4] += l * u[1] * u[2];
+        d[5] += l * u[2] * u[2];
+      }
+      for (unsigned int i = 0; i < 6; i++)
+      {
+        v[i] = static_cast<float>(d[i]);
+      }
+    }
+    itk::gtractDiffusionTensor3D<double> tensor;
+    for (unsigned int i = 0; i < 6; i++)
+    {
+      tensor[i] = v[i];
+    }
+    tIt.Set(tensor);
+    vIt.Set(v);
+  }
+}
+
+// gtractAnisotropyMap before it used the filter, with ITK's eigen analysis
+static double
+ReferenceVoxelAnisotropy(const itk::gtractDiffusionTensor3D<double> & tensor, const itk::AnisotropyType type)
+{
+  using TensorType = itk::gtractDiffusionTensor3D<double>;
+  TensorType::EigenValuesArrayType eigenValues;
+  switch (type)
+  {
+    case itk::MEAN_DIFFUSIVITY:
+      return tensor.GetTrace() / 3.0;
+    case itk::FRACTIONAL_ANISOTROPY:
+      return tensor.GetFractionalAnisotropy();
+    case itk::RELATIVE_ANISOTROPY:
+      return tensor.GetRelativeAnisotropy();
+    case itk::VOLUME_RATIO:
+      return tensor.GetTrace() == 0 ? 0.0 : tensor.GetVolumeRatio();
+    case itk::AXIAL_DIFFUSIVITY:
+      tensor.ComputeEigenValues(eigenValues);
+      return std::abs(eigenValues[2]);
+    case itk::RADIAL_DIFFUSIVITY:
+      tensor.ComputeEigenValues(eigenValues);
+      return (std::abs(eigenValues[0]) + std::abs(eigenValues[1])) / 2.0;
+    case itk::VOXEL_LATTICE_INDEX:
+      return tensor.GetLatticeIndex();
+    default:
+      return 0.0;
+  }
+}
+
+// The serial neighborhood loop of the filter before it was threaded
+static AnisotropyImageType::Pointer
+ReferenceNeighborhoodAnisotropy(const VectorImageType * input, const itk::AnisotropyType type)
+{
+  AnisotropyImageType::Pointer output = AnisotropyImageType::New();
+  output->CopyInformation(input);
+  output->SetRegions(input->GetLargestPossibleRegion());
+  output->Allocate();
+  output->FillBuffer(0.0);
+
+  using NeighborhoodIteratorType = itk::ConstNeighborhoodIterator<VectorImageType>;
+  NeighborhoodIteratorType::RadiusType radius;
+  radius.Fill(1);
+  radius[2] = 0;
+  using FaceCalculatorType = itk::NeighborhoodAlgorithm::ImageBoundaryFacesCalculator<VectorImageType>;
+  FaceCalculatorType faceCalculator;
+  for (const auto & face : faceCalculator(input, input->GetLargestPossibleRegion(), radius))
+  {
+    NeighborhoodIteratorType it(radius, input, face);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      TVector center = it.GetCenterPixel().GetVnlVector();
+      float   ai = 0;
+      if (!center.is_zero())
+      {
+        float sum = 0;
+        float coef = 0;
+        for (int i = 0; i <= 8; i++)
+        {
+          TVector neighbor = it.GetPixel(i).GetVnlVector();
+          if (i == 4 || neighbor.is_zero())
+          {
+            continue;
+          }
+          const float a = ((i % 2) == 0) ? 0.7071 : 1;
+          const float temp = (type == itk::COHERENCE_INDEX) ? CI(center, neighbor) : LI(center, neighbor);
+          sum += a * temp;
+          coef += a;
+        }
+        if ((coef != 0) & (sum > 0))
+        {
+          ai = sum / coef;
+        }
+      }
+      output->SetPixel(it.GetIndex(), ai);
+    }
+  }
+  return output;
+}
+
+template <typename TImage>
+static AnisotropyImageType::Pointer
+RunFilter(const TImage * input, const itk::AnisotropyType type, const int numberOfWorkUnits)
+{
+  using FilterType = itk::TensorToAnisotropyImageFilter<TImage, AnisotropyImageType>;
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(input);
+  filter->SetAnisotropyType(type);
+  filter->SetNumberOfWorkUnits(numberOfWorkUnits);
+  filter->Update();
+  return filter->GetOutput();
+}
+
+static double
+MaximumDifference(const AnisotropyImageType * a, const AnisotropyImageType * b)
+{
+  double                                             maximum = 0.0;
+  itk::ImageRegionConstIterator<AnisotropyImageType> aIt(a, a->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<AnisotropyImageType> bIt(b, b->GetLargestPossibleRegion());
+  for (; !aIt.IsAtEnd(); ++aIt, ++bIt)
+  {
+    maximum = std::max(maximum, static_cast<double>(std::abs(aIt.Get() - bIt.Get())));
+  }
+  return maximum;
+}
+
+int
+main(int, char *[])
+{
+  constexpr unsigned int size = 24;
+
+  TensorImageType::Pointer tensors;
+  VectorImageType::Pointer vectors;
+  MakeTensorImages(size, tensors, vectors);
+
+  bool passed = true;
+
+  // Voxel wise types against gtractDiffusionTensor3D, relative to the range
+  // of the measure
+  const itk::AnisotropyType voxelTypes[] = { itk::MEAN_DIFFUSIVITY,    itk::FRACTIONAL_ANISOTROPY,
+                                             itk::RELATIVE_ANISOTROPY, itk::VOLUME_RATIO,
+                                             itk::AXIAL_DIFFUSIVITY,   itk::RADIAL_DIFFUSIVITY,
+                                             itk::VOXEL_LATTICE_INDEX };
+  for (const auto type : voxelTypes)
+  {
+    const AnisotropyImageType::Pointer serial = RunFilter(tensors.GetPointer(), type, 1);
+    const AnisotropyImageType::Pointer threaded = RunFilter(tensors.GetPointer(), type, 8);
+
+    AnisotropyImageType::Pointer reference = AnisotropyImageType::New();
+    reference->SetRegions(tensors->GetLargestPossibleRegion());
+    reference->Allocate();
+    itk::ImageRegionConstIterator<TensorImageType> tIt(tensors, tensors->GetLargestPossibleRegion());
+    itk::ImageRegionIterator<AnisotropyImageType>  rIt(reference, reference->GetLargestPossibleRegion());
+    double                                         range = 0.0;
+    for (; !tIt.IsAtEnd(); ++tIt, ++rIt)
+    {
+      rIt.Set(static_cast<float>(ReferenceVoxelAnisotropy(tIt.Get(), type)));
+      range = std::max(range, static_cast<double>(std::abs(rIt.Get())));
+    }
+    const double difference = MaximumDifference(threaded, reference);
+    if (difference > 1e-5 * range || MaximumDifference(serial, threaded) != 0.0)
+    {
+      std::cerr << "type " << type << ": max difference " << difference << " of " << range << std::endl;
+      passed = false;
+    }
+  }
+
+  // Neighborhood indices against the eigen system version of algo.h
+  const itk::AnisotropyType neighborhoodTypes[] = { itk::COHERENCE_INDEX, itk::LATTICE_INDEX };
+  for (const auto type : neighborhoodTypes)
+  {
+    const AnisotropyImageType::Pointer serial = RunFilter(vectors.GetPointer(), type, 1);
+    const AnisotropyImageType::Pointer threaded = RunFilter(vectors.GetPointer(), type, 8);
+    const AnisotropyImageType::Pointer reference = ReferenceNeighborhoodAnisotropy(vectors, type);
+
+    const double difference = MaximumDifference(threaded, reference);
+    if (difference > 1e-4 || MaximumDifference(serial, threaded) != 0.0)
+    {
+      std::cerr << "type " << type << ": max difference " << difference << std::endl;
+      passed = false;
+    }
+  }
+
+  if (!passed)
+  {
+    std::cerr << "TensorToAnisotropyImageFilter differs from the serial computation" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
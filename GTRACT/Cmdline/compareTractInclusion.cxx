@@ -36,6 +36,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 #include <vtkPoints.h>
 #include <vtkFloatArray.h>
@@ -59,60 +60,47 @@
 
 #include "compareTractInclusionCLP.h"
 #include "BRAINSThreadControl.h"
+#include "gtractFiberPairing.h"
 #include <BRAINSCommonLib.h>
 
-double
-PairOffFibers(vtkPolyData * resampledTestFibers, vtkPolyData * resampledStandardFibers, int numberOfPoints)
+// Gather the first numberOfPoints points of every poly line cell.
+static FiberSet
+ExtractFibers(vtkPolyData * resampledFibers, int numberOfPoints)
 {
-  double maxDistances = 0.0;
-
-  for (int j = 0; j < resampledTestFibers->GetNumberOfCells(); j++)
+  FiberSet            fibers(numberOfPoints);
+  std::vector<double> points(3 * numberOfPoints);
+  vtkIdList *         pointList = vtkIdList::New();
+  for (vtkIdType j = 0; j < resampledFibers->GetNumberOfCells(); j++)
   {
-    if (resampledTestFibers->GetCellType(j) == VTK_POLY_LINE)
+    if (resampledFibers->GetCellType(j) == VTK_POLY_LINE)
     {
-      vtkIdList * testPointList = vtkIdList::New();
-      resampledTestFibers->GetCellPoints(j, testPointList);
-      double minDist = 1E200;
-      int    closestK = -1;
-      for (int k = 0; k < resampledStandardFibers->GetNumberOfCells(); k++)
+      resampledFibers->GetCellPoints(j, pointList);
+      for (int i = 0; i < numberOfPoints; i++)
       {
-        if (resampledStandardFibers->GetCellType(k) == VTK_POLY_LINE)
-        {
-          vtkIdList * standardPointList = vtkIdList::New();
-          resampledStandardFibers->GetCellPoints(k, standardPointList);
-          double sumDist = 0.0;
-          for (int i = 0; i < numberOfPoints; i++)
-          {
-            double testPoint[3];
-            resampledTestFibers->GetPoint(testPointList->GetId(i), testPoint);
-
-            double standardPoint[3];
-            resampledStandardFibers->GetPoint(standardPointList->GetId(i), standardPoint);
-
-            double sumSquares = 0.0;
-            for (int p = 0; p < 3; p++)
-            {
-              double edge = testPoint[p] - standardPoint[p];
-              sumSquares += edge * edge;
-            }
-            sumDist += std::sqrt(sumSquares);
-          }
-
-          double dist = (sumDist / numberOfPoints);
-          if (dist < minDist)
-          {
-            minDist = dist;
-            closestK = k;
-          }
-        }
+        resampledFibers->GetPoint(pointList->GetId(i), &points[3 * i]);
       }
+      fibers.AddFiber(j, points.data());
+    }
+  }
+  pointList->Delete();
+  return fibers;
+}
 
-      std::cout << "Pairing test fiber " << j << " with standard fiber " << closestK << " at distance " << minDist
-                << std::endl;
-      if (maxDistances < minDist)
-      {
-        maxDistances = minDist;
-      }
+double
+PairOffFibers(vtkPolyData * resampledTestFibers, vtkPolyData * resampledStandardFibers, int numberOfPoints)
+{
+  const FiberSet                  testFibers = ExtractFibers(resampledTestFibers, numberOfPoints);
+  const FiberSet                  standardFibers = ExtractFibers(resampledStandardFibers, numberOfPoints);
+  const std::vector<FiberPairing> pairings = PairFibers(testFibers, standardFibers);
+
+  double maxDistances = 0.0;
+  for (size_t j = 0; j < pairings.size(); j++)
+  {
+    std::cout << "Pairing test fiber " << testFibers.GetCellId(j) << " with standard fiber "
+              << pairings[j].standardCellId << " at distance " << pairings[j].distance << std::endl;
+    if (maxDistances < pairings[j].distance)
+    {
+      maxDistances = pairings[j].distance;
     }
   }
   return maxDistances;
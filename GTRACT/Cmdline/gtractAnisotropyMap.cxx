@@ -38,14 +38,12 @@
 #include <fstream>
 
 #include <itkImage.h>
-#include <itkImageRegionIterator.h>
-#include <itkImageRegionConstIterator.h>
 #include <itkImageFileWriter.h>
 #include <itkImageFileReader.h>
 
 /* Defines the Additional Anisotropy Metrics */
 #include "../Common/gtractDiffusionTensor3D.h"
-#include "algo.h"
+#include "itkTensorToAnisotropyImageFilter.h"
 #include "GtractTypes.h"
 #include "gtractAnisotropyMapCLP.h"
 #include "BRAINSThreadControl.h"
@@ -103,55 +101,52 @@ main(int argc, char * argv[])
     throw;
   }
 
-  TensorImageType::Pointer tensorImage = tensorImageReader->GetOutput();
-
-  AnisotropyImageType::Pointer anisotropyImage = AnisotropyImageType::New();
-  anisotropyImage->SetRegions(tensorImage->GetLargestPossibleRegion());
-  anisotropyImage->SetSpacing(tensorImage->GetSpacing());
-  anisotropyImage->SetOrigin(tensorImage->GetOrigin());
-  anisotropyImage->SetDirection(tensorImage->GetDirection());
-  anisotropyImage->Allocate();
-
-  using IteratorType = itk::ImageRegionIterator<AnisotropyImageType>;
-  IteratorType anisoIt(anisotropyImage, anisotropyImage->GetRequestedRegion());
-
-  using ConstIteratorType = itk::ImageRegionConstIterator<TensorImageType>;
-  ConstIteratorType tensorIt(tensorImage, tensorImage->GetRequestedRegion());
-
-  float anisotropy = 0.0;
-  for (anisoIt.GoToBegin(), tensorIt.GoToBegin(); !anisoIt.IsAtEnd(); ++anisoIt, ++tensorIt)
-  {
-    TensorPixelType tensorPixel = tensorIt.Get();
-    if (anisotropyType == "ADC" || anisotropyType == "adc")
-    {
-      anisotropy = static_cast<float>(tensorPixel.GetTrace() / 3.0);
-    }
-    else if (anisotropyType == "FA" || anisotropyType == "fa")
-    {
-      anisotropy = static_cast<float>(tensorPixel.GetFractionalAnisotropy());
-    }
-    else if (anisotropyType == "RA" || anisotropyType == "ra")
-    {
-      anisotropy = static_cast<float>(tensorPixel.GetRelativeAnisotropy());
-    }
-    else if (anisotropyType == "VR" || anisotropyType == "vr")
-    {
-      anisotropy = static_cast<float>(tensorPixel.GetVolumeRatio());
-    }
-    else if (anisotropyType == "AD" || anisotropyType == "ad")
-    {
-      anisotropy = static_cast<float>(tensorPixel.GetAxialDiffusivity());
-    }
-    else if (anisotropyType == "RD" || anisotropyType == "rd")
-    {
-      anisotropy = static_cast<float>(tensorPixel.GetRadialDiffusivity());
-    }
-    else if (anisotropyType == "LI" || anisotropyType == "li")
-    {
-      anisotropy = static_cast<float>(tensorPixel.GetLatticeIndex());
-    }
-    anisoIt.Set(anisotropy);
+  itk::AnisotropyType anisotropyCode = itk::MEAN_DIFFUSIVITY;
+  if (anisotropyType == "ADC" || anisotropyType == "adc")
+  {
+    anisotropyCode = itk::MEAN_DIFFUSIVITY;
+  }
+  else if (anisotropyType == "FA" || anisotropyType == "fa")
+  {
+    anisotropyCode = itk::FRACTIONAL_ANISOTROPY;
+  }
+  else if (anisotropyType == "RA" || anisotropyType == "ra")
+  {
+    anisotropyCode = itk::RELATIVE_ANISOTROPY;
+  }
+  else if (anisotropyType == "VR" || anisotropyType == "vr")
+  {
+    anisotropyCode = itk::VOLUME_RATIO;
+  }
+  else if (anisotropyType == "AD" || anisotropyType == "ad")
+  {
+    anisotropyCode = itk::AXIAL_DIFFUSIVITY;
+  }
+  else if (anisotropyType == "RD" || anisotropyType == "rd")
+  {
+    anisotropyCode = itk::RADIAL_DIFFUSIVITY;
+  }
+  else if (anisotropyType == "LI" || anisotropyType == "li")
+  {
+    anisotropyCode = itk::VOXEL_LATTICE_INDEX;
+  }
+  else if (anisotropyType == "CI" || anisotropyType == "ci")
+  {
+    anisotropyCode = itk::COHERENCE_INDEX;
   }
+  else
+  {
+    std::cout << "  Unknown --anisotropyType " << anisotropyType << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  using AnisotropyFilterType = itk::TensorToAnisotropyImageFilter<TensorImageType, AnisotropyImageType>;
+  AnisotropyFilterType::Pointer anisotropyFilter = AnisotropyFilterType::New();
+  anisotropyFilter->SetInput(tensorImageReader->GetOutput());
+  anisotropyFilter->SetAnisotropyType(anisotropyCode);
+  anisotropyFilter->Update();
+
+  AnisotropyImageType::Pointer anisotropyImage = anisotropyFilter->GetOutput();
 
   using WriterType = itk::ImageFileWriter<AnisotropyImageType>;
   WriterType::Pointer anisotropyWriter = WriterType::New();
@@ -97,7 +97,7 @@ main(int argc, char * argv[])
   GenericTransformType::Pointer baseTransform = itk::ReadTransformFromDisk(inputTransform);
 
   using InvertFilterType = itk::InvertBSplineFilter;
-  std::cout << "Running Inversion using TPS" << std::endl;
+  std::cout << "Running Inversion using a B-Spline fit" << std::endl;
   InvertFilterType::Pointer invertTransformFilter = InvertFilterType::New();
   {
     InvertFilterType::BsplineTransformTypePointer myBSpline =
@@ -109,7 +109,9 @@ main(int argc, char * argv[])
   invertTransformFilter->SetZgridSize(zSize);
   invertTransformFilter->SetExampleImage(ExampleImage);
   invertTransformFilter->Update();
-  std::cout << "TPS Inversion Complete" << std::endl;
+  std::cout << "B-Spline Inversion Complete, inverse consistency error mean "
+            << invertTransformFilter->GetMeanInverseConsistencyError() << " mm, maximum "
+            << invertTransformFilter->GetMaximumInverseConsistencyError() << " mm" << std::endl;
 
   itk::WriteTransformToDisk<double>(invertTransformFilter->GetOutput(), outputTransform);
   return EXIT_SUCCESS;
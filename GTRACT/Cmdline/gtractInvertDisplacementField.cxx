@@ -37,6 +37,7 @@
 #include "itkImage.h"
 #include "itkVector.h"
 #include "itkGtractInverseDisplacementFieldImageFilter.h"
+#include "itkGtractFixedPointInverseDisplacementFieldImageFilter.h"
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
 #include "gtractInvertDisplacementFieldCLP.h"
@@ -50,6 +51,12 @@ main(int argc, char * argv[])
   BRAINSRegisterAlternateIO();
   const BRAINSUtils::StackPushITKDefaultNumberOfThreads TempDefaultNumberOfThreadsHolder(numberOfThreads);
 
+  if (maximumNumberOfIterations < 1)
+  {
+    std::cerr << "The maximumNumberOfIterations must be at least 1, got " << maximumNumberOfIterations << std::endl;
+    return EXIT_FAILURE;
+  }
+
   constexpr unsigned int Dimension = 3;
   using ScalarPixelType = signed short;
   using ScalarImageType = itk::Image<ScalarPixelType, Dimension>;
@@ -92,25 +99,56 @@ main(int argc, char * argv[])
   }
 
   // Invert the deformationfield field
-  using FilterType = itk::GtractInverseDisplacementFieldImageFilter<DisplacementFieldType, DisplacementFieldType>;
-
-  FilterType::Pointer inverseFilter = FilterType::New();
-  inverseFilter->SetOutputSpacing(scalarReader->GetOutput()->GetSpacing());
-  inverseFilter->SetOutputOrigin(scalarReader->GetOutput()->GetOrigin());
-  ScalarImageType::RegionType region = scalarReader->GetOutput()->GetLargestPossibleRegion();
-
-  inverseFilter->SetSize(region.GetSize());
-  inverseFilter->SetInput(vectorReader->GetOutput());
-  inverseFilter->SetSubsamplingFactor(subsamplingFactor);
-
-  try
+  ScalarImageType::RegionType    region = scalarReader->GetOutput()->GetLargestPossibleRegion();
+  DisplacementFieldType::Pointer inverseField;
+  if (inversionMethod == "FixedPoint")
   {
-    inverseFilter->UpdateLargestPossibleRegion();
+    using FilterType =
+      itk::GtractFixedPointInverseDisplacementFieldImageFilter<DisplacementFieldType, DisplacementFieldType>;
+
+    FilterType::Pointer inverseFilter = FilterType::New();
+    inverseFilter->SetOutputSpacing(scalarReader->GetOutput()->GetSpacing());
+    inverseFilter->SetOutputOrigin(scalarReader->GetOutput()->GetOrigin());
+    inverseFilter->SetSize(region.GetSize());
+    inverseFilter->SetInput(vectorReader->GetOutput());
+    inverseFilter->SetMaximumNumberOfIterations(maximumNumberOfIterations);
+    inverseFilter->SetTolerance(tolerance);
+
+    try
+    {
+      inverseFilter->UpdateLargestPossibleRegion();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      std::cerr << "Exception thrown in Inverse filter" << std::endl;
+      std::cerr << excp << std::endl;
+    }
+    std::cout << "Inverse residual: mean " << inverseFilter->GetMeanResidual() << " mm, maximum "
+              << inverseFilter->GetMaximumResidual() << " mm, " << inverseFilter->GetNumberOfUnconvergedVoxels()
+              << " voxels above the tolerance" << std::endl;
+    inverseField = inverseFilter->GetOutput();
   }
-  catch (itk::ExceptionObject & excp)
+  else
   {
-    std::cerr << "Exception thrown in Inverse filter" << std::endl;
-    std::cerr << excp << std::endl;
+    using FilterType = itk::GtractInverseDisplacementFieldImageFilter<DisplacementFieldType, DisplacementFieldType>;
+
+    FilterType::Pointer inverseFilter = FilterType::New();
+    inverseFilter->SetOutputSpacing(scalarReader->GetOutput()->GetSpacing());
+    inverseFilter->SetOutputOrigin(scalarReader->GetOutput()->GetOrigin());
+    inverseFilter->SetSize(region.GetSize());
+    inverseFilter->SetInput(vectorReader->GetOutput());
+    inverseFilter->SetSubsamplingFactor(subsamplingFactor);
+
+    try
+    {
+      inverseFilter->UpdateLargestPossibleRegion();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      std::cerr << "Exception thrown in Inverse filter" << std::endl;
+      std::cerr << excp << std::endl;
+    }
+    inverseField = inverseFilter->GetOutput();
   }
 
   // Write an image for regression testing
@@ -118,7 +156,7 @@ main(int argc, char * argv[])
 
   WriterType::Pointer writer = WriterType::New();
   writer->UseCompressionOn();
-  writer->SetInput(inverseFilter->GetOutput());
+  writer->SetInput(inverseField);
   writer->SetFileName(outputVolume);
 
   try
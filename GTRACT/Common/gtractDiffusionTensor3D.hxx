@@ -39,6 +39,7 @@
 
 #include "gtractDiffusionTensor3D.h"
 #include "itkNumericTraits.h"
+#include "gtractSymmetricEigen3x3.h"
 
 namespace itk
 {
@@ -69,9 +70,9 @@ template <typename TComponent>
 typename gtractDiffusionTensor3D<TComponent>::RealValueType
 gtractDiffusionTensor3D<TComponent>::GetAxialDiffusivity() const
 {
-  EigenValuesArrayType eigenValues;
+  RealValueType eigenValues[3];
 
-  this->Superclass::ComputeEigenValues(eigenValues);
+  SymmetricEigenValues3x3(*this, eigenValues);
 
   return itk::Math::abs(eigenValues[2]);
 }
@@ -83,9 +84,9 @@ template <typename TComponent>
 typename gtractDiffusionTensor3D<TComponent>::RealValueType
 gtractDiffusionTensor3D<TComponent>::GetRadialDiffusivity() const
 {
-  EigenValuesArrayType eigenValues;
+  RealValueType eigenValues[3];
 
-  this->Superclass::ComputeEigenValues(eigenValues);
+  SymmetricEigenValues3x3(*this, eigenValues);
 
   return (itk::Math::abs(eigenValues[0]) + itk::Math::abs(eigenValues[1])) / 2.0;
 }
@@ -0,0 +1,289 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __gtractFiberPairing_h
+#define __gtractFiberPairing_h
+
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+/** \class FiberSet
+ * \brief Fibers resampled to the same number of points, stored contiguously.
+ *
+ * Point i of fiber f is Point(f) + 3 * i.  Each fiber keeps the id of the
+ * cell it was taken from so pairings can be reported in terms of the input.
+ */
+class FiberSet
+{
+public:
+  explicit FiberSet(const unsigned int numberOfPoints)
+    : m_NumberOfPoints(numberOfPoints)
+  {}
+
+  /** Append a fiber given by numberOfPoints consecutive (x, y, z) triples. */
+  void
+  AddFiber(const long cellId, const double * points)
+  {
+    m_CellIds.push_back(cellId);
+    m_Points.insert(m_Points.end(), points, points + 3 * m_NumberOfPoints);
+  }
+
+  std::size_t
+  GetNumberOfFibers() const
+  {
+    return m_CellIds.size();
+  }
+
+  unsigned int
+  GetNumberOfPoints() const
+  {
+    return m_NumberOfPoints;
+  }
+
+  long
+  GetCellId(const std::size_t fiber) const
+  {
+    return m_CellIds[fiber];
+  }
+
+  const double *
+  Point(const std::size_t fiber) const
+  {
+    return m_Points.data() + fiber * 3 * m_NumberOfPoints;
+  }
+
+private:
+  unsigned int        m_NumberOfPoints;
+  std::vector<long>   m_CellIds;
+  std::vector<double> m_Points;
+};
+
+/** Mean distance between corresponding points of two fibers, accumulated in
+ *  point order.  Stops early and returns a value greater than cutoff once
+ *  the partial sum shows the mean cannot come in at or below cutoff. */
+inline double
+MeanCorrespondingPointDistance(const double *     testFiber,
+                               const double *     standardFiber,
+                               const unsigned int numberOfPoints,
+                               const double       cutoff)
+{
+  // The slack keeps candidates that tie with cutoff after rounding.
+  const double sumCutoff = cutoff * numberOfPoints * (1.0 + 1e-12);
+  double       sumDist = 0.0;
+  for (unsigned int i = 0; i < numberOfPoints; ++i)
+  {
+    double sumSquares = 0.0;
+    for (unsigned int p = 0; p < 3; ++p)
+    {
+      const double edge = testFiber[3 * i + p] - standardFiber[3 * i + p];
+      sumSquares += edge * edge;
+    }
+    sumDist += std::sqrt(sumSquares);
+    if (sumDist > sumCutoff)
+    {
+      return sumDist / numberOfPoints;
+    }
+  }
+  return sumDist / numberOfPoints;
+}
+
+/** Closest standard fiber of a test fiber, as a cell id and mean distance. */
+struct FiberPairing
+{
+  long   standardCellId{ -1 };
+  double distance{ 1E200 };
+};
+
+/** \class FiberPairingIndex
+ * \brief k-d tree over the centroids of a FiberSet.
+ *
+ * The mean corresponding point distance of two fibers is never smaller
+ * than the distance between their centroids, so subtrees and candidates
+ * whose centroid bound exceeds the running minimum are skipped without
+ * changing the result.  Among fibers at the same distance the one with
+ * the smallest cell id wins, as in an exhaustive scan.
+ */
+class FiberPairingIndex
+{
+public:
+  explicit FiberPairingIndex(const FiberSet & fibers)
+    : m_Fibers(fibers)
+    , m_Order(fibers.GetNumberOfFibers())
+    , m_SplitAxis(fibers.GetNumberOfFibers(), 0)
+    , m_Centroids(3 * fibers.GetNumberOfFibers())
+  {
+    for (std::size_t f = 0; f < fibers.GetNumberOfFibers(); ++f)
+    {
+      ComputeCentroid(fibers.Point(f), fibers.GetNumberOfPoints(), &m_Centroids[3 * f]);
+    }
+    std::iota(m_Order.begin(), m_Order.end(), 0);
+    this->Build(0, m_Order.size());
+  }
+
+  FiberPairing
+  FindClosest(const double * testFiber) const
+  {
+    double centroid[3];
+    ComputeCentroid(testFiber, m_Fibers.GetNumberOfPoints(), centroid);
+    FiberPairing best;
+    this->Search(0, m_Order.size(), testFiber, centroid, best);
+    return best;
+  }
+
+private:
+  static void
+  ComputeCentroid(const double * fiber, const unsigned int numberOfPoints, double * centroid)
+  {
+    centroid[0] = centroid[1] = centroid[2] = 0.0;
+    for (unsigned int i = 0; i < numberOfPoints; ++i)
+    {
+      for (unsigned int p = 0; p < 3; ++p)
+      {
+        centroid[p] += fiber[3 * i + p];
+      }
+    }
+    for (unsigned int p = 0; p < 3; ++p)
+    {
+      centroid[p] /= numberOfPoints;
+    }
+  }
+
+  // Lower bounds are shrunk slightly so rounding never prunes a tie.
+  static bool
+  CannotImprove(const double lowerBound, const double currentBest)
+  {
+    return lowerBound * (1.0 - 1e-9) > currentBest;
+  }
+
+  void
+  Build(const std::size_t begin, const std::size_t end)
+  {
+    if (end - begin <= 1)
+    {
+      return;
+    }
+    double lower[3] = { 1E200, 1E200, 1E200 };
+    double upper[3] = { -1E200, -1E200, -1E200 };
+    for (std::size_t n = begin; n < end; ++n)
+    {
+      const double * c = &m_Centroids[3 * m_Order[n]];
+      for (unsigned int p = 0; p < 3; ++p)
+      {
+        lower[p] = std::min(lower[p], c[p]);
+        upper[p] = std::max(upper[p], c[p]);
+      }
+    }
+    unsigned char axis = 0;
+    for (unsigned char p = 1; p < 3; ++p)
+    {
+      if (upper[p] - lower[p] > upper[axis] - lower[axis])
+      {
+        axis = p;
+      }
+    }
+    const std::size_t mid = begin + (end - begin) / 2;
+    std::nth_element(m_Order.begin() + begin,
+                     m_Order.begin() + mid,
+                     m_Order.begin() + end,
+                     [this, axis](const std::size_t a, const std::size_t b) {
+                       return m_Centroids[3 * a + axis] < m_Centroids[3 * b + axis];
+                     });
+    m_SplitAxis[mid] = axis;
+    this->Build(begin, mid);
+    this->Build(mid + 1, end);
+  }
+
+  void
+  Search(const std::size_t begin,
+         const std::size_t end,
+         const double *    testFiber,
+         const double *    testCentroid,
+         FiberPairing &    best) const
+  {
+    if (begin >= end)
+    {
+      return;
+    }
+    const std::size_t mid = begin + (end - begin) / 2;
+    const std::size_t fiber = m_Order[mid];
+    const double *    centroid = &m_Centroids[3 * fiber];
+
+    double centroidDistance = 0.0;
+    for (unsigned int p = 0; p < 3; ++p)
+    {
+      const double edge = testCentroid[p] - centroid[p];
+      centroidDistance += edge * edge;
+    }
+    centroidDistance = std::sqrt(centroidDistance);
+    if (!CannotImprove(centroidDistance, best.distance))
+    {
+      const double distance = MeanCorrespondingPointDistance(
+        testFiber, m_Fibers.Point(fiber), m_Fibers.GetNumberOfPoints(), best.distance);
+      const long cellId = m_Fibers.GetCellId(fiber);
+      if (distance < best.distance || (distance == best.distance && cellId < best.standardCellId))
+      {
+        best.distance = distance;
+        best.standardCellId = cellId;
+      }
+    }
+    if (end - begin == 1)
+    {
+      return;
+    }
+
+    const unsigned char axis = m_SplitAxis[mid];
+    const double        planeOffset = testCentroid[axis] - centroid[axis];
+    const bool          lowerFirst = planeOffset < 0.0;
+    this->Search(lowerFirst ? begin : mid + 1, lowerFirst ? mid : end, testFiber, testCentroid, best);
+    if (!CannotImprove(std::abs(planeOffset), best.distance))
+    {
+      this->Search(lowerFirst ? mid + 1 : begin, lowerFirst ? end : mid, testFiber, testCentroid, best);
+    }
+  }
+
+  const FiberSet &           m_Fibers;
+  std::vector<std::size_t>   m_Order;
+  std::vector<unsigned char> m_SplitAxis;
+  std::vector<double>        m_Centroids;
+};
+
+/** Pair every test fiber with its closest standard fiber, test fibers in
+ *  parallel.  Entry j of the result belongs to test fiber j. */
+inline std::vector<FiberPairing>
+PairFibers(const FiberSet & testFibers, const FiberSet & standardFibers)
+{
+  const FiberPairingIndex   index(standardFibers);
+  std::vector<FiberPairing> pairings(testFibers.GetNumberOfFibers());
+  if (pairings.empty())
+  {
+    return pairings;
+  }
+  itk::MultiThreaderBase::New()->ParallelizeArray(
+    0,
+    pairings.size(),
+    [&](const itk::SizeValueType j) { pairings[j] = index.FindClosest(testFibers.Point(j)); },
+    nullptr);
+  return pairings;
+}
+
+#endif
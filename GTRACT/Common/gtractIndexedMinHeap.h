@@ -0,0 +1,188 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __gtractIndexedMinHeap_h
+#define __gtractIndexedMinHeap_h
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/** \class IndexedMinHeap
+ * \brief Binary min-heap of nodes keyed by a dense integer id.
+ *
+ * Each id (typically the offset of a voxel in the buffered region) is
+ * present at most once.  Pushing an id that is already queued replaces its
+ * node and restores the heap order, which gives the decrease-key operation
+ * needed by fast marching without the duplicate entries a
+ * std::priority_queue accumulates.  Clearing only touches the queued ids.
+ */
+template <typename TNode, typename TCompare = std::less<TNode>>
+class IndexedMinHeap
+{
+public:
+  using NodeType = TNode;
+  using IdType = std::size_t;
+
+  /** Size the id to heap position map for ids in [0, numberOfIds) and empty the heap. */
+  void
+  Initialize(const IdType numberOfIds)
+  {
+    m_Heap.clear();
+    m_Position.assign(numberOfIds, NotQueued);
+  }
+
+  bool
+  empty() const
+  {
+    return m_Heap.empty();
+  }
+
+  std::size_t
+  size() const
+  {
+    return m_Heap.size();
+  }
+
+  bool
+  contains(const IdType id) const
+  {
+    return m_Position[id] != NotQueued;
+  }
+
+  const NodeType &
+  top() const
+  {
+    return m_Heap.front().second;
+  }
+
+  /** Insert the node for id, or replace the node already queued for id. */
+  void
+  push(const IdType id, const NodeType & node)
+  {
+    std::size_t pos = m_Position[id];
+    if (pos == NotQueued)
+    {
+      pos = m_Heap.size();
+      m_Heap.emplace_back(id, node);
+      m_Position[id] = pos;
+      this->SiftUp(pos);
+      return;
+    }
+    const bool decreased = m_Compare(node, m_Heap[pos].second);
+    m_Heap[pos].second = node;
+    if (decreased)
+    {
+      this->SiftUp(pos);
+    }
+    else
+    {
+      this->SiftDown(pos);
+    }
+  }
+
+  void
+  pop()
+  {
+    m_Position[m_Heap.front().first] = NotQueued;
+    if (m_Heap.size() > 1)
+    {
+      m_Heap.front() = std::move(m_Heap.back());
+      m_Position[m_Heap.front().first] = 0;
+      m_Heap.pop_back();
+      this->SiftDown(0);
+    }
+    else
+    {
+      m_Heap.pop_back();
+    }
+  }
+
+  void
+  clear()
+  {
+    for (const auto & entry : m_Heap)
+    {
+      m_Position[entry.first] = NotQueued;
+    }
+    m_Heap.clear();
+  }
+
+private:
+  static constexpr std::size_t NotQueued = std::numeric_limits<std::size_t>::max();
+
+  void
+  SiftUp(std::size_t pos)
+  {
+    while (pos > 0)
+    {
+      const std::size_t parent = (pos - 1) / 2;
+      if (!m_Compare(m_Heap[pos].second, m_Heap[parent].second))
+      {
+        break;
+      }
+      this->Swap(pos, parent);
+      pos = parent;
+    }
+  }
+
+  void
+  SiftDown(std::size_t pos)
+  {
+    const std::size_t count = m_Heap.size();
+    while (true)
+    {
+      const std::size_t left = 2 * pos + 1;
+      if (left >= count)
+      {
+        break;
+      }
+      const std::size_t right = left + 1;
+      std::size_t       smallest = left;
+      if (right < count && m_Compare(m_Heap[right].second, m_Heap[left].second))
+      {
+        smallest = right;
+      }
+      if (!m_Compare(m_Heap[smallest].second, m_Heap[pos].second))
+      {
+        break;
+      }
+      this->Swap(pos, smallest);
+      pos = smallest;
+    }
+  }
+
+  void
+  Swap(const std::size_t a, const std::size_t b)
+  {
+    std::swap(m_Heap[a], m_Heap[b]);
+    m_Position[m_Heap[a].first] = a;
+    m_Position[m_Heap[b].first] = b;
+  }
+
+  std::vector<std::pair<IdType, NodeType>> m_Heap;
+  std::vector<std::size_t>                 m_Position;
+  TCompare                                 m_Compare;
+};
+
+template <typename TNode, typename TCompare>
+constexpr std::size_t IndexedMinHeap<TNode, TCompare>::NotQueued;
+
+#endif
@@ -0,0 +1,180 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** \
+ *  Closed form eigen analysis of a symmetric 3x3 matrix stored as the six
+ *  unique tensor elements in DiffusionTensor3D order (xx, xy, xz, yy, yz, zz).
+ *
+ *  Everything is computed on the stack, so these are safe to call per voxel
+ *  from many threads.  Eigenvalues use the trigonometric solution of the
+ *  characteristic polynomial, eigenvectors the largest cross product of the
+ *  rows of (A - lambda I).
+ */
+#ifndef __gtractSymmetricEigen3x3_h
+#define __gtractSymmetricEigen3x3_h
+
+#include <algorithm>
+#include <cmath>
+
+/** Eigenvalues of the symmetric tensor, in ascending order. */
+template <typename TTensor, typename TValue>
+inline void
+SymmetricEigenValues3x3(const TTensor & tensor, TValue eigenValues[3])
+{
+  const double a00 = tensor[0];
+  const double a01 = tensor[1];
+  const double a02 = tensor[2];
+  const double a11 = tensor[3];
+  const double a12 = tensor[4];
+  const double a22 = tensor[5];
+
+  const double offDiagonal = a01 * a01 + a02 * a02 + a12 * a12;
+  double       e[3];
+  if (offDiagonal == 0.0)
+  {
+    e[0] = a00;
+    e[1] = a11;
+    e[2] = a22;
+    std::sort(e, e + 3);
+  }
+  else
+  {
+    const double q = (a00 + a11 + a22) / 3.0;
+    const double b00 = a00 - q;
+    const double b11 = a11 - q;
+    const double b22 = a22 - q;
+    const double p = std::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2.0 * offDiagonal) / 6.0);
+
+    // r = det( (A - qI) / p ) / 2, clamped against round off
+    const double det = b00 * (b11 * b22 - a12 * a12) - a01 * (a01 * b22 - a12 * a02) + a02 * (a01 * a12 - b11 * a02);
+    const double r = std::max(-1.0, std::min(1.0, det / (2.0 * p * p * p)));
+
+    constexpr double twoThirdsPi = 2.0943951023931954923;
+    const double     phi = std::acos(r) / 3.0;
+    e[2] = q + 2.0 * p * std::cos(phi);
+    e[0] = q + 2.0 * p * std::cos(phi + twoThirdsPi);
+    e[1] = 3.0 * q - e[0] - e[2];
+  }
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    eigenValues[i] = static_cast<TValue>(e[i]);
+  }
+}
+
+/** Unit eigenvector of the symmetric tensor for a given eigenvalue.
+ *  Returns false when the eigenvalue is not simple (the eigenspace is
+ *  not a single direction), in which case eigenVector is left untouched. */
+template <typename TTensor, typename TValue>
+inline bool
+SymmetricEigenVector3x3(const TTensor & tensor, const double eigenValue, TValue eigenVector[3])
+{
+  const double row0[3] = { tensor[0] - eigenValue, tensor[1], tensor[2] };
+  const double row1[3] = { tensor[1], tensor[3] - eigenValue, tensor[4] };
+  const double row2[3] = { tensor[2], tensor[4], tensor[5] - eigenValue };
+
+  const double c01[3] = { row0[1] * row1[2] - row0[2] * row1[1],
+                          row0[2] * row1[0] - row0[0] * row1[2],
+                          row0[0] * row1[1] - row0[1] * row1[0] };
+  const double c02[3] = { row0[1] * row2[2] - row0[2] * row2[1],
+                          row0[2] * row2[0] - row0[0] * row2[2],
+                          row0[0] * row2[1] - row0[1] * row2[0] };
+  const double c12[3] = { row1[1] * row2[2] - row1[2] * row2[1],
+                          row1[2] * row2[0] - row1[0] * row2[2],
+                          row1[0] * row2[1] - row1[1] * row2[0] };
+  const double n01 = c01[0] * c01[0] + c01[1] * c01[1] + c01[2] * c01[2];
+  const double n02 = c02[0] * c02[0] + c02[1] * c02[1] + c02[2] * c02[2];
+  const double n12 = c12[0] * c12[0] + c12[1] * c12[1] + c12[2] * c12[2];
+
+  const double * best = c01;
+  double         bestNorm = n01;
+  if (n02 > bestNorm)
+  {
+    best = c02;
+    bestNorm = n02;
+  }
+  if (n12 > bestNorm)
+  {
+    best = c12;
+    bestNorm = n12;
+  }
+
+  // Relative to the scale of the matrix, a vanishing cross product means a
+  // repeated eigenvalue.
+  double scale = 0.0;
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    scale = std::max(scale, std::abs(row0[i]));
+    scale = std::max(scale, std::abs(row1[i]));
+    scale = std::max(scale, std::abs(row2[i]));
+  }
+  const double tolerance = 1e-12 * scale * scale;
+  if (bestNorm <= tolerance * tolerance || bestNorm == 0.0)
+  {
+    return false;
+  }
+  const double invNorm = 1.0 / std::sqrt(bestNorm);
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    eigenVector[i] = static_cast<TValue>(best[i] * invNorm);
+  }
+  return true;
+}
+
+/** Unit eigenvector of the largest eigenvalue.  For a repeated largest
+ *  eigenvalue any unit vector of that eigenspace is returned, and the
+ *  z axis for an isotropic tensor. */
+template <typename TTensor, typename TValue>
+inline void
+PrincipalEigenVector3x3(const TTensor & tensor, TValue principalEigenVector[3])
+{
+  double eigenValues[3];
+  SymmetricEigenValues3x3(tensor, eigenValues);
+  if (SymmetricEigenVector3x3(tensor, eigenValues[2], principalEigenVector))
+  {
+    return;
+  }
+
+  // The largest eigenvalue is repeated, pick a direction orthogonal to the
+  // eigenvector of the smallest one.
+  double minorEigenVector[3];
+  if (!SymmetricEigenVector3x3(tensor, eigenValues[0], minorEigenVector))
+  {
+    principalEigenVector[0] = 0;
+    principalEigenVector[1] = 0;
+    principalEigenVector[2] = 1;
+    return;
+  }
+  const unsigned int smallestAxis =
+    (std::abs(minorEigenVector[0]) < std::abs(minorEigenVector[1]))
+      ? ((std::abs(minorEigenVector[0]) < std::abs(minorEigenVector[2])) ? 0 : 2)
+      : ((std::abs(minorEigenVector[1]) < std::abs(minorEigenVector[2])) ? 1 : 2);
+  double axis[3] = { 0.0, 0.0, 0.0 };
+  axis[smallestAxis] = 1.0;
+  double orthogonal[3] = { minorEigenVector[1] * axis[2] - minorEigenVector[2] * axis[1],
+                           minorEigenVector[2] * axis[0] - minorEigenVector[0] * axis[2],
+                           minorEigenVector[0] * axis[1] - minorEigenVector[1] * axis[0] };
+  const double invNorm =
+    1.0 / std::sqrt(orthogonal[0] * orthogonal[0] + orthogonal[1] * orthogonal[1] + orthogonal[2] * orthogonal[2]);
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    principalEigenVector[i] = static_cast<TValue>(orthogonal[i] * invNorm);
+  }
+}
+
+#endif
@@ -34,23 +34,18 @@
 
 =========================================================================*/
 
+
 #ifndef __itkComputeDiffusionTensorImageFilter_cxx
 #define __itkComputeDiffusionTensorImageFilter_cxx
 
-#include "itkImageRegionIterator.h"
-#include "itkImageRegionConstIterator.h"
-#include "itkImageRegionIteratorWithIndex.h"
-#include "itkImageLinearConstIteratorWithIndex.h"
-#include "itkConstNeighborhoodIterator.h"
-#include "itkNeighborhoodAlgorithm.h"
-#include <itkIOCommon.h>
-#include "itkMetaDataObject.h"
-#include "itkProgressAccumulator.h"
+#include "itkImageScanlineIterator.h"
 #include "itkMedianImageFilter.h"
 
 #include "itkComputeDiffusionTensorImageFilter.h"
 #include "algo.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 namespace itk
@@ -65,129 +60,206 @@ ComputeDiffusionTensorImageFilter ::ComputeDiffusionTensorImageFilter()
 }
 
 void
-ComputeDiffusionTensorImageFilter ::Update()
+ComputeDiffusionTensorImageFilter ::GenerateOutputInformation()
+{
+  // The input has one more dimension than the output, so the output
+  // information is set here instead of copied by the superclass.
+  const InputImageType * input = this->GetInput();
+  OutputImageType *      output = this->GetOutput();
+  if (input == nullptr || output == nullptr)
+  {
+    return;
+  }
+
+  const InputImageRegionType ADCRegion = input->GetLargestPossibleRegion();
+  OutputImageRegionType      TensorRegion;
+  OutputImageSpacingType     TensorSpacing;
+  for (int i = 0; i < 3; i++)
+  {
+    TensorRegion.SetIndex(i, ADCRegion.GetIndex(i));
+    TensorRegion.SetSize(i, ADCRegion.GetSize(i));
+    TensorSpacing[i] = input->GetSpacing()[i];
+  }
+  OutputImagePointType fixedOrigin;
+  fixedOrigin.Fill(0.0);
+
+  output->SetLargestPossibleRegion(TensorRegion);
+  output->SetSpacing(TensorSpacing);
+  output->SetOrigin(fixedOrigin);
+}
+
+void
+ComputeDiffusionTensorImageFilter ::GenerateInputRequestedRegion()
 {
+  Superclass::GenerateInputRequestedRegion();
+  auto * input = const_cast<InputImageType *>(this->GetInput());
+  if (input != nullptr)
+  {
+    input->SetRequestedRegionToLargestPossibleRegion();
+  }
+}
+
+void
+ComputeDiffusionTensorImageFilter ::BeforeThreadedGenerateData()
+{
+  const InputImageType * input = this->GetInput();
   if (m_UseMedianFilter == true)
   {
     using MedianFilterType = itk::MedianImageFilter<InputImageType, InputImageType>;
     MedianFilterType::Pointer filter = MedianFilterType::New();
-    filter->SetInput(m_Input);
+    filter->SetInput(input);
     filter->SetRadius(m_MedianFilterSize);
     filter->Update();
     m_InternalImage = filter->GetOutput();
   }
   else
   {
-    m_InternalImage = m_Input;
+    m_InternalImage = input;
   }
 
   std::cout << "Tensor Directions: " << std::endl;
   std::cout << m_DiffusionDirections << std::endl;
 
-  OutputImageRegionType  TensorRegion;
-  OutputImageSizeType    TensorSize;
-  OutputImageIndexType   TensorIndex;
-  OutputImageSpacingType TensorSpacing;
-  OutputImagePointType   TensorOrigin;
-
-  InputImageRegionType  ADCRegion = m_InternalImage->GetLargestPossibleRegion();
-  InputImageSizeType    ADCSize = ADCRegion.GetSize();
-  InputImageIndexType   ADCIndex = ADCRegion.GetIndex();
-  InputImageSpacingType ADCSpacing = m_InternalImage->GetSpacing();
-  InputImagePointType   ADCOrigin = m_InternalImage->GetOrigin();
-  for (int i = 0; i < 3; i++)
+  const unsigned int numberOfDirections = std::max(m_NumberOfDirections, 0);
+  const unsigned int numberOfBSteps = std::max(m_NumberOfBSteps, 0);
+  const unsigned int numberOfGradientImages = numberOfDirections * numberOfBSteps;
+  if (numberOfGradientImages == 0 || m_BValues.size() != numberOfBSteps + 1 ||
+      m_DiffusionDirections.rows() != numberOfDirections || m_DiffusionDirections.cols() != 6 ||
+      input->GetLargestPossibleRegion().GetSize(3) < numberOfGradientImages + 1)
   {
-    TensorSize[i] = ADCSize[i];
-    TensorIndex[i] = ADCIndex[i];
-    TensorSpacing[i] = ADCSpacing[i];
-    TensorOrigin[i] = ADCOrigin[i];
+    itkExceptionMacro(<< "Expected " << numberOfBSteps + 1 << " BValues, a " << numberOfDirections
+                      << " x 6 DiffusionDirections matrix and " << numberOfGradientImages + 1
+                      << " volumes, got " << m_BValues.size() << " BValues, a " << m_DiffusionDirections.rows()
+                      << " x " << m_DiffusionDirections.cols() << " matrix and "
+                      << input->GetLargestPossibleRegion().GetSize(3) << " volumes");
   }
 
-  TensorRegion.SetSize(TensorSize);
-  TensorRegion.SetIndex(TensorIndex);
+  // The least squares slope My_lsf fits to the log signal ratios y_k over
+  // the b-values b_k is sum_k w_k y_k, and y_0 = log(S0 / S0) = 0.
+  const double numberOfBValues = numberOfBSteps + 1;
+  double       bSum = 0.0;
+  double       bSquares = 0.0;
+  for (unsigned int k = 0; k < m_BValues.size(); k++)
+  {
+    bSum += m_BValues(k);
+    bSquares += m_BValues(k) * m_BValues(k);
+  }
+  const double denominator = bSquares / bSum - bSum / numberOfBValues;
+
+  // ADCm(direction) = -slope, and the tensor is the pseudo inverse of the
+  // diffusion directions times ADCm.
+  const TMatrix pseudoInverse = Matrix_Inverse(m_DiffusionDirections);
+  m_TensorWeights.assign(6 * numberOfGradientImages, 0.0);
+  for (unsigned int e = 0; e < 6; e++)
+  {
+    for (unsigned int direction = 0; direction < numberOfDirections; direction++)
+    {
+      for (unsigned int step = 0; step < numberOfBSteps; step++)
+      {
+        const double slopeWeight = (m_BValues(step + 1) / bSum - 1.0 / numberOfBValues) / denominator;
+        m_TensorWeights[e * numberOfGradientImages + direction * numberOfBSteps + step] =
+          -pseudoInverse(e, direction) * slopeWeight;
+      }
+    }
+  }
 
-  m_Output = OutputImageType::New();
-  m_Output->SetRegions(TensorRegion);
-  m_Output->SetSpacing(TensorSpacing);
-  m_Output->SetOrigin(TensorOrigin);
-  m_Output->Allocate();
+  // Signals are signed short, so every log the fit needs comes from a table.
+  m_LogTable.resize(NumericTraits<InputImagePixelType>::max() + 1);
+  m_LogTable[0] = 0.0;
+  for (size_t v = 1; v < m_LogTable.size(); v++)
+  {
+    m_LogTable[v] = std::log(static_cast<double>(v));
+  }
+}
 
-  using ADCIteratorType = itk::ImageLinearConstIteratorWithIndex<InputImageType>;
-  ADCIteratorType ADC_It(m_InternalImage, m_InternalImage->GetRequestedRegion());
+void
+ComputeDiffusionTensorImageFilter ::DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread)
+{
+  const InputImageType *      input = m_InternalImage;
+  const InputImagePixelType * buffer = input->GetBufferPointer();
+  const OffsetValueType       volumeStride = input->GetOffsetTable()[3];
+  const unsigned int          numberOfGradientImages = m_TensorWeights.size() / 6;
+  const SizeValueType         lineLength = outputRegionForThread.GetSize(0);
+  const double *              logTable = m_LogTable.data();
 
-  ADC_It.SetDirection(3);
-  ADC_It.GoToBegin();
-  TMatrix mMatrix = Matrix_Inverse(m_DiffusionDirections);
+  // Scanline buffers, so the inner loops run over contiguous voxels
+  std::vector<double>        tensorSums(6 * lineLength);
+  std::vector<double>        logB0(lineLength);
+  std::vector<unsigned char> validVoxel(lineLength);
 
-  while (!ADC_It.IsAtEnd())
+  ImageScanlineIterator<OutputImageType> outIt(this->GetOutput(), outputRegionForThread);
+  while (!outIt.IsAtEnd())
   {
-    /* Get the index & value for B0 */
-    ADC_It.GoToBeginOfLine();
-    auto ADC0 = (float)ADC_It.Get();
-    ADCIndex = ADC_It.GetIndex();
+    InputImageIndexType ADCIndex;
     for (int i = 0; i < 3; i++)
     {
-      TensorIndex[i] = ADCIndex[i];
+      ADCIndex[i] = outIt.GetIndex()[i];
     }
+    ADCIndex[3] = input->GetBufferedRegion().GetIndex(3);
+    const InputImagePixelType * B0 = buffer + input->ComputeOffset(ADCIndex);
 
-    OutputPixelType currentVoxel;
-    currentVoxel.Fill(0);
-
-    if (ADC0 > m_BackgroundThreshold)
+    for (SizeValueType x = 0; x < lineLength; x++)
     {
-      ++ADC_It;
-      TVector temp(m_NumberOfBSteps * m_NumberOfDirections);
-      for (int i = 0; i < m_NumberOfBSteps * m_NumberOfDirections; i++)
+      validVoxel[x] = (B0[x] > m_BackgroundThreshold) && (B0[x] > 0);
+      logB0[x] = logTable[std::max<InputImagePixelType>(B0[x], 0)];
+    }
+    std::fill(tensorSums.begin(), tensorSums.end(), 0.0);
+    for (unsigned int j = 0; j < numberOfGradientImages; j++)
+    {
+      const InputImagePixelType * DWI = B0 + (j + 1) * volumeStride;
+      double                      w[6];
+      for (unsigned int e = 0; e < 6; e++)
       {
-        temp(i) = (float)ADC_It.Get();
-        ++ADC_It;
+        w[e] = m_TensorWeights[e * numberOfGradientImages + j];
       }
-
-      // ////////////////////////////////////////////////////////////////////////
-      TVector ADCm(m_NumberOfDirections);
-      TVector Ln_ADCs(m_NumberOfBSteps + 1);
-      Ln_ADCs(0) = 0;
-      bool ErrFlg = false;
-      for (int direction = 0; direction < m_NumberOfDirections; direction++)
+      for (SizeValueType x = 0; x < lineLength; x++)
       {
-        for (int step = 0; step < m_NumberOfBSteps; step++)
+        // A zero signal has no log, the voxel is left zero as before
+        validVoxel[x] &= (DWI[x] > 0);
+        const double logRatio = logTable[std::max<InputImagePixelType>(DWI[x], 0)] - logB0[x];
+        for (unsigned int e = 0; e < 6; e++)
         {
-          float tempflt;
-          tempflt = temp(direction * m_NumberOfBSteps + step);
-
-          if (tempflt == 0)
-          {
-            ErrFlg = true;
-            break;
-          }
-          Ln_ADCs(step + 1) = std::log(tempflt / ADC0);
+          tensorSums[e * lineLength + x] += w[e] * logRatio;
         }
-        if (ErrFlg)
-        {
-          break;
-        }
-        ADCm(direction) = -1 * My_lsf(m_BValues, Ln_ADCs);
-      }
-      if (!ErrFlg)
-      {
-        TVector ADCe = mMatrix * ADCm;
-        currentVoxel.SetVnlVector(ADCe);
       }
-      m_Output->SetPixel(TensorIndex, currentVoxel);
     }
-    else
+
+    for (SizeValueType x = 0; x < lineLength; x++)
     {
-      m_Output->SetPixel(TensorIndex, currentVoxel);
+      OutputPixelType currentVoxel;
+      currentVoxel.Fill(0);
+      if (validVoxel[x])
+      {
+        for (unsigned int e = 0; e < 6; e++)
+        {
+          currentVoxel[e] = static_cast<float>(tensorSums[e * lineLength + x]);
+        }
+      }
+      outIt.Set(currentVoxel);
+      ++outIt;
     }
-    // ////////////////////////////////////////////////////////////////////////
-
-    ADC_It.NextLine();
+    outIt.NextLine();
   }
+}
 
-  itk::Point<double, 3> fixedOrigin = m_Output->GetOrigin();
-  fixedOrigin.GetVnlVector().fill(0.0);
-  m_Output->SetOrigin(fixedOrigin);
-  m_Output->SetMetaDataDictionary(m_Input->GetMetaDataDictionary());
+void
+ComputeDiffusionTensorImageFilter ::AfterThreadedGenerateData()
+{
+  this->GetOutput()->SetMetaDataDictionary(this->GetInput()->GetMetaDataDictionary());
+  m_InternalImage = nullptr;
+}
+
+void
+ComputeDiffusionTensorImageFilter ::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "UseMedianFilter: " << m_UseMedianFilter << std::endl;
+  os << indent << "MedianFilterSize: " << m_MedianFilterSize << std::endl;
+  os << indent << "BackgroundThreshold: " << m_BackgroundThreshold << std::endl;
+  os << indent << "NumberOfDirections: " << m_NumberOfDirections << std::endl;
+  os << indent << "NumberOfBSteps: " << m_NumberOfBSteps << std::endl;
+  os << indent << "DiffusionDirections: " << m_DiffusionDirections << std::endl;
+  os << indent << "BValues: " << m_BValues << std::endl;
 }
 } // end namespace itk
 #endif
@@ -34,44 +34,45 @@
 
 =========================================================================*/
 
+
 #ifndef __itkComputeDiffusionTensorImageFilter_h
 #define __itkComputeDiffusionTensorImageFilter_h
 
-#include "itkObject.h"
 #include "itkImage.h"
 #include "itkImageToImageFilter.h"
-#include "itkIOCommon.h"
 #include "gtractCommonWin32.h"
 #include "algo.h"
 
-#include <map>
-#include <string>
+#include <vector>
 
 namespace itk
 {
-/** \class TensorToAnisotropyImageFilter
- * \brief Calculates the Specified Anisotropy Index.
+/** \class ComputeDiffusionTensorImageFilter
+ * \brief Estimates the diffusion tensor of every voxel from a 4D image of
+ * diffusion weighted volumes.
  *
- * The following Anisotropy Image are supported:
- *    Fractional Anistropy
- *    Relatibve Anisotropy
- *    Volume Ratio
- *    Radial Diffusivity
- *    Axial Diffusivity
- *    Coheernce Index
- *    Lattice Index
- *    Mean Diffusivity
+ * Volume 0 along the fourth dimension is the B0 image, followed by
+ * NumberOfBSteps volumes for each of the NumberOfDirections diffusion
+ * directions.  The ADC along every direction is the least squares slope of
+ * the log signal ratio over the BValues (NumberOfBSteps + 1 of them, the
+ * first one for the B0), and the tensor is the least squares fit of the
+ * ADCs with the DiffusionDirections matrix.
  *
+ * Both fits are linear in the log signal, so they are folded into one set
+ * of weights per diffusion weighted volume before the threads start.  Each
+ * work unit then only sums weighted logs along scanlines, with no per voxel
+ * allocation.  Voxels with a B0 at or below BackgroundThreshold, or with a
+ * zero or negative signal, get a zero tensor.
  */
-
-class GTRACT_COMMON_EXPORT ComputeDiffusionTensorImageFilter : public itk::Object
+class GTRACT_COMMON_EXPORT ComputeDiffusionTensorImageFilter
+  : public ImageToImageFilter<Image<signed short, 4>, Image<Vector<float, 6>, 3>>
 {
 public:
   ITK_DISALLOW_COPY_AND_ASSIGN(ComputeDiffusionTensorImageFilter);
 
   /** Standard class type alias. */
   using Self = ComputeDiffusionTensorImageFilter;
-  using Superclass = itk::Object;
+  using Superclass = ImageToImageFilter<Image<signed short, 4>, Image<Vector<float, 6>, 3>>;
   using Pointer = SmartPointer<Self>;
   using ConstPointer = SmartPointer<const Self>;
 
@@ -101,28 +102,11 @@ public:
   using OutputImageSpacingType = OutputImageType::SpacingType;
   using OutputImagePointType = OutputImageType::PointType;
 
-  /** ImageDimension constants * /
-  static constexpr unsigned int InputImageDimension = TInputImage::ImageDimension;
-  static constexpr unsigned int OutputImageDimension = TOutputImage::ImageDimension;
-
-  / ** The dimensions of the input image must equal those of the
-      output image. * /
-  itkConceptMacro(SameDimension,
-    (Concept::SameDimension<Self::InputImageDimension,Self::OutputImageDimension>));
-
-  / ** The dimension of the input image must be 4. * /
-  itkConceptMacro(DimensionShouldBe4,
-    (Concept::SameDimension<Self::InputImageDimension,4>));
-*/
   /** Standard New method. */
   itkNewMacro(Self);
 
   /** Runtime information support. */
-  itkTypeMacro(ComputeDiffusionTensorImageFilter, itk::Object);
-
-  /* SetInput and GetOutput Macros */
-  itkSetObjectMacro(Input, InputImageType);
-  itkGetConstObjectMacro(Output, OutputImageType);
+  itkTypeMacro(ComputeDiffusionTensorImageFilter, ImageToImageFilter);
 
   itkSetMacro(UseMedianFilter, bool);
   itkSetMacro(MedianFilterSize, InputImageSizeType);
@@ -140,28 +124,32 @@ public:
   itkGetMacro(DiffusionDirections, TMatrix);
   itkGetMacro(BValues, TVector);
 
-  void
-  Update();
-
 protected:
   ComputeDiffusionTensorImageFilter();
   ~ComputeDiffusionTensorImageFilter() override = default;
 
-private:
   void
-  computVoxelIsotropy();
+  PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** The output is the first three dimensions of the input, at the origin. */
   void
-  computSimpleVoxelAnisotropy();
+  GenerateOutputInformation() override;
 
+  /** Every voxel needs all volumes, and the median filter a border. */
   void
-  computNeighborhoodVoxelAnisotropy();
+  GenerateInputRequestedRegion() override;
 
-  // Input and Output Image
-  InputImagePointer  m_Input;
-  OutputImagePointer m_Output;
+  void
+  BeforeThreadedGenerateData() override;
+
+  void
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  void
+  AfterThreadedGenerateData() override;
 
-  InputImagePointer m_InternalImage;
+private:
+  InputImageConstPointer m_InternalImage;
 
   bool               m_UseMedianFilter;
   InputImageSizeType m_MedianFilterSize;
@@ -171,6 +159,13 @@ private:
 
   TMatrix m_DiffusionDirections;
   TVector m_BValues;
+
+  /** Weight of log(S / S0) of every diffusion weighted volume in each of the
+   *  six tensor elements, element major. */
+  std::vector<double> m_TensorWeights;
+
+  /** log(v) of every non negative pixel value v, with log(0) set to 0. */
+  std::vector<double> m_LogTable;
 }; // end of class
 } // end namespace itk
 
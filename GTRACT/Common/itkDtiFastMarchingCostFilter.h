@@ -48,6 +48,7 @@
 #include <itkConstNeighborhoodIterator.h>
 
 #include "GtractTypes.h"
+#include "gtractIndexedMinHeap.h"
 #include <map>
 #include <string>
 
@@ -56,7 +57,6 @@
 #include <itkMath.h>
 
 #include <functional>
-#include <queue>
 
 namespace itk
 {
@@ -407,12 +407,19 @@ private:
   typename LevelSetImageType::PixelType m_LargeValue;
   AxisNodeType                          m_NodesUsed[dimension];
 
-  /** Trial points are stored in a min-heap. This allow efficient access
-   * to the trial point with minimum value which is the next grid point
-   * the algorithm processes. */
-  using HeapContainer = std::vector<AxisNodeType>;
-  using NodeComparer = std::greater<AxisNodeType>;
-  using HeapType = std::priority_queue<AxisNodeType, HeapContainer, NodeComparer>;
+  /** Trial points are stored in a min-heap indexed by voxel offset. This allow
+   * efficient access to the trial point with minimum value which is the next
+   * grid point the algorithm processes, and an improved trial point value
+   * decreases its key in place instead of adding a duplicate entry. */
+  using NodeComparer = std::less<AxisNodeType>;
+  using HeapType = IndexedMinHeap<AxisNodeType, NodeComparer>;
+
+  /** Insert or decrease the key of a trial point. */
+  void
+  PushTrialPoint(const AxisNodeType & node)
+  {
+    m_TrialHeap.push(m_LabelImage->ComputeOffset(node.GetIndex()), node);
+  }
 
   HeapType m_TrialHeap;
 
@@ -50,8 +50,10 @@
 #include <itkFixedArray.h>
 #include "itkMetaDataObject.h"
 #include <itkDiffusionTensor3D.h>
+#include <itkMultiThreaderBase.h>
 
 #include "itkDtiFastMarchingCostFilter.h"
+#include "gtractSymmetricEigen3x3.h"
 
 #include <iostream>
 
@@ -196,6 +198,7 @@ void DtiFastMarchingCostFilter<TLevelSet, TTensorImage>
 
   // cache some buffered region information
   m_BufferedRegion = output->GetBufferedRegion();
+  m_TrialHeap.Initialize(m_BufferedRegion.GetNumberOfPixels());
   m_StartIndex = m_BufferedRegion.GetIndex();
   m_LastIndex = m_StartIndex + m_BufferedRegion.GetSize();
   typename LevelSetImageType::OffsetType offset;
@@ -220,48 +223,37 @@ void DtiFastMarchingCostFilter<TLevelSet, TTensorImage>
   m_EigenvectorImage->SetDirection(tensorImage->GetDirection());
   m_EigenvectorImage->Allocate();
 
-  using EigIteratorType = itk::ImageRegionIterator<EigenvectorImageType>;
-  EigIteratorType eigIt(m_EigenvectorImage, m_EigenvectorImage->GetRequestedRegion());
-
-  using TensorImageIteratorType = itk::ImageRegionConstIterator<TensorImageType>;
-  TensorImageIteratorType tensorIt(tensorImage, tensorImage->GetRequestedRegion());
-  for (eigIt.GoToBegin(), tensorIt.GoToBegin(); !eigIt.IsAtEnd() && !tensorIt.IsAtEnd(); ++eigIt, ++tensorIt)
-  {
-    EigenvectorPixelType principalEigenvector;
-    TensorImageIndexType tensorIndex = tensorIt.GetIndex();
-
-    // Define type of tensor pixel
-    constexpr unsigned int tensElements = 6;
-    using VectorTensorPixelType = itk::Vector<float, tensElements>;
-    VectorTensorPixelType tensor;
-
-    TensorImagePixelType tensorPixel = tensorImage->GetPixel(tensorIndex);
-    for (unsigned int i = 0; i < tensElements; i++)
-    {
-      tensor[i] = tensorPixel[i];
-    }
-
-    if (tensor.GetNorm() != 0)
-    {
-      typename TensorImagePixelType::EigenValuesArrayType   eigenValues;
-      typename TensorImagePixelType::EigenVectorsMatrixType eigenVectors;
-      tensorPixel.ComputeEigenAnalysis(eigenValues, eigenVectors);
-      for (unsigned int i = 0; i < dimension; i++)
+  // The principal eigenvectors are independent per voxel, so compute them
+  // in parallel with the closed form symmetric 3x3 eigen solver.
+  MultiThreaderBase::New()->ParallelizeImageRegion<TensorImageType::ImageDimension>(
+    m_EigenvectorImage->GetBufferedRegion(),
+    [this, &tensorImage](const TensorImageRegionType & region) {
+      ImageRegionConstIterator<TensorImageType> tensorIt(tensorImage, region);
+      ImageRegionIterator<EigenvectorImageType> eigIt(m_EigenvectorImage, region);
+      for (; !eigIt.IsAtEnd(); ++eigIt, ++tensorIt)
       {
-        principalEigenvector[i] = eigenVectors[(dimension - 1)][i];
-      }
-    }
+        const TensorImagePixelType & tensorPixel = tensorIt.Value();
+        EigenvectorPixelType         principalEigenvector;
+        principalEigenvector.Fill(0.0);
 
-    else
-    {
-      for (unsigned int i = 0; i < dimension; i++)
-      {
-        principalEigenvector[i] = 0.0;
+        constexpr unsigned int tensElements = 6;
+        bool                   isZeroTensor = true;
+        for (unsigned int i = 0; i < tensElements; i++)
+        {
+          if (tensorPixel[i] != 0)
+          {
+            isZeroTensor = false;
+            break;
+          }
+        }
+        if (!isZeroTensor)
+        {
+          PrincipalEigenVector3x3(tensorPixel, principalEigenvector.GetDataPointer());
+        }
+        eigIt.Set(principalEigenvector);
       }
-    }
-
-    eigIt.Set(principalEigenvector);
-  }
+    },
+    nullptr);
 
   // set all output value to Large Value
   using OutputIterator = ImageRegionIterator<LevelSetImageType>;
@@ -335,10 +327,7 @@ void DtiFastMarchingCostFilter<TLevelSet, TTensorImage>
       }
 
       // make sure the heap is empty
-      while (!m_TrialHeap.empty())
-      {
-        m_TrialHeap.pop();
-      }
+      m_TrialHeap.clear();
 
       // make this an alive point
       m_LabelImage->SetPixel(node.GetIndex(), AlivePoint);
@@ -480,10 +469,7 @@ DtiFastMarchingCostFilter<TLevelSet, TTensorImage>::InitializeTrialPoints(
   double outputSpeedPixel;
 
   // make sure the heap is empty
-  while (!m_TrialHeap.empty())
-  {
-    m_TrialHeap.pop();
-  }
+  m_TrialHeap.clear();
 
   // Get complete neighborhood of alive point to process as trial points
 
@@ -587,7 +573,7 @@ DtiFastMarchingCostFilter<TLevelSet, TTensorImage>::InitializeTrialPoints(
         m_LabelImage->SetPixel(eigIndex, TrialPoint);
         node.SetValue(outputPixel);
         node.SetIndex(eigIndex);
-        m_TrialHeap.push(node);
+        this->PushTrialPoint(node);
       }
     }
   }
@@ -807,7 +793,7 @@ DtiFastMarchingCostFilter<TLevelSet, TTensorImage>
     m_LabelImage->SetPixel(index, TrialPoint);
     node.SetValue(outputPixel);
     node.SetIndex(index);
-    m_TrialHeap.push(node);
+    this->PushTrialPoint(node);
   }
 
   return solution;
@@ -942,7 +928,7 @@ DtiFastMarchingCostFilter<TLevelSet, TTensorImage>
     m_LabelImage->SetPixel(index, TrialPoint);
     node.SetValue(outputPixel);
     node.SetIndex(index);
-    m_TrialHeap.push(node);
+    this->PushTrialPoint(node);
   }
 
   return solution;
@@ -0,0 +1,173 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGtractFixedPointInverseDisplacementFieldImageFilter_h
+#define __itkGtractFixedPointInverseDisplacementFieldImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
+
+#include <mutex>
+
+namespace itk
+{
+/** \class GtractFixedPointInverseDisplacementFieldImageFilter
+ * \brief Computes the inverse of a displacement field by fixed point
+ * iteration.
+ *
+ * If the input field v maps a point p of space A to p + v(p) in space B, the
+ * inverse displacement u at a point x of the output grid satisfies
+ * x + u(x) + v(x + u(x)) = x.  Every output voxel solves this on its own
+ * with the iteration u <- -v(x + u), starting from u = -v(x), where v is
+ * linearly interpolated and zero outside the input field.  The iteration
+ * converges where the field is smooth enough to be invertible (the
+ * Jacobian of v has a norm below one).
+ *
+ * A voxel stops once the residual |u + v(x + u)| is at most Tolerance
+ * (physical units), or after MaximumNumberOfIterations, keeping the
+ * iterate with the smallest residual.  The cost is linear in the number of
+ * output voxels and the voxels are split across threads.  The mean and
+ * maximum residual of the output are available after the update.
+ *
+ * The output grid is set with Size, OutputSpacing, OutputOrigin and
+ * OutputDirection, as for GtractInverseDisplacementFieldImageFilter.
+ *
+ * \ingroup ImageToImageFilter
+ */
+template <typename TInputImage, typename TOutputImage>
+class GtractFixedPointInverseDisplacementFieldImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(GtractFixedPointInverseDisplacementFieldImageFilter);
+
+  /** Standard class type alias. */
+  using Self = GtractFixedPointInverseDisplacementFieldImageFilter;
+  using Superclass = ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  using InputImageType = TInputImage;
+  using InputImagePointer = typename InputImageType::Pointer;
+  using InputImageRegionType = typename InputImageType::RegionType;
+  using OutputImageType = TOutputImage;
+  using OutputImagePointer = typename OutputImageType::Pointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(GtractFixedPointInverseDisplacementFieldImageFilter, ImageToImageFilter);
+
+  /** Number of dimensions. */
+  static constexpr unsigned int ImageDimension = TOutputImage::ImageDimension;
+
+  using SizeType = typename OutputImageType::SizeType;
+  using IndexType = typename OutputImageType::IndexType;
+  using OutputPixelType = typename TOutputImage::PixelType;
+  using OutputPixelComponentType = typename OutputPixelType::ValueType;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+  using SpacingType = typename TOutputImage::SpacingType;
+  using OriginPointType = typename TOutputImage::PointType;
+  using DirectionType = typename TOutputImage::DirectionType;
+
+  using InterpolatorType = VectorLinearInterpolateImageFunction<InputImageType, double>;
+
+  /** Set/Get the size of the output image. */
+  itkSetMacro(Size, SizeType);
+  itkGetConstReferenceMacro(Size, SizeType);
+
+  /** Set/Get the output image spacing. */
+  itkSetMacro(OutputSpacing, SpacingType);
+  itkGetConstReferenceMacro(OutputSpacing, SpacingType);
+
+  /** Set/Get the output image origin. */
+  itkSetMacro(OutputOrigin, OriginPointType);
+  itkGetConstReferenceMacro(OutputOrigin, OriginPointType);
+
+  /** Set/Get the output image direction. */
+  itkSetMacro(OutputDirection, DirectionType);
+  itkGetConstReferenceMacro(OutputDirection, DirectionType);
+
+  /** Set/Get the maximum number of fixed point iterations per voxel. */
+  itkSetMacro(MaximumNumberOfIterations, unsigned int);
+  itkGetConstMacro(MaximumNumberOfIterations, unsigned int);
+
+  /** Set/Get the residual, in physical units, at which a voxel has converged. */
+  itkSetMacro(Tolerance, double);
+  itkGetConstMacro(Tolerance, double);
+
+  /** Mean and maximum residual |u(x) + v(x + u(x))| of the last update. */
+  itkGetConstMacro(MeanResidual, double);
+  itkGetConstMacro(MaximumResidual, double);
+
+  /** Number of output voxels that did not reach the Tolerance. */
+  itkGetConstMacro(NumberOfUnconvergedVoxels, SizeValueType);
+
+#ifdef ITK_USE_CONCEPT_CHECKING
+  /** Begin concept checking */
+  itkConceptMacro(OutputHasNumericTraitsCheck, (Concept::HasNumericTraits<OutputPixelComponentType>));
+  /** End concept checking */
+#endif
+protected:
+  GtractFixedPointInverseDisplacementFieldImageFilter();
+  ~GtractFixedPointInverseDisplacementFieldImageFilter() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** The output grid is given by the parameters, not by the input. */
+  void
+  GenerateOutputInformation() override;
+
+  /** Any output voxel may map to any input voxel, request the whole input. */
+  void
+  GenerateInputRequestedRegion() override;
+
+  void
+  BeforeThreadedGenerateData() override;
+
+  void
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  void
+  AfterThreadedGenerateData() override;
+
+private:
+  SizeType        m_Size;
+  SpacingType     m_OutputSpacing;
+  OriginPointType m_OutputOrigin;
+  DirectionType   m_OutputDirection;
+
+  unsigned int m_MaximumNumberOfIterations{ 20 };
+  double       m_Tolerance{ 0.01 };
+
+  typename InterpolatorType::Pointer m_Interpolator;
+
+  std::mutex    m_ResidualMutex;
+  double        m_ResidualSum{ 0.0 };
+  double        m_MeanResidual{ 0.0 };
+  double        m_MaximumResidual{ 0.0 };
+  SizeValueType m_NumberOfUnconvergedVoxels{ 0 };
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkGtractFixedPointInverseDisplacementFieldImageFilter.hxx"
+#endif
+
+#endif // __itkGtractFixedPointInverseDisplacementFieldImageFilter_h
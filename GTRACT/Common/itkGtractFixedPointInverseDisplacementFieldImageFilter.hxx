@@ -0,0 +1,195 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkGtractFixedPointInverseDisplacementFieldImageFilter_hxx
+#define __itkGtractFixedPointInverseDisplacementFieldImageFilter_hxx
+
+#include "itkGtractFixedPointInverseDisplacementFieldImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+/**
+ * Initialize new instance
+ */
+template <typename TInputImage, typename TOutputImage>
+GtractFixedPointInverseDisplacementFieldImageFilter<TInputImage,
+                                                    TOutputImage>::GtractFixedPointInverseDisplacementFieldImageFilter()
+{
+  m_Size.Fill(0);
+  m_OutputSpacing.Fill(1.0);
+  m_OutputOrigin.Fill(0.0);
+  m_OutputDirection.SetIdentity();
+  this->DynamicMultiThreadingOn();
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+GtractFixedPointInverseDisplacementFieldImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os,
+                                                                                          Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Size:                      " << m_Size << std::endl;
+  os << indent << "OutputSpacing:             " << m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin:              " << m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection:           " << m_OutputDirection << std::endl;
+  os << indent << "MaximumNumberOfIterations: " << m_MaximumNumberOfIterations << std::endl;
+  os << indent << "Tolerance:                 " << m_Tolerance << std::endl;
+  os << indent << "MeanResidual:              " << m_MeanResidual << std::endl;
+  os << indent << "MaximumResidual:           " << m_MaximumResidual << std::endl;
+  os << indent << "NumberOfUnconvergedVoxels: " << m_NumberOfUnconvergedVoxels << std::endl;
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+GtractFixedPointInverseDisplacementFieldImageFilter<TInputImage, TOutputImage>::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+
+  OutputImagePointer outputPtr = this->GetOutput();
+  if (!outputPtr)
+  {
+    return;
+  }
+
+  typename TOutputImage::RegionType outputLargestPossibleRegion;
+  outputLargestPossibleRegion.SetSize(m_Size);
+  outputPtr->SetLargestPossibleRegion(outputLargestPossibleRegion);
+  outputPtr->SetSpacing(m_OutputSpacing);
+  outputPtr->SetOrigin(m_OutputOrigin);
+  outputPtr->SetDirection(m_OutputDirection);
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+GtractFixedPointInverseDisplacementFieldImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  if (!this->GetInput())
+  {
+    return;
+  }
+  InputImagePointer inputPtr = const_cast<InputImageType *>(this->GetInput());
+  inputPtr->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+GtractFixedPointInverseDisplacementFieldImageFilter<TInputImage, TOutputImage>::BeforeThreadedGenerateData()
+{
+  m_Interpolator = InterpolatorType::New();
+  m_Interpolator->SetInputImage(this->GetInput());
+
+  m_ResidualSum = 0.0;
+  m_MeanResidual = 0.0;
+  m_MaximumResidual = 0.0;
+  m_NumberOfUnconvergedVoxels = 0;
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+GtractFixedPointInverseDisplacementFieldImageFilter<TInputImage, TOutputImage>::DynamicThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread)
+{
+  using PointType = typename InterpolatorType::PointType;
+  using VectorType = Vector<double, ImageDimension>;
+
+  OutputImageType * outputPtr = this->GetOutput();
+
+  // v(p), zero outside the input field
+  auto displacement = [this](const PointType & p) -> VectorType {
+    VectorType v;
+    v.Fill(0.0);
+    if (m_Interpolator->IsInsideBuffer(p))
+    {
+      const typename InterpolatorType::OutputType value = m_Interpolator->Evaluate(p);
+      for (unsigned int i = 0; i < ImageDimension; i++)
+      {
+        v[i] = value[i];
+      }
+    }
+    return v;
+  };
+
+  double        residualSum = 0.0;
+  double        maximumResidual = 0.0;
+  SizeValueType unconverged = 0;
+
+  ImageRegionIteratorWithIndex<OutputImageType> outIt(outputPtr, outputRegionForThread);
+  for (outIt.GoToBegin(); !outIt.IsAtEnd(); ++outIt)
+  {
+    PointType x;
+    outputPtr->TransformIndexToPhysicalPoint(outIt.GetIndex(), x);
+
+    // u <- -v(x + u), the residual u + v(x + u) is the next step
+    VectorType u = -displacement(x);
+    VectorType bestU = u;
+    double     bestResidual = NumericTraits<double>::max();
+    for (unsigned int iteration = 0;; iteration++)
+    {
+      const VectorType v = displacement(x + u);
+      const double     residual = (u + v).GetNorm();
+      if (residual < bestResidual)
+      {
+        bestResidual = residual;
+        bestU = u;
+      }
+      if (residual <= m_Tolerance || iteration == m_MaximumNumberOfIterations)
+      {
+        break;
+      }
+      u = -v;
+    }
+    if (bestResidual > m_Tolerance)
+    {
+      ++unconverged;
+    }
+
+    OutputPixelType inverseDisplacement;
+    for (unsigned int i = 0; i < ImageDimension; i++)
+    {
+      inverseDisplacement[i] = static_cast<OutputPixelComponentType>(bestU[i]);
+    }
+    outIt.Set(inverseDisplacement);
+
+    residualSum += bestResidual;
+    maximumResidual = std::max(maximumResidual, bestResidual);
+  }
+
+  std::lock_guard<std::mutex> lock(m_ResidualMutex);
+  m_ResidualSum += residualSum;
+  m_MaximumResidual = std::max(m_MaximumResidual, maximumResidual);
+  m_NumberOfUnconvergedVoxels += unconverged;
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+GtractFixedPointInverseDisplacementFieldImageFilter<TInputImage, TOutputImage>::AfterThreadedGenerateData()
+{
+  const SizeValueType numberOfPixels = this->GetOutput()->GetRequestedRegion().GetNumberOfPixels();
+  m_MeanResidual = (numberOfPixels > 0) ? m_ResidualSum / numberOfPixels : 0.0;
+  m_Interpolator = nullptr;
+}
+} // end namespace itk
+
+#endif
@@ -34,16 +34,11 @@
 
 =========================================================================*/
 
-#include "itkImageRegionIterator.h"
-#include "itkImageRegionConstIterator.h"
 #include "itkInvertBSplineFilter.h"
-#include <itkIOCommon.h>
-#include <itkCastImageFilter.h>
-#include <itkConstantPadImageFilter.h>
-#include <itkExtractImageFilter.h>
-#include "itkMetaDataObject.h"
-#include "itkProgressAccumulator.h"
+#include "itkBSplineScatteredDataPointSetToImageFilter.h"
+#include "itkMultiThreaderBase.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace itk
@@ -59,56 +54,215 @@ void
 InvertBSplineFilter::Update()
 {
   std::cout << "InvertBSplineFilter()...." << std::endl;
+  if (m_Input.IsNull() || m_ExampleImage.IsNull())
+  {
+    itkExceptionMacro(<< "A B-Spline transform and an example image are required");
+  }
+  if (m_XgridSize < 1 || m_YgridSize < 1 || m_ZgridSize < 1)
+  {
+    itkExceptionMacro(<< "Grid sizes must be positive, got " << m_XgridSize << " " << m_YgridSize << " "
+                      << m_ZgridSize);
+  }
 
-  ImageType::SizeType   imageSize = m_ExampleImage->GetLargestPossibleRegion().GetSize();
-  PointSetType::Pointer sourceLandMarks = PointSetType::New();
-  PointSetType::Pointer targetLandMarks = PointSetType::New();
-
-  PointSetType::PointsContainer::Pointer sourceLandMarkContainer = sourceLandMarks->GetPoints();
-  PointSetType::PointsContainer::Pointer targetLandMarkContainer = targetLandMarks->GetPoints();
+  ImageType::SizeType imageSize = m_ExampleImage->GetLargestPossibleRegion().GetSize();
 
-  float xinr = (float)(imageSize[0]) / (float)m_XgridSize;
-  float yinr = (float)(imageSize[1]) / (float)m_YgridSize;
-  float zinr = (float)(imageSize[2]) / (float)m_ZgridSize;
+  const double xinr = static_cast<double>(imageSize[0]) / m_XgridSize;
+  const double yinr = static_cast<double>(imageSize[1]) / m_YgridSize;
+  const double zinr = static_cast<double>(imageSize[2]) / m_ZgridSize;
 
-  PointIdType id = itk::NumericTraits<PointIdType>::ZeroValue();
   std::cout << "Xsize " << imageSize[0] << " Ysize " << imageSize[1] << " Zsize " << imageSize[2] << std::endl;
   std::cout << "Xinc " << xinr << " Yinc " << yinr << " Zinc " << zinr << std::endl;
 
-  for (float z = 0; z <= imageSize[2] + 1; z += zinr)
+  // Samples every Xinc, Yinc, Zinc voxels up to the image size + 1, and
+  // where the forward transform maps them
+  const auto          numberOfX = static_cast<SizeValueType>((imageSize[0] + 1) / xinr) + 1;
+  const auto          numberOfY = static_cast<SizeValueType>((imageSize[1] + 1) / yinr) + 1;
+  const auto          numberOfZ = static_cast<SizeValueType>((imageSize[2] + 1) / zinr) + 1;
+  const SizeValueType numberOfSamples = numberOfX * numberOfY * numberOfZ;
+
+  std::vector<PointType> samplePoints(numberOfSamples);
+  std::vector<PointType> mappedPoints(numberOfSamples);
+  MultiThreaderBase::New()->ParallelizeArray(
+    0,
+    numberOfSamples,
+    [&](const SizeValueType k) {
+      itk::ContinuousIndex<double, 3> imageIndex;
+      imageIndex[0] = (k % numberOfX) * xinr;
+      imageIndex[1] = ((k / numberOfX) % numberOfY) * yinr;
+      imageIndex[2] = (k / (numberOfX * numberOfY)) * zinr;
+      m_ExampleImage->TransformContinuousIndexToPhysicalPoint(imageIndex, samplePoints[k]);
+      mappedPoints[k] = m_Input->TransformPoint(samplePoints[k]);
+    },
+    nullptr);
+
+  // The inverse is fitted over the domain of the forward transform, keep the
+  // samples that map into it
+  const BsplineTransformType::OriginType             domainOrigin = m_Input->GetTransformDomainOrigin();
+  const BsplineTransformType::PhysicalDimensionsType domainDimensions = m_Input->GetTransformDomainPhysicalDimensions();
+  const BsplineTransformType::DirectionType          domainDirection = m_Input->GetTransformDomainDirection();
+
+  std::vector<PointType> insideSamplePoints;
+  std::vector<PointType> insideMappedPoints;
+  for (SizeValueType k = 0; k < numberOfSamples; k++)
   {
-    for (float y = 0; y <= imageSize[1] + 1; y += yinr)
+    bool inside = true;
+    for (unsigned int i = 0; i < transformDimension; i++)
     {
-      for (float x = 0; x <= imageSize[0] + 1; x += xinr)
+      double position = 0.0;
+      for (unsigned int j = 0; j < transformDimension; j++)
       {
-        PointType                       p1;
-        PointType                       p2;
-        itk::ContinuousIndex<double, 3> imageIndex;
-        imageIndex[0] = x;
-        imageIndex[1] = y;
-        imageIndex[2] = z;
-        m_ExampleImage->TransformContinuousIndexToPhysicalPoint(imageIndex, p1);
-        p2 = m_Input->TransformPoint(p1);
-
-        // Add Points and the Landmark Point Lists
-        sourceLandMarkContainer->InsertElement(id, p2);
-        targetLandMarkContainer->InsertElement(id, p1);
-        id++;
-        // std::cout << "Set Z points " << z << " " << p1 << " " << p2 <<
-        // std::endl;
+        position += domainDirection[j][i] * (mappedPoints[k][j] - domainOrigin[j]);
       }
+      const double margin = 1e-6 * domainDimensions[i];
+      inside &= position >= margin && position <= domainDimensions[i] - margin;
+    }
+    if (inside)
+    {
+      insideSamplePoints.push_back(samplePoints[k]);
+      insideMappedPoints.push_back(mappedPoints[k]);
     }
   }
-  std::cout << "Set Landmarks and Invert " << std::endl;
+  std::cout << insideSamplePoints.size() << " of " << numberOfSamples << " samples map into the transform domain"
+            << std::endl;
+  if (insideSamplePoints.empty())
+  {
+    itkExceptionMacro(<< "No sample maps into the domain of the B-Spline transform");
+  }
 
-  // Create TPS Approximation of B-Spline Transform
-  m_Output = TransformType::New();
-  m_Output->SetSourceLandmarks(sourceLandMarks);
-  m_Output->SetTargetLandmarks(targetLandMarks);
-  m_Output->ComputeWMatrix();
+  // Identity on the forward domain, with the mesh the fit refines to.  Stop
+  // refining before the mesh gets finer than the sample grid.
+  const BsplineTransformType::MeshSizeType forwardMesh = m_Input->GetTransformDomainMeshSize();
+  const SizeValueType                      sampleSpans[3] = { numberOfX - 1, numberOfY - 1, numberOfZ - 1 };
+  unsigned int                             numberOfLevels = 1;
+  while (numberOfLevels < m_NumberOfFittingLevels)
+  {
+    bool finerThanSamples = false;
+    for (unsigned int i = 0; i < transformDimension; i++)
+    {
+      finerThanSamples |= (forwardMesh[i] << numberOfLevels) > sampleSpans[i];
+    }
+    if (finerThanSamples)
+    {
+      break;
+    }
+    numberOfLevels++;
+  }
+  BsplineTransformType::MeshSizeType finestMesh;
+  for (unsigned int i = 0; i < transformDimension; i++)
+  {
+    finestMesh[i] = forwardMesh[i] << (numberOfLevels - 1);
+  }
+  std::cout << "Fitting " << numberOfLevels << " levels up to a mesh of " << finestMesh << std::endl;
+  m_Output = BsplineTransformType::New();
+  m_Output->SetTransformDomainOrigin(domainOrigin);
+  m_Output->SetTransformDomainPhysicalDimensions(domainDimensions);
+  m_Output->SetTransformDomainDirection(domainDirection);
+  m_Output->SetTransformDomainMeshSize(finestMesh);
+  BsplineTransformType::ParametersType identity(m_Output->GetNumberOfParameters());
+  identity.Fill(0.0);
+  m_Output->SetParametersByValue(identity);
 
-  std::cout << "Computed TPS Inverse transform" << std::endl;
+  // Coarse to fine fit, then refits of the residual on the finest mesh
+  PointSetType::Pointer residuals = this->ComputeResiduals(insideSamplePoints, insideMappedPoints);
+  this->FitDisplacements(residuals, forwardMesh, numberOfLevels);
+  for (unsigned int iteration = 0;; iteration++)
+  {
+    residuals = this->ComputeResiduals(insideSamplePoints, insideMappedPoints);
+    std::cout << "Fit " << iteration << ": inverse consistency error mean " << m_MeanInverseConsistencyError
+              << " mm, maximum " << m_MaximumInverseConsistencyError << " mm" << std::endl;
+    if (iteration == m_NumberOfFittingIterations)
+    {
+      break;
+    }
+    this->FitDisplacements(residuals, finestMesh, 1);
+  }
 
-  std::cout << m_Output << std::endl;
+  std::cout << "Computed B-Spline Inverse transform" << std::endl;
+}
+
+InvertBSplineFilter::PointSetType::Pointer
+InvertBSplineFilter::ComputeResiduals(const std::vector<PointType> & samplePoints,
+                                      const std::vector<PointType> & mappedPoints)
+{
+  const SizeValueType     numberOfSamples = samplePoints.size();
+  std::vector<VectorType> residuals(numberOfSamples);
+  MultiThreaderBase::New()->ParallelizeArray(
+    0,
+    numberOfSamples,
+    [&](const SizeValueType k) { residuals[k] = samplePoints[k] - m_Output->TransformPoint(mappedPoints[k]); },
+    nullptr);
+
+  PointSetType::Pointer displacements = PointSetType::New();
+  double                errorSum = 0.0;
+  double                errorMaximum = 0.0;
+  for (SizeValueType k = 0; k < numberOfSamples; k++)
+  {
+    displacements->SetPoint(k, mappedPoints[k]);
+    displacements->SetPointData(k, residuals[k]);
+    const double error = residuals[k].GetNorm();
+    errorSum += error;
+    errorMaximum = std::max(errorMaximum, error);
+  }
+  m_MeanInverseConsistencyError = (numberOfSamples > 0) ? errorSum / numberOfSamples : 0.0;
+  m_MaximumInverseConsistencyError = errorMaximum;
+  return displacements;
+}
+
+void
+InvertBSplineFilter::FitDisplacements(const PointSetType *                     displacements,
+                                      const BsplineTransformType::MeshSizeType & meshSize,
+                                      const unsigned int                       numberOfLevels)
+{
+  using ControlPointImageType = itk::Image<VectorType, transformDimension>;
+  using FitterType = itk::BSplineScatteredDataPointSetToImageFilter<PointSetType, ControlPointImageType>;
+
+  // The parametric domain of the fit is the transform domain, so the control
+  // point lattice holds the transform coefficients
+  const BsplineTransformType::PhysicalDimensionsType domainDimensions =
+    m_Output->GetTransformDomainPhysicalDimensions();
+
+  FitterType::SizeType    size;
+  FitterType::SpacingType spacing;
+  FitterType::ArrayType   numberOfControlPoints;
+  FitterType::ArrayType   levels;
+  for (unsigned int i = 0; i < transformDimension; i++)
+  {
+    size[i] = meshSize[i] + 1;
+    spacing[i] = domainDimensions[i] / meshSize[i];
+    numberOfControlPoints[i] = meshSize[i] + SplineOrder;
+    levels[i] = numberOfLevels;
+  }
+
+  FitterType::Pointer fitter = FitterType::New();
+  fitter->SetInput(displacements);
+  fitter->SetOrigin(m_Output->GetTransformDomainOrigin());
+  fitter->SetSpacing(spacing);
+  fitter->SetSize(size);
+  fitter->SetDirection(m_Output->GetTransformDomainDirection());
+  fitter->SetSplineOrder(SplineOrder);
+  fitter->SetNumberOfControlPoints(numberOfControlPoints);
+  fitter->SetNumberOfLevels(levels);
+  fitter->SetGenerateOutputImage(false);
+  fitter->Update();
+
+  const ControlPointImageType * lattice = fitter->GetPhiLattice();
+  const SizeValueType           numberOfCoefficients = m_Output->GetNumberOfParametersPerDimension();
+  if (lattice->GetLargestPossibleRegion().GetNumberOfPixels() != numberOfCoefficients)
+  {
+    itkExceptionMacro(<< "Fitted " << lattice->GetLargestPossibleRegion().GetSize()
+                      << " control points, the inverse transform has " << numberOfCoefficients);
+  }
+
+  // Parameters are stored dimension by dimension, each in lattice order
+  BsplineTransformType::ParametersType parameters = m_Output->GetParameters();
+  const VectorType *                   coefficients = lattice->GetBufferPointer();
+  for (unsigned int d = 0; d < transformDimension; d++)
+  {
+    for (SizeValueType k = 0; k < numberOfCoefficients; k++)
+    {
+      parameters[d * numberOfCoefficients + k] += coefficients[k][d];
+    }
+  }
+  m_Output->SetParametersByValue(parameters);
 }
 } // end namespace itk
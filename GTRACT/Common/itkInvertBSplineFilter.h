@@ -48,7 +48,7 @@
 #include <itkMattesMutualInformationImageToImageMetric.h>
 #include <itkLinearInterpolateImageFunction.h>
 #include <itkBSplineTransform.h>
-#include <itkThinPlateR2LogRSplineKernelTransform.h>
+#include <itkPointSet.h>
 #include <itkLBFGSBOptimizer.h>
 #include <itkCenteredTransformInitializer.h>
 #include <itkTimeProbesCollectorBase.h>
@@ -57,11 +57,26 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace itk
 {
 /** \class InvertBSplineFilter
+ * \brief Approximates the inverse of a B-Spline transform by a B-Spline
+ * transform.
  *
+ * The forward transform is sampled, in parallel, at (XgridSize + 1) x
+ * (YgridSize + 1) x (ZgridSize + 1) points spread over the ExampleImage.  Each
+ * sample p maps to q = T(p), and the inverse displacement p - q at q is
+ * fitted over the domain of the forward transform with
+ * BSplineScatteredDataPointSetToImageFilter.  The fit starts on the forward
+ * mesh and doubles it up to NumberOfFittingLevels - 1 times, while the mesh
+ * stays no finer than the sample grid.  The residuals are then refitted on
+ * the finest mesh NumberOfFittingIterations times.
+ *
+ * The output is a BSplineTransform, so applying it costs the same as applying
+ * the forward transform.  The inverse consistency error |Tinv(T(p)) - p| over
+ * the samples is reported after the update.
  */
 
 class GTRACT_COMMON_EXPORT InvertBSplineFilter : public itk::Object
@@ -96,10 +111,17 @@ public:
   using BsplineTransformTypePointer = BsplineTransformType::Pointer;
 
   /** Output Transform type alias. */
-  using TransformType = itk::ThinPlateR2LogRSplineKernelTransform<CoordinateRepresentationType, transformDimension>;
+  using TransformType = BsplineTransformType;
   using TransformTypePointer = TransformType::Pointer;
   using PointType = itk::Point<CoordinateRepresentationType, transformDimension>;
-  using PointSetType = TransformType::PointSetType;
+  using VectorType = itk::Vector<CoordinateRepresentationType, transformDimension>;
+  using PointSetType = itk::PointSet<VectorType,
+                                     transformDimension,
+                                     itk::DefaultStaticMeshTraits<VectorType,
+                                                                  transformDimension,
+                                                                  transformDimension,
+                                                                  CoordinateRepresentationType,
+                                                                  CoordinateRepresentationType>>;
   using PointIdType = PointSetType::PointIdentifier;
 
   /** Standard New method. */
@@ -121,6 +143,18 @@ public:
   itkGetMacro(YgridSize, int);
   itkGetMacro(ZgridSize, int);
 
+  /** Number of mesh doublings of the fit, 1 fits on the forward mesh only. */
+  itkSetMacro(NumberOfFittingLevels, unsigned int);
+  itkGetMacro(NumberOfFittingLevels, unsigned int);
+
+  /** Number of refits of the residual on the finest mesh. */
+  itkSetMacro(NumberOfFittingIterations, unsigned int);
+  itkGetMacro(NumberOfFittingIterations, unsigned int);
+
+  /** Inverse consistency error |Tinv(T(p)) - p| over the samples, in mm. */
+  itkGetMacro(MeanInverseConsistencyError, double);
+  itkGetMacro(MaximumInverseConsistencyError, double);
+
   void
   Update();
 
@@ -129,6 +163,17 @@ protected:
   ~InvertBSplineFilter() override = default;
 
 private:
+  /** Add the fit of the displacements at the mapped samples to the
+   *  coefficients of the inverse, on a control grid of the given mesh size. */
+  void
+  FitDisplacements(const PointSetType *                     displacements,
+                   const BsplineTransformType::MeshSizeType & meshSize,
+                   unsigned int                             numberOfLevels);
+
+  /** Set the inverse consistency errors, return the residual displacements. */
+  PointSetType::Pointer
+  ComputeResiduals(const std::vector<PointType> & samplePoints, const std::vector<PointType> & mappedPoints);
+
   /*** Input and Output Objects ***/
   BsplineTransformTypePointer m_Input;
   TransformTypePointer        m_Output;
@@ -137,6 +182,11 @@ private:
   int m_XgridSize;
   int m_YgridSize;
   int m_ZgridSize;
+
+  unsigned int m_NumberOfFittingLevels{ 3 };
+  unsigned int m_NumberOfFittingIterations{ 3 };
+  double       m_MeanInverseConsistencyError{ 0.0 };
+  double       m_MaximumInverseConsistencyError{ 0.0 };
 }; // end of class
 } // end namespace itk
 
@@ -34,33 +34,39 @@
 
 =========================================================================*/
 
+
 #ifndef __itkTensorToAnisotropyImageFilter_h
 #define __itkTensorToAnisotropyImageFilter_h
 
-#include "itkObject.h"
 #include "itkImage.h"
 #include "itkImageToImageFilter.h"
-#include "itkIOCommon.h"
-#include "gtractCommonWin32.h"
-
-#include <map>
-#include <string>
+#include "itkConstNeighborhoodIterator.h"
 
 namespace itk
 {
 /** \class TensorToAnisotropyImageFilter
  * \brief Calculates the Specified Anisotropy Index.
  *
+ * The input pixels hold the six unique tensor elements in
+ * (xx, xy, xz, yy, yz, zz) order, e.g. DiffusionTensor3D or Vector<float, 6>.
  * The following Anisotropy Image are supported:
+ *    Mean Diffusivity
  *    Fractional Anistropy
- *    Relatibve Anisotropy
+ *    Relative Anisotropy
  *    Volume Ratio
- *    Radial Diffusivity
  *    Axial Diffusivity
- *    Coheernce Index
+ *    Radial Diffusivity
+ *    Lattice Index of the voxel tensor
+ * as defined by gtractDiffusionTensor3D, and the in plane neighborhood
+ * indices
+ *    Coherence Index
  *    Lattice Index
- *    Mean Diffusivity
+ * which average the index between the voxel tensor and each of its 8 in plane
+ * neighbors.  Voxels with a zero tensor are set to 0.
  *
+ * The filter is multi-threaded.  Eigenvalues come from the closed form
+ * solution of gtractSymmetricEigen3x3.h and the neighborhood indices only
+ * need tensor contractions, so no voxel allocates memory.
  */
 
 enum ENUM_ANISOTROPY_TYPE
@@ -72,88 +78,87 @@ enum ENUM_ANISOTROPY_TYPE
   AXIAL_DIFFUSIVITY = 4,
   RADIAL_DIFFUSIVITY = 5,
   COHERENCE_INDEX = 6,
-  LATTICE_INDEX = 7
+  LATTICE_INDEX = 7,
+  VOXEL_LATTICE_INDEX = 8
 };
 using AnisotropyType = enum ENUM_ANISOTROPY_TYPE;
 
-class GTRACT_COMMON_EXPORT TensorToAnisotropyImageFilter : public itk::Object
+template <typename TInputImage, typename TOutputImage = Image<float, TInputImage::ImageDimension>>
+class TensorToAnisotropyImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
 {
 public:
   ITK_DISALLOW_COPY_AND_ASSIGN(TensorToAnisotropyImageFilter);
 
   /** Standard class type alias. */
   using Self = TensorToAnisotropyImageFilter;
-  using Superclass = itk::Object;
+  using Superclass = ImageToImageFilter<TInputImage, TOutputImage>;
   using Pointer = SmartPointer<Self>;
   using ConstPointer = SmartPointer<const Self>;
 
-  /** Some convenient type alias. */
-  using InputPixelType = itk::Vector<float, 6>;
-  using InputImageType = itk::Image<InputPixelType, 3>;
-  using InputImagePointer = InputImageType::Pointer;
-  using InputImageConstPointer = InputImageType::ConstPointer;
-  using InputImageRegionType = InputImageType::RegionType;
-  using InputImageSizeType = InputImageType::SizeType;
-  using InputImageSpacingType = InputImageType::SpacingType;
-  using InputImagePointType = InputImageType::PointType;
-  using InputImagePixelType = InputImageType::PixelType;
-  using InputImageDirectionType = InputImageType::DirectionType;
-
-  using OutputImageType = itk::Image<float, 3>;
-  using OutputImagePointer = OutputImageType::Pointer;
-  using OutputImageConstPointer = OutputImageType::ConstPointer;
-  using OutputImageRegionType = OutputImageType::RegionType;
-  using OutputImagePixelType = OutputImageType::PixelType;
-  using OutputImageIndexType = OutputImageType::IndexType;
-
-  /** ImageDimension constants * /
-  static constexpr unsigned int InputImageDimension = TInputImage::ImageDimension;
-  static constexpr unsigned int OutputImageDimension = TOutputImage::ImageDimension;
-
-  / ** The dimensions of the input image must equal those of the
-      output image. * /
-  itkConceptMacro(SameDimension,
-    (Concept::SameDimension<Self::InputImageDimension,Self::OutputImageDimension>));
-
-  / ** The dimension of the input image must be 4. * /
-  itkConceptMacro(DimensionShouldBe4,
-    (Concept::SameDimension<Self::InputImageDimension,4>));
-*/
   /** Standard New method. */
   itkNewMacro(Self);
 
   /** Runtime information support. */
-  itkTypeMacro(TensorToAnisotropyImageFilter, itk::Object);
+  itkTypeMacro(TensorToAnisotropyImageFilter, ImageToImageFilter);
 
-  /* SetInput and GetOutput Macros */
-  itkSetObjectMacro(Input, InputImageType);
-  itkGetConstObjectMacro(Output, OutputImageType);
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+  static_assert(ImageDimension == 3, "TensorToAnisotropyImageFilter needs 3D images");
 
-  itkSetMacro(AnisotropyType, AnisotropyType);
+  /** Some convenient type alias. */
+  using InputImageType = TInputImage;
+  using InputPixelType = typename InputImageType::PixelType;
+  using InputImageRegionType = typename InputImageType::RegionType;
+  using OutputImageType = TOutputImage;
+  using OutputPixelType = typename OutputImageType::PixelType;
+  using OutputImageRegionType = typename OutputImageType::RegionType;
+  using NeighborhoodIteratorType = ConstNeighborhoodIterator<InputImageType>;
 
-  void
-  Update();
+  itkSetMacro(AnisotropyType, AnisotropyType);
+  itkGetConstMacro(AnisotropyType, AnisotropyType);
 
 protected:
-  TensorToAnisotropyImageFilter();
+  TensorToAnisotropyImageFilter() = default;
   ~TensorToAnisotropyImageFilter() override = default;
 
-private:
   void
-  computVoxelIsotropy();
+  PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** The neighborhood indices need a one voxel in plane border. */
   void
-  computSimpleVoxelAnisotropy();
+  GenerateInputRequestedRegion() override;
 
   void
-  computNeighborhoodVoxelAnisotropy();
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+private:
+  bool
+  IsNeighborhoodAnisotropy() const
+  {
+    return m_AnisotropyType == COHERENCE_INDEX || m_AnisotropyType == LATTICE_INDEX;
+  }
 
-  // Input and Output Image
-  InputImagePointer  m_Input;
-  OutputImagePointer m_Output;
+  static typename NeighborhoodIteratorType::RadiusType
+  GetInPlaneRadius();
 
-  AnisotropyType m_AnisotropyType;
+  static bool
+  IsZeroTensor(const InputPixelType & tensor);
+
+  /** Tensor double dot product A : B = trace(A B). */
+  static double
+  TensorDotProduct(const InputPixelType & a, const InputPixelType & b);
+
+  void
+  computVoxelAnisotropy(const OutputImageRegionType & region);
+
+  void
+  computNeighborhoodVoxelAnisotropy(const OutputImageRegionType & region);
+
+  AnisotropyType m_AnisotropyType{ FRACTIONAL_ANISOTROPY };
 }; // end of class
 } // end namespace itk
 
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkTensorToAnisotropyImageFilter.hxx"
+#endif
+
 #endif
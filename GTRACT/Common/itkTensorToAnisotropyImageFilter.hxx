@@ -0,0 +1,245 @@
+/*=========================================================================
+ *
+ *  Copyright SINAPSE: Scalable Informatics for Neuroscience, Processing and Software Engineering
+ *            The University of Iowa
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/*=========================================================================
+
+ Program:   GTRACT (Guided Tensor Restore Anatomical Connectivity Tractography)
+ Module:    $RCSfile: $
+ Language:  C++
+ Date:      $Date: 2006/03/29 14:53:40 $
+ Version:   $Revision: 1.9 $
+
+   Copyright (c) University of Iowa Department of Radiology. All rights reserved.
+   See GTRACT-Copyright.txt or http://mri.radiology.uiowa.edu/copyright/GTRACT-Copyright.txt
+   for details.
+
+      This software is distributed WITHOUT ANY WARRANTY; without even
+      the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+      PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+
+#ifndef __itkTensorToAnisotropyImageFilter_hxx
+#define __itkTensorToAnisotropyImageFilter_hxx
+
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkNeighborhoodAlgorithm.h"
+
+#include "itkTensorToAnisotropyImageFilter.h"
+#include "gtractDiffusionTensor3D.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace itk
+{
+template <typename TInputImage, typename TOutputImage>
+typename TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::NeighborhoodIteratorType::RadiusType
+TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::GetInPlaneRadius()
+{
+  typename NeighborhoodIteratorType::RadiusType radius;
+  radius.Fill(1);
+  radius[2] = 0;
+  return radius;
+}
+
+template <typename TInputImage, typename TOutputImage>
+bool
+TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::IsZeroTensor(const InputPixelType & tensor)
+{
+  for (unsigned int i = 0; i < 6; i++)
+  {
+    if (tensor[i] != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename TInputImage, typename TOutputImage>
+double
+TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::TensorDotProduct(const InputPixelType & a,
+                                                                           const InputPixelType & b)
+{
+  return static_cast<double>(a[0]) * b[0] + static_cast<double>(a[3]) * b[3] + static_cast<double>(a[5]) * b[5] +
+         2.0 * (static_cast<double>(a[1]) * b[1] + static_cast<double>(a[2]) * b[2] + static_cast<double>(a[4]) * b[4]);
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  if (!this->IsNeighborhoodAnisotropy())
+  {
+    return;
+  }
+
+  auto * input = const_cast<InputImageType *>(this->GetInput());
+  if (input == nullptr)
+  {
+    return;
+  }
+  InputImageRegionType requestedRegion = input->GetRequestedRegion();
+  requestedRegion.PadByRadius(GetInPlaneRadius());
+  requestedRegion.Crop(input->GetLargestPossibleRegion());
+  input->SetRequestedRegion(requestedRegion);
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::DynamicThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread)
+{
+  if (this->IsNeighborhoodAnisotropy())
+  {
+    this->computNeighborhoodVoxelAnisotropy(outputRegionForThread);
+  }
+  else
+  {
+    this->computVoxelAnisotropy(outputRegionForThread);
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::computVoxelAnisotropy(const OutputImageRegionType & region)
+{
+  ImageRegionConstIterator<InputImageType> inIt(this->GetInput(), region);
+  ImageRegionIterator<OutputImageType>     outIt(this->GetOutput(), region);
+
+  gtractDiffusionTensor3D<double> tensor;
+  for (; !outIt.IsAtEnd(); ++inIt, ++outIt)
+  {
+    const InputPixelType & currentVoxel = inIt.Get();
+    double                 ai = 0;
+    if (!IsZeroTensor(currentVoxel))
+    {
+      for (unsigned int i = 0; i < 6; i++)
+      {
+        tensor[i] = currentVoxel[i];
+      }
+      switch (m_AnisotropyType)
+      {
+        case MEAN_DIFFUSIVITY:
+          ai = tensor.GetTrace() / 3.0;
+          break;
+        case FRACTIONAL_ANISOTROPY:
+          ai = tensor.GetFractionalAnisotropy();
+          break;
+        case RELATIVE_ANISOTROPY:
+          ai = tensor.GetRelativeAnisotropy();
+          break;
+        case VOLUME_RATIO:
+          ai = tensor.GetVolumeRatio();
+          break;
+        case AXIAL_DIFFUSIVITY:
+          ai = tensor.GetAxialDiffusivity();
+          break;
+        case RADIAL_DIFFUSIVITY:
+          ai = tensor.GetRadialDiffusivity();
+          break;
+        case VOXEL_LATTICE_INDEX:
+          ai = tensor.GetLatticeIndex();
+          break;
+        default:
+          break;
+      }
+    }
+    outIt.Set(static_cast<OutputPixelType>(ai));
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::computNeighborhoodVoxelAnisotropy(
+  const OutputImageRegionType & region)
+{
+  // The coherence and lattice indices only need the inner products of the
+  // eigen systems:  sum_ij l1_i l2_j (e1_i . e2_j)^2 = D1 : D2, and
+  // sum_i l_i^2 = D : D.
+  using FaceCalculatorType = NeighborhoodAlgorithm::ImageBoundaryFacesCalculator<InputImageType>;
+  FaceCalculatorType                             faceCalculator;
+  const typename FaceCalculatorType::FaceListType faceList =
+    faceCalculator(this->GetInput(), region, GetInPlaneRadius());
+  for (const auto & face : faceList)
+  { // This is temporary, further consideration on boundary condition needed
+    NeighborhoodIteratorType             it(GetInPlaneRadius(), this->GetInput(), face);
+    ImageRegionIterator<OutputImageType> outIt(this->GetOutput(), face);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it, ++outIt)
+    {
+      const InputPixelType center = it.GetCenterPixel();
+      double               ai = 0;
+      if (!IsZeroTensor(center))
+      {
+        const double centerTrace = static_cast<double>(center[0]) + center[3] + center[5];
+        const double centerSquares = TensorDotProduct(center, center);
+        double       sum = 0;
+        double       coef = 0;
+        for (unsigned int i = 0; i <= 8; i++)
+        {
+          if (i == 4)
+          {
+            continue;
+          }
+
+          const InputPixelType neighbor = it.GetPixel(i);
+          if (IsZeroTensor(neighbor))
+          {
+            continue;
+          }
+          const double a = ((i % 2) == 0) ? 0.7071 : 1.0;
+          const double dd = TensorDotProduct(center, neighbor);
+          const double isotropicPart = centerTrace * (static_cast<double>(neighbor[0]) + neighbor[3] + neighbor[5]) / 3;
+          double       temp = 0;
+          if (m_AnisotropyType == COHERENCE_INDEX)
+          {
+            temp = (dd - isotropicPart) / dd;
+          }
+          else if ((dd - isotropicPart) >= 0 && dd >= 0)
+          {
+            temp = 0.612372 * std::sqrt(dd - isotropicPart) / std::sqrt(dd) +
+                   0.75 * (dd - isotropicPart) / std::sqrt(centerSquares * TensorDotProduct(neighbor, neighbor));
+          }
+          sum += a * temp;
+          coef += a;
+        }
+
+        // Cut off the value that < 0, It's right or wrong?
+        if ((coef != 0) && (sum > 0))
+        {
+          ai = sum / coef;
+        }
+      }
+      outIt.Set(static_cast<OutputPixelType>(ai));
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+TensorToAnisotropyImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "AnisotropyType: " << m_AnisotropyType << std::endl;
+}
+} // end namespace itk
+#endif
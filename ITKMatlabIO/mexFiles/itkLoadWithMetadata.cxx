@@ -3,6 +3,7 @@
 #include "itkMetaDataObject.h"
 #include "itkImageFileReader.h"
 #include "itkNrrdImageIOFactory.h"
+#include <algorithm>
 #include <iomanip>
 #include "nrrdCommon.h"
 #include "myMexPrintf.h" //add by HuiXie
@@ -74,96 +75,42 @@ ITKToMType<itk::VariableLengthVector<float>>()
   return mxSINGLE_CLASS;
 }
 
-/** In order to use Reorganize below in a template function, there
- * needs to be a valid template function for the compiler to
- * instantiate even if it isn't going to be used
- */
-template <typename ImageType1, typename ImageType2>
-void
-Reorganize(typename ImageType1::Pointer &, typename ImageType2::Pointer &)
+template <>
+mxClassID
+ITKToMType<itk::VariableLengthVector<short>>()
 {
-  itkGenericExceptionMacro(<< "Should never Instantiate this template function");
+  myMexPrintf("UNITS = mxINT16_CLASS\n");
+  return mxINT16_CLASS;
 }
 
-/** Go from a Vector Image to a 4D image */
+/** Copy the rows x columns row major matrix source to the columns x rows
+ * row major matrix target.  The copy goes tile by tile, so the strided side
+ * of the transpose touches only a few cache lines per tile instead of one
+ * per element.
+ */
 template <typename TPixel>
-void Reorganize(typename itk::VectorImage<TPixel, 3>::Pointer & vecImage,
-                typename itk::Image<TPixel, 4>::Pointer &       scalarImage)
+void
+BlockedTranspose(const TPixel * source, TPixel * target, const size_t rows, const size_t columns)
 {
-  using TVecImage = itk::VectorImage<TPixel, 3>;
-  using TScalarImage = itk::Image<TPixel, 4>;
-  //
-  // this does a full, correct job of creating the corresponding 4D
-  // image from the 3D Vector Image, even though all we care about in
-  // this context is the reorganization of the voxels.
-  const typename TVecImage::SizeType vecImageSize = vecImage->GetLargestPossibleRegion().GetSize();
-  typename TScalarImage::SizeType    size;
-
-  const typename TVecImage::SpacingType vecSpacing = vecImage->GetSpacing();
-  typename TScalarImage::SpacingType    spacing;
-
-  const typename TVecImage::PointType vecOrigin = vecImage->GetOrigin();
-  typename TScalarImage::PointType    origin;
-
-  const typename TVecImage::DirectionType vecDirections = vecImage->GetDirection();
-  typename TScalarImage::DirectionType    directions;
-
-  for (unsigned int i = 0; i < TScalarImage::ImageDimension; ++i)
-  {
-    if (i < TVecImage::ImageDimension)
-    {
-      size[i] = vecImageSize[i];
-      spacing[i] = vecSpacing[i];
-      origin[i] = vecOrigin[i];
-    }
-    else
-    {
-      size[i] = vecImage->GetNumberOfComponentsPerPixel();
-      spacing[i] = 1.0;
-      origin[i] = 0.0;
-    }
-    for (unsigned int j = 0; j < TScalarImage::ImageDimension; ++j)
-    {
-      if (i < TVecImage::ImageDimension && j < TVecImage::ImageDimension)
-      {
-        directions(i, j) = vecDirections(i, j);
-      }
-      else
-      {
-        directions(i, j) = i == j ? 1.0 : 0.0;
-      }
-    }
-  }
-  scalarImage = TScalarImage::New();
-  scalarImage->SetRegions(size);
-  scalarImage->SetOrigin(origin);
-  scalarImage->SetSpacing(spacing);
-  scalarImage->SetDirection(directions);
-  scalarImage->Allocate();
-
-  typename TVecImage::IndexType    vecIndex;
-  typename TScalarImage::IndexType volIndex;
-
-  using IndexValueType = typename TScalarImage::IndexType::IndexValueType;
-
-  // convert from vector image to 4D volume image
-  for (volIndex[3] = 0; volIndex[3] < static_cast<IndexValueType>(size[3]); ++volIndex[3])
+  constexpr size_t tileSize = 64;
+  for (size_t rowStart = 0; rowStart < rows; rowStart += tileSize)
   {
-    for (volIndex[2] = 0; volIndex[2] < static_cast<IndexValueType>(size[2]); ++volIndex[2])
+    const size_t rowEnd = std::min(rows, rowStart + tileSize);
+    for (size_t columnStart = 0; columnStart < columns; columnStart += tileSize)
     {
-      vecIndex[2] = volIndex[2];
-      for (volIndex[1] = 0; volIndex[1] < static_cast<IndexValueType>(size[1]); ++volIndex[1])
+      const size_t columnEnd = std::min(columns, columnStart + tileSize);
+      for (size_t column = columnStart; column < columnEnd; ++column)
       {
-        vecIndex[1] = volIndex[1];
-        for (volIndex[0] = 0; volIndex[0] < static_cast<IndexValueType>(size[0]); ++volIndex[0])
+        const TPixel * in = source + rowStart * columns + column;
+        TPixel *       out = target + column * rows + rowStart;
+        for (size_t row = rowStart; row < rowEnd; ++row, in += columns, ++out)
         {
-          vecIndex[0] = volIndex[0];
-          scalarImage->SetPixel(volIndex, vecImage->GetPixel(vecIndex)[volIndex[3]]);
+          *out = *in;
         }
       }
     }
   }
-} // end reorganize
+}
 
 /** Copy image data. In order for C++ function signature matching to
  * work properly, the function is templated over type, and it needs to
@@ -179,16 +126,27 @@ CopyImageData(typename TImage::Pointer & im, void * target, unsigned long numPix
   std::copy(data, data + numPixels, static_cast<PixelType *>(target));
 }
 
+/** A VectorImage stores the components of a voxel together, the Matlab
+ * array stores one volume per component (the 4D image with the components
+ * on the last axis), so the voxel x component buffer is transposed straight
+ * into the Matlab array.
+ */
+template <typename TPixel>
+void
+CopyVectorImageData(typename itk::VectorImage<TPixel, 3>::Pointer & im, void * target, unsigned long numPixels)
+{
+  const size_t numComponents = im->GetNumberOfComponentsPerPixel();
+  BlockedTranspose<TPixel>(
+    im->GetBufferPointer(), static_cast<TPixel *>(target), numPixels / numComponents, numComponents);
+}
+
 template <>
 void
 CopyImageData<itk::VectorImage<double, 3>>(itk::VectorImage<double, 3>::Pointer & im,
                                            void *                                 target,
                                            unsigned long                          numPixels)
 {
-  using ScalarImageType = itk::Image<double, 4>;
-  ScalarImageType::Pointer newImage;
-  Reorganize<double>(im, newImage);
-  CopyImageData<ScalarImageType>(newImage, target, numPixels);
+  CopyVectorImageData<double>(im, target, numPixels);
 }
 
 template <>
@@ -197,10 +155,7 @@ CopyImageData<itk::VectorImage<float, 3>>(itk::VectorImage<float, 3>::Pointer &
                                           void *                                target,
                                           unsigned long                         numPixels)
 {
-  using ScalarImageType = itk::Image<float, 4>;
-  ScalarImageType::Pointer newImage;
-  Reorganize<float>(im, newImage);
-  CopyImageData<ScalarImageType>(newImage, target, numPixels);
+  CopyVectorImageData<float>(im, target, numPixels);
 }
 
 template <>
@@ -209,10 +164,7 @@ CopyImageData<itk::VectorImage<short, 3>>(itk::VectorImage<short, 3>::Pointer &
                                           void *                                target,
                                           unsigned long                         numPixels)
 {
-  using ScalarImageType = itk::Image<short, 4>;
-  ScalarImageType::Pointer newImage;
-  Reorganize<short>(im, newImage);
-  CopyImageData<ScalarImageType>(newImage, target, numPixels);
+  CopyVectorImageData<short>(im, target, numPixels);
 }
 
 // build the matlab DWI image structure. This should work as well for non-DWI images
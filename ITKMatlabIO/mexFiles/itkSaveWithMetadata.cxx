@@ -109,20 +109,9 @@ WriteITKImageFromMatlabStructure(const MatlabStructManager & msm, const char * f
   const unsigned int           numDims = msm.GetNumberOfDimensions("data");
   const mwSize * const         mSize = msm.GetDimensions("data");
   typename ImageType::SizeType itkSize;
-  size_t                       numPixels = 1;
+  for (unsigned int axIdx = 0; axIdx < ImageType::ImageDimension; axIdx++)
   {
-    unsigned int axIdx;
-    for (axIdx = 0; axIdx < ImageType::ImageDimension; axIdx++)
-    {
-      itkSize[axIdx] = mSize[axIdx];
-      numPixels *= itkSize[axIdx];
-    }
-
-    //???? this code has problem, it should never be executed. by Hui Xie
-    if (axIdx < numDims)
-    {
-      numPixels *= mSize[axIdx];
-    }
+    itkSize[axIdx] = mSize[axIdx];
   }
 
   /** spaceorigin **/
@@ -219,14 +208,14 @@ WriteITKImageFromMatlabStructure(const MatlabStructManager & msm, const char * f
     ComponentsPerPixel = mSize[ImageType::ImageDimension];
     SetNumberOfComponentsPerPixel<ImageType>(im, ComponentsPerPixel);
   }
-  im->Allocate();
   const mxArray * const dataMx = msm.GetField("data");
   // Note: Matlab returns the internal value types, not a vector of those types.
-  const typename TImage::InternalPixelType * voxels =
-    static_cast<typename TImage::InternalPixelType *>(mxGetData(dataMx));
-  {
-    std::copy(voxels, voxels + numPixels * ComponentsPerPixel, im->GetBufferPointer());
-  }
+  typename TImage::InternalPixelType * voxels = static_cast<typename TImage::InternalPixelType *>(mxGetData(dataMx));
+  // The column major Matlab array has the layout of the ITK buffer, so the
+  // writer reads it in place instead of from a copy.  Matlab keeps
+  // ownership, and the writer does not modify the buffer.
+  im->GetPixelContainer()->SetImportPointer(
+    voxels, im->GetLargestPossibleRegion().GetNumberOfPixels() * ComponentsPerPixel, false);
 
   itk::MetaDataDictionary & thisDic = im->GetMetaDataDictionary();
 